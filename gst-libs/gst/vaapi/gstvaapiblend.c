@@ -36,8 +36,25 @@ struct _GstVaapiBlend
 
   VAConfigID va_config;
   VAContextID va_context;
+  GRecMutex mutex;              /* protects va_context */
 
   guint32 flags;
+
+  /* per-layer parameter buffers, reused across frames */
+  GArray *layer_buffers;
+  GArray *layers;
+  guint max_batch;              /* layers per vaRenderPicture() call */
+};
+
+typedef struct _GstVaapiBlendLayer GstVaapiBlendLayer;
+struct _GstVaapiBlendLayer
+{
+  VASurfaceID surface;
+  VARectangle src_rect;
+  VARectangle dst_rect;
+#if VA_CHECK_VERSION(1,1,0)
+  VABlendState blend_state;
+#endif
 };
 
 typedef struct _GstVaapiBlendClass GstVaapiBlendClass;
@@ -104,11 +121,17 @@ static void
 gst_vaapi_blend_finalize (GObject * object)
 {
   GstVaapiBlend *const blend = GST_VAAPI_BLEND (object);
+  guint i;
 
   if (!blend->display)
     goto bail;
 
-  GST_VAAPI_DISPLAY_LOCK (blend->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (blend->display, &blend->mutex);
+
+  for (i = 0; i < blend->layer_buffers->len; i++) {
+    vaapi_destroy_buffer (GST_VAAPI_DISPLAY_VADISPLAY (blend->display),
+        &g_array_index (blend->layer_buffers, VABufferID, i));
+  }
 
   if (blend->va_context != VA_INVALID_ID) {
     vaDestroyContext (GST_VAAPI_DISPLAY_VADISPLAY (blend->display),
@@ -122,11 +145,15 @@ gst_vaapi_blend_finalize (GObject * object)
     blend->va_config = VA_INVALID_ID;
   }
 
-  GST_VAAPI_DISPLAY_UNLOCK (blend->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (blend->display, &blend->mutex);
 
   gst_vaapi_display_replace (&blend->display, NULL);
 
 bail:
+  g_array_unref (blend->layer_buffers);
+  g_array_unref (blend->layers);
+  g_rec_mutex_clear (&blend->mutex);
+
   G_OBJECT_CLASS (gst_vaapi_blend_parent_class)->finalize (object);
 }
 
@@ -152,6 +179,10 @@ gst_vaapi_blend_init (GstVaapiBlend * blend)
   blend->va_config = VA_INVALID_ID;
   blend->va_context = VA_INVALID_ID;
   blend->flags = 0;
+  blend->layer_buffers = g_array_new (FALSE, FALSE, sizeof (VABufferID));
+  blend->layers = g_array_new (FALSE, TRUE, sizeof (GstVaapiBlendLayer));
+  blend->max_batch = G_MAXUINT;
+  g_rec_mutex_init (&blend->mutex);
 }
 
 static gboolean
@@ -214,85 +245,186 @@ gst_vaapi_blend_replace (GstVaapiBlend ** old_blend_ptr,
   gst_object_replace ((GstObject **) old_blend_ptr, GST_OBJECT (new_blend));
 }
 
+/* Fetches all the layers from @next, and validates their regions */
 static gboolean
-gst_vaapi_blend_process_unlocked (GstVaapiBlend * blend,
-    GstVaapiSurface * output, GstVaapiBlendSurfaceNextFunc next,
-    gpointer user_data)
+gst_vaapi_blend_collect_layers (GstVaapiBlend * blend,
+    GstVaapiBlendSurfaceNextFunc next, gpointer user_data)
 {
-  VAStatus va_status;
-  VADisplay va_display;
   GstVaapiBlendSurface *current;
 
-  va_display = GST_VAAPI_DISPLAY_VADISPLAY (blend->display);
-
-  va_status = vaBeginPicture (va_display, blend->va_context,
-      GST_VAAPI_SURFACE_ID (output));
-  if (!vaapi_check_status (va_status, "vaBeginPicture()"))
-    return FALSE;
+  g_array_set_size (blend->layers, 0);
 
   current = next (user_data);
   for (; current; current = next (user_data)) {
-    VAProcPipelineParameterBuffer *param = NULL;
-    VABufferID id = VA_INVALID_ID;
-    VARectangle src_rect = { 0, };
-    VARectangle dst_rect = { 0, };
-#if VA_CHECK_VERSION(1,1,0)
-    VABlendState blend_state;
-#endif
+    GstVaapiBlendLayer *layer;
 
     if (!current->surface)
       return FALSE;
 
+    g_array_set_size (blend->layers, blend->layers->len + 1);
+    layer = &g_array_index (blend->layers, GstVaapiBlendLayer,
+        blend->layers->len - 1);
+    layer->surface = GST_VAAPI_SURFACE_ID (current->surface);
+
     /* Build surface region (source) */
-    src_rect.width = GST_VAAPI_SURFACE_WIDTH (current->surface);
-    src_rect.height = GST_VAAPI_SURFACE_HEIGHT (current->surface);
+    layer->src_rect.width = GST_VAAPI_SURFACE_WIDTH (current->surface);
+    layer->src_rect.height = GST_VAAPI_SURFACE_HEIGHT (current->surface);
     if (current->crop) {
-      if ((current->crop->x + current->crop->width > src_rect.width) ||
-          (current->crop->y + current->crop->height > src_rect.height))
+      if ((current->crop->x + current->crop->width > layer->src_rect.width) ||
+          (current->crop->y + current->crop->height > layer->src_rect.height))
         return FALSE;
-      src_rect.x = current->crop->x;
-      src_rect.y = current->crop->y;
-      src_rect.width = current->crop->width;
-      src_rect.height = current->crop->height;
+      layer->src_rect.x = current->crop->x;
+      layer->src_rect.y = current->crop->y;
+      layer->src_rect.width = current->crop->width;
+      layer->src_rect.height = current->crop->height;
     }
 
     /* Build output region (target) */
-    dst_rect.x = current->target.x;
-    dst_rect.y = current->target.y;
-    dst_rect.width = current->target.width;
-    dst_rect.height = current->target.height;
-
-    if (!vaapi_create_buffer (va_display, blend->va_context,
-            VAProcPipelineParameterBufferType, sizeof (*param), NULL, &id,
-            (gpointer *) & param))
+    layer->dst_rect.x = current->target.x;
+    layer->dst_rect.y = current->target.y;
+    layer->dst_rect.width = current->target.width;
+    layer->dst_rect.height = current->target.height;
+
+#if VA_CHECK_VERSION(1,1,0)
+    layer->blend_state.flags = VA_BLEND_GLOBAL_ALPHA;
+    layer->blend_state.global_alpha = current->alpha;
+#endif
+  }
+
+  return TRUE;
+}
+
+/* Fills one pipeline parameter buffer per layer. The buffers are
+ * created on first use and kept for the next frames */
+static gboolean
+gst_vaapi_blend_fill_layer_buffers (GstVaapiBlend * blend)
+{
+  VADisplay va_display = GST_VAAPI_DISPLAY_VADISPLAY (blend->display);
+  GArray *const buffers = blend->layer_buffers;
+  guint i;
+
+  for (i = 0; i < blend->layers->len; i++) {
+    GstVaapiBlendLayer *const layer =
+        &g_array_index (blend->layers, GstVaapiBlendLayer, i);
+    VAProcPipelineParameterBuffer *param;
+    VABufferID id = VA_INVALID_ID;
+
+    if (i == buffers->len) {
+      if (!vaapi_create_buffer (va_display, blend->va_context,
+              VAProcPipelineParameterBufferType, sizeof (*param), NULL, &id,
+              NULL))
+        return FALSE;
+      g_array_append_val (buffers, id);
+    }
+    id = g_array_index (buffers, VABufferID, i);
+
+    param = vaapi_map_buffer (va_display, id);
+    if (!param)
       return FALSE;
 
     memset (param, 0, sizeof (*param));
 
-    param->surface = GST_VAAPI_SURFACE_ID (current->surface);
-    param->surface_region = &src_rect;
-    param->output_region = &dst_rect;
+    param->surface = layer->surface;
+    param->surface_region = &layer->src_rect;
+    param->output_region = &layer->dst_rect;
     param->output_background_color = 0xff000000;
 
 #if VA_CHECK_VERSION(1,1,0)
-    blend_state.flags = VA_BLEND_GLOBAL_ALPHA;
-    blend_state.global_alpha = current->alpha;
-    param->blend_state = &blend_state;
+    param->blend_state = &layer->blend_state;
 #endif
 
     vaapi_unmap_buffer (va_display, id, NULL);
+  }
 
-    va_status = vaRenderPicture (va_display, blend->va_context, &id, 1);
-    vaapi_destroy_buffer (va_display, &id);
-    if (!vaapi_check_status (va_status, "vaRenderPicture()"))
-      return FALSE;
+  return TRUE;
+}
+
+/* Whether @va_status comes from a driver limiting the number of
+ * pipeline buffers per vaRenderPicture() call */
+static inline gboolean
+is_batch_size_error (VAStatus va_status)
+{
+  return va_status == VA_STATUS_ERROR_MAX_NUM_EXCEEDED ||
+      va_status == VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+/* Submits all the layers of the current picture, in batches of at
+ * most max_batch layers per vaRenderPicture() call. A batch the driver
+ * rejects for its size is submitted again in smaller batches, within
+ * the same picture, and the smaller size is kept for the next frames
+ * once the picture went through */
+static VAStatus
+gst_vaapi_blend_render_layers (GstVaapiBlend * blend)
+{
+  VADisplay va_display = GST_VAAPI_DISPLAY_VADISPLAY (blend->display);
+  VABufferID *const ids = (VABufferID *) blend->layer_buffers->data;
+  const guint num_layers = blend->layers->len;
+  guint max_batch = blend->max_batch;
+  VAStatus va_status;
+  guint i, batch;
+
+  for (i = 0; i < num_layers; i += batch) {
+    batch = MIN (max_batch, num_layers - i);
+
+    va_status = vaRenderPicture (va_display, blend->va_context, ids + i,
+        batch);
+    if (va_status == VA_STATUS_SUCCESS)
+      continue;
+    if (batch < 2 || !is_batch_size_error (va_status))
+      return va_status;
+
+    max_batch = batch / 2;
+    GST_WARNING_OBJECT (blend, "vaRenderPicture() failed with %u layers (%s), "
+        "retrying with at most %u per call", batch, vaErrorStr (va_status),
+        max_batch);
+    batch = 0;
   }
 
+  blend->max_batch = max_batch;
+  return VA_STATUS_SUCCESS;
+}
+
+static gboolean
+gst_vaapi_blend_process_unlocked (GstVaapiBlend * blend,
+    GstVaapiSurface * output, GstVaapiBlendSurfaceNextFunc next,
+    gpointer user_data)
+{
+  VAStatus va_status;
+  VADisplay va_display;
+
+  va_display = GST_VAAPI_DISPLAY_VADISPLAY (blend->display);
+
+  /* build all the parameter buffers up front, so that the layers can
+   * be submitted together */
+  if (!gst_vaapi_blend_collect_layers (blend, next, user_data))
+    return FALSE;
+
+  if (!gst_vaapi_blend_fill_layer_buffers (blend))
+    return FALSE;
+
+  va_status = vaBeginPicture (va_display, blend->va_context,
+      GST_VAAPI_SURFACE_ID (output));
+  if (!vaapi_check_status (va_status, "vaBeginPicture()"))
+    return FALSE;
+
+  va_status = gst_vaapi_blend_render_layers (blend);
+  if (va_status != VA_STATUS_SUCCESS)
+    goto error_render_picture;
+
   va_status = vaEndPicture (va_display, blend->va_context);
   if (!vaapi_check_status (va_status, "vaEndPicture()"))
     return FALSE;
 
   return TRUE;
+
+  /* ERRORS */
+error_render_picture:
+  {
+    vaapi_check_status (va_status, "vaRenderPicture()");
+    /* close the picture, so that the context can take the next one */
+    vaEndPicture (va_display, blend->va_context);
+    return FALSE;
+  }
 }
 
 /**
@@ -318,9 +450,9 @@ gst_vaapi_blend_process (GstVaapiBlend * blend, GstVaapiSurface * output,
   g_return_val_if_fail (output != NULL, FALSE);
   g_return_val_if_fail (next != NULL, FALSE);
 
-  GST_VAAPI_DISPLAY_LOCK (blend->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (blend->display, &blend->mutex);
   result = gst_vaapi_blend_process_unlocked (blend, output, next, user_data);
-  GST_VAAPI_DISPLAY_UNLOCK (blend->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (blend->display, &blend->mutex);
 
   return result;
 }
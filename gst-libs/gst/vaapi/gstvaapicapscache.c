@@ -0,0 +1,366 @@
+/*
+ *  gstvaapicapscache.c - On-disk cache of VA driver capabilities
+ *
+ *  Copyright (C) 2021 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:gstvaapicapscache
+ * @short_description: On-disk cache of VA driver capabilities
+ *
+ * Probing the VA profiles, entrypoints and image formats of a driver
+ * is noticeably slow, and it is done again by every process and for
+ * every display. The capabilities are thus saved into the user cache
+ * directory, keyed by the driver vendor string, the VA-API version
+ * and the device, so that next displays can skip the driver queries.
+ *
+ * The cache can be disabled by setting the GST_VAAPI_DISABLE_CAPS_CACHE
+ * environment variable.
+ */
+
+#include "sysdeps.h"
+#include "gstvaapicapscache.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+#define CAPS_CACHE_DISABLE_ENV  "GST_VAAPI_DISABLE_CAPS_CACHE"
+#define CAPS_CACHE_GROUP        "capabilities"
+#define CAPS_CACHE_VERSION      1
+
+/* Number of integers needed to serialize a VAImageFormat */
+#define IMAGE_FORMAT_N_FIELDS   8
+
+static gchar *
+caps_cache_get_dirname (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "gstreamer-1.0", "vaapi",
+      NULL);
+}
+
+static GArray *
+load_integer_list (GKeyFile * key_file, const gchar * name, guint multiple)
+{
+  GError *error = NULL;
+  GArray *array;
+  gint *values;
+  gsize length = 0;
+
+  if (!g_key_file_has_key (key_file, CAPS_CACHE_GROUP, name, NULL))
+    return NULL;
+
+  values = g_key_file_get_integer_list (key_file, CAPS_CACHE_GROUP, name,
+      &length, &error);
+  if (error) {
+    GST_WARNING ("invalid \"%s\" entry: %s", name, error->message);
+    g_error_free (error);
+    return NULL;
+  }
+  if (length % multiple) {
+    g_free (values);
+    return NULL;
+  }
+
+  array = g_array_sized_new (FALSE, FALSE, sizeof (gint), length);
+  g_array_append_vals (array, values, length);
+  g_free (values);
+  return array;
+}
+
+static void
+save_integer_list (GKeyFile * key_file, const gchar * name, GArray * array)
+{
+  if (!array)
+    return;
+  g_key_file_set_integer_list (key_file, CAPS_CACHE_GROUP, name,
+      (gint *) array->data, array->len);
+}
+
+static GArray *
+image_formats_from_integers (GArray * values)
+{
+  GArray *formats;
+  guint i;
+
+  formats = g_array_sized_new (FALSE, FALSE, sizeof (VAImageFormat),
+      values->len / IMAGE_FORMAT_N_FIELDS);
+
+  for (i = 0; i < values->len; i += IMAGE_FORMAT_N_FIELDS) {
+    const gint *const v = &g_array_index (values, gint, i);
+    VAImageFormat format = { 0, };
+
+    format.fourcc = (guint) v[0];
+    format.byte_order = (guint) v[1];
+    format.bits_per_pixel = (guint) v[2];
+    format.depth = (guint) v[3];
+    format.red_mask = (guint) v[4];
+    format.green_mask = (guint) v[5];
+    format.blue_mask = (guint) v[6];
+    format.alpha_mask = (guint) v[7];
+    g_array_append_val (formats, format);
+  }
+  return formats;
+}
+
+static GArray *
+image_formats_to_integers (GArray * formats)
+{
+  GArray *values;
+  guint i;
+
+  values = g_array_sized_new (FALSE, FALSE, sizeof (gint),
+      formats->len * IMAGE_FORMAT_N_FIELDS);
+
+  for (i = 0; i < formats->len; i++) {
+    const VAImageFormat *const f = &g_array_index (formats, VAImageFormat, i);
+    const gint v[IMAGE_FORMAT_N_FIELDS] = {
+      f->fourcc, f->byte_order, f->bits_per_pixel, f->depth,
+      f->red_mask, f->green_mask, f->blue_mask, f->alpha_mask
+    };
+
+    g_array_append_vals (values, v, IMAGE_FORMAT_N_FIELDS);
+  }
+  return values;
+}
+
+static void
+caps_cache_load_configs (GstVaapiCapsCache * cache, GKeyFile * key_file)
+{
+  GArray *profiles, *entrypoints;
+  guint i;
+
+  profiles = load_integer_list (key_file, "profiles", 1);
+  entrypoints = load_integer_list (key_file, "entrypoints", 1);
+  if (!profiles || !entrypoints || profiles->len != entrypoints->len)
+    goto bail;
+
+  cache->configs = g_array_sized_new (FALSE, FALSE,
+      sizeof (GstVaapiCapsCacheConfig), profiles->len);
+  for (i = 0; i < profiles->len; i++) {
+    GstVaapiCapsCacheConfig config;
+
+    config.profile = g_array_index (profiles, gint, i);
+    config.entrypoints = g_array_index (entrypoints, gint, i);
+    g_array_append_val (cache->configs, config);
+  }
+
+bail:
+  g_clear_pointer (&profiles, g_array_unref);
+  g_clear_pointer (&entrypoints, g_array_unref);
+}
+
+static void
+caps_cache_load_formats (GstVaapiCapsCache * cache, GKeyFile * key_file)
+{
+  GArray *values;
+
+  values = load_integer_list (key_file, "image-formats", IMAGE_FORMAT_N_FIELDS);
+  if (values) {
+    cache->image_formats = image_formats_from_integers (values);
+    g_array_unref (values);
+  }
+
+  values = load_integer_list (key_file, "subpicture-formats",
+      IMAGE_FORMAT_N_FIELDS);
+  if (!values)
+    return;
+
+  cache->subpicture_flags = load_integer_list (key_file, "subpicture-flags", 1);
+  if (cache->subpicture_flags &&
+      cache->subpicture_flags->len * IMAGE_FORMAT_N_FIELDS == values->len)
+    cache->subpicture_formats = image_formats_from_integers (values);
+  else
+    g_clear_pointer (&cache->subpicture_flags, g_array_unref);
+  g_array_unref (values);
+}
+
+static void
+caps_cache_load (GstVaapiCapsCache * cache)
+{
+  GKeyFile *key_file;
+  gchar *key = NULL;
+  gint version;
+
+  key_file = g_key_file_new ();
+  if (!g_key_file_load_from_file (key_file, cache->filename, G_KEY_FILE_NONE,
+          NULL))
+    goto bail;
+
+  version = g_key_file_get_integer (key_file, CAPS_CACHE_GROUP, "version",
+      NULL);
+  key = g_key_file_get_string (key_file, CAPS_CACHE_GROUP, "key", NULL);
+  if (version != CAPS_CACHE_VERSION || g_strcmp0 (key, cache->key) != 0) {
+    GST_INFO ("ignoring stale capabilities cache %s", cache->filename);
+    goto bail;
+  }
+
+  caps_cache_load_configs (cache, key_file);
+  caps_cache_load_formats (cache, key_file);
+  GST_INFO ("loaded capabilities cache %s", cache->filename);
+
+bail:
+  g_free (key);
+  g_key_file_free (key_file);
+}
+
+/**
+ * gst_vaapi_caps_cache_new:
+ * @vendor_string: the VA driver vendor string
+ * @device_name: (nullable): the name of the device the driver runs on
+ * @va_major_version: the major version of the VA-API runtime
+ * @va_minor_version: the minor version of the VA-API runtime
+ *
+ * Creates a capabilities snapshot for the VA driver identified by
+ * @vendor_string on @device_name, and fills it in from the on-disk
+ * cache if a matching entry exists. The entries are keyed on the
+ * versions of the runtime and the driver, as reported by
+ * vaInitialize() and vaQueryVendorString(), so that upgrading either
+ * of them invalidates the cache.
+ *
+ * Return value: the newly allocated #GstVaapiCapsCache, or %NULL if
+ *   the cache is disabled
+ */
+GstVaapiCapsCache *
+gst_vaapi_caps_cache_new (const gchar * vendor_string,
+    const gchar * device_name, gint va_major_version, gint va_minor_version)
+{
+  GstVaapiCapsCache *cache;
+  gchar *dirname, *checksum, *basename;
+
+  g_return_val_if_fail (vendor_string != NULL, NULL);
+
+  if (g_getenv (CAPS_CACHE_DISABLE_ENV))
+    return NULL;
+
+  cache = g_new0 (GstVaapiCapsCache, 1);
+  cache->key = g_strdup_printf ("%s|%s|%d.%d|%s", vendor_string,
+      GST_STR_NULL (device_name), va_major_version, va_minor_version,
+      GST_VAAPI_VERSION_ID);
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, cache->key, -1);
+  basename = g_strdup_printf ("caps-%s.ini", checksum);
+  dirname = caps_cache_get_dirname ();
+  cache->filename = g_build_filename (dirname, basename, NULL);
+  g_free (dirname);
+  g_free (basename);
+  g_free (checksum);
+
+  caps_cache_load (cache);
+  return cache;
+}
+
+/**
+ * gst_vaapi_caps_cache_free:
+ * @cache: a #GstVaapiCapsCache
+ *
+ * Releases the capabilities snapshot. The on-disk cache is not
+ * modified.
+ */
+void
+gst_vaapi_caps_cache_free (GstVaapiCapsCache * cache)
+{
+  if (!cache)
+    return;
+
+  g_clear_pointer (&cache->configs, g_array_unref);
+  g_clear_pointer (&cache->image_formats, g_array_unref);
+  g_clear_pointer (&cache->subpicture_formats, g_array_unref);
+  g_clear_pointer (&cache->subpicture_flags, g_array_unref);
+  g_free (cache->filename);
+  g_free (cache->key);
+  g_free (cache);
+}
+
+/**
+ * gst_vaapi_caps_cache_save:
+ * @cache: a #GstVaapiCapsCache
+ *
+ * Atomically writes the capabilities that were filled in so far to
+ * the on-disk cache.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+gst_vaapi_caps_cache_save (GstVaapiCapsCache * cache)
+{
+  GKeyFile *key_file;
+  GError *error = NULL;
+  GArray *profiles, *entrypoints, *values;
+  gchar *dirname;
+  gboolean success = FALSE;
+  guint i;
+
+  g_return_val_if_fail (cache != NULL, FALSE);
+
+  key_file = g_key_file_new ();
+  g_key_file_set_integer (key_file, CAPS_CACHE_GROUP, "version",
+      CAPS_CACHE_VERSION);
+  g_key_file_set_string (key_file, CAPS_CACHE_GROUP, "key", cache->key);
+
+  if (cache->configs) {
+    profiles = g_array_sized_new (FALSE, FALSE, sizeof (gint),
+        cache->configs->len);
+    entrypoints = g_array_sized_new (FALSE, FALSE, sizeof (gint),
+        cache->configs->len);
+    for (i = 0; i < cache->configs->len; i++) {
+      const GstVaapiCapsCacheConfig *const config =
+          &g_array_index (cache->configs, GstVaapiCapsCacheConfig, i);
+      const gint profile = config->profile;
+      const gint entrypoint_mask = config->entrypoints;
+
+      g_array_append_val (profiles, profile);
+      g_array_append_val (entrypoints, entrypoint_mask);
+    }
+    save_integer_list (key_file, "profiles", profiles);
+    save_integer_list (key_file, "entrypoints", entrypoints);
+    g_array_unref (profiles);
+    g_array_unref (entrypoints);
+  }
+
+  if (cache->image_formats) {
+    values = image_formats_to_integers (cache->image_formats);
+    save_integer_list (key_file, "image-formats", values);
+    g_array_unref (values);
+  }
+
+  if (cache->subpicture_formats && cache->subpicture_flags) {
+    values = image_formats_to_integers (cache->subpicture_formats);
+    save_integer_list (key_file, "subpicture-formats", values);
+    save_integer_list (key_file, "subpicture-flags", cache->subpicture_flags);
+    g_array_unref (values);
+  }
+
+  dirname = caps_cache_get_dirname ();
+  if (g_mkdir_with_parents (dirname, 0755) < 0) {
+    GST_WARNING ("failed to create directory %s", dirname);
+    goto bail;
+  }
+
+  if (!g_key_file_save_to_file (key_file, cache->filename, &error)) {
+    GST_WARNING ("failed to save capabilities cache: %s", error->message);
+    g_error_free (error);
+    goto bail;
+  }
+  GST_DEBUG ("saved capabilities cache %s", cache->filename);
+  success = TRUE;
+
+bail:
+  g_free (dirname);
+  g_key_file_free (key_file);
+  return success;
+}
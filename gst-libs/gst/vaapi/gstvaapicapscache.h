@@ -0,0 +1,87 @@
+/*
+ *  gstvaapicapscache.h - On-disk cache of VA driver capabilities
+ *
+ *  Copyright (C) 2021 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_CAPS_CACHE_H
+#define GST_VAAPI_CAPS_CACHE_H
+
+#include <glib.h>
+#include <va/va.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVaapiCapsCache               GstVaapiCapsCache;
+typedef struct _GstVaapiCapsCacheConfig         GstVaapiCapsCacheConfig;
+
+/**
+ * GstVaapiCapsCacheConfig:
+ * @profile: the VA profile
+ * @entrypoints: bits map of the VAEntrypoint supported for @profile
+ *
+ * A raw VA profile/entrypoints pair, as reported by the driver.
+ */
+struct _GstVaapiCapsCacheConfig
+{
+  VAProfile profile;
+  guint32 entrypoints;
+};
+
+/**
+ * GstVaapiCapsCache:
+ * @configs: (element-type GstVaapiCapsCacheConfig): VA profiles and
+ *   their entrypoints, including VAProfileNone
+ * @image_formats: (element-type VAImageFormat): VA image formats
+ * @subpicture_formats: (element-type VAImageFormat): VA subpicture formats
+ * @subpicture_flags: (element-type guint): VA subpicture flags, one
+ *   per subpicture format
+ *
+ * A snapshot of the capabilities of a VA driver on a given device.
+ * Each array is %NULL until filled in, either from the on-disk cache
+ * or from the driver.
+ */
+struct _GstVaapiCapsCache
+{
+  /*< private >*/
+  gchar *key;
+  gchar *filename;
+
+  /*< public >*/
+  GArray *configs;
+  GArray *image_formats;
+  GArray *subpicture_formats;
+  GArray *subpicture_flags;
+};
+
+G_GNUC_INTERNAL
+GstVaapiCapsCache *
+gst_vaapi_caps_cache_new (const gchar * vendor_string,
+    const gchar * device_name, gint va_major_version, gint va_minor_version);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_caps_cache_free (GstVaapiCapsCache * cache);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_caps_cache_save (GstVaapiCapsCache * cache);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_CAPS_CACHE_H */
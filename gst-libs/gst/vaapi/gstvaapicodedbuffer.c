@@ -25,6 +25,7 @@
 #include "gstvaapicodedbuffer.h"
 #include "gstvaapicodedbuffer_priv.h"
 #include "gstvaapiencoder_priv.h"
+#include "gstvaapidisplay_priv.h"
 #include "gstvaapiutils.h"
 
 #define DEBUG 1
@@ -80,11 +81,11 @@ coded_buffer_map (GstVaapiCodedBuffer * buf)
   if (buf->segment_list)
     return TRUE;
 
-  GST_VAAPI_DISPLAY_LOCK (display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (display, NULL);
   buf->segment_list =
       vaapi_map_buffer (GST_VAAPI_DISPLAY_VADISPLAY (display),
       GST_VAAPI_CODED_BUFFER_ID (buf));
-  GST_VAAPI_DISPLAY_UNLOCK (display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (display, NULL);
   return buf->segment_list != NULL;
 }
 
@@ -96,10 +97,10 @@ coded_buffer_unmap (GstVaapiCodedBuffer * buf)
   if (!buf->segment_list)
     return;
 
-  GST_VAAPI_DISPLAY_LOCK (display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (display, NULL);
   vaapi_unmap_buffer (GST_VAAPI_DISPLAY_VADISPLAY (display),
       GST_VAAPI_CODED_BUFFER_ID (buf), (void **) &buf->segment_list);
-  GST_VAAPI_DISPLAY_UNLOCK (display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (display, NULL);
 }
 
 GST_DEFINE_MINI_OBJECT_TYPE (GstVaapiCodedBuffer, gst_vaapi_coded_buffer);
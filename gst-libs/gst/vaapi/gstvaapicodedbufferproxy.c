@@ -93,6 +93,9 @@ gst_vaapi_coded_buffer_proxy_new_from_pool (GstVaapiCodedBufferPool * pool)
 
   proxy->destroy_func = NULL;
   proxy->user_data_destroy = NULL;
+  proxy->num_temporal_layers = 0;
+  proxy->new_rate_control = FALSE;
+  proxy->has_stats = FALSE;
   proxy->pool = gst_vaapi_video_pool_ref (GST_VAAPI_VIDEO_POOL (pool));
   proxy->buffer = gst_vaapi_video_pool_get_object (proxy->pool);
   if (!proxy->buffer)
@@ -254,3 +257,82 @@ gst_vaapi_coded_buffer_proxy_set_user_data (GstVaapiCodedBufferProxy * proxy,
 
   coded_buffer_proxy_set_user_data (proxy, user_data, destroy_func);
 }
+
+/**
+ * gst_vaapi_coded_buffer_proxy_get_temporal_layer:
+ * @proxy: a #GstVaapiCodedBufferProxy
+ * @temporal_id: (out) (optional): return location for the temporal
+ *   layer of the coded frame
+ * @num_layers: (out) (optional): return location for the number of
+ *   temporal layers of the stream
+ * @layer_sync: (out) (optional): return location for whether the
+ *   coded frame only references base layer frames
+ *
+ * Gets the temporal layer of the coded frame held by @proxy, for the
+ * encoders producing temporal layers.
+ *
+ * Return value: %TRUE if the stream has temporal layers
+ */
+gboolean
+gst_vaapi_coded_buffer_proxy_get_temporal_layer (GstVaapiCodedBufferProxy *
+    proxy, guint * temporal_id, guint * num_layers, gboolean * layer_sync)
+{
+  g_return_val_if_fail (proxy != NULL, FALSE);
+
+  if (proxy->num_temporal_layers == 0)
+    return FALSE;
+
+  if (temporal_id)
+    *temporal_id = proxy->temporal_id;
+  if (num_layers)
+    *num_layers = proxy->num_temporal_layers;
+  if (layer_sync)
+    *layer_sync = proxy->layer_sync;
+  return TRUE;
+}
+
+/**
+ * gst_vaapi_coded_buffer_proxy_has_new_rate_control:
+ * @proxy: a #GstVaapiCodedBufferProxy
+ *
+ * Checks whether the coded frame held by @proxy is the first one
+ * encoded with the rate control parameters updated while the encoder
+ * was running, e.g. a new bitrate: the decoder buffer they describe
+ * applies from this frame on.
+ *
+ * Return value: %TRUE if the rate control changed with this frame
+ */
+gboolean
+gst_vaapi_coded_buffer_proxy_has_new_rate_control (GstVaapiCodedBufferProxy *
+    proxy)
+{
+  g_return_val_if_fail (proxy != NULL, FALSE);
+
+  return proxy->new_rate_control;
+}
+
+/**
+ * gst_vaapi_coded_buffer_proxy_get_stats:
+ * @proxy: a #GstVaapiCodedBufferProxy
+ * @stats: (out caller-allocates): return location for the statistics
+ *   of the coded frame
+ *
+ * Gets the statistics of the coded frame held by @proxy, collected
+ * when the "frame-stats" or "stats-interval" property of the encoder
+ * is set.
+ *
+ * Return value: %TRUE if the statistics of the frame were collected
+ */
+gboolean
+gst_vaapi_coded_buffer_proxy_get_stats (GstVaapiCodedBufferProxy * proxy,
+    GstVaapiEncoderFrameStats * stats)
+{
+  g_return_val_if_fail (proxy != NULL, FALSE);
+  g_return_val_if_fail (stats != NULL, FALSE);
+
+  if (!proxy->has_stats)
+    return FALSE;
+
+  *stats = proxy->stats;
+  return TRUE;
+}
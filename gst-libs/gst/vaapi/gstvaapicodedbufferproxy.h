@@ -25,6 +25,7 @@
 
 #include <gst/vaapi/gstvaapicodedbuffer.h>
 #include <gst/vaapi/gstvaapicodedbufferpool.h>
+#include <gst/vaapi/gstvaapiencoder_stats.h>
 
 G_BEGIN_DECLS
 
@@ -77,6 +78,18 @@ void
 gst_vaapi_coded_buffer_proxy_set_user_data (GstVaapiCodedBufferProxy * proxy,
     gpointer user_data, GDestroyNotify destroy_func);
 
+gboolean
+gst_vaapi_coded_buffer_proxy_get_temporal_layer (GstVaapiCodedBufferProxy *
+    proxy, guint * temporal_id, guint * num_layers, gboolean * layer_sync);
+
+gboolean
+gst_vaapi_coded_buffer_proxy_has_new_rate_control (GstVaapiCodedBufferProxy *
+    proxy);
+
+gboolean
+gst_vaapi_coded_buffer_proxy_get_stats (GstVaapiCodedBufferProxy * proxy,
+    GstVaapiEncoderFrameStats * stats);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_CODED_BUFFER_PROXY_H */
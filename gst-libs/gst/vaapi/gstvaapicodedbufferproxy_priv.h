@@ -24,6 +24,7 @@
 #define GST_VAAPI_CODED_BUFFER_PROXY_PRIV_H
 
 #include "gstvaapicodedbuffer_priv.h"
+#include "gstvaapiencoder_stats.h"
 #include "gstvaapiminiobject.h"
 
 G_BEGIN_DECLS
@@ -42,6 +43,18 @@ struct _GstVaapiCodedBufferProxy
   gpointer              destroy_data;
   GDestroyNotify        user_data_destroy;
   gpointer              user_data;
+
+  /* temporal layer of the coded frame, if num_temporal_layers > 0 */
+  guint                 temporal_id;
+  guint                 num_temporal_layers;
+  gboolean              layer_sync;
+
+  /* the coded frame is the first one with new rate control parameters */
+  gboolean              new_rate_control;
+
+  /* statistics of the coded frame, if has_stats is set */
+  gboolean              has_stats;
+  GstVaapiEncoderFrameStats stats;
 };
 
 /**
@@ -197,11 +197,11 @@ context_ensure_surfaces (GstVaapiContext * context)
   format = context->preferred_format;
   for (i = context->surfaces->len; i < num_surfaces; i++) {
     if (format != GST_VIDEO_FORMAT_UNKNOWN) {
-      surface = gst_vaapi_surface_new_with_format (display, format, cip->width,
-          cip->height, 0);
+      surface = gst_vaapi_surface_new_with_format (display, format,
+          context->surfaces_width, context->surfaces_height, 0);
     } else {
-      surface = gst_vaapi_surface_new (display, cip->chroma_type, cip->width,
-          cip->height);
+      surface = gst_vaapi_surface_new (display, cip->chroma_type,
+          context->surfaces_width, context->surfaces_height);
     }
     if (!surface)
       return FALSE;
@@ -237,6 +237,8 @@ context_create_surfaces (GstVaapiContext * context)
 
     if (!context->surfaces_pool)
       return FALSE;
+    context->surfaces_width = cip->width;
+    context->surfaces_height = cip->height;
   }
   return context_ensure_surfaces (context);
 }
@@ -509,6 +511,8 @@ gst_vaapi_context_new (GstVaapiDisplay * display,
   g_atomic_int_set (&context->ref_count, 1);
   context->surfaces = NULL;
   context->surfaces_pool = NULL;
+  context->surfaces_width = 0;
+  context->surfaces_height = 0;
 
   gst_vaapi_context_init (context, cip);
 
@@ -573,7 +577,12 @@ gst_vaapi_context_reset (GstVaapiContext * context,
   if (cip->width != new_cip->width || cip->height != new_cip->height) {
     cip->width = new_cip->width;
     cip->height = new_cip->height;
-    reset_surfaces = TRUE;
+    /* an encoder can keep coding into larger surfaces */
+    if (new_cip->usage != GST_VAAPI_CONTEXT_USAGE_ENCODE
+        || context->reset_on_resize || !context->surfaces
+        || cip->width > context->surfaces_width
+        || cip->height > context->surfaces_height)
+      reset_surfaces = TRUE;
   }
 
   if (cip->profile != new_cip->profile ||
@@ -679,7 +688,9 @@ gst_vaapi_context_get_surface_count (GstVaapiContext * context)
  * @reset_on_resize: Should the context be reset on size change
  *
  * Sets whether the underlying context should be reset when a size change
- * happens. The proper setting for this is codec dependent.
+ * happens. The proper setting for this is codec dependent. An encoding
+ * context that is not reset on resize also keeps its surfaces as long
+ * as the new size fits in them.
  */
 void
 gst_vaapi_context_reset_on_resize (GstVaapiContext * context,
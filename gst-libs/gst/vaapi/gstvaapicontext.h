@@ -111,6 +111,8 @@ struct _GstVaapiContext
   VAConfigID va_config;
   GPtrArray *surfaces;
   GstVaapiVideoPool *surfaces_pool;
+  guint surfaces_width;
+  guint surfaces_height;
   gboolean reset_on_resize;
   GstVaapiConfigSurfaceAttributes *attribs;
   GstVideoFormat preferred_format;
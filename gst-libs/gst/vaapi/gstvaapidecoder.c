@@ -33,6 +33,7 @@
 #include "gstvaapidecoder_priv.h"
 #include "gstvaapiparser_frame.h"
 #include "gstvaapisurfaceproxy_priv.h"
+#include "gstvaapitrace.h"
 #include "gstvaapiutils.h"
 
 #define DEBUG 1
@@ -283,11 +284,17 @@ do_decode (GstVaapiDecoder * decoder, GstVideoCodecFrame * base_frame)
 
   ps->current_frame = base_frame;
 
+  gst_vaapi_va_calls_add_frame (&decoder->va_calls);
+  gst_vaapi_va_calls_push (&decoder->va_calls);
   gst_vaapi_parser_frame_ref (frame);
   status = do_decode_1 (decoder, frame);
   gst_vaapi_parser_frame_unref (frame);
+  gst_vaapi_va_calls_pop ();
 
   switch ((guint) status) {
+    case GST_VAAPI_DECODER_STATUS_SUCCESS:
+      GST_VAAPI_TRACE (GST_VAAPI_TRACE_VA_SUBMIT, decoder, base_frame->pts);
+      break;
     case GST_VAAPI_DECODER_STATUS_DROP_FRAME:
       drop_frame (decoder, base_frame);
       status = GST_VAAPI_DECODER_STATUS_SUCCESS;
@@ -353,6 +360,8 @@ decode_step (GstVaapiDecoder * decoder)
     }
 
     if (got_frame) {
+      GST_VAAPI_TRACE (GST_VAAPI_TRACE_PARSE_DONE, decoder,
+          ps->current_frame->pts);
       ps->current_frame->input_buffer =
           gst_adapter_take_buffer (ps->output_adapter,
           gst_adapter_available (ps->output_adapter));
@@ -998,6 +1007,8 @@ gst_vaapi_decoder_parse (GstVaapiDecoder * decoder,
     GstVideoCodecFrame * base_frame, GstAdapter * adapter, gboolean at_eos,
     guint * got_unit_size_ptr, gboolean * got_frame_ptr)
 {
+  GstVaapiDecoderStatus status;
+
   g_return_val_if_fail (decoder != NULL,
       GST_VAAPI_DECODER_STATUS_ERROR_INVALID_PARAMETER);
   g_return_val_if_fail (base_frame != NULL,
@@ -1009,8 +1020,11 @@ gst_vaapi_decoder_parse (GstVaapiDecoder * decoder,
   g_return_val_if_fail (got_frame_ptr != NULL,
       GST_VAAPI_DECODER_STATUS_ERROR_INVALID_PARAMETER);
 
-  return do_parse (decoder, base_frame, adapter, at_eos,
+  status = do_parse (decoder, base_frame, adapter, at_eos,
       got_unit_size_ptr, got_frame_ptr);
+  if (status == GST_VAAPI_DECODER_STATUS_SUCCESS && *got_frame_ptr)
+    GST_VAAPI_TRACE (GST_VAAPI_TRACE_PARSE_DONE, decoder, base_frame->pts);
+  return status;
 }
 
 GstVaapiDecoderStatus
@@ -1211,3 +1225,20 @@ gst_vaapi_decoder_get_surface_attributes (GstVaapiDecoder * decoder,
     *mem_types = attribs.mem_types;
   return attribs.formats;
 }
+
+/**
+ * gst_vaapi_decoder_get_va_call_stats:
+ * @decoder: a #GstVaapiDecoder
+ * @stats: (out caller-allocates): return location for the statistics
+ *
+ * Retrieves the VA calls issued by the @decoder, and the number of
+ * frames it processed, while the VA call accounting was enabled.
+ */
+void
+gst_vaapi_decoder_get_va_call_stats (GstVaapiDecoder * decoder,
+    GstVaapiVaCallStats * stats)
+{
+  g_return_if_fail (decoder != NULL);
+
+  gst_vaapi_va_calls_get_stats (&decoder->va_calls, stats);
+}
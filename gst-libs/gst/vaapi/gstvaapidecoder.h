@@ -28,6 +28,7 @@
 #include <gst/gstbuffer.h>
 #include <gst/base/gstadapter.h>
 #include <gst/vaapi/gstvaapisurfaceproxy.h>
+#include <gst/vaapi/gstvaapivacalls.h>
 #include <gst/video/gstvideoutils.h>
 
 G_BEGIN_DECLS
@@ -141,6 +142,10 @@ gst_vaapi_decoder_get_surface_attributes (GstVaapiDecoder * decoder,
     gint * min_width, gint * min_height, gint * max_width, gint * max_height,
     guint * mem_types);
 
+void
+gst_vaapi_decoder_get_va_call_stats (GstVaapiDecoder * decoder,
+    GstVaapiVaCallStats * stats);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GstVaapiDecoder, gst_object_unref)
 
 G_END_DECLS
@@ -232,7 +232,8 @@ do_decode (VADisplay dpy, VAContextID ctx, VABufferID * buf_id, void **buf_ptr)
 
   vaapi_unmap_buffer (dpy, *buf_id, buf_ptr);
 
-  status = vaRenderPicture (dpy, ctx, buf_id, 1);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_RENDER_PICTURE, status,
+      vaRenderPicture (dpy, ctx, buf_id, 1));
   if (!vaapi_check_status (status, "vaRenderPicture()"))
     return FALSE;
 
@@ -262,7 +263,8 @@ gst_vaapi_picture_decode_with_surface_id (GstVaapiPicture * picture,
 
   GST_DEBUG ("decode picture 0x%08x", surface_id);
 
-  status = vaBeginPicture (va_display, va_context, surface_id);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_BEGIN_PICTURE, status,
+      vaBeginPicture (va_display, va_context, surface_id));
   if (!vaapi_check_status (status, "vaBeginPicture()"))
     return FALSE;
 
@@ -302,12 +304,14 @@ gst_vaapi_picture_decode_with_surface_id (GstVaapiPicture * picture,
     va_buffers[0] = slice->param_id;
     va_buffers[1] = slice->data_id;
 
-    status = vaRenderPicture (va_display, va_context, va_buffers, 2);
+    GST_VAAPI_VA_CALL (GST_VAAPI_VA_RENDER_PICTURE, status,
+        vaRenderPicture (va_display, va_context, va_buffers, 2));
     if (!vaapi_check_status (status, "vaRenderPicture()"))
       return FALSE;
   }
 
-  status = vaEndPicture (va_display, va_context);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_END_PICTURE, status,
+      vaEndPicture (va_display, va_context));
 
   for (i = 0; i < picture->slices->len; i++) {
     GstVaapiSlice *const slice = g_ptr_array_index (picture->slices, i);
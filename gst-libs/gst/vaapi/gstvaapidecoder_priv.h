@@ -29,6 +29,7 @@
 #include <gst/vaapi/gstvaapidecoder.h>
 #include <gst/vaapi/gstvaapidecoder_unit.h>
 #include <gst/vaapi/gstvaapicontext.h>
+#include <gst/vaapi/gstvaapivacalls.h>
 
 G_BEGIN_DECLS
 
@@ -200,6 +201,7 @@ struct _GstVaapiDecoder
   GstVaapiParserState parser_state;
   GstVaapiDecoderStateChangedFunc codec_state_changed_func;
   gpointer codec_state_changed_data;
+  GstVaapiVaCallStats va_calls;
 };
 
 /**
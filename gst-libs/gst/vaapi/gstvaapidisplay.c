@@ -33,6 +33,7 @@
 #include "gstvaapidisplay.h"
 #include "gstvaapitexturemap.h"
 #include "gstvaapidisplay_priv.h"
+#include "gstvaapicapscache.h"
 #include "gstvaapiworkarounds.h"
 
 /* Debug category for all vaapi libs */
@@ -458,38 +459,180 @@ find_property_id (const gchar * name)
   return 0;
 }
 
-/* Initialize VA profiles (decoders, encoders) */
-static gboolean
-ensure_profiles (GstVaapiDisplay * display)
+/* Capability tables of a display, shared by all the displays that
+ * are bound to the same device and driver. Each table is built once,
+ * and is immutable after it got published, so readers don't need to
+ * take any lock. */
+typedef struct _GstVaapiDisplayProfiles GstVaapiDisplayProfiles;
+struct _GstVaapiDisplayProfiles
 {
-  GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
-  VAProfile *profiles = NULL;
-  VAEntrypoint *entrypoints = NULL;
-  gint i, j, n, num_entrypoints;
-  VAStatus status;
-  gboolean success = FALSE;
+  GArray *codecs;
+  GPtrArray *decoders;          /* ref element in codecs */
+  GPtrArray *encoders;          /* ref element in codecs */
+  gboolean has_vpp;
+};
 
-  GST_VAAPI_DISPLAY_LOCK (display);
+struct _GstVaapiDisplayCaps
+{
+  gint ref_count;
+  gchar *key;
 
-  if (priv->has_profiles) {
-    GST_VAAPI_DISPLAY_UNLOCK (display);
-    return TRUE;
+  /* protects the on-disk cache snapshot */
+  GMutex lock;
+  GstVaapiCapsCache *cache;
+
+  GstVaapiDisplayProfiles *profiles;
+  GArray *image_formats;
+  GArray *subpicture_formats;
+};
+
+G_LOCK_DEFINE_STATIC (display_caps);
+static GHashTable *g_display_caps;
+
+static GstVaapiDisplayProfiles *
+display_profiles_new (void)
+{
+  GstVaapiDisplayProfiles *const profiles =
+      g_new0 (GstVaapiDisplayProfiles, 1);
+
+  profiles->codecs = g_array_new (FALSE, FALSE, sizeof (GstVaapiProfileConfig));
+  profiles->decoders = g_ptr_array_new ();
+  profiles->encoders = g_ptr_array_new ();
+  return profiles;
+}
+
+static void
+display_profiles_free (GstVaapiDisplayProfiles * profiles)
+{
+  if (!profiles)
+    return;
+
+  g_ptr_array_unref (profiles->decoders);
+  g_ptr_array_unref (profiles->encoders);
+  g_array_unref (profiles->codecs);
+  g_free (profiles);
+}
+
+static void
+display_caps_free (GstVaapiDisplayCaps * caps)
+{
+  display_profiles_free (caps->profiles);
+  g_clear_pointer (&caps->image_formats, g_array_unref);
+  g_clear_pointer (&caps->subpicture_formats, g_array_unref);
+  gst_vaapi_caps_cache_free (caps->cache);
+  g_mutex_clear (&caps->lock);
+  g_free (caps->key);
+  g_free (caps);
+}
+
+/* Looks up the capability tables for the VA driver @vendor_string
+ * running on @device_name, or creates new ones. The on-disk cache is
+ * also keyed on the version of the VA-API runtime */
+static GstVaapiDisplayCaps *
+display_caps_acquire (const gchar * vendor_string, const gchar * device_name,
+    gint va_major_version, gint va_minor_version)
+{
+  GstVaapiDisplayCaps *caps = NULL;
+  gchar *key = NULL;
+
+  if (vendor_string)
+    key = g_strdup_printf ("%s|%s", vendor_string, GST_STR_NULL (device_name));
+
+  G_LOCK (display_caps);
+  if (key && g_display_caps)
+    caps = g_hash_table_lookup (g_display_caps, key);
+
+  if (caps) {
+    caps->ref_count++;
+    g_free (key);
+  } else {
+    caps = g_new0 (GstVaapiDisplayCaps, 1);
+    caps->ref_count = 1;
+    caps->key = key;
+    g_mutex_init (&caps->lock);
+
+    /* unidentified drivers don't get shared nor cached tables */
+    if (key) {
+      caps->cache = gst_vaapi_caps_cache_new (vendor_string, device_name,
+          va_major_version, va_minor_version);
+      if (!g_display_caps)
+        g_display_caps = g_hash_table_new (g_str_hash, g_str_equal);
+      g_hash_table_insert (g_display_caps, caps->key, caps);
+    }
   }
+  G_UNLOCK (display_caps);
 
-  priv->codecs = g_array_new (FALSE, FALSE, sizeof (GstVaapiProfileConfig));
-  if (!priv->codecs)
-    goto cleanup;
+  return caps;
+}
 
-  priv->decoders = g_ptr_array_new ();
-  if (!priv->decoders)
-    goto cleanup;
-  priv->encoders = g_ptr_array_new ();
-  if (!priv->encoders)
-    goto cleanup;
-  priv->has_profiles = TRUE;
+static void
+display_caps_release (GstVaapiDisplayCaps * caps)
+{
+  gboolean is_last;
+
+  if (!caps)
+    return;
+
+  G_LOCK (display_caps);
+  is_last = --caps->ref_count == 0;
+  if (is_last && caps->key)
+    g_hash_table_remove (g_display_caps, caps->key);
+  G_UNLOCK (display_caps);
+
+  if (is_last)
+    display_caps_free (caps);
+}
+
+/* Publishes the table @new_table into @table_ptr, unless some other
+ * thread built it first. Returns the published table */
+static gpointer
+display_caps_publish (gpointer * table_ptr, gpointer new_table,
+    GDestroyNotify destroy)
+{
+  if (!g_atomic_pointer_compare_and_exchange (table_ptr, NULL, new_table))
+    destroy (new_table);
+  return g_atomic_pointer_get (table_ptr);
+}
+
+static inline GstVaapiDisplayProfiles *
+display_peek_profiles (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayCaps *const caps =
+      GST_VAAPI_DISPLAY_GET_PRIVATE (display)->caps;
+
+  return g_atomic_pointer_get (&caps->profiles);
+}
+
+static inline GArray *
+display_peek_image_formats (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayCaps *const caps =
+      GST_VAAPI_DISPLAY_GET_PRIVATE (display)->caps;
+
+  return g_atomic_pointer_get (&caps->image_formats);
+}
 
-  /* VA profiles */
-  profiles = g_new (VAProfile, vaMaxNumProfiles (priv->display));
+static inline GArray *
+display_peek_subpicture_formats (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayCaps *const caps =
+      GST_VAAPI_DISPLAY_GET_PRIVATE (display)->caps;
+
+  return g_atomic_pointer_get (&caps->subpicture_formats);
+}
+
+/* Queries the raw VA profiles and entrypoints from the driver */
+static GArray *
+query_configs (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  VAProfile *profiles = NULL;
+  VAEntrypoint *entrypoints = NULL;
+  GArray *configs = NULL;
+  gint i, j, n, num_entrypoints;
+  VAStatus status;
+
+  profiles = g_new (VAProfile, vaMaxNumProfiles (priv->display) + 1);
   if (!profiles)
     goto cleanup;
   entrypoints = g_new (VAEntrypoint, vaMaxNumEntrypoints (priv->display));
@@ -501,67 +644,118 @@ ensure_profiles (GstVaapiDisplay * display)
   if (!vaapi_check_status (status, "vaQueryConfigProfiles()"))
     goto cleanup;
 
-  GST_DEBUG ("%d profiles", n);
+  /* Video processing API */
+  profiles[n++] = VAProfileNone;
+
+  configs = g_array_sized_new (FALSE, FALSE, sizeof (GstVaapiCapsCacheConfig),
+      n);
   for (i = 0; i < n; i++) {
-    if (profiles[i] == VAProfileNone)
+    GstVaapiCapsCacheConfig config = { profiles[i], 0 };
+
+    status = vaQueryConfigEntrypoints (priv->display,
+        profiles[i], entrypoints, &num_entrypoints);
+    if (!vaapi_check_status (status, "vaQueryConfigEntrypoints()"))
       continue;
-    GST_DEBUG ("  %s", string_of_VAProfile (profiles[i]));
+
+    for (j = 0; j < num_entrypoints; j++)
+      config.entrypoints |= (1U << entrypoints[j]);
+
+    g_array_append_val (configs, config);
   }
 
-  for (i = 0; i < n; i++) {
+cleanup:
+  g_free (profiles);
+  g_free (entrypoints);
+  return configs;
+}
+
+/* Initialize VA profiles (decoders, encoders) */
+static gboolean
+ensure_profiles (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayCaps *const caps =
+      GST_VAAPI_DISPLAY_GET_PRIVATE (display)->caps;
+  GstVaapiDisplayProfiles *profiles;
+  GArray *configs = NULL;
+  guint i, j;
+
+  if (!caps)
+    return FALSE;
+  if (g_atomic_pointer_get (&caps->profiles))
+    return TRUE;
+
+  g_mutex_lock (&caps->lock);
+  if (caps->cache && caps->cache->configs)
+    configs = g_array_ref (caps->cache->configs);
+  g_mutex_unlock (&caps->lock);
+
+  if (!configs) {
+    GST_VAAPI_DISPLAY_LOCK (display);
+    configs = query_configs (display);
+    GST_VAAPI_DISPLAY_UNLOCK (display);
+    if (!configs)
+      return FALSE;
+
+    g_mutex_lock (&caps->lock);
+    if (caps->cache && !caps->cache->configs) {
+      caps->cache->configs = g_array_ref (configs);
+      gst_vaapi_caps_cache_save (caps->cache);
+    }
+    g_mutex_unlock (&caps->lock);
+  }
+
+  profiles = display_profiles_new ();
+
+  GST_DEBUG ("%d profiles", configs->len);
+  for (i = 0; i < configs->len; i++) {
+    const GstVaapiCapsCacheConfig *const va_config =
+        &g_array_index (configs, GstVaapiCapsCacheConfig, i);
     GstVaapiProfileConfig config = { 0, };
 
-    config.profile = gst_vaapi_profile (profiles[i]);
-    if (!config.profile)
+    if (va_config->profile == VAProfileNone) {
+      if (va_config->entrypoints & (1U << VAEntrypointVideoProc))
+        profiles->has_vpp = TRUE;
       continue;
+    }
 
-    status = vaQueryConfigEntrypoints (priv->display,
-        profiles[i], entrypoints, &num_entrypoints);
-    if (!vaapi_check_status (status, "vaQueryConfigEntrypoints()"))
+    GST_DEBUG ("  %s", string_of_VAProfile (va_config->profile));
+
+    config.profile = gst_vaapi_profile (va_config->profile);
+    if (!config.profile)
       continue;
 
-    for (j = 0; j < num_entrypoints; j++)
-      config.entrypoints |= (1U << gst_vaapi_entrypoint (entrypoints[j]));
+    for (j = 0; j < 32; j++) {
+      if (va_config->entrypoints & (1U << j))
+        config.entrypoints |= (1U << gst_vaapi_entrypoint (j));
+    }
 
-    priv->codecs = g_array_append_val (priv->codecs, config);
+    g_array_append_val (profiles->codecs, config);
   }
+  g_array_unref (configs);
 
-  for (i = 0; i < priv->codecs->len; i++) {
+  for (i = 0; i < profiles->codecs->len; i++) {
     GstVaapiProfileConfig *cfg;
 
-    cfg = &g_array_index (priv->codecs, GstVaapiProfileConfig, i);
+    cfg = &g_array_index (profiles->codecs, GstVaapiProfileConfig, i);
 
     if ((cfg->entrypoints & ENTRY_POINT_FLAG (VLD))
         || (cfg->entrypoints & ENTRY_POINT_FLAG (IDCT))
         || (cfg->entrypoints & ENTRY_POINT_FLAG (MOCO)))
-      g_ptr_array_add (priv->decoders, cfg);
+      g_ptr_array_add (profiles->decoders, cfg);
     if ((cfg->entrypoints & ENTRY_POINT_FLAG (SLICE_ENCODE))
         || (cfg->entrypoints & ENTRY_POINT_FLAG (PICTURE_ENCODE))
         || (cfg->entrypoints & ENTRY_POINT_FLAG (SLICE_ENCODE_LP)))
-      g_ptr_array_add (priv->encoders, cfg);
+      g_ptr_array_add (profiles->encoders, cfg);
   }
 
-  append_h263_config (priv->codecs, priv->decoders);
+  append_h263_config (profiles->codecs, profiles->decoders);
 
-  g_ptr_array_sort (priv->decoders, compare_profiles);
-  g_ptr_array_sort (priv->encoders, compare_profiles);
+  g_ptr_array_sort (profiles->decoders, compare_profiles);
+  g_ptr_array_sort (profiles->encoders, compare_profiles);
 
-  /* Video processing API */
-  status = vaQueryConfigEntrypoints (priv->display, VAProfileNone,
-      entrypoints, &num_entrypoints);
-  if (vaapi_check_status (status, "vaQueryEntrypoints() [VAProfileNone]")) {
-    for (j = 0; j < num_entrypoints; j++) {
-      if (entrypoints[j] == VAEntrypointVideoProc)
-        priv->has_vpp = TRUE;
-    }
-  }
-  success = TRUE;
-
-cleanup:
-  g_free (profiles);
-  g_free (entrypoints);
-  GST_VAAPI_DISPLAY_UNLOCK (display);
-  return success;
+  display_caps_publish ((gpointer *) & caps->profiles, profiles,
+      (GDestroyNotify) display_profiles_free);
+  return TRUE;
 }
 
 /* Initialize VA display attributes */
@@ -652,31 +846,49 @@ static gboolean
 ensure_image_formats (GstVaapiDisplay * display)
 {
   GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  GstVaapiDisplayCaps *const caps = priv->caps;
   VAImageFormat *formats = NULL;
+  GArray *image_formats;
   VAStatus status;
   gint i, n, max_images;
-  gboolean success = FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (display);
-  if (priv->image_formats) {
-    GST_VAAPI_DISPLAY_UNLOCK (display);
+  if (!caps)
+    return FALSE;
+  if (g_atomic_pointer_get (&caps->image_formats))
     return TRUE;
-  }
-
-  priv->image_formats = g_array_new (FALSE, FALSE, sizeof (GstVaapiFormatInfo));
-  if (!priv->image_formats)
-    goto cleanup;
 
   /* VA image formats */
-  max_images = vaMaxNumImageFormats (priv->display);
-  formats = g_new (VAImageFormat, max_images);
-  if (!formats)
-    goto cleanup;
+  g_mutex_lock (&caps->lock);
+  if (caps->cache && caps->cache->image_formats) {
+    GArray *const cached_formats = caps->cache->image_formats;
+
+    max_images = n = cached_formats->len;
+    formats = g_memdup2 (cached_formats->data, n * sizeof (VAImageFormat));
+  } else {
+    max_images = -1;
+  }
+  g_mutex_unlock (&caps->lock);
 
-  n = 0;
-  status = vaQueryImageFormats (priv->display, formats, &n);
-  if (!vaapi_check_status (status, "vaQueryImageFormats()"))
-    goto cleanup;
+  if (max_images < 0) {
+    GST_VAAPI_DISPLAY_LOCK (display);
+    max_images = vaMaxNumImageFormats (priv->display);
+    formats = g_new (VAImageFormat, max_images);
+
+    n = 0;
+    status = vaQueryImageFormats (priv->display, formats, &n);
+    GST_VAAPI_DISPLAY_UNLOCK (display);
+    if (!vaapi_check_status (status, "vaQueryImageFormats()"))
+      goto error;
+
+    g_mutex_lock (&caps->lock);
+    if (caps->cache && !caps->cache->image_formats) {
+      caps->cache->image_formats =
+          g_array_sized_new (FALSE, FALSE, sizeof (VAImageFormat), n);
+      g_array_append_vals (caps->cache->image_formats, formats, n);
+      gst_vaapi_caps_cache_save (caps->cache);
+    }
+    g_mutex_unlock (&caps->lock);
+  }
 
   /* XXX(victor): Force RGBA in i965 display formats.
    *
@@ -707,17 +919,24 @@ ensure_image_formats (GstVaapiDisplay * display)
 
   if (!gst_vaapi_video_format_create_map (formats, n)) {
     GST_ERROR ("fail to create map between gst video format and vaImageFormat");
-    goto cleanup;
+    goto error;
   }
 
-  append_formats (priv->image_formats, formats, NULL, n);
-  g_array_sort (priv->image_formats, compare_yuv_formats);
-  success = TRUE;
-
-cleanup:
+  image_formats = g_array_new (FALSE, FALSE, sizeof (GstVaapiFormatInfo));
+  append_formats (image_formats, formats, NULL, n);
+  g_array_sort (image_formats, compare_yuv_formats);
   g_free (formats);
-  GST_VAAPI_DISPLAY_UNLOCK (display);
-  return success;
+
+  display_caps_publish ((gpointer *) & caps->image_formats, image_formats,
+      (GDestroyNotify) g_array_unref);
+  return TRUE;
+
+  /* ERRORS */
+error:
+  {
+    g_free (formats);
+    return FALSE;
+  }
 }
 
 /* Initialize VA subpicture formats */
@@ -725,36 +944,53 @@ static gboolean
 ensure_subpicture_formats (GstVaapiDisplay * display)
 {
   GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  GstVaapiDisplayCaps *const caps = priv->caps;
   VAImageFormat *formats = NULL;
   unsigned int *flags = NULL;
+  GArray *subpicture_formats;
   VAStatus status;
   guint i, n;
-  gboolean success = FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (display);
-  if (priv->subpicture_formats) {
-    GST_VAAPI_DISPLAY_UNLOCK (display);
+  if (!caps)
+    return FALSE;
+  if (g_atomic_pointer_get (&caps->subpicture_formats))
     return TRUE;
-  }
-
-  priv->subpicture_formats =
-      g_array_new (FALSE, FALSE, sizeof (GstVaapiFormatInfo));
-  if (!priv->subpicture_formats)
-    goto cleanup;
 
   /* VA subpicture formats */
-  n = vaMaxNumSubpictureFormats (priv->display);
-  formats = g_new (VAImageFormat, n);
-  if (!formats)
-    goto cleanup;
-  flags = g_new (guint, n);
-  if (!flags)
-    goto cleanup;
+  g_mutex_lock (&caps->lock);
+  if (caps->cache && caps->cache->subpicture_formats) {
+    n = caps->cache->subpicture_formats->len;
+    formats = g_memdup2 (caps->cache->subpicture_formats->data,
+        n * sizeof (VAImageFormat));
+    flags = g_memdup2 (caps->cache->subpicture_flags->data,
+        n * sizeof (guint));
+  }
+  g_mutex_unlock (&caps->lock);
 
-  n = 0;
-  status = vaQuerySubpictureFormats (priv->display, formats, flags, &n);
-  if (!vaapi_check_status (status, "vaQuerySubpictureFormats()"))
-    goto cleanup;
+  if (!formats) {
+    GST_VAAPI_DISPLAY_LOCK (display);
+    n = vaMaxNumSubpictureFormats (priv->display);
+    formats = g_new (VAImageFormat, n);
+    flags = g_new (guint, n);
+
+    n = 0;
+    status = vaQuerySubpictureFormats (priv->display, formats, flags, &n);
+    GST_VAAPI_DISPLAY_UNLOCK (display);
+    if (!vaapi_check_status (status, "vaQuerySubpictureFormats()"))
+      goto error;
+
+    g_mutex_lock (&caps->lock);
+    if (caps->cache && !caps->cache->subpicture_formats) {
+      caps->cache->subpicture_formats =
+          g_array_sized_new (FALSE, FALSE, sizeof (VAImageFormat), n);
+      g_array_append_vals (caps->cache->subpicture_formats, formats, n);
+      caps->cache->subpicture_flags =
+          g_array_sized_new (FALSE, FALSE, sizeof (guint), n);
+      g_array_append_vals (caps->cache->subpicture_flags, flags, n);
+      gst_vaapi_caps_cache_save (caps->cache);
+    }
+    g_mutex_unlock (&caps->lock);
+  }
 
   GST_DEBUG ("%d subpicture formats", n);
   for (i = 0; i < n; i++) {
@@ -762,15 +998,23 @@ ensure_subpicture_formats (GstVaapiDisplay * display)
     flags[i] = to_GstVaapiSubpictureFlags (flags[i]);
   }
 
-  append_formats (priv->subpicture_formats, formats, flags, n);
-  g_array_sort (priv->subpicture_formats, compare_rgb_formats);
-  success = TRUE;
-
-cleanup:
+  subpicture_formats = g_array_new (FALSE, FALSE, sizeof (GstVaapiFormatInfo));
+  append_formats (subpicture_formats, formats, flags, n);
+  g_array_sort (subpicture_formats, compare_rgb_formats);
   g_free (formats);
   g_free (flags);
-  GST_VAAPI_DISPLAY_UNLOCK (display);
-  return success;
+
+  display_caps_publish ((gpointer *) & caps->subpicture_formats,
+      subpicture_formats, (GDestroyNotify) g_array_unref);
+  return TRUE;
+
+  /* ERRORS */
+error:
+  {
+    g_free (formats);
+    g_free (flags);
+    return FALSE;
+  }
 }
 
 /* Ensures the VA driver vendor string was copied */
@@ -828,6 +1072,32 @@ set_driver_quirks (GstVaapiDisplay * display)
       "(%#x)", priv->vendor_string, priv->driver_quirks);
 }
 
+static void
+set_thread_safety (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  const gchar *env;
+  guint i;
+
+  /* Drivers that can process several VA contexts from different
+   * threads concurrently, as long as each one is used by a single
+   * thread at a time */
+  static const gchar *thread_safe_drivers[] = { "iHD", "Mesa Gallium" };
+
+  env = g_getenv ("GST_VAAPI_DISPLAY_THREAD_SAFE");
+  if (env) {
+    priv->thread_safe = g_strcmp0 (env, "0") != 0;
+  } else if (priv->vendor_string) {
+    for (i = 0; i < G_N_ELEMENTS (thread_safe_drivers); i++) {
+      if (strstr (priv->vendor_string, thread_safe_drivers[i]))
+        priv->thread_safe = TRUE;
+    }
+  }
+
+  if (priv->thread_safe)
+    GST_INFO_OBJECT (display, "using per-context submission locks");
+}
+
 static void
 gst_vaapi_display_calculate_pixel_aspect_ratio (GstVaapiDisplay * display)
 {
@@ -902,11 +1172,7 @@ gst_vaapi_display_destroy (GstVaapiDisplay * display)
   GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
   GstVaapiDisplayClass *klass = GST_VAAPI_DISPLAY_GET_CLASS (display);
 
-  g_clear_pointer (&priv->decoders, g_ptr_array_unref);
-  g_clear_pointer (&priv->encoders, g_ptr_array_unref);
-  g_clear_pointer (&priv->codecs, g_array_unref);
-  g_clear_pointer (&priv->image_formats, g_array_unref);
-  g_clear_pointer (&priv->subpicture_formats, g_array_unref);
+  g_clear_pointer (&priv->caps, display_caps_release);
   g_clear_pointer (&priv->properties, g_array_unref);
 
   if (priv->display) {
@@ -969,8 +1235,14 @@ gst_vaapi_display_create (GstVaapiDisplay * display,
     return FALSE;
 
   if (!priv->parent) {
-    if (!vaapi_initialize (priv->display))
+    if (!vaapi_initialize (priv->display, &priv->va_major_version,
+            &priv->va_minor_version))
       return FALSE;
+  } else {
+    GstVaapiDisplayPrivate *const parent_priv =
+        GST_VAAPI_DISPLAY_GET_PRIVATE (priv->parent);
+    priv->va_major_version = parent_priv->va_major_version;
+    priv->va_minor_version = parent_priv->va_minor_version;
   }
 
   GST_INFO_OBJECT (display, "new display addr=%p", display);
@@ -978,6 +1250,11 @@ gst_vaapi_display_create (GstVaapiDisplay * display,
   priv->display_name = g_strdup (info.display_name);
 
   set_driver_quirks (display);
+  set_thread_safety (display);
+
+  display_caps_release (priv->caps);
+  priv->caps = display_caps_acquire (priv->vendor_string, priv->display_name,
+      priv->va_major_version, priv->va_minor_version);
 
   if (!ensure_image_formats (display)) {
     gst_vaapi_display_destroy (display);
@@ -987,6 +1264,83 @@ gst_vaapi_display_create (GstVaapiDisplay * display,
   return TRUE;
 }
 
+/* Records a contended acquisition of a @type lock, after @wait_us
+   spent waiting for it. The uncontended acquisitions are only counted
+   in lock_with_stats() */
+static void
+lock_stats_record_wait (GstVaapiDisplayPrivate * priv,
+    GstVaapiDisplayLockType type, gint64 wait_us)
+{
+  GstVaapiDisplayLockStats *const stats = &priv->lock_stats[type];
+  guint bucket;
+
+  bucket = wait_us > 0 ? g_bit_storage (wait_us) - 1 : 0;
+  bucket = MIN (bucket, GST_VAAPI_DISPLAY_LOCK_STATS_BUCKETS - 1);
+
+  g_mutex_lock (&priv->lock_stats_mutex);
+  stats->n_contended++;
+  stats->total_wait_us += wait_us;
+  stats->max_wait_us = MAX (stats->max_wait_us, wait_us);
+  stats->histogram[bucket]++;
+  g_mutex_unlock (&priv->lock_stats_mutex);
+}
+
+/* Fills in @stats with a snapshot of the @type lock statistics */
+static void
+lock_stats_get (GstVaapiDisplayPrivate * priv, GstVaapiDisplayLockType type,
+    GstVaapiDisplayLockStats * stats)
+{
+  g_mutex_lock (&priv->lock_stats_mutex);
+  *stats = priv->lock_stats[type];
+  g_mutex_unlock (&priv->lock_stats_mutex);
+  stats->n_acquisitions =
+      (gsize) g_atomic_pointer_get (&priv->lock_acquisitions[type]);
+}
+
+static void
+lock_stats_dump (GstVaapiDisplay * display)
+{
+#ifndef GST_DISABLE_GST_DEBUG
+  static const gchar *lock_names[] = { "display", "context" };
+  GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (priv->lock_stats); i++) {
+    GstVaapiDisplayLockStats stats_data, *const stats = &stats_data;
+
+    lock_stats_get (priv, i, stats);
+    if (!stats->n_contended)
+      continue;
+
+    GST_DEBUG_OBJECT (display, "%s lock: %" G_GUINT64_FORMAT " acquisitions, "
+        "%" G_GUINT64_FORMAT " contended, %" G_GUINT64_FORMAT " us waited "
+        "(max %" G_GUINT64_FORMAT " us)", lock_names[i], stats->n_acquisitions,
+        stats->n_contended, stats->total_wait_us, stats->max_wait_us);
+    for (j = 0; j < GST_VAAPI_DISPLAY_LOCK_STATS_BUCKETS; j++) {
+      if (stats->histogram[j])
+        GST_DEBUG_OBJECT (display, "  < %u us: %" G_GUINT64_FORMAT,
+            1U << (j + 1), stats->histogram[j]);
+    }
+  }
+#endif
+}
+
+/* Locks @mutex, and records the time spent waiting for it */
+static void
+lock_with_stats (GstVaapiDisplayPrivate * priv, GRecMutex * mutex,
+    GstVaapiDisplayLockType type)
+{
+  gint64 start;
+
+  g_atomic_pointer_add (&priv->lock_acquisitions[type], 1);
+  if (g_rec_mutex_trylock (mutex))
+    return;
+
+  start = g_get_monotonic_time ();
+  g_rec_mutex_lock (mutex);
+  lock_stats_record_wait (priv, type, g_get_monotonic_time () - start);
+}
+
 static void
 gst_vaapi_display_lock_default (GstVaapiDisplay * display)
 {
@@ -994,7 +1348,7 @@ gst_vaapi_display_lock_default (GstVaapiDisplay * display)
 
   if (priv->parent)
     priv = GST_VAAPI_DISPLAY_GET_PRIVATE (priv->parent);
-  g_rec_mutex_lock (&priv->mutex);
+  lock_with_stats (priv, &priv->mutex, GST_VAAPI_DISPLAY_LOCK_TYPE_DISPLAY);
 }
 
 static void
@@ -1018,6 +1372,7 @@ gst_vaapi_display_init (GstVaapiDisplay * display)
   priv->par_d = 1;
 
   g_rec_mutex_init (&priv->mutex);
+  g_mutex_init (&priv->lock_stats_mutex);
 }
 
 static gboolean
@@ -1148,7 +1503,9 @@ gst_vaapi_display_finalize (GObject * object)
   GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
 
   gst_vaapi_display_destroy (display);
+  lock_stats_dump (display);
   g_rec_mutex_clear (&priv->mutex);
+  g_mutex_clear (&priv->lock_stats_mutex);
 
   G_OBJECT_CLASS (gst_vaapi_display_parent_class)->finalize (object);
 }
@@ -1351,6 +1708,57 @@ gst_vaapi_display_unlock (GstVaapiDisplay * display)
     klass->unlock (display);
 }
 
+/**
+ * gst_vaapi_display_lock_context:
+ * @display: a #GstVaapiDisplay
+ * @mutex: (nullable): the #GRecMutex protecting a VA context
+ *
+ * Locks @display for submitting work to a VA context. If the
+ * underlying driver is thread-safe, only @mutex is locked, so that
+ * unrelated contexts don't serialize on the display-wide lock. A
+ * %NULL @mutex means no lock is needed at all on such drivers.
+ */
+void
+gst_vaapi_display_lock_context (GstVaapiDisplay * display, GRecMutex * mutex)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_if_fail (display != NULL);
+
+  priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  if (priv->parent)
+    priv = GST_VAAPI_DISPLAY_GET_PRIVATE (priv->parent);
+
+  if (!priv->thread_safe)
+    gst_vaapi_display_lock (display);
+  else if (mutex)
+    lock_with_stats (priv, mutex, GST_VAAPI_DISPLAY_LOCK_TYPE_CONTEXT);
+}
+
+/**
+ * gst_vaapi_display_unlock_context:
+ * @display: a #GstVaapiDisplay
+ * @mutex: (nullable): the #GRecMutex protecting a VA context
+ *
+ * Unlocks @display after gst_vaapi_display_lock_context().
+ */
+void
+gst_vaapi_display_unlock_context (GstVaapiDisplay * display, GRecMutex * mutex)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_if_fail (display != NULL);
+
+  priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  if (priv->parent)
+    priv = GST_VAAPI_DISPLAY_GET_PRIVATE (priv->parent);
+
+  if (!priv->thread_safe)
+    gst_vaapi_display_unlock (display);
+  else if (mutex)
+    g_rec_mutex_unlock (mutex);
+}
+
 /**
  * gst_vaapi_display_sync:
  * @display: a #GstVaapiDisplay
@@ -1562,7 +1970,7 @@ gst_vaapi_display_has_video_processing (GstVaapiDisplay * display)
 
   if (!ensure_profiles (display))
     return FALSE;
-  return GST_VAAPI_DISPLAY_GET_PRIVATE (display)->has_vpp;
+  return display_peek_profiles (display)->has_vpp;
 }
 
 /**
@@ -1583,7 +1991,7 @@ gst_vaapi_display_get_decode_profiles (GstVaapiDisplay * display)
 
   if (!ensure_profiles (display))
     return NULL;
-  return get_profiles (GST_VAAPI_DISPLAY_GET_PRIVATE (display)->decoders, 0);
+  return get_profiles (display_peek_profiles (display)->decoders, 0);
 }
 
 /**
@@ -1605,8 +2013,8 @@ gst_vaapi_display_has_decoder (GstVaapiDisplay * display,
 
   if (!ensure_profiles (display))
     return FALSE;
-  return find_config (GST_VAAPI_DISPLAY_GET_PRIVATE (display)->decoders,
-      profile, entrypoint);
+  return find_config (display_peek_profiles (display)->decoders, profile,
+      entrypoint);
 }
 
 /**
@@ -1627,7 +2035,7 @@ gst_vaapi_display_get_encode_profiles (GstVaapiDisplay * display)
 
   if (!ensure_profiles (display))
     return NULL;
-  return get_profiles (GST_VAAPI_DISPLAY_GET_PRIVATE (display)->encoders, 0);
+  return get_profiles (display_peek_profiles (display)->encoders, 0);
 }
 
 /**
@@ -1651,8 +2059,7 @@ gst_vaapi_display_get_encode_profiles_by_codec (GstVaapiDisplay * display,
 
   if (!ensure_profiles (display))
     return NULL;
-  return get_profiles (GST_VAAPI_DISPLAY_GET_PRIVATE (display)->encoders,
-      codec);
+  return get_profiles (display_peek_profiles (display)->encoders, codec);
 }
 
 /**
@@ -1674,8 +2081,8 @@ gst_vaapi_display_has_encoder (GstVaapiDisplay * display,
 
   if (!ensure_profiles (display))
     return FALSE;
-  return find_config (GST_VAAPI_DISPLAY_GET_PRIVATE (display)->encoders,
-      profile, entrypoint);
+  return find_config (display_peek_profiles (display)->encoders, profile,
+      entrypoint);
 }
 
 /**
@@ -1706,7 +2113,7 @@ gst_vaapi_display_get_image_formats (GstVaapiDisplay * display)
 
   if (!ensure_image_formats (display))
     return NULL;
-  return get_formats (GST_VAAPI_DISPLAY_GET_PRIVATE (display)->image_formats);
+  return get_formats (display_peek_image_formats (display));
 }
 
 /**
@@ -1722,16 +2129,12 @@ gboolean
 gst_vaapi_display_has_image_format (GstVaapiDisplay * display,
     GstVideoFormat format)
 {
-  GstVaapiDisplayPrivate *priv;
-
   g_return_val_if_fail (display != NULL, FALSE);
   g_return_val_if_fail (format, FALSE);
 
-  priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
-
   if (!ensure_image_formats (display))
     return FALSE;
-  if (find_format (priv->image_formats, format))
+  if (find_format (display_peek_image_formats (display), format))
     return TRUE;
 
   /* XXX: try subpicture formats since some drivers could report a
@@ -1740,7 +2143,7 @@ gst_vaapi_display_has_image_format (GstVaapiDisplay * display,
    */
   if (!ensure_subpicture_formats (display))
     return FALSE;
-  return find_format (priv->subpicture_formats, format);
+  return find_format (display_peek_subpicture_formats (display), format);
 }
 
 /**
@@ -1768,8 +2171,7 @@ gst_vaapi_display_get_subpicture_formats (GstVaapiDisplay * display)
 
   if (!ensure_subpicture_formats (display))
     return NULL;
-  return
-      get_formats (GST_VAAPI_DISPLAY_GET_PRIVATE (display)->subpicture_formats);
+  return get_formats (display_peek_subpicture_formats (display));
 }
 
 /**
@@ -1787,18 +2189,15 @@ gboolean
 gst_vaapi_display_has_subpicture_format (GstVaapiDisplay * display,
     GstVideoFormat format, guint * flags_ptr)
 {
-  GstVaapiDisplayPrivate *priv;
   const GstVaapiFormatInfo *fip;
 
   g_return_val_if_fail (display != NULL, FALSE);
   g_return_val_if_fail (format, FALSE);
 
-  priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
-
   if (!ensure_subpicture_formats (display))
     return FALSE;
 
-  fip = find_format_info (priv->subpicture_formats, format);
+  fip = find_format_info (display_peek_subpicture_formats (display), format);
   if (!fip)
     return FALSE;
 
@@ -2183,3 +2582,48 @@ gst_vaapi_display_has_driver_quirks (GstVaapiDisplay * display, guint quirks)
 
   return (GST_VAAPI_DISPLAY_GET_PRIVATE (display)->driver_quirks & quirks);
 }
+
+/**
+ * gst_vaapi_display_is_thread_safe:
+ * @display: a #GstVaapiDisplay
+ *
+ * Returns: %TRUE if work submission to distinct VA contexts of
+ *   @display only takes per-context locks
+ */
+gboolean
+gst_vaapi_display_is_thread_safe (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_val_if_fail (GST_VAAPI_IS_DISPLAY (display), FALSE);
+
+  priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  if (priv->parent)
+    priv = GST_VAAPI_DISPLAY_GET_PRIVATE (priv->parent);
+  return priv->thread_safe;
+}
+
+/**
+ * gst_vaapi_display_get_lock_stats:
+ * @display: a #GstVaapiDisplay
+ * @type: the #GstVaapiDisplayLockType to report
+ * @stats: (out caller-allocates): return location for the statistics
+ *
+ * Retrieves the wait-time statistics of the @type locks of @display.
+ */
+void
+gst_vaapi_display_get_lock_stats (GstVaapiDisplay * display,
+    GstVaapiDisplayLockType type, GstVaapiDisplayLockStats * stats)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_if_fail (GST_VAAPI_IS_DISPLAY (display));
+  g_return_if_fail (type <= GST_VAAPI_DISPLAY_LOCK_TYPE_CONTEXT);
+  g_return_if_fail (stats != NULL);
+
+  priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  if (priv->parent)
+    priv = GST_VAAPI_DISPLAY_GET_PRIVATE (priv->parent);
+
+  lock_stats_get (priv, type, stats);
+}
@@ -286,6 +286,50 @@ gst_vaapi_display_reset_texture_map (GstVaapiDisplay * display);
 gboolean
 gst_vaapi_display_has_driver_quirks (GstVaapiDisplay * display, guint quirks);
 
+/**
+ * GstVaapiDisplayLockType:
+ * @GST_VAAPI_DISPLAY_LOCK_TYPE_DISPLAY: the display-wide lock, as
+ *   taken by gst_vaapi_display_lock().
+ * @GST_VAAPI_DISPLAY_LOCK_TYPE_CONTEXT: the per-context submission
+ *   locks, only used on thread-safe drivers.
+ */
+typedef enum
+{
+  GST_VAAPI_DISPLAY_LOCK_TYPE_DISPLAY = 0,
+  GST_VAAPI_DISPLAY_LOCK_TYPE_CONTEXT,
+} GstVaapiDisplayLockType;
+
+#define GST_VAAPI_DISPLAY_LOCK_STATS_BUCKETS 16
+
+/**
+ * GstVaapiDisplayLockStats:
+ * @n_acquisitions: number of times the lock was taken.
+ * @n_contended: number of times the lock was held by another thread.
+ * @total_wait_us: total time spent waiting for the lock, in microseconds.
+ * @max_wait_us: longest wait for the lock, in microseconds.
+ * @histogram: contended acquisitions, where bucket i counts the waits
+ *   in the [2^i, 2^(i+1)[ microseconds range. The first bucket also
+ *   counts shorter waits, and the last one all the longer waits.
+ *
+ * Wait-time statistics of the locks of a #GstVaapiDisplay.
+ */
+typedef struct _GstVaapiDisplayLockStats GstVaapiDisplayLockStats;
+struct _GstVaapiDisplayLockStats
+{
+  guint64 n_acquisitions;
+  guint64 n_contended;
+  guint64 total_wait_us;
+  guint64 max_wait_us;
+  guint64 histogram[GST_VAAPI_DISPLAY_LOCK_STATS_BUCKETS];
+};
+
+gboolean
+gst_vaapi_display_is_thread_safe (GstVaapiDisplay * display);
+
+void
+gst_vaapi_display_get_lock_stats (GstVaapiDisplay * display,
+    GstVaapiDisplayLockType type, GstVaapiDisplayLockStats * stats);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GstVaapiDisplay, gst_object_unref)
 
 G_END_DECLS
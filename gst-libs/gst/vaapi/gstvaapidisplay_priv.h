@@ -49,6 +49,7 @@ G_BEGIN_DECLS
     (G_TYPE_INSTANCE_GET_CLASS ((obj), GST_TYPE_VAAPI_DISPLAY, GstVaapiDisplayClass))
 
 typedef struct _GstVaapiDisplayPrivate          GstVaapiDisplayPrivate;
+typedef struct _GstVaapiDisplayCaps             GstVaapiDisplayCaps;
 typedef struct _GstVaapiDisplayClass            GstVaapiDisplayClass;
 typedef enum _GstVaapiDisplayInitType           GstVaapiDisplayInitType;
 
@@ -120,18 +121,21 @@ struct _GstVaapiDisplayPrivate
   guint height_mm;
   guint par_n;
   guint par_d;
-  GPtrArray *decoders; /* ref element in codecs */
-  GPtrArray *encoders; /* ref element in codecs */
-  GArray *codecs;
-  GArray *image_formats;
-  GArray *subpicture_formats;
+  GstVaapiDisplayCaps *caps; /* shared with displays on the same device */
   GArray *properties;
   gchar *vendor_string;
+  gint va_major_version;
+  gint va_minor_version;
   guint use_foreign_display:1;
-  guint has_vpp:1;
-  guint has_profiles:1;
   guint got_scrres:1;
+  guint thread_safe:1;
   guint driver_quirks;
+
+  /* the contended acquisitions are recorded under lock_stats_mutex,
+     all of them are counted atomically in lock_acquisitions */
+  gsize lock_acquisitions[2];
+  GMutex lock_stats_mutex;
+  GstVaapiDisplayLockStats lock_stats[2];
 };
 
 /**
@@ -206,6 +210,36 @@ GstVaapiDisplay *
 gst_vaapi_display_config (GstVaapiDisplay * display,
     GstVaapiDisplayInitType init_type, gpointer init_value);
 
+/**
+ * GST_VAAPI_DISPLAY_LOCK_CONTEXT:
+ * @display: a #GstVaapiDisplay
+ * @mutex: (nullable): the #GRecMutex protecting a VA context
+ *
+ * Locks @display for submitting work to the VA context protected by
+ * @mutex. On thread-safe drivers, only @mutex is locked, if any.
+ */
+#define GST_VAAPI_DISPLAY_LOCK_CONTEXT(display, mutex) \
+  gst_vaapi_display_lock_context (GST_VAAPI_DISPLAY_CAST (display), mutex)
+
+/**
+ * GST_VAAPI_DISPLAY_UNLOCK_CONTEXT:
+ * @display: a #GstVaapiDisplay
+ * @mutex: (nullable): the #GRecMutex protecting a VA context
+ *
+ * Unlocks @display after GST_VAAPI_DISPLAY_LOCK_CONTEXT().
+ */
+#define GST_VAAPI_DISPLAY_UNLOCK_CONTEXT(display, mutex) \
+  gst_vaapi_display_unlock_context (GST_VAAPI_DISPLAY_CAST (display), mutex)
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_display_lock_context (GstVaapiDisplay * display, GRecMutex * mutex);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_display_unlock_context (GstVaapiDisplay * display,
+    GRecMutex * mutex);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_DISPLAY_PRIV_H */
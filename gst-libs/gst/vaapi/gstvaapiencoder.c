@@ -25,8 +25,11 @@
 #include "gstvaapicompat.h"
 #include "gstvaapiencoder.h"
 #include "gstvaapiencoder_priv.h"
+#include "gstvaapiencoder_qpmap.h"
+#include "gstvaapicodedbufferproxy_priv.h"
 #include "gstvaapicontext.h"
 #include "gstvaapidisplay_priv.h"
+#include "gstvaapitrace.h"
 #include "gstvaapiutils.h"
 #include "gstvaapiutils_core.h"
 #include "gstvaapivalue.h"
@@ -96,6 +99,128 @@ gst_vaapi_encoder_ensure_param_control_rate (GstVaapiEncoder * encoder,
   return TRUE;
 }
 
+/* Same as gst_vaapi_encoder_ensure_param_control_rate(), with the
+ * layer structure, and the rate control and frame rate of each layer.
+ * The bitrates of the layers are cumulative, in kbps */
+gboolean
+gst_vaapi_encoder_ensure_param_temporal_layers (GstVaapiEncoder * encoder,
+    GstVaapiEncPicture * picture, const GstVaapiTemporalLayers * layers,
+    const guint * bitrates)
+{
+#if VA_CHECK_VERSION(1,0,0)
+  GstVaapiEncMiscParam *misc;
+  VAEncMiscParameterTemporalLayerStructure *structure;
+  VAEncMiscParameterRateControl *rate_control;
+  VAEncMiscParameterFrameRate *frame_rate;
+  GstVideoInfo *const vip = GST_VAAPI_ENCODER_VIDEO_INFO (encoder);
+  gint fps_n, fps_d;
+  guint i;
+
+  /* Layer structure */
+  misc = GST_VAAPI_ENC_MISC_PARAM_NEW (TemporalLayerStructure, encoder);
+  if (!misc)
+    return FALSE;
+  structure = misc->data;
+  structure->number_of_layers = layers->num_layers;
+  structure->periodicity = layers->periodicity;
+  for (i = 0; i < layers->periodicity; i++)
+    structure->layer_id[i] = layers->pattern[i].temporal_id;
+  gst_vaapi_enc_picture_add_misc_param (picture, misc);
+  gst_vaapi_codec_object_replace (&misc, NULL);
+
+  if (GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CQP)
+    return TRUE;
+
+  /* HRD params */
+  misc = GST_VAAPI_ENC_MISC_PARAM_NEW (HRD, encoder);
+  if (!misc)
+    return FALSE;
+  memcpy (misc->data, &GST_VAAPI_ENCODER_VA_HRD (encoder),
+      sizeof (VAEncMiscParameterHRD));
+  gst_vaapi_enc_picture_add_misc_param (picture, misc);
+  gst_vaapi_codec_object_replace (&misc, NULL);
+
+  for (i = 0; i < layers->num_layers; i++) {
+    /* RateControl params */
+    misc = GST_VAAPI_ENC_MISC_PARAM_NEW (RateControl, encoder);
+    if (!misc)
+      return FALSE;
+    rate_control = misc->data;
+    *rate_control = GST_VAAPI_ENCODER_VA_RATE_CONTROL (encoder);
+    rate_control->bits_per_second = bitrates[i] * 1000;
+    rate_control->rc_flags.bits.temporal_id = i;
+    gst_vaapi_enc_picture_add_misc_param (picture, misc);
+    gst_vaapi_codec_object_replace (&misc, NULL);
+
+    /* FrameRate params */
+    if (GST_VAAPI_ENCODER_VA_FRAME_RATE (encoder).framerate == 0)
+      continue;
+
+    gst_vaapi_temporal_layers_get_framerate (layers, i,
+        GST_VIDEO_INFO_FPS_N (vip), GST_VIDEO_INFO_FPS_D (vip), &fps_n,
+        &fps_d);
+    if (fps_n > G_MAXUINT16 || fps_d > G_MAXUINT16) {
+      GST_WARNING ("cannot express the frame rate %d/%d of layer %u",
+          fps_n, fps_d, i);
+      continue;
+    }
+
+    misc = GST_VAAPI_ENC_MISC_PARAM_NEW (FrameRate, encoder);
+    if (!misc)
+      return FALSE;
+    frame_rate = misc->data;
+    frame_rate->framerate = fps_d << 16 | fps_n;
+    frame_rate->framerate_flags.bits.temporal_id = i;
+    gst_vaapi_enc_picture_add_misc_param (picture, misc);
+    gst_vaapi_codec_object_replace (&misc, NULL);
+  }
+  return TRUE;
+#else
+  return gst_vaapi_encoder_ensure_param_control_rate (encoder, picture);
+#endif
+}
+
+/* Resets the software rate control, if enabled in constant-qp mode:
+ * the QP of each picture is then picked from the sizes of the coded
+ * pictures, to reach the target bitrate with a virtual buffer of
+ * cpb_length ms. A running software rate control only gets the new
+ * target. The per-frame budget needs a fixed framerate: variable
+ * framerate streams are coded with the constant QPs */
+void
+gst_vaapi_encoder_ensure_sw_rate_control (GstVaapiEncoder * encoder,
+    guint cpb_length, gint init_qp, gint min_qp, gint max_qp)
+{
+  const gboolean was_active = encoder->sw_rc_active;
+
+  encoder->sw_rc_active = FALSE;
+  if (!encoder->software_rate_control ||
+      GST_VAAPI_ENCODER_RATE_CONTROL (encoder) != GST_VAAPI_RATECONTROL_CQP ||
+      encoder->bitrate == 0)
+    return;
+
+  if (GST_VAAPI_ENCODER_FPS_N (encoder) <= 0 ||
+      GST_VAAPI_ENCODER_FPS_D (encoder) <= 0) {
+    GST_WARNING ("software rate control needs a fixed framerate, "
+        "falling back to constant-qp");
+    return;
+  }
+  encoder->sw_rc_active = TRUE;
+
+  if (was_active) {
+    g_mutex_lock (&encoder->mutex);
+    gst_vaapi_sw_rate_control_set_target (&encoder->sw_rc, encoder->bitrate,
+        GST_VAAPI_ENCODER_FPS_N (encoder), GST_VAAPI_ENCODER_FPS_D (encoder),
+        cpb_length, min_qp, max_qp);
+    g_mutex_unlock (&encoder->mutex);
+    return;
+  }
+
+  gst_vaapi_sw_rate_control_init (&encoder->sw_rc, encoder->bitrate,
+      GST_VAAPI_ENCODER_FPS_N (encoder), GST_VAAPI_ENCODER_FPS_D (encoder),
+      cpb_length, init_qp, min_qp, max_qp);
+  GST_INFO ("software rate control targets %u kbps", encoder->bitrate);
+}
+
 gboolean
 gst_vaapi_encoder_ensure_param_trellis (GstVaapiEncoder * encoder,
     GstVaapiEncPicture * picture)
@@ -125,6 +250,154 @@ gst_vaapi_encoder_ensure_param_trellis (GstVaapiEncoder * encoder,
   return TRUE;
 }
 
+gboolean
+gst_vaapi_encoder_ensure_param_intra_refresh (GstVaapiEncoder * encoder,
+    GstVaapiEncPicture * picture, GstVaapiEncoderIntraRefresh mode,
+    guint location, guint size)
+{
+#if VA_CHECK_VERSION(1,0,0)
+  GstVaapiEncMiscParam *misc;
+  VAEncMiscParameterRIR *param;
+
+  if (mode == GST_VAAPI_ENCODER_INTRA_REFRESH_NONE || size == 0)
+    return TRUE;
+
+  misc = GST_VAAPI_ENC_MISC_PARAM_NEW (RIR, encoder);
+  if (!misc)
+    return FALSE;
+  if (!misc->data)
+    return FALSE;
+
+  param = (VAEncMiscParameterRIR *) misc->data;
+  param->rir_flags.bits.enable_rir_column =
+      (mode == GST_VAAPI_ENCODER_INTRA_REFRESH_COLUMN);
+  param->rir_flags.bits.enable_rir_row =
+      (mode == GST_VAAPI_ENCODER_INTRA_REFRESH_ROW);
+  param->intra_insertion_location = location;
+  param->intra_insert_size = size;
+
+  gst_vaapi_enc_picture_add_misc_param (picture, misc);
+  gst_vaapi_codec_object_replace (&misc, NULL);
+#endif
+  return TRUE;
+}
+
+/**
+ * gst_vaapi_encoder_get_picture_qp:
+ * @encoder: a #GstVaapiEncoder
+ * @picture: a #GstVaapiEncPicture
+ * @qp_i: the QP of the intra pictures
+ * @qp_ip: the QP difference of the P pictures with the intra ones
+ * @qp_ib: the QP difference of the B pictures with the intra ones
+ * @min_qp: the minimal QP
+ * @max_qp: the maximal QP
+ *
+ * Computes the QP of the slices of @picture in constant-qp mode,
+ * unless the software rate control already chose it.
+ *
+ * Returns: the QP of @picture
+ **/
+gint
+gst_vaapi_encoder_get_picture_qp (GstVaapiEncoder * encoder,
+    GstVaapiEncPicture * picture, gint qp_i, gint qp_ip, gint qp_ib,
+    gint min_qp, gint max_qp)
+{
+  gint qp = qp_i;
+
+  /* chosen by the software rate control */
+  if (picture->sw_rc_qp >= 0)
+    return picture->sw_rc_qp;
+
+  if (picture->type == GST_VAAPI_PICTURE_TYPE_P)
+    qp += qp_ip;
+  else if (picture->type == GST_VAAPI_PICTURE_TYPE_B)
+    qp += qp_ib;
+  return CLAMP (qp, min_qp, max_qp);
+}
+
+/**
+ * gst_vaapi_encoder_ensure_qp_map:
+ * @encoder: a #GstVaapiEncoder
+ * @picture: the #GstVaapiEncPicture to encode
+ * @base_qp: the QP of @picture
+ * @min_qp: the minimal QP
+ * @max_qp: the maximal QP
+ *
+ * Submits the QP delta map attached to the input buffer of @picture,
+ * if any, as a VAEncQPBufferType holding the QP of each block. The
+ * drivers only honour it in constant-qp mode: with the other rate
+ * controls, the map is collapsed into ROI regions by
+ * gst_vaapi_encoder_ensure_param_roi_regions().
+ *
+ * Returns: %FALSE on error
+ **/
+gboolean
+gst_vaapi_encoder_ensure_qp_map (GstVaapiEncoder * encoder,
+    GstVaapiEncPicture * picture, gint base_qp, gint min_qp, gint max_qp)
+{
+  const guint block_size = encoder->qp_block_size;
+  GstVaapiQPMap map;
+  GstBuffer *input;
+  guint columns, rows, pitch;
+  guint8 *qps;
+
+  if (block_size == 0 ||
+      GST_VAAPI_ENCODER_RATE_CONTROL (encoder) != GST_VAAPI_RATECONTROL_CQP)
+    return TRUE;
+
+  if (!picture->frame)
+    return FALSE;
+
+  input = picture->frame->input_buffer;
+  if (!input)
+    return FALSE;
+
+  if (!gst_vaapi_buffer_get_qp_map (input, &map))
+    return TRUE;
+
+  columns = (GST_VAAPI_ENCODER_WIDTH (encoder) + block_size - 1) / block_size;
+  rows = (GST_VAAPI_ENCODER_HEIGHT (encoder) + block_size - 1) / block_size;
+
+  qps = gst_vaapi_enc_picture_alloc_qp_map (picture, columns, rows, &pitch);
+  if (!qps)
+    return FALSE;
+
+  gst_vaapi_qp_map_get_block_qps (&map, block_size, columns, rows, pitch,
+      base_qp, min_qp, max_qp, qps);
+  picture->has_roi = TRUE;
+  return TRUE;
+}
+
+/* Fills the ROI regions from a QP delta map, after the ones of the
+   GstVideoRegionOfInterestMeta */
+static guint
+fill_roi_regions_from_qp_map (GstVaapiEncoder * encoder,
+    const GstVaapiQPMap * map, VAEncROI * region_roi, guint max_roi,
+    gint min_delta_qp, gint max_delta_qp)
+{
+  GstVaapiQPRegion *regions;
+  guint i, num_regions;
+
+  regions = g_newa (GstVaapiQPRegion, max_roi);
+  num_regions = gst_vaapi_qp_map_get_regions (map,
+      GST_VAAPI_ENCODER_WIDTH (encoder), GST_VAAPI_ENCODER_HEIGHT (encoder),
+      regions, max_roi);
+
+  for (i = 0; i < num_regions; i++) {
+    GST_LOG ("QP map region: (%d, %d) %dx%d delta-qp %d", regions[i].x,
+        regions[i].y, regions[i].width, regions[i].height,
+        regions[i].delta_qp);
+
+    region_roi[i].roi_rectangle.x = regions[i].x;
+    region_roi[i].roi_rectangle.y = regions[i].y;
+    region_roi[i].roi_rectangle.width = regions[i].width;
+    region_roi[i].roi_rectangle.height = regions[i].height;
+    region_roi[i].roi_value =
+        CLAMP (regions[i].delta_qp, min_delta_qp, max_delta_qp);
+  }
+  return num_regions;
+}
+
 gboolean
 gst_vaapi_encoder_ensure_param_roi_regions (GstVaapiEncoder * encoder,
     GstVaapiEncPicture * picture)
@@ -136,7 +409,9 @@ gst_vaapi_encoder_ensure_param_roi_regions (GstVaapiEncoder * encoder,
   GstVaapiEncMiscParam *misc;
   VAEncROI *region_roi;
   GstBuffer *input;
-  guint num_roi, i;
+  GstVaapiQPMap map;
+  gboolean has_qp_map;
+  guint num_meta, num_roi, i;
   gpointer state = NULL;
 
   if (!config->roi_capability)
@@ -149,15 +424,20 @@ gst_vaapi_encoder_ensure_param_roi_regions (GstVaapiEncoder * encoder,
   if (!input)
     return FALSE;
 
-  num_roi =
+  num_meta =
       gst_buffer_get_n_meta (input, GST_VIDEO_REGION_OF_INTEREST_META_API_TYPE);
-  if (num_roi == 0)
+
+  /* the QP map was not submitted as is */
+  has_qp_map = picture->qp_map_id == VA_INVALID_ID &&
+      gst_vaapi_buffer_get_qp_map (input, &map);
+
+  if (num_meta == 0 && !has_qp_map)
     return TRUE;
-  num_roi = CLAMP (num_roi, 1, config->roi_num_supported);
 
   misc =
       gst_vaapi_enc_misc_param_new (encoder, VAEncMiscParameterTypeROI,
-      sizeof (VAEncMiscParameterBufferROI) + num_roi * sizeof (VAEncROI));
+      sizeof (VAEncMiscParameterBufferROI) +
+      config->roi_num_supported * sizeof (VAEncROI));
   if (!misc)
     return FALSE;
 
@@ -166,7 +446,6 @@ gst_vaapi_encoder_ensure_param_roi_regions (GstVaapiEncoder * encoder,
       sizeof (VAEncMiscParameterBufferROI));
 
   roi_param = misc->data;
-  roi_param->num_roi = num_roi;
   roi_param->roi = region_roi;
 
   /* roi_value in VAEncROI should be used as ROI delta QP */
@@ -174,7 +453,8 @@ gst_vaapi_encoder_ensure_param_roi_regions (GstVaapiEncoder * encoder,
   roi_param->max_delta_qp = 10;
   roi_param->min_delta_qp = -10;
 
-  for (i = 0; i < num_roi; i++) {
+  num_roi = 0;
+  for (i = 0; i < num_meta && num_roi < config->roi_num_supported; i++) {
     GstVideoRegionOfInterestMeta *roi;
     GstStructure *s;
 
@@ -193,12 +473,10 @@ gst_vaapi_encoder_ensure_param_roi_regions (GstVaapiEncoder * encoder,
         g_quark_to_string (roi->roi_type), roi->id, roi->x, roi->y, roi->w,
         roi->h);
 
-    picture->has_roi = TRUE;
-
-    region_roi[i].roi_rectangle.x = roi->x;
-    region_roi[i].roi_rectangle.y = roi->y;
-    region_roi[i].roi_rectangle.width = roi->w;
-    region_roi[i].roi_rectangle.height = roi->h;
+    region_roi[num_roi].roi_rectangle.x = roi->x;
+    region_roi[num_roi].roi_rectangle.y = roi->y;
+    region_roi[num_roi].roi_rectangle.width = roi->w;
+    region_roi[num_roi].roi_rectangle.height = roi->h;
 
     s = gst_video_region_of_interest_meta_get_param (roi, "roi/vaapi");
     if (s) {
@@ -207,17 +485,28 @@ gst_vaapi_encoder_ensure_param_roi_regions (GstVaapiEncoder * encoder,
       if (!gst_structure_get_int (s, "delta-qp", &value))
         continue;
       value = CLAMP (value, roi_param->min_delta_qp, roi_param->max_delta_qp);
-      region_roi[i].roi_value = value;
+      region_roi[num_roi].roi_value = value;
     } else {
-      region_roi[i].roi_value = encoder->default_roi_value;
+      region_roi[num_roi].roi_value = encoder->default_roi_value;
 
       GST_LOG ("No ROI value specified upstream, use default (%d)",
           encoder->default_roi_value);
     }
+    num_roi++;
   }
 
-  if (picture->has_roi)
+  /* the regions of the QP map come last, with a lower priority */
+  if (has_qp_map && num_roi < config->roi_num_supported) {
+    num_roi += fill_roi_regions_from_qp_map (encoder, &map,
+        &region_roi[num_roi], config->roi_num_supported - num_roi,
+        roi_param->min_delta_qp, roi_param->max_delta_qp);
+  }
+
+  roi_param->num_roi = num_roi;
+  if (num_roi > 0) {
+    picture->has_roi = TRUE;
     gst_vaapi_enc_picture_add_misc_param (picture, misc);
+  }
 
   gst_vaapi_codec_object_replace (&misc, NULL);
 #endif
@@ -311,6 +600,72 @@ gst_vaapi_encoder_create_surface (GstVaapiEncoder * encoder)
   return proxy;
 }
 
+static GstVaapiSwRateControlFrameType
+get_sw_rc_frame_type (GstVaapiEncPicture * picture)
+{
+  switch (picture->type) {
+    case GST_VAAPI_PICTURE_TYPE_I:
+      return GST_VAAPI_SW_RC_FRAME_I;
+    case GST_VAAPI_PICTURE_TYPE_B:
+      return GST_VAAPI_SW_RC_FRAME_B;
+    default:
+      return GST_VAAPI_SW_RC_FRAME_P;
+  }
+}
+
+static GstVaapiEncoderFrameType
+get_stats_frame_type (GstVaapiEncPicture * picture)
+{
+  switch (picture->type) {
+    case GST_VAAPI_PICTURE_TYPE_I:
+      return GST_VAAPI_ENCODER_FRAME_I;
+    case GST_VAAPI_PICTURE_TYPE_B:
+      return GST_VAAPI_ENCODER_FRAME_B;
+    default:
+      return GST_VAAPI_ENCODER_FRAME_P;
+  }
+}
+
+static inline gboolean
+collects_stats (GstVaapiEncoder * encoder)
+{
+  return encoder->frame_stats || encoder->stats_interval > 0;
+}
+
+/* Fills the statistics of the coded frame of @picture in, from the
+   status the driver reports in its coded buffer */
+static void
+set_frame_stats (GstVaapiEncPicture * picture,
+    GstVaapiCodedBufferProxy * codedbuf_proxy)
+{
+  GstVaapiEncoderFrameStats *const stats = &codedbuf_proxy->stats;
+  GstVaapiCodedBuffer *const buf =
+      GST_VAAPI_CODED_BUFFER_PROXY_BUFFER (codedbuf_proxy);
+  VACodedBufferSegment *segment;
+  guint qp = 0;
+
+  stats->frame_type = get_stats_frame_type (picture);
+  stats->encode_latency = gst_util_get_timestamp () - picture->submit_time;
+  stats->hrd_fullness = -1;
+
+  stats->coded_size = 0;
+  if (gst_vaapi_coded_buffer_map (buf, &segment)) {
+    if (segment)
+      qp = segment->status & VA_CODED_BUF_STATUS_PICTURE_AVE_QP_MASK;
+    for (; segment != NULL; segment = segment->next)
+      stats->coded_size += segment->size;
+    gst_vaapi_coded_buffer_unmap (buf);
+  }
+
+  /* the drivers that do not report the average QP leave it to 0 */
+  if (picture->sw_rc_qp >= 0)
+    stats->qp = picture->sw_rc_qp;
+  else
+    stats->qp = qp > 0 ? qp : -1;
+
+  codedbuf_proxy->has_stats = TRUE;
+}
+
 /* Create a coded buffer proxy where the picture is going to be
  * decoded, the subclass encode vmethod is called and, if it doesn't
  * fail, the coded buffer is pushed into the async queue */
@@ -326,10 +681,27 @@ gst_vaapi_encoder_encode_and_queue (GstVaapiEncoder * encoder,
   if (!codedbuf_proxy)
     goto error_create_coded_buffer;
 
+  g_mutex_lock (&encoder->mutex);
+  if (encoder->rate_control_applied) {
+    GST_VAAPI_ENC_PICTURE_FLAG_SET (picture,
+        GST_VAAPI_ENC_PICTURE_FLAG_RATE_CONTROL);
+    encoder->rate_control_applied = FALSE;
+  }
+  if (encoder->sw_rc_active)
+    picture->sw_rc_qp = gst_vaapi_sw_rate_control_get_qp (&encoder->sw_rc,
+        get_sw_rc_frame_type (picture), &picture->sw_rc_target);
+  g_mutex_unlock (&encoder->mutex);
+
+  if (collects_stats (encoder))
+    picture->submit_time = gst_util_get_timestamp ();
+
   status = klass->encode (encoder, picture, codedbuf_proxy);
   if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
     goto error_encode;
 
+  GST_VAAPI_TRACE (GST_VAAPI_TRACE_ENCODE_SUBMIT, encoder,
+      picture->frame ? picture->frame->pts : GST_CLOCK_TIME_NONE);
+
   gst_vaapi_coded_buffer_proxy_set_user_data (codedbuf_proxy,
       picture, (GDestroyNotify) gst_vaapi_mini_object_unref);
   g_async_queue_push (encoder->codedbuf_queue, codedbuf_proxy);
@@ -351,6 +723,9 @@ error_encode:
   }
 }
 
+static GstVaapiEncoderStatus
+apply_rate_control_changes (GstVaapiEncoder * encoder);
+
 /**
  * gst_vaapi_encoder_put_frame:
  * @encoder: a #GstVaapiEncoder
@@ -369,6 +744,14 @@ gst_vaapi_encoder_put_frame (GstVaapiEncoder * encoder,
   GstVaapiEncoderStatus status;
   GstVaapiEncPicture *picture;
 
+  if (frame)
+    gst_vaapi_va_calls_add_frame (&encoder->va_calls);
+  gst_vaapi_va_calls_push (&encoder->va_calls);
+
+  status = apply_rate_control_changes (encoder);
+  if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
+    goto error_rate_control;
+
   for (;;) {
     picture = NULL;
     status = klass->reordering (encoder, frame, &picture);
@@ -384,17 +767,26 @@ gst_vaapi_encoder_put_frame (GstVaapiEncoder * encoder,
     /* Try again with any pending reordered frame now available for encoding */
     frame = NULL;
   }
+  gst_vaapi_va_calls_pop ();
   return GST_VAAPI_ENCODER_STATUS_SUCCESS;
 
   /* ERRORS */
+error_rate_control:
+  {
+    GST_ERROR ("failed to update the rate control");
+    gst_vaapi_va_calls_pop ();
+    return status;
+  }
 error_reorder_frame:
   {
     GST_ERROR ("failed to process reordered frames");
+    gst_vaapi_va_calls_pop ();
     return status;
   }
 error_encode:
   {
     gst_vaapi_enc_picture_unref (picture);
+    gst_vaapi_va_calls_pop ();
     return status;
   }
 }
@@ -430,8 +822,40 @@ gst_vaapi_encoder_get_buffer_with_timeout (GstVaapiEncoder * encoder,
 
   /* Wait for completion of all operations and report any error that occurred */
   picture = gst_vaapi_coded_buffer_proxy_get_user_data (codedbuf_proxy);
-  if (!gst_vaapi_surface_sync (picture->surface))
+  gst_vaapi_va_calls_push (&encoder->va_calls);
+  if (!gst_vaapi_surface_sync (picture->surface)) {
+    gst_vaapi_va_calls_pop ();
     goto error_invalid_buffer;
+  }
+  gst_vaapi_va_calls_pop ();
+
+  /* this runs from the output thread: identify the frame by its pts */
+  GST_VAAPI_TRACE (GST_VAAPI_TRACE_CODED_READY, encoder, picture->frame->pts);
+
+  /* the coded buffers come out in coding order */
+  if (picture->sw_rc_qp >= 0) {
+    const gssize size =
+        GST_VAAPI_CODED_BUFFER_PROXY_BUFFER_SIZE (codedbuf_proxy);
+
+    g_mutex_lock (&encoder->mutex);
+    gst_vaapi_sw_rate_control_update (&encoder->sw_rc,
+        get_sw_rc_frame_type (picture), picture->sw_rc_qp,
+        picture->sw_rc_target, size > 0 ? size * 8 : 0);
+    g_mutex_unlock (&encoder->mutex);
+  }
+
+  if (picture->num_temporal_layers > 0) {
+    codedbuf_proxy->temporal_id = picture->temporal_id;
+    codedbuf_proxy->num_temporal_layers = picture->num_temporal_layers;
+    codedbuf_proxy->layer_sync = GST_VAAPI_ENC_PICTURE_FLAG_IS_SET (picture,
+        GST_VAAPI_ENC_PICTURE_FLAG_LAYER_SYNC);
+  }
+
+  codedbuf_proxy->new_rate_control = GST_VAAPI_ENC_PICTURE_FLAG_IS_SET (picture,
+      GST_VAAPI_ENC_PICTURE_FLAG_RATE_CONTROL);
+
+  if (GST_CLOCK_TIME_IS_VALID (picture->submit_time))
+    set_frame_stats (picture, codedbuf_proxy);
 
   gst_vaapi_coded_buffer_proxy_set_user_data (codedbuf_proxy,
       gst_video_codec_frame_ref (picture->frame),
@@ -479,6 +903,7 @@ gst_vaapi_encoder_flush (GstVaapiEncoder * encoder)
   gpointer iter = NULL;
 
   picture = NULL;
+  gst_vaapi_va_calls_push (&encoder->va_calls);
   while (_get_pending_reordered (encoder, &picture, &iter)) {
     if (!picture)
       continue;
@@ -487,6 +912,7 @@ gst_vaapi_encoder_flush (GstVaapiEncoder * encoder)
       goto error_encode;
   }
   g_free (iter);
+  gst_vaapi_va_calls_pop ();
 
   return klass->flush (encoder);
 
@@ -494,6 +920,7 @@ gst_vaapi_encoder_flush (GstVaapiEncoder * encoder)
 error_encode:
   {
     gst_vaapi_enc_picture_unref (picture);
+    gst_vaapi_va_calls_pop ();
     return status;
   }
 }
@@ -613,15 +1040,19 @@ get_packed_headers (GstVaapiEncoder * encoder)
       GST_VAAPI_ENCODER_GET_CLASS (encoder)->class_data;
   guint value;
 
-  if (encoder->got_packed_headers)
-    return encoder->packed_headers;
+  if (!encoder->got_packed_headers) {
+    if (!get_config_attribute (encoder, VAConfigAttribEncPackedHeaders,
+            &value))
+      value = 0;
+    GST_INFO ("supported packed headers: 0x%08x", value);
 
-  if (!get_config_attribute (encoder, VAConfigAttribEncPackedHeaders, &value))
-    value = 0;
-  GST_INFO ("supported packed headers: 0x%08x", value);
+    encoder->got_packed_headers = TRUE;
+    encoder->va_packed_headers = value;
+  }
 
-  encoder->got_packed_headers = TRUE;
-  encoder->packed_headers = cdata->packed_headers & value;
+  /* the optional packed headers depend on the current configuration */
+  encoder->packed_headers = (cdata->packed_headers |
+      encoder->optional_packed_headers) & encoder->va_packed_headers;
 
   return encoder->packed_headers;
 }
@@ -657,6 +1088,24 @@ get_roi_capability (GstVaapiEncoder * encoder, guint * num_roi_supported)
 #endif
 }
 
+/* Determines the size of the blocks of VAEncQPBufferType, returns 0
+   if the driver doesn't support QP maps */
+static guint
+get_qp_block_size (GstVaapiEncoder * encoder)
+{
+#if VA_CHECK_VERSION(1,1,0)
+  guint value;
+
+  if (!get_config_attribute (encoder, VAConfigAttribQPBlockSize, &value))
+    return 0;
+
+  GST_INFO ("Support for QP maps - block size: %d", value);
+  return value;
+#else
+  return 0;
+#endif
+}
+
 static inline gboolean
 is_chroma_type_supported (GstVaapiEncoder * encoder)
 {
@@ -745,6 +1194,7 @@ set_context_info (GstVaapiEncoder * encoder)
   config->packed_headers = get_packed_headers (encoder);
   config->roi_capability =
       get_roi_capability (encoder, &config->roi_num_supported);
+  encoder->qp_block_size = get_qp_block_size (encoder);
 
   return TRUE;
 
@@ -773,29 +1223,22 @@ gst_vaapi_encoder_ensure_context (GstVaapiEncoder * encoder)
     encoder->context = gst_vaapi_context_new (encoder->display, cip);
     if (!encoder->context)
       return FALSE;
+    /* a smaller resolution is coded into the current surfaces */
+    gst_vaapi_context_reset_on_resize (encoder->context, FALSE);
   }
   encoder->va_context = gst_vaapi_context_get_id (encoder->context);
   return TRUE;
 }
 
-/* Reconfigures the encoder with the new properties */
-static GstVaapiEncoderStatus
-gst_vaapi_encoder_reconfigure_internal (GstVaapiEncoder * encoder)
+/* Sets the default frame rate and rate control parameters, refined by
+   the subclasses */
+static void
+init_rate_control_params (GstVaapiEncoder * encoder)
 {
-  GstVaapiEncoderClass *const klass = GST_VAAPI_ENCODER_GET_CLASS (encoder);
   GstVideoInfo *const vip = GST_VAAPI_ENCODER_VIDEO_INFO (encoder);
-  GstVaapiEncoderStatus status;
-  GstVaapiVideoPool *pool;
-  guint codedbuf_size, target_percentage;
-  guint fps_d, fps_n;
-  guint quality_level_max = 0;
-
-  fps_d = GST_VIDEO_INFO_FPS_D (vip);
-  fps_n = GST_VIDEO_INFO_FPS_N (vip);
-
-  /* Generate a keyframe every second */
-  if (!encoder->keyframe_period)
-    encoder->keyframe_period = (fps_n + fps_d - 1) / fps_d;
+  const guint fps_d = GST_VIDEO_INFO_FPS_D (vip);
+  const guint fps_n = GST_VIDEO_INFO_FPS_N (vip);
+  guint target_percentage;
 
   /* Default frame rate parameter */
   if (fps_d > 0 && fps_n > 0)
@@ -813,6 +1256,32 @@ gst_vaapi_encoder_reconfigure_internal (GstVaapiEncoder * encoder)
     .window_size = 500,
   };
   /* *INDENT-ON* */
+}
+
+/* Reconfigures the encoder with the new properties */
+static GstVaapiEncoderStatus
+gst_vaapi_encoder_reconfigure_internal (GstVaapiEncoder * encoder)
+{
+  GstVaapiEncoderClass *const klass = GST_VAAPI_ENCODER_GET_CLASS (encoder);
+  GstVideoInfo *const vip = GST_VAAPI_ENCODER_VIDEO_INFO (encoder);
+  GstVaapiEncoderStatus status;
+  GstVaapiVideoPool *pool;
+  guint codedbuf_size;
+  guint fps_d, fps_n;
+  guint quality_level_max = 0;
+
+  fps_d = GST_VIDEO_INFO_FPS_D (vip);
+  fps_n = GST_VIDEO_INFO_FPS_N (vip);
+
+  /* Generate a keyframe every second */
+  if (!encoder->keyframe_period)
+    encoder->keyframe_period = (fps_n + fps_d - 1) / fps_d;
+
+  init_rate_control_params (encoder);
+
+  /* the software rate control starts over */
+  encoder->sw_rc_active = FALSE;
+  encoder->rate_control_changed = FALSE;
 
   status = klass->reconfigure (encoder);
   if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
@@ -849,10 +1318,11 @@ gst_vaapi_encoder_reconfigure_internal (GstVaapiEncoder * encoder)
 #endif
   }
 
+  /* the coded buffers are only reallocated if they are too small */
   codedbuf_size = encoder->codedbuf_pool ?
       gst_vaapi_coded_buffer_pool_get_buffer_size (GST_VAAPI_CODED_BUFFER_POOL
       (encoder)) : 0;
-  if (codedbuf_size != encoder->codedbuf_size) {
+  if (codedbuf_size < encoder->codedbuf_size) {
     pool = gst_vaapi_coded_buffer_pool_new (encoder, encoder->codedbuf_size);
     if (!pool)
       goto error_alloc_codedbuf_pool;
@@ -875,6 +1345,57 @@ error_reset_context:
   }
 }
 
+/* Schedules the new rate control parameters of a running encoder for
+ * the next frame, or reconfigures the encoder if its class cannot
+ * apply them on the fly */
+GstVaapiEncoderStatus
+gst_vaapi_encoder_update_rate_control (GstVaapiEncoder * encoder)
+{
+  GstVaapiEncoderClass *const klass = GST_VAAPI_ENCODER_GET_CLASS (encoder);
+
+  if (!klass->update_rate_control) {
+    GstVaapiEncoderStatus status;
+
+    status = gst_vaapi_encoder_reconfigure_internal (encoder);
+    if (status == GST_VAAPI_ENCODER_STATUS_SUCCESS) {
+      g_mutex_lock (&encoder->mutex);
+      encoder->rate_control_applied = TRUE;
+      g_mutex_unlock (&encoder->mutex);
+    }
+    return status;
+  }
+
+  g_mutex_lock (&encoder->mutex);
+  encoder->rate_control_changed = TRUE;
+  g_mutex_unlock (&encoder->mutex);
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+}
+
+/* Applies the scheduled rate control parameters, from the thread
+ * submitting the frames: they are passed down with the next picture,
+ * and the VA context and surfaces are kept as is */
+static GstVaapiEncoderStatus
+apply_rate_control_changes (GstVaapiEncoder * encoder)
+{
+  GstVaapiEncoderClass *const klass = GST_VAAPI_ENCODER_GET_CLASS (encoder);
+  gboolean changed;
+
+  g_mutex_lock (&encoder->mutex);
+  changed = encoder->rate_control_changed;
+  encoder->rate_control_changed = FALSE;
+  if (changed)
+    encoder->rate_control_applied = TRUE;
+  g_mutex_unlock (&encoder->mutex);
+  if (!changed)
+    return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+
+  GST_INFO ("updating the rate control: %u kbps, %d/%d fps",
+      encoder->bitrate, GST_VAAPI_ENCODER_FPS_N (encoder),
+      GST_VAAPI_ENCODER_FPS_D (encoder));
+  init_rate_control_params (encoder);
+  return klass->update_rate_control (encoder);
+}
+
 /**
  * gst_vaapi_encoder_set_codec_state:
  * @encoder: a #GstVaapiEncoder
@@ -887,7 +1408,13 @@ error_reset_context:
  * This function is a synchronization point for codec configuration.
  * This means that, at this point, the encoder is reconfigured to
  * match the new properties and any other change beyond this point has
- * zero effect.
+ * zero effect. If the encoding already started and only the framerate
+ * changed, the rate control is updated from the next submitted frame
+ * instead, if the codec supports it.
+ *
+ * A resolution change of a running encoder codes the pending frames at
+ * the previous resolution first, and the next frame starts a new
+ * sequence, with the same VA context.
  *
  * Return value: a #GstVaapiEncoderStatus
  */
@@ -896,16 +1423,48 @@ gst_vaapi_encoder_set_codec_state (GstVaapiEncoder * encoder,
     GstVideoCodecState * state)
 {
   GstVaapiEncoderStatus status;
+  GstVideoInfo info;
 
   g_return_val_if_fail (encoder != NULL,
       GST_VAAPI_ENCODER_STATUS_ERROR_INVALID_PARAMETER);
   g_return_val_if_fail (state != NULL,
       GST_VAAPI_ENCODER_STATUS_ERROR_INVALID_PARAMETER);
 
+  if (encoder->num_codedbuf_queued > 0
+      && GST_VIDEO_INFO_FPS_N (&state->info) > 0
+      && GST_VIDEO_INFO_FPS_D (&state->info) > 0) {
+    info = encoder->video_info;
+    GST_VIDEO_INFO_FPS_N (&info) = GST_VIDEO_INFO_FPS_N (&state->info);
+    GST_VIDEO_INFO_FPS_D (&info) = GST_VIDEO_INFO_FPS_D (&state->info);
+    if (gst_video_info_is_equal (&state->info, &info)) {
+      if (gst_video_info_is_equal (&state->info, &encoder->video_info))
+        return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+      GST_INFO ("framerate is changed to %d/%d on runtime",
+          GST_VIDEO_INFO_FPS_N (&info), GST_VIDEO_INFO_FPS_D (&info));
+      encoder->video_info = info;
+      return gst_vaapi_encoder_update_rate_control (encoder);
+    }
+  }
+
   if (!gst_video_info_is_equal (&state->info, &encoder->video_info)) {
     status = check_video_info (encoder, &state->info);
     if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
       return status;
+
+    /* the pending pictures are coded at the previous resolution, and
+       the next one starts a new sequence */
+    if (encoder->num_codedbuf_queued > 0 &&
+        (GST_VIDEO_INFO_WIDTH (&state->info) !=
+            GST_VAAPI_ENCODER_WIDTH (encoder)
+            || GST_VIDEO_INFO_HEIGHT (&state->info) !=
+            GST_VAAPI_ENCODER_HEIGHT (encoder))) {
+      GST_INFO ("resolution is changed to %dx%d on runtime",
+          GST_VIDEO_INFO_WIDTH (&state->info),
+          GST_VIDEO_INFO_HEIGHT (&state->info));
+      status = gst_vaapi_encoder_flush (encoder);
+      if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
+        return status;
+    }
     encoder->video_info = state->info;
   }
   return gst_vaapi_encoder_reconfigure_internal (encoder);
@@ -994,10 +1553,9 @@ error_unsupported_rate_control:
  *
  * Notifies the @encoder to use the supplied @bitrate value.
  *
- * Note: currently, the bitrate can only be specified before the first
- * frame is encoded. Afterwards, any change to this parameter is
- * invalid and @GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED is
- * returned.
+ * Once the encoding started, the new @bitrate is applied from the
+ * next submitted frame, without resetting the encoder, if the codec
+ * supports it. Otherwise, the encoder is reconfigured.
  *
  * Return value: a #GstVaapiEncoderStatus
  */
@@ -1009,7 +1567,7 @@ gst_vaapi_encoder_set_bitrate (GstVaapiEncoder * encoder, guint bitrate)
   if (encoder->bitrate != bitrate && encoder->num_codedbuf_queued > 0) {
     GST_INFO ("Bitrate is changed to %d on runtime", bitrate);
     encoder->bitrate = bitrate;
-    return gst_vaapi_encoder_reconfigure_internal (encoder);
+    return gst_vaapi_encoder_update_rate_control (encoder);
   }
 
   encoder->bitrate = bitrate;
@@ -1028,7 +1586,7 @@ gst_vaapi_encoder_set_target_percentage (GstVaapiEncoder * encoder,
       GST_INFO ("Target percentage is changed to %d on runtime",
           target_percentage);
       encoder->target_percentage = target_percentage;
-      return gst_vaapi_encoder_reconfigure_internal (encoder);
+      return gst_vaapi_encoder_update_rate_control (encoder);
     }
     GST_WARNING ("Target percentage is ignored for CBR rate-control");
     return GST_VAAPI_ENCODER_STATUS_SUCCESS;
@@ -1179,6 +1737,44 @@ error_operation_failed:
   }
 }
 
+/**
+ * gst_vaapi_encoder_set_software_rate_control:
+ * @encoder: a #GstVaapiEncoder
+ * @enable: whether to control the bitrate in software
+ *
+ * Notifies the @encoder to pick the QP of each frame itself, from the
+ * sizes of the coded frames, when the rate control is constant QP.
+ * The bitrate property is then the target bitrate.
+ *
+ * Note: this option can only be specified before the first frame is
+ * encoded. Afterwards, any change to this parameter causes
+ * gst_vaapi_encoder_set_software_rate_control() to return
+ * @GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED.
+ *
+ * Return value: a #GstVaapiEncoderStatus
+ */
+GstVaapiEncoderStatus
+gst_vaapi_encoder_set_software_rate_control (GstVaapiEncoder * encoder,
+    gboolean enable)
+{
+  g_return_val_if_fail (encoder != NULL, 0);
+
+  if (encoder->software_rate_control != enable &&
+      encoder->num_codedbuf_queued > 0)
+    goto error_operation_failed;
+
+  encoder->software_rate_control = enable;
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+
+  /* ERRORS */
+error_operation_failed:
+  {
+    GST_ERROR ("could not change the software rate control after encoding "
+        "started");
+    return GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED;
+  }
+}
+
 G_DEFINE_ABSTRACT_TYPE (GstVaapiEncoder, gst_vaapi_encoder, GST_TYPE_OBJECT);
 
 /**
@@ -1192,6 +1788,14 @@ G_DEFINE_ABSTRACT_TYPE (GstVaapiEncoder, gst_vaapi_encoder, GST_TYPE_OBJECT);
  * @ENCODER_PROP_DEFAULT_ROI_VALUE: The default delta qp to apply
  *   to each region of interest.
  * @ENCODER_PROP_TRELLIS: Use trellis quantization method (gboolean).
+ * @ENCODER_PROP_SOFTWARE_RATE_CONTROL: Pick the QP of each frame in
+ *   software, in constant-qp mode (gboolean).
+ * @ENCODER_PROP_VERIFY_HRD: Verify the output against the HRD buffer
+ *   (gboolean).
+ * @ENCODER_PROP_FRAME_STATS: Attach the statistics of each frame to the
+ *   coded buffers (gboolean).
+ * @ENCODER_PROP_STATS_INTERVAL: Number of frames between the summaries
+ *   of the statistics, or 0 (uint).
  *
  * The set of configurable properties for the encoder.
  */
@@ -1204,6 +1808,10 @@ enum
   ENCODER_PROP_QUALITY_LEVEL,
   ENCODER_PROP_DEFAULT_ROI_VALUE,
   ENCODER_PROP_TRELLIS,
+  ENCODER_PROP_SOFTWARE_RATE_CONTROL,
+  ENCODER_PROP_VERIFY_HRD,
+  ENCODER_PROP_FRAME_STATS,
+  ENCODER_PROP_STATS_INTERVAL,
   ENCODER_N_PROPERTIES
 };
 
@@ -1250,6 +1858,21 @@ gst_vaapi_encoder_set_property (GObject * object, guint prop_id,
       status =
           gst_vaapi_encoder_set_trellis (encoder, g_value_get_boolean (value));
       break;
+    case ENCODER_PROP_SOFTWARE_RATE_CONTROL:
+      status = gst_vaapi_encoder_set_software_rate_control (encoder,
+          g_value_get_boolean (value));
+      break;
+    case ENCODER_PROP_VERIFY_HRD:
+      encoder->verify_hrd = g_value_get_boolean (value);
+      status = GST_VAAPI_ENCODER_STATUS_SUCCESS;
+      break;
+    case ENCODER_PROP_FRAME_STATS:
+      encoder->frame_stats = g_value_get_boolean (value);
+      break;
+    case ENCODER_PROP_STATS_INTERVAL:
+      encoder->stats_interval = g_value_get_uint (value);
+      status = GST_VAAPI_ENCODER_STATUS_SUCCESS;
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1288,6 +1911,18 @@ gst_vaapi_encoder_get_property (GObject * object, guint prop_id,
     case ENCODER_PROP_TRELLIS:
       g_value_set_boolean (value, encoder->trellis);
       break;
+    case ENCODER_PROP_SOFTWARE_RATE_CONTROL:
+      g_value_set_boolean (value, encoder->software_rate_control);
+      break;
+    case ENCODER_PROP_VERIFY_HRD:
+      g_value_set_boolean (value, encoder->verify_hrd);
+      break;
+    case ENCODER_PROP_FRAME_STATS:
+      g_value_set_boolean (value, encoder->frame_stats);
+      break;
+    case ENCODER_PROP_STATS_INTERVAL:
+      g_value_set_uint (value, encoder->stats_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1446,6 +2081,66 @@ gst_vaapi_encoder_class_init (GstVaapiEncoderClass * klass)
       FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
       GST_VAAPI_PARAM_ENCODER_EXPOSURE);
 
+  /**
+   * GstVaapiEncoder: software-rate-control:
+   *
+   * With the constant-qp rate control, pick the QP of each frame from
+   * the sizes of the coded frames, so as to reach the bitrate
+   * property with a virtual buffer of cpb-length ms. Only supported
+   * by the H.264 and H.265 encoders, and with a fixed framerate.
+   */
+  properties[ENCODER_PROP_SOFTWARE_RATE_CONTROL] =
+      g_param_spec_boolean ("software-rate-control",
+      "Software Rate Control",
+      "Pick the QP of each frame in software, in constant-qp mode",
+      FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
+  /**
+   * GstVaapiEncoder: verify-hrd:
+   *
+   * Model the hypothetical reference decoder buffer from the sizes of
+   * the coded frames, with the constant and variable bitrate rate
+   * controls, and report the frames that underflow or overflow it
+   * with a "GstVaapiHrdViolation" element message.
+   */
+  properties[ENCODER_PROP_VERIFY_HRD] =
+      g_param_spec_boolean ("verify-hrd",
+      "Verify HRD",
+      "Verify the output against the HRD buffer model",
+      FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
+  /**
+   * GstVaapiEncoder: frame-stats:
+   *
+   * Attach the coding type, quantizer, size, encode latency and HRD
+   * buffer fullness of each frame to its coded buffer, as a
+   * #GST_VAAPI_ENCODER_STATS_META_NAME meta.
+   */
+  properties[ENCODER_PROP_FRAME_STATS] =
+      g_param_spec_boolean ("frame-stats",
+      "Frame Statistics",
+      "Attach the statistics of each frame to the coded buffers",
+      FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
+  /**
+   * GstVaapiEncoder: stats-interval:
+   *
+   * Sum up the statistics of the frames every this many frames, and
+   * post the summary as a "GstVaapiEncoderStats" element message, as
+   * described by gst_vaapi_encoder_stats_summary_to_structure(). No
+   * summary is posted if 0.
+   */
+  properties[ENCODER_PROP_STATS_INTERVAL] =
+      g_param_spec_uint ("stats-interval",
+      "Statistics Interval",
+      "Number of frames between the statistics messages (0: disabled)",
+      0, G_MAXUINT, 0,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
   g_object_class_install_properties (object_class, ENCODER_N_PROPERTIES,
       properties);
 }
@@ -1721,6 +2416,56 @@ gst_vaapi_encoder_ensure_tile_support (GstVaapiEncoder * encoder,
   return tile > 0;
 }
 
+/**
+ * gst_vaapi_encoder_ensure_intra_refresh_support:
+ * @encoder: a #GstVaapiEncoder
+ * @profile: a #GstVaapiProfile
+ * @entrypoint: a #GstVaapiEntrypoint
+ * @mode: the requested #GstVaapiEncoderIntraRefresh
+ *
+ * This function will query VAConfigAttribEncIntraRefresh to check
+ * whether the encoder supports the rolling intra refresh @mode.
+ *
+ * We need to pass the @profile and the @entrypoint, because at the
+ * moment the encoder base class, still doesn't have them assigned,
+ * and this function is meant to be called by the derived classes
+ * while they are configured.
+ *
+ * Returns: %TRUE if supported, %FALSE if not.
+ **/
+gboolean
+gst_vaapi_encoder_ensure_intra_refresh_support (GstVaapiEncoder * encoder,
+    GstVaapiProfile profile, GstVaapiEntrypoint entrypoint,
+    GstVaapiEncoderIntraRefresh mode)
+{
+  guint value = 0, mask = 0;
+
+#if VA_CHECK_VERSION(1,0,0)
+  VAProfile va_profile;
+  VAEntrypoint va_entrypoint;
+
+  va_profile = gst_vaapi_profile_get_va_profile (profile);
+  va_entrypoint = gst_vaapi_entrypoint_get_va_entrypoint (entrypoint);
+
+  if (!gst_vaapi_get_config_attribute (encoder->display, va_profile,
+          va_entrypoint, VAConfigAttribEncIntraRefresh, &value))
+    return FALSE;
+
+  switch (mode) {
+    case GST_VAAPI_ENCODER_INTRA_REFRESH_COLUMN:
+      mask = VA_ENC_INTRA_REFRESH_ROLLING_COLUMN;
+      break;
+    case GST_VAAPI_ENCODER_INTRA_REFRESH_ROW:
+      mask = VA_ENC_INTRA_REFRESH_ROLLING_ROW;
+      break;
+    default:
+      break;
+  }
+#endif
+
+  return (value & mask) != 0;
+}
+
 GstVaapiProfile
 gst_vaapi_encoder_get_profile (GstVaapiEncoder * encoder)
 {
@@ -1822,6 +2567,73 @@ out:
   return profiles;
 }
 
+/**
+ * gst_vaapi_encoder_get_va_call_stats:
+ * @encoder: a #GstVaapiEncoder
+ * @stats: (out caller-allocates): return location for the statistics
+ *
+ * Retrieves the VA calls issued by the @encoder, and the number of
+ * frames it processed, while the VA call accounting was enabled.
+ */
+void
+gst_vaapi_encoder_get_va_call_stats (GstVaapiEncoder * encoder,
+    GstVaapiVaCallStats * stats)
+{
+  g_return_if_fail (encoder != NULL);
+
+  gst_vaapi_va_calls_get_stats (&encoder->va_calls, stats);
+}
+
+/**
+ * gst_vaapi_encoder_get_hrd_params:
+ * @encoder: a #GstVaapiEncoder
+ * @bitrate: (out): return location for the bitrate, in bits per second
+ * @buffer_size: (out): return location for the size of the coded
+ *   picture buffer, in bits
+ * @initial_fullness: (out): return location for the initial fullness
+ *   of the coded picture buffer, in bits
+ * @constant_bitrate: (out): return location for whether the bitrate
+ *   is constant
+ *
+ * Retrieves the hypothetical reference decoder buffer the @encoder
+ * was configured with, so that its output can be verified against it.
+ *
+ * Return value: %FALSE if the rate control does not use any buffer
+ */
+gboolean
+gst_vaapi_encoder_get_hrd_params (GstVaapiEncoder * encoder, guint * bitrate,
+    guint * buffer_size, guint * initial_fullness,
+    gboolean * constant_bitrate)
+{
+  const VAEncMiscParameterHRD *hrd;
+
+  g_return_val_if_fail (encoder != NULL, FALSE);
+
+  hrd = &GST_VAAPI_ENCODER_VA_HRD (encoder);
+
+  switch (GST_VAAPI_ENCODER_RATE_CONTROL (encoder)) {
+    case GST_VAAPI_RATECONTROL_CBR:
+    case GST_VAAPI_RATECONTROL_VBR:
+    case GST_VAAPI_RATECONTROL_VBR_CONSTRAINED:
+      break;
+    default:
+      return FALSE;
+  }
+  if (encoder->bitrate == 0 || hrd->buffer_size == 0)
+    return FALSE;
+
+  if (bitrate)
+    *bitrate = encoder->bitrate * 1000;
+  if (buffer_size)
+    *buffer_size = hrd->buffer_size;
+  if (initial_fullness)
+    *initial_fullness = hrd->initial_buffer_fullness;
+  if (constant_bitrate)
+    *constant_bitrate =
+        GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CBR;
+  return TRUE;
+}
+
 /** Returns a GType for the #GstVaapiEncoderTune set */
 GType
 gst_vaapi_encoder_tune_get_type (void)
@@ -1871,3 +2683,25 @@ gst_vaapi_encoder_mbbrc_get_type (void)
   }
   return g_type;
 }
+
+/** Returns a GType for the #GstVaapiEncoderIntraRefresh set */
+GType
+gst_vaapi_encoder_intra_refresh_get_type (void)
+{
+  static gsize g_type = 0;
+
+  if (g_once_init_enter (&g_type)) {
+    static const GEnumValue encoder_intra_refresh_values[] = {
+      {GST_VAAPI_ENCODER_INTRA_REFRESH_NONE, "None", "none"},
+      {GST_VAAPI_ENCODER_INTRA_REFRESH_COLUMN, "Rolling column", "column"},
+      {GST_VAAPI_ENCODER_INTRA_REFRESH_ROW, "Rolling row", "row"},
+      {0, NULL, NULL},
+    };
+
+    GType type =
+        g_enum_register_static (g_intern_static_string
+        ("GstVaapiEncoderIntraRefresh"), encoder_intra_refresh_values);
+    g_once_init_leave (&g_type, type);
+  }
+  return g_type;
+}
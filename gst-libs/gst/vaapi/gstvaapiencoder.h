@@ -26,6 +26,7 @@
 
 #include <gst/video/gstvideoutils.h>
 #include <gst/vaapi/gstvaapicodedbufferproxy.h>
+#include <gst/vaapi/gstvaapivacalls.h>
 
 G_BEGIN_DECLS
 
@@ -125,12 +126,36 @@ typedef enum {
   GST_VAAPI_ENCODER_MBBRC_OFF = 2,
 } GstVaapiEncoderMbbrc;
 
+/**
+ * GstVaapiEncoderIntraRefresh:
+ * @GST_VAAPI_ENCODER_INTRA_REFRESH_NONE: no gradual intra refresh
+ * @GST_VAAPI_ENCODER_INTRA_REFRESH_COLUMN: intra code a column sweeping
+ *   the picture from left to right
+ * @GST_VAAPI_ENCODER_INTRA_REFRESH_ROW: intra code a row sweeping the
+ *   picture from top to bottom
+ *
+ * Values for the gradual intra refresh, where the picture is refreshed
+ * piecewise over a number of P-frames instead of with periodic
+ * key-frames.
+ *
+ * This property values are only available for H264 and H265 (HEVC)
+ * encoders.
+ **/
+typedef enum {
+  GST_VAAPI_ENCODER_INTRA_REFRESH_NONE = 0,
+  GST_VAAPI_ENCODER_INTRA_REFRESH_COLUMN = 1,
+  GST_VAAPI_ENCODER_INTRA_REFRESH_ROW = 2,
+} GstVaapiEncoderIntraRefresh;
+
 GType
 gst_vaapi_encoder_tune_get_type (void) G_GNUC_CONST;
 
 GType
 gst_vaapi_encoder_mbbrc_get_type (void) G_GNUC_CONST;
 
+GType
+gst_vaapi_encoder_intra_refresh_get_type (void) G_GNUC_CONST;
+
 void
 gst_vaapi_encoder_replace (GstVaapiEncoder ** old_encoder_ptr,
     GstVaapiEncoder * new_encoder);
@@ -173,6 +198,10 @@ gst_vaapi_encoder_set_quality_level (GstVaapiEncoder * encoder,
 GstVaapiEncoderStatus
 gst_vaapi_encoder_set_trellis (GstVaapiEncoder * encoder, gboolean trellis);
 
+GstVaapiEncoderStatus
+gst_vaapi_encoder_set_software_rate_control (GstVaapiEncoder * encoder,
+    gboolean enable);
+
 GstVaapiEncoderStatus
 gst_vaapi_encoder_get_buffer_with_timeout (GstVaapiEncoder * encoder,
     GstVaapiCodedBufferProxy ** out_codedbuf_proxy_ptr, guint64 timeout);
@@ -195,6 +224,15 @@ gst_vaapi_encoder_get_entrypoint (GstVaapiEncoder * encoder,
 GArray *
 gst_vaapi_encoder_get_available_profiles (GstVaapiEncoder * encoder);
 
+void
+gst_vaapi_encoder_get_va_call_stats (GstVaapiEncoder * encoder,
+    GstVaapiVaCallStats * stats);
+
+gboolean
+gst_vaapi_encoder_get_hrd_params (GstVaapiEncoder * encoder, guint * bitrate,
+    guint * buffer_size, guint * initial_fullness,
+    gboolean * constant_bitrate);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GstVaapiEncoder, gst_object_unref)
 
 G_END_DECLS
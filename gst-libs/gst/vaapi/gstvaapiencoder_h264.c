@@ -145,7 +145,8 @@ typedef enum
 {
   GST_VAAPI_H264_SEI_UNKNOWN = 0,
   GST_VAAPI_H264_SEI_BUF_PERIOD = (1 << 0),
-  GST_VAAPI_H264_SEI_PIC_TIMING = (1 << 1)
+  GST_VAAPI_H264_SEI_PIC_TIMING = (1 << 1),
+  GST_VAAPI_H264_SEI_RECOVERY_POINT = (1 << 2)
 } GstVaapiH264SeiPayloadType;
 
 typedef struct
@@ -795,6 +796,23 @@ struct _GstVaapiEncoderH264
 
   gboolean use_aud;
 
+  /* Gradual intra refresh */
+  GstVaapiEncoderIntraRefresh intra_refresh;
+  guint intra_refresh_period;
+  guint intra_refresh_index;    /* position in the refresh cycle */
+  guint intra_refresh_location; /* of the current picture, in MBs */
+  guint intra_refresh_size;
+  gboolean intra_refresh_start; /* the picture starts a refresh cycle */
+
+  /* The coding structure requested through the properties. The fields
+     above hold the effective values, which reconfigure adjusts to the
+     driver and to the other settings */
+  guint32 prop_num_bframes;
+  guint prop_temporal_levels;
+  guint prop_prediction_type;
+  GstVaapiEncoderIntraRefresh prop_intra_refresh;
+  guint prop_intra_refresh_period;
+
   /* Complance mode */
   GstVaapiEncoderH264ComplianceMode compliance_mode;
   guint min_cr;                 // Minimum Compression Ratio (A.3.1)
@@ -1656,7 +1674,7 @@ add_packed_sei_header (GstVaapiEncoderH264 * encoder,
   guint32 data_bit_size;
   guint8 buf_period_payload_size = 0, pic_timing_payload_size = 0;
   guint8 *data, *buf_period_payload = NULL, *pic_timing_payload = NULL;
-  gboolean need_buf_period, need_pic_timing;
+  gboolean need_buf_period, need_pic_timing, need_recovery_point;
 
   gst_bit_writer_init_with_size (&bs_buf_period, 128, FALSE);
   gst_bit_writer_init_with_size (&bs_pic_timing, 128, FALSE);
@@ -1664,6 +1682,7 @@ add_packed_sei_header (GstVaapiEncoderH264 * encoder,
 
   need_buf_period = GST_VAAPI_H264_SEI_BUF_PERIOD & payloadtype;
   need_pic_timing = GST_VAAPI_H264_SEI_PIC_TIMING & payloadtype;
+  need_recovery_point = GST_VAAPI_H264_SEI_RECOVERY_POINT & payloadtype;
 
   if (need_buf_period) {
     /* Write a Buffering Period SEI message */
@@ -1704,6 +1723,11 @@ add_packed_sei_header (GstVaapiEncoderH264 * encoder,
     gst_bit_writer_put_bytes (&bs, pic_timing_payload, pic_timing_payload_size);
   }
 
+  /* The picture is fully refreshed at the end of the cycle */
+  if (need_recovery_point && !bs_write_sei_recovery_point_h264 (&bs,
+          encoder->intra_refresh_period - 1))
+    goto bs_error;
+
   /* rbsp_trailing_bits */
   bs_write_trailing_bits (&bs);
 
@@ -1891,6 +1915,19 @@ reference_pic_free (GstVaapiEncoderH264 * encoder, GstVaapiEncoderH264Ref * ref)
   g_slice_free (GstVaapiEncoderH264Ref, ref);
 }
 
+/* Releases all the reference pictures */
+static void
+reference_list_clear (GstVaapiEncoderH264 * encoder)
+{
+  guint i;
+
+  for (i = 0; i < MAX_NUM_VIEWS; i++) {
+    GstVaapiH264ViewRefPool *const ref_pool = &encoder->ref_pools[i];
+    while (!g_queue_is_empty (&ref_pool->ref_list))
+      reference_pic_free (encoder, g_queue_pop_head (&ref_pool->ref_list));
+  }
+}
+
 static inline GstVaapiEncoderH264Ref *
 reference_pic_create (GstVaapiEncoderH264 * encoder,
     GstVaapiEncPicture * picture, GstVaapiSurfaceProxy * surface)
@@ -2302,7 +2339,8 @@ add_slice_headers (GstVaapiEncoderH264 * encoder, GstVaapiEncPicture * picture,
     g_assert ((gint8) slice_param->slice_type != -1);
     slice_param->pic_parameter_set_id = encoder->view_idx;
     slice_param->idr_pic_id = encoder->idr_num;
-    slice_param->pic_order_cnt_lsb = picture->poc;
+    slice_param->pic_order_cnt_lsb =
+        picture->poc % encoder->max_pic_order_cnt;
 
     /* not used if pic_order_cnt_type = 0 */
     slice_param->delta_pic_order_cnt_bottom = 0;
@@ -2384,21 +2422,11 @@ add_slice_headers (GstVaapiEncoderH264 * encoder, GstVaapiEncPicture * picture,
 
     slice_param->cabac_init_idc = 0;
     slice_param->slice_qp_delta = encoder->qp_i - encoder->init_qp;
-    if (GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CQP) {
-      if (picture->type == GST_VAAPI_PICTURE_TYPE_P) {
-        slice_param->slice_qp_delta += encoder->qp_ip;
-      } else if (picture->type == GST_VAAPI_PICTURE_TYPE_B) {
-        slice_param->slice_qp_delta += encoder->qp_ib;
-      }
-      if ((gint) encoder->init_qp + slice_param->slice_qp_delta <
-          (gint) encoder->min_qp) {
-        slice_param->slice_qp_delta = encoder->min_qp - encoder->init_qp;
-      }
-      if ((gint) encoder->init_qp + slice_param->slice_qp_delta >
-          (gint) encoder->max_qp) {
-        slice_param->slice_qp_delta = encoder->max_qp - encoder->init_qp;
-      }
-    }
+    if (GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CQP)
+      slice_param->slice_qp_delta =
+          gst_vaapi_encoder_get_picture_qp (GST_VAAPI_ENCODER_CAST (encoder),
+          picture, encoder->qp_i, encoder->qp_ip, encoder->qp_ib,
+          encoder->min_qp, encoder->max_qp) - encoder->init_qp;
     slice_param->disable_deblocking_filter_idc = 0;
     slice_param->slice_alpha_c0_offset_div2 = 2;
     slice_param->slice_beta_offset_div2 = 2;
@@ -2549,6 +2577,7 @@ static gboolean
 ensure_misc_params (GstVaapiEncoderH264 * encoder, GstVaapiEncPicture * picture)
 {
   GstVaapiEncoder *const base_encoder = GST_VAAPI_ENCODER_CAST (encoder);
+  GstVaapiH264SeiPayloadType payloadtype = GST_VAAPI_H264_SEI_UNKNOWN;
 
   if (!gst_vaapi_encoder_ensure_param_control_rate (base_encoder, picture))
     return FALSE;
@@ -2556,25 +2585,35 @@ ensure_misc_params (GstVaapiEncoderH264 * encoder, GstVaapiEncPicture * picture)
   if (GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CBR ||
       GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_VBR) {
     if (!encoder->view_idx) {
-      if ((GST_VAAPI_ENC_PICTURE_IS_IDR (picture)) &&
-          (GST_VAAPI_ENCODER_PACKED_HEADERS (encoder) &
-              VA_ENC_PACKED_HEADER_MISC) &&
-          !add_packed_sei_header (encoder, picture,
-              GST_VAAPI_H264_SEI_BUF_PERIOD | GST_VAAPI_H264_SEI_PIC_TIMING))
-        goto error_create_packed_sei_hdr;
-
-      else if (!GST_VAAPI_ENC_PICTURE_IS_IDR (picture) &&
-          (GST_VAAPI_ENCODER_PACKED_HEADERS (encoder) &
-              VA_ENC_PACKED_HEADER_MISC) &&
-          !add_packed_sei_header (encoder, picture,
-              GST_VAAPI_H264_SEI_PIC_TIMING))
-        goto error_create_packed_sei_hdr;
+      if (GST_VAAPI_ENC_PICTURE_IS_IDR (picture))
+        payloadtype |= GST_VAAPI_H264_SEI_BUF_PERIOD;
+      payloadtype |= GST_VAAPI_H264_SEI_PIC_TIMING;
     }
   }
 
+  if (encoder->intra_refresh_start)
+    payloadtype |= GST_VAAPI_H264_SEI_RECOVERY_POINT;
+
+  if (payloadtype != GST_VAAPI_H264_SEI_UNKNOWN &&
+      (GST_VAAPI_ENCODER_PACKED_HEADERS (encoder) &
+          VA_ENC_PACKED_HEADER_MISC) &&
+      !add_packed_sei_header (encoder, picture, payloadtype))
+    goto error_create_packed_sei_hdr;
+
+  if (!gst_vaapi_encoder_ensure_param_intra_refresh (base_encoder, picture,
+          encoder->intra_refresh, encoder->intra_refresh_location,
+          encoder->intra_refresh_size))
+    return FALSE;
+
   if (!gst_vaapi_encoder_ensure_param_trellis (base_encoder, picture))
     return FALSE;
 
+  /* before the ROI regions, the QP map falls back on them */
+  if (!gst_vaapi_encoder_ensure_qp_map (base_encoder, picture,
+          gst_vaapi_encoder_get_picture_qp (base_encoder, picture,
+              encoder->qp_i, encoder->qp_ip, encoder->qp_ib, encoder->min_qp,
+              encoder->max_qp), encoder->min_qp, encoder->max_qp))
+    return FALSE;
   if (!gst_vaapi_encoder_ensure_param_roi_regions (base_encoder, picture))
     return FALSE;
 
@@ -2653,7 +2692,9 @@ ensure_bitrate_hrd (GstVaapiEncoderH264 * encoder)
   GstVaapiEncoder *const base_encoder = GST_VAAPI_ENCODER_CAST (encoder);
   guint bitrate, cpb_size;
 
-  if (!base_encoder->bitrate) {
+  /* the target of the software rate control is not signalled */
+  if (!base_encoder->bitrate ||
+      GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CQP) {
     encoder->bitrate_bits = 0;
     return;
   }
@@ -2686,6 +2727,13 @@ ensure_bitrate (GstVaapiEncoderH264 * encoder)
 
   /* Default compression: 48 bits per macroblock in "high-compression" mode */
   switch (GST_VAAPI_ENCODER_RATE_CONTROL (encoder)) {
+    case GST_VAAPI_RATECONTROL_CQP:
+      if (!base_encoder->software_rate_control) {
+        base_encoder->bitrate = 0;
+        break;
+      }
+      /* the software rate control needs a target bitrate too */
+      /* fall through */
     case GST_VAAPI_RATECONTROL_CBR:
     case GST_VAAPI_RATECONTROL_VBR:
     case GST_VAAPI_RATECONTROL_VBR_CONSTRAINED:
@@ -2760,6 +2808,56 @@ ensure_profile_and_level (GstVaapiEncoderH264 * encoder)
   return GST_VAAPI_ENCODER_STATUS_SUCCESS;
 }
 
+/* Checks the gradual intra refresh settings against the driver and
+   the rest of the configuration */
+static void
+reset_intra_refresh (GstVaapiEncoderH264 * encoder)
+{
+  GstVaapiEncoder *const base_encoder = GST_VAAPI_ENCODER_CAST (encoder);
+  guint num_units;
+
+  encoder->intra_refresh_index = 0;
+  encoder->intra_refresh_size = 0;
+  encoder->intra_refresh_start = FALSE;
+
+  if (encoder->intra_refresh == GST_VAAPI_ENCODER_INTRA_REFRESH_NONE)
+    return;
+
+  if (encoder->is_mvc) {
+    GST_WARNING ("Disabling intra refresh since MVC encoding is enabled");
+    encoder->intra_refresh = GST_VAAPI_ENCODER_INTRA_REFRESH_NONE;
+    return;
+  }
+
+  if (!gst_vaapi_encoder_ensure_intra_refresh_support (base_encoder,
+          encoder->profile, encoder->entrypoint, encoder->intra_refresh)) {
+    GST_WARNING ("Disabling intra refresh since the driver doesn't support it");
+    encoder->intra_refresh = GST_VAAPI_ENCODER_INTRA_REFRESH_NONE;
+    return;
+  }
+
+  /* the recovery point counts on every picture being a reference
+   * P-frame, coded in display order */
+  if (encoder->num_bframes > 0 || encoder->temporal_levels > 1 ||
+      encoder->prediction_type != GST_VAAPI_ENCODER_H264_PREDICTION_DEFAULT) {
+    GST_WARNING ("Disabling b-frames and temporal levels for intra refresh");
+    encoder->num_bframes = 0;
+    encoder->temporal_levels = MIN_TEMPORAL_LEVELS;
+    encoder->prediction_type = GST_VAAPI_ENCODER_H264_PREDICTION_DEFAULT;
+  }
+
+  num_units = encoder->intra_refresh == GST_VAAPI_ENCODER_INTRA_REFRESH_COLUMN ?
+      encoder->mb_width : encoder->mb_height;
+  if (encoder->intra_refresh_period > num_units) {
+    GST_INFO ("Lowering the intra refresh period to %d", num_units);
+    encoder->intra_refresh_period = num_units;
+  }
+
+  /* recovery_frame_cnt has to be lower than MaxFrameNum */
+  if (encoder->idr_period < encoder->intra_refresh_period)
+    encoder->idr_period = encoder->intra_refresh_period;
+}
+
 static void
 reset_properties (GstVaapiEncoderH264 * encoder)
 {
@@ -2767,8 +2865,7 @@ reset_properties (GstVaapiEncoderH264 * encoder)
   guint mb_size, i;
   gboolean ret;
 
-  if (encoder->idr_period < base_encoder->keyframe_period)
-    encoder->idr_period = base_encoder->keyframe_period;
+  encoder->idr_period = base_encoder->keyframe_period;
 
   g_assert (encoder->min_qp <= encoder->max_qp);
   if (encoder->min_qp > encoder->init_qp)
@@ -2778,6 +2875,8 @@ reset_properties (GstVaapiEncoderH264 * encoder)
 
   encoder->qp_i = encoder->init_qp;
 
+  reset_intra_refresh (encoder);
+
   mb_size = encoder->mb_width * encoder->mb_height;
   ret = gst_vaapi_encoder_ensure_num_slices (base_encoder, encoder->profile,
       encoder->entrypoint, (mb_size + 1) / 2, &encoder->num_slices);
@@ -2905,6 +3004,36 @@ reset_properties (GstVaapiEncoderH264 * encoder)
   }
 }
 
+/* Selects the intra coded region of the supplied picture */
+static void
+update_intra_refresh (GstVaapiEncoderH264 * encoder,
+    GstVaapiEncPicture * picture)
+{
+  guint num_units;
+
+  encoder->intra_refresh_size = 0;
+  encoder->intra_refresh_start = FALSE;
+
+  if (encoder->intra_refresh == GST_VAAPI_ENCODER_INTRA_REFRESH_NONE)
+    return;
+
+  /* a key-frame refreshes the whole picture, a new cycle starts on
+   * the next frame */
+  if (picture->type == GST_VAAPI_PICTURE_TYPE_I) {
+    encoder->intra_refresh_index = 0;
+    return;
+  }
+
+  num_units = encoder->intra_refresh == GST_VAAPI_ENCODER_INTRA_REFRESH_COLUMN ?
+      encoder->mb_width : encoder->mb_height;
+  encoder->intra_refresh_start =
+      gst_vaapi_utils_h26x_get_intra_refresh_region (num_units,
+      encoder->intra_refresh_period, encoder->intra_refresh_index,
+      &encoder->intra_refresh_location, &encoder->intra_refresh_size);
+  encoder->intra_refresh_index =
+      (encoder->intra_refresh_index + 1) % encoder->intra_refresh_period;
+}
+
 static GstVaapiEncoderStatus
 gst_vaapi_encoder_h264_encode (GstVaapiEncoder * base_encoder,
     GstVaapiEncPicture * picture, GstVaapiCodedBufferProxy * codedbuf)
@@ -2917,6 +3046,8 @@ gst_vaapi_encoder_h264_encode (GstVaapiEncoder * base_encoder,
 
   g_assert (GST_VAAPI_SURFACE_PROXY_SURFACE (reconstruct));
 
+  update_intra_refresh (encoder, picture);
+
   if (!ensure_sequence (encoder, picture))
     goto error;
   if (!ensure_misc_params (encoder, picture))
@@ -3227,19 +3358,24 @@ gst_vaapi_encoder_h264_reordering (GstVaapiEncoder * base_encoder,
     return GST_VAAPI_ENCODER_STATUS_ERROR_ALLOCATION_FAILED;
   }
   ++reorder_pool->cur_present_index;
-  picture->poc = ((reorder_pool->cur_present_index * 2) %
-      encoder->max_pic_order_cnt);
+  picture->poc = reorder_pool->cur_present_index * 2;
 
   picture->temporal_id = (encoder->temporal_levels == 1) ? 1 :
       get_temporal_id (encoder, reorder_pool->frame_index);
 
-  is_idr = (reorder_pool->frame_index == 0 ||
-      reorder_pool->frame_index >= encoder->idr_period);
+  /* with gradual intra refresh, the GOP is infinite: only the first
+   * frame, and the forced ones, are key-frames */
+  if (encoder->intra_refresh != GST_VAAPI_ENCODER_INTRA_REFRESH_NONE)
+    is_idr = (reorder_pool->frame_index == 0);
+  else
+    is_idr = (reorder_pool->frame_index == 0 ||
+        reorder_pool->frame_index >= encoder->idr_period);
 
   /* check key frames */
   if (is_idr || GST_VIDEO_CODEC_FRAME_IS_FORCE_KEYFRAME (frame) ||
-      (reorder_pool->frame_index %
-          GST_VAAPI_ENCODER_KEYFRAME_PERIOD (encoder)) == 0) {
+      (encoder->intra_refresh == GST_VAAPI_ENCODER_INTRA_REFRESH_NONE &&
+          (reorder_pool->frame_index %
+              GST_VAAPI_ENCODER_KEYFRAME_PERIOD (encoder)) == 0)) {
     ++reorder_pool->frame_index;
 
     /* b frame enabled,  check queue of reorder_frame_list */
@@ -3377,6 +3513,14 @@ gst_vaapi_encoder_h264_reconfigure (GstVaapiEncoder * base_encoder)
   GstVaapiEncoderStatus status;
   guint mb_width, mb_height;
 
+  /* start over from the requested coding structure, so that lifting a
+     constraint, such as disabling intra refresh, restores it */
+  encoder->num_bframes = encoder->prop_num_bframes;
+  encoder->temporal_levels = encoder->prop_temporal_levels;
+  encoder->prediction_type = encoder->prop_prediction_type;
+  encoder->intra_refresh = encoder->prop_intra_refresh;
+  encoder->intra_refresh_period = encoder->prop_intra_refresh_period;
+
   mb_width = (GST_VAAPI_ENCODER_WIDTH (encoder) + 15) / 16;
   mb_height = (GST_VAAPI_ENCODER_HEIGHT (encoder) + 15) / 16;
   if (mb_width != encoder->mb_width || mb_height != encoder->mb_height) {
@@ -3385,6 +3529,9 @@ gst_vaapi_encoder_h264_reconfigure (GstVaapiEncoder * base_encoder)
     encoder->mb_width = mb_width;
     encoder->mb_height = mb_height;
     encoder->config_changed = TRUE;
+    /* the next picture is an IDR: the references of the previous size
+       are not needed anymore */
+    reference_list_clear (encoder);
   }
 
   /* Take number of MVC views from input caps if provided */
@@ -3402,9 +3549,27 @@ gst_vaapi_encoder_h264_reconfigure (GstVaapiEncoder * base_encoder)
 
   reset_properties (encoder);
   ensure_control_rate_params (encoder);
+  gst_vaapi_encoder_ensure_sw_rate_control (base_encoder, encoder->cpb_length,
+      encoder->init_qp, encoder->min_qp, encoder->max_qp);
   return set_context_info (base_encoder);
 }
 
+/* Applies the new bitrate, framerate and QP bounds to the rate control
+ * parameters sent with the next picture. The SPS, with the new timing
+ * and HRD parameters, goes out with the next I-frame */
+static GstVaapiEncoderStatus
+gst_vaapi_encoder_h264_update_rate_control (GstVaapiEncoder * base_encoder)
+{
+  GstVaapiEncoderH264 *const encoder = GST_VAAPI_ENCODER_H264 (base_encoder);
+
+  ensure_bitrate (encoder);
+  encoder->config_changed = TRUE;
+  ensure_control_rate_params (encoder);
+  gst_vaapi_encoder_ensure_sw_rate_control (base_encoder, encoder->cpb_length,
+      encoder->init_qp, encoder->min_qp, encoder->max_qp);
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+}
+
 struct _GstVaapiEncoderH264Class
 {
   GstVaapiEncoderClass parent_class;
@@ -3425,7 +3590,7 @@ gst_vaapi_encoder_h264_init (GstVaapiEncoderH264 * encoder)
   encoder->is_mvc = FALSE;
   encoder->num_views = 1;
   encoder->view_idx = 0;
-  encoder->temporal_levels = MIN_TEMPORAL_LEVELS;
+  encoder->prop_temporal_levels = MIN_TEMPORAL_LEVELS;
   encoder->abs_diff_pic_num_list0 = 1;
   encoder->abs_diff_pic_num_list1 = 1;
   memset (encoder->view_ids, 0, sizeof (encoder->view_ids));
@@ -3573,6 +3738,10 @@ get_view_ids (GstVaapiEncoderH264 * const encoder, GValue * value)
  * @ENCODER_H264_PROP_PREDICTION_TYPE: Reference picture selection modes
  * @ENCODER_H264_PROP_MAX_QP: Maximal quantizer value (uint).
  * @ENCODER_H264_PROP_QUALITY_FACTOR: Factor for ICQ/QVBR bitrate control mode.
+ * @ENCODER_H264_PROP_INTRA_REFRESH: Gradual intra refresh mode
+ *   (#GstVaapiEncoderIntraRefresh).
+ * @ENCODER_H264_PROP_INTRA_REFRESH_PERIOD: Number of frames of an
+ *   intra refresh cycle (uint).
  *
  * The set of H.264 encoder specific configurable properties.
  */
@@ -3599,11 +3768,29 @@ enum
   ENCODER_H264_PROP_PREDICTION_TYPE,
   ENCODER_H264_PROP_MAX_QP,
   ENCODER_H264_PROP_QUALITY_FACTOR,
+  ENCODER_H264_PROP_INTRA_REFRESH,
+  ENCODER_H264_PROP_INTRA_REFRESH_PERIOD,
   ENCODER_H264_N_PROPERTIES
 };
 
 static GParamSpec *properties[ENCODER_H264_N_PROPERTIES];
 
+/* Changes the QP bounds of a running encoder, from the next picture */
+static void
+update_qp_bounds (GstVaapiEncoderH264 * encoder, guint min_qp, guint max_qp)
+{
+  if (min_qp > max_qp) {
+    GST_ERROR_OBJECT (encoder, "invalid QP bounds: [%u, %u]", min_qp, max_qp);
+    return;
+  }
+
+  GST_INFO_OBJECT (encoder, "QP bounds are changed to [%u, %u] on runtime",
+      min_qp, max_qp);
+  encoder->min_qp = min_qp;
+  encoder->max_qp = max_qp;
+  gst_vaapi_encoder_update_rate_control (GST_VAAPI_ENCODER_CAST (encoder));
+}
+
 static void
 gst_vaapi_encoder_h264_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -3612,6 +3799,15 @@ gst_vaapi_encoder_h264_set_property (GObject * object, guint prop_id,
   GstVaapiEncoder *const base_encoder = GST_VAAPI_ENCODER (object);
 
   if (base_encoder->num_codedbuf_queued > 0) {
+    /* the QP bounds only go into the rate control parameters */
+    if (prop_id == ENCODER_H264_PROP_MIN_QP) {
+      update_qp_bounds (encoder, g_value_get_uint (value), encoder->max_qp);
+      return;
+    }
+    if (prop_id == ENCODER_H264_PROP_MAX_QP) {
+      update_qp_bounds (encoder, encoder->min_qp, g_value_get_uint (value));
+      return;
+    }
     GST_ERROR_OBJECT (object,
         "failed to set any property after encoding started");
     return;
@@ -3626,7 +3822,7 @@ gst_vaapi_encoder_h264_set_property (GObject * object, guint prop_id,
       gst_vaapi_encoder_set_tuning (base_encoder, g_value_get_enum (value));
       break;
     case ENCODER_H264_PROP_MAX_BFRAMES:
-      encoder->num_bframes = g_value_get_uint (value);
+      encoder->prop_num_bframes = g_value_get_uint (value);
       break;
     case ENCODER_H264_PROP_INIT_QP:
       encoder->init_qp = g_value_get_uint (value);
@@ -3671,10 +3867,10 @@ gst_vaapi_encoder_h264_set_property (GObject * object, guint prop_id,
       encoder->mbbrc = g_value_get_enum (value);
       break;
     case ENCODER_H264_PROP_TEMPORAL_LEVELS:
-      encoder->temporal_levels = g_value_get_uint (value);
+      encoder->prop_temporal_levels = g_value_get_uint (value);
       break;
     case ENCODER_H264_PROP_PREDICTION_TYPE:
-      encoder->prediction_type = g_value_get_enum (value);
+      encoder->prop_prediction_type = g_value_get_enum (value);
       break;
     case ENCODER_H264_PROP_MAX_QP:
       encoder->max_qp = g_value_get_uint (value);
@@ -3682,6 +3878,12 @@ gst_vaapi_encoder_h264_set_property (GObject * object, guint prop_id,
     case ENCODER_H264_PROP_QUALITY_FACTOR:
       encoder->quality_factor = g_value_get_uint (value);
       break;
+    case ENCODER_H264_PROP_INTRA_REFRESH:
+      encoder->prop_intra_refresh = g_value_get_enum (value);
+      break;
+    case ENCODER_H264_PROP_INTRA_REFRESH_PERIOD:
+      encoder->prop_intra_refresh_period = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -3702,7 +3904,7 @@ gst_vaapi_encoder_h264_get_property (GObject * object, guint prop_id,
       g_value_set_enum (value, base_encoder->tune);
       break;
     case ENCODER_H264_PROP_MAX_BFRAMES:
-      g_value_set_uint (value, encoder->num_bframes);
+      g_value_set_uint (value, encoder->prop_num_bframes);
       break;
     case ENCODER_H264_PROP_INIT_QP:
       g_value_set_uint (value, encoder->init_qp);
@@ -3747,10 +3949,10 @@ gst_vaapi_encoder_h264_get_property (GObject * object, guint prop_id,
       g_value_set_enum (value, encoder->mbbrc);
       break;
     case ENCODER_H264_PROP_TEMPORAL_LEVELS:
-      g_value_set_uint (value, encoder->temporal_levels);
+      g_value_set_uint (value, encoder->prop_temporal_levels);
       break;
     case ENCODER_H264_PROP_PREDICTION_TYPE:
-      g_value_set_enum (value, encoder->prediction_type);
+      g_value_set_enum (value, encoder->prop_prediction_type);
       break;
     case ENCODER_H264_PROP_MAX_QP:
       g_value_set_uint (value, encoder->max_qp);
@@ -3758,6 +3960,12 @@ gst_vaapi_encoder_h264_get_property (GObject * object, guint prop_id,
     case ENCODER_H264_PROP_QUALITY_FACTOR:
       g_value_set_uint (value, encoder->quality_factor);
       break;
+    case ENCODER_H264_PROP_INTRA_REFRESH:
+      g_value_set_enum (value, encoder->prop_intra_refresh);
+      break;
+    case ENCODER_H264_PROP_INTRA_REFRESH_PERIOD:
+      g_value_set_uint (value, encoder->prop_intra_refresh_period);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -3773,6 +3981,8 @@ gst_vaapi_encoder_h264_class_init (GstVaapiEncoderH264Class * klass)
 
   encoder_class->class_data = &g_class_data;
   encoder_class->reconfigure = gst_vaapi_encoder_h264_reconfigure;
+  encoder_class->update_rate_control =
+      gst_vaapi_encoder_h264_update_rate_control;
   encoder_class->reordering = gst_vaapi_encoder_h264_reordering;
   encoder_class->encode = gst_vaapi_encoder_h264_encode;
   encoder_class->flush = gst_vaapi_encoder_h264_flush;
@@ -4059,10 +4269,46 @@ gst_vaapi_encoder_h264_class_init (GstVaapiEncoderH264Class * klass)
       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
       GST_VAAPI_PARAM_ENCODER_EXPOSURE);
 
+  /**
+   * GstVaapiEncoderH264:intra-refresh:
+   *
+   * Refresh the picture with a column, or a row, of intra coded
+   * macroblocks sweeping it over #GstVaapiEncoderH264:intra-refresh-period
+   * P-frames, instead of periodic key-frames. This keeps the size of
+   * the frames even, for low latency streaming. A recovery point SEI
+   * message is inserted at the start of each refresh cycle, and the
+   * key-frame period is ignored: only the first frame and the forced
+   * key-frames are IDR. B-frames and temporal levels are disabled.
+   */
+  properties[ENCODER_H264_PROP_INTRA_REFRESH] =
+      g_param_spec_enum ("intra-refresh",
+      "Intra Refresh",
+      "Gradual intra refresh mode, replacing the periodic key-frames",
+      GST_VAAPI_TYPE_ENCODER_INTRA_REFRESH,
+      GST_VAAPI_ENCODER_INTRA_REFRESH_NONE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
+  /**
+   * GstVaapiEncoderH264:intra-refresh-period:
+   *
+   * Number of frames needed to refresh the whole picture, when
+   * #GstVaapiEncoderH264:intra-refresh is enabled. It is lowered to
+   * the number of macroblock columns, or rows, if needed.
+   */
+  properties[ENCODER_H264_PROP_INTRA_REFRESH_PERIOD] =
+      g_param_spec_uint ("intra-refresh-period",
+      "Intra Refresh Period",
+      "Number of frames of an intra refresh cycle",
+      2, 1024, 30,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
   g_object_class_install_properties (object_class, ENCODER_H264_N_PROPERTIES,
       properties);
 
   gst_type_mark_as_plugin_api (GST_VAAPI_TYPE_ENCODER_MBBRC, 0);
+  gst_type_mark_as_plugin_api (GST_VAAPI_TYPE_ENCODER_INTRA_REFRESH, 0);
   gst_type_mark_as_plugin_api (gst_vaapi_encoder_h264_prediction_type (), 0);
   gst_type_mark_as_plugin_api (g_class_data.rate_control_get_type (), 0);
   gst_type_mark_as_plugin_api (g_class_data.encoder_tune_get_type (), 0);
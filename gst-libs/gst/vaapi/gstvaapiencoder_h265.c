@@ -36,6 +36,10 @@
 #define DEBUG 1
 #include "gstvaapidebug.h"
 
+/* Define default temporal levels */
+#define MIN_TEMPORAL_LEVELS 1
+#define MAX_TEMPORAL_LEVELS 4
+
 /* Supported set of VA rate controls, within this implementation */
 #define SUPPORTED_RATECONTROLS                          \
   (GST_VAAPI_RATECONTROL_MASK (CQP) |                   \
@@ -55,10 +59,43 @@
    VA_ENC_PACKED_HEADER_PICTURE  |              \
    VA_ENC_PACKED_HEADER_SLICE)
 
+typedef enum
+{
+  GST_VAAPI_ENCODER_H265_PREDICTION_DEFAULT,
+  GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_P,
+  GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_B
+} GstVaapiEncoderH265PredictionType;
+
+static GType
+gst_vaapi_encoder_h265_prediction_type (void)
+{
+  static GType gtype = 0;
+
+  if (gtype == 0) {
+    static const GEnumValue values[] = {
+      {GST_VAAPI_ENCODER_H265_PREDICTION_DEFAULT,
+            "Default encode, prev/next frame as ref ",
+          "default"},
+      {GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_P,
+            "Hierarchical P frame encode",
+          "hierarchical-p"},
+      {GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_B,
+            "Hierarchical B frame encode",
+          "hierarchical-b"},
+      {0, NULL, NULL},
+    };
+
+    gtype =
+        g_enum_register_static ("GstVaapiEncoderH265PredictionType", values);
+  }
+  return gtype;
+}
+
 typedef struct
 {
   GstVaapiSurfaceProxy *pic;
   guint poc;
+  guint temporal_id;
 } GstVaapiEncoderH265Ref;
 
 typedef enum
@@ -81,6 +118,7 @@ typedef struct _GstVaapiH265ReorderPool
   GQueue reorder_frame_list;
   guint reorder_state;
   guint frame_index;
+  guint key_frame_index;        /* frame_index of the last key-frame */
   guint cur_present_index;
 } GstVaapiH265ReorderPool;
 
@@ -133,6 +171,12 @@ struct _GstVaapiEncoderH265
    * the CVS in decoding order and follow that picture in output order */
   guint32 max_num_reorder_pics;
 
+  /* Temporal scalability */
+  guint temporal_levels;
+  /* to find the temporal id from the display order */
+  guint temporal_level_div[MAX_TEMPORAL_LEVELS];
+  guint prediction_type;
+
   /* frame, poc */
   guint32 max_pic_order_cnt;
   guint32 log2_max_pic_order_cnt;
@@ -148,6 +192,23 @@ struct _GstVaapiEncoderH265
   guint cpb_length_bits;        // length of CPB buffer (bits)
   GstVaapiEncoderMbbrc mbbrc;   // macroblock bitrate control
 
+  /* Gradual intra refresh */
+  GstVaapiEncoderIntraRefresh intra_refresh;
+  guint intra_refresh_period;
+  guint intra_refresh_index;    /* position in the refresh cycle */
+  guint intra_refresh_location; /* of the current picture, in 16x16 blocks */
+  guint intra_refresh_size;
+  gboolean intra_refresh_start; /* the picture starts a refresh cycle */
+
+  /* The coding structure requested through the properties. The fields
+     above hold the effective values, which reconfigure adjusts to the
+     driver and to the other settings */
+  guint32 prop_num_bframes;
+  guint prop_temporal_levels;
+  guint prop_prediction_type;
+  GstVaapiEncoderIntraRefresh prop_intra_refresh;
+  guint prop_intra_refresh_period;
+
   /* Crop rectangle */
   guint conformance_window_flag:1;
   guint32 conf_win_left_offset;
@@ -223,10 +284,11 @@ h265_get_log2_max_pic_order_cnt (guint num)
 
 /* Write the NAL unit header */
 static gboolean
-bs_write_nal_header (GstBitWriter * bs, guint32 nal_unit_type)
+bs_write_nal_header (GstBitWriter * bs, guint32 nal_unit_type,
+    guint32 temporal_id)
 {
   guint8 nuh_layer_id = 0;
-  guint8 nuh_temporal_id_plus1 = 1;
+  guint8 nuh_temporal_id_plus1 = temporal_id + 1;
 
   WRITE_UINT32 (bs, 0, 1);
   WRITE_UINT32 (bs, nal_unit_type, 6);
@@ -263,7 +325,8 @@ bs_error:
 /* Write profile_tier_level()  */
 static gboolean
 bs_write_profile_tier_level (GstBitWriter * bs,
-    const VAEncSequenceParameterBufferHEVC * seq_param, GstVaapiProfile profile)
+    const VAEncSequenceParameterBufferHEVC * seq_param, GstVaapiProfile profile,
+    guint32 max_sub_layers_minus1)
 {
   guint i;
 
@@ -546,6 +609,19 @@ bs_write_profile_tier_level (GstBitWriter * bs,
   /* general_level_idc */
   WRITE_UINT32 (bs, seq_param->general_level_idc, 8);
 
+  /* the sub-layers share the general profile and level */
+  for (i = 0; i < max_sub_layers_minus1; i++) {
+    /* sub_layer_profile_present_flag */
+    WRITE_UINT32 (bs, 0, 1);
+    /* sub_layer_level_present_flag */
+    WRITE_UINT32 (bs, 0, 1);
+  }
+  if (max_sub_layers_minus1 > 0) {
+    /* reserved_zero_2bits */
+    for (i = max_sub_layers_minus1; i < 8; i++)
+      WRITE_UINT32 (bs, 0, 2);
+  }
+
   return TRUE;
 
   /* ERRORS */
@@ -556,6 +632,18 @@ bs_error:
   }
 }
 
+/* Gets the value of the temporal_id_nesting_flag: the hierarchical B
+   pictures may reference a picture of their own temporal layer across
+   a picture of a lower one, so their sub-layers are not nested */
+static guint32
+get_temporal_id_nesting_flag (GstVaapiEncoderH265 * encoder)
+{
+  if (encoder->temporal_levels > 1 && encoder->prediction_type ==
+      GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_B)
+    return 0;
+  return 1;
+}
+
 /* Write an VPS NAL unit */
 static gboolean
 bs_write_vps_data (GstBitWriter * bs, GstVaapiEncoderH265 * encoder,
@@ -564,8 +652,9 @@ bs_write_vps_data (GstBitWriter * bs, GstVaapiEncoderH265 * encoder,
 {
   guint32 video_parameter_set_id = 0;
   guint32 vps_max_layers_minus1 = 0;
-  guint32 vps_max_sub_layers_minus1 = 0;
-  guint32 vps_temporal_id_nesting_flag = 1;
+  guint32 vps_max_sub_layers_minus1 = encoder->temporal_levels - 1;
+  guint32 vps_temporal_id_nesting_flag =
+      get_temporal_id_nesting_flag (encoder);
   guint32 vps_sub_layer_ordering_info_present_flag = 0;
   guint32 vps_max_latency_increase_plus1 = 0;
   guint32 vps_max_layer_id = 0;
@@ -591,7 +680,8 @@ bs_write_vps_data (GstBitWriter * bs, GstVaapiEncoderH265 * encoder,
   WRITE_UINT32 (bs, 0xffff, 16);
 
   /* profile_tier_level */
-  bs_write_profile_tier_level (bs, seq_param, profile);
+  bs_write_profile_tier_level (bs, seq_param, profile,
+      vps_max_sub_layers_minus1);
 
   /* vps_sub_layer_ordering_info_present_flag */
   WRITE_UINT32 (bs, vps_sub_layer_ordering_info_present_flag, 1);
@@ -642,8 +732,8 @@ bs_write_sps_data (GstBitWriter * bs, GstVaapiEncoderH265 * encoder,
     GstVaapiRateControl rate_control, const VAEncMiscParameterHRD * hrd_params)
 {
   guint32 video_parameter_set_id = 0;
-  guint32 max_sub_layers_minus1 = 0;
-  guint32 temporal_id_nesting_flag = 1;
+  guint32 max_sub_layers_minus1 = encoder->temporal_levels - 1;
+  guint32 temporal_id_nesting_flag = get_temporal_id_nesting_flag (encoder);
   guint32 separate_colour_plane_flag = 0;
   guint32 seq_parameter_set_id = 0;
   guint32 sps_sub_layer_ordering_info_present_flag = 0;
@@ -652,7 +742,7 @@ bs_write_sps_data (GstBitWriter * bs, GstVaapiEncoderH265 * encoder,
   guint32 long_term_ref_pics_present_flag = 0;
   guint32 sps_extension_flag = 0;
   guint32 nal_hrd_parameters_present_flag = 0;
-  guint maxNumSubLayers = 1, i;
+  guint maxNumSubLayers = max_sub_layers_minus1 + 1, i;
   guint32 cbr_flag = rate_control == GST_VAAPI_RATECONTROL_CBR ? 1 : 0;
 
   /* video_parameter_set_id */
@@ -663,7 +753,7 @@ bs_write_sps_data (GstBitWriter * bs, GstVaapiEncoderH265 * encoder,
   WRITE_UINT32 (bs, temporal_id_nesting_flag, 1);
 
   /* profile_tier_level */
-  bs_write_profile_tier_level (bs, seq_param, profile);
+  bs_write_profile_tier_level (bs, seq_param, profile, max_sub_layers_minus1);
 
   /* seq_parameter_set_id */
   WRITE_UE (bs, seq_parameter_set_id);
@@ -1033,6 +1123,27 @@ bs_error:
   }
 }
 
+/* Write short_term_ref_pic_set(0) out of the reference pool */
+static gboolean
+bs_write_short_term_ref_pic_set (GstBitWriter * bs,
+    const VAEncSliceParameterBufferHEVC * slice_param,
+    GstVaapiEncoderH265 * encoder, GstVaapiEncPicture * picture)
+{
+  GstVaapiEncoderH265Ref *ref;
+  guint ref_pocs[16];
+  guint num_refs = 0;
+  GList *iter;
+
+  for (iter = g_queue_peek_head_link (&encoder->ref_pool.ref_list);
+      iter && num_refs < G_N_ELEMENTS (ref_pocs); iter = g_list_next (iter)) {
+    ref = iter->data;
+    ref_pocs[num_refs++] = ref->poc;
+  }
+
+  return bs_write_short_term_ref_pic_set_h265 (bs, slice_param, picture->poc,
+      ref_pocs, num_refs);
+}
+
 /* Write a Slice NAL unit */
 static gboolean
 bs_write_slice (GstBitWriter * bs,
@@ -1083,81 +1194,8 @@ bs_write_slice (GstBitWriter * bs,
       WRITE_UINT32 (bs, short_term_ref_pic_set_sps_flag, 1);
 
     /*---------- Write short_term_ref_pic_set(0) ----------- */
-      {
-        guint num_positive_pics = 0, num_negative_pics = 0;
-        guint delta_poc_s0_minus1 = 0, delta_poc_s1_minus1 = 0;
-        guint used_by_curr_pic_s0_flag = 0, used_by_curr_pic_s1_flag = 0;
-        guint reflist_0_count = 0, reflist_1_count = 0;
-        gint i;
-
-        /* Get count of ref_pic_list */
-        if (picture->type == GST_VAAPI_PICTURE_TYPE_P
-            || picture->type == GST_VAAPI_PICTURE_TYPE_B) {
-          for (i = 0; i < G_N_ELEMENTS (slice_param->ref_pic_list0); ++i) {
-            if (slice_param->ref_pic_list0[i].picture_id == VA_INVALID_SURFACE)
-              break;
-          }
-          reflist_0_count = i;
-
-          if (picture->type == GST_VAAPI_PICTURE_TYPE_B) {
-            for (i = 0; i < G_N_ELEMENTS (slice_param->ref_pic_list1); ++i) {
-              if (slice_param->ref_pic_list1[i].picture_id ==
-                  VA_INVALID_SURFACE)
-                break;
-            }
-            reflist_1_count = i;
-          }
-        }
-
-        if (picture->type == GST_VAAPI_PICTURE_TYPE_P) {
-          delta_poc_s0_minus1 =
-              picture->poc - slice_param->ref_pic_list0[0].pic_order_cnt - 1;
-          used_by_curr_pic_s0_flag = 1;
-          delta_poc_s1_minus1 = 0;
-          used_by_curr_pic_s1_flag = 0;
-        }
-        if (picture->type == GST_VAAPI_PICTURE_TYPE_B) {
-          delta_poc_s0_minus1 =
-              picture->poc - slice_param->ref_pic_list0[0].pic_order_cnt - 1;
-          used_by_curr_pic_s0_flag = 1;
-          delta_poc_s1_minus1 =
-              slice_param->ref_pic_list1[0].pic_order_cnt - picture->poc - 1;
-          used_by_curr_pic_s1_flag = 1;
-        }
-
-        num_negative_pics = reflist_0_count;
-        num_positive_pics = reflist_1_count;
-
-        /* num_negative_pics */
-        WRITE_UE (bs, num_negative_pics);
-        /* num_positive_pics */
-        WRITE_UE (bs, num_positive_pics);
-
-        for (i = 0; i < num_negative_pics; i++) {
-          /* delta_poc_s0_minus1 */
-          if (i == 0) {
-            WRITE_UE (bs, delta_poc_s0_minus1);
-          } else {
-            WRITE_UE (bs,
-                slice_param->ref_pic_list0[i - 1].pic_order_cnt -
-                slice_param->ref_pic_list0[i].pic_order_cnt - 1);
-          }
-          /* used_by_curr_pic_s0_flag */
-          WRITE_UINT32 (bs, used_by_curr_pic_s0_flag, 1);
-        }
-        for (i = 0; i < num_positive_pics; i++) {
-          /* delta_poc_s1_minus1 */
-          if (i == 0) {
-            WRITE_UE (bs, delta_poc_s1_minus1);
-          } else {
-            WRITE_UE (bs,
-                slice_param->ref_pic_list1[i - 1].pic_order_cnt -
-                slice_param->ref_pic_list1[i].pic_order_cnt - 1);
-          }
-          /* used_by_curr_pic_s1_flag */
-          WRITE_UINT32 (bs, used_by_curr_pic_s1_flag, 1);
-        }
-      }
+      if (!bs_write_short_term_ref_pic_set (bs, slice_param, encoder, picture))
+        goto bs_error;
 
       /* slice_temporal_mvp_enabled_flag */
       if (encoder->sps_temporal_mvp_enabled_flag)
@@ -1457,6 +1495,13 @@ error_unsupported_level:
   }
 }
 
+static gboolean
+is_temporal_id_max (GstVaapiEncoderH265 * encoder, guint32 temporal_id)
+{
+  g_assert (temporal_id < encoder->temporal_levels);
+  return temporal_id == encoder->temporal_levels - 1;
+}
+
 /* Handle new GOP starts */
 static void
 reset_gop_start (GstVaapiEncoderH265 * encoder)
@@ -1475,6 +1520,18 @@ set_b_frame (GstVaapiEncPicture * pic, GstVaapiEncoderH265 * encoder)
   g_assert (pic && encoder);
   g_return_if_fail (pic->type == GST_VAAPI_PICTURE_TYPE_NONE);
   pic->type = GST_VAAPI_PICTURE_TYPE_B;
+
+  if (encoder->temporal_levels > 1) {
+    /* while doing temporal encoding, b frames are allowed
+     * only in hierarchical-b mode */
+    g_assert (encoder->prediction_type ==
+        GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_B);
+    /* temporal_encode: set b-frame as reference frames in
+     * hierarchical-b encode unless they belong to the highest level */
+    if (!is_temporal_id_max (encoder, pic->temporal_id))
+      GST_VAAPI_ENC_PICTURE_FLAG_SET (pic,
+          GST_VAAPI_ENC_PICTURE_FLAG_REFERENCE);
+  }
 }
 
 /* Marks the supplied picture as a P-frame */
@@ -1483,6 +1540,12 @@ set_p_frame (GstVaapiEncPicture * pic, GstVaapiEncoderH265 * encoder)
 {
   g_return_if_fail (pic->type == GST_VAAPI_PICTURE_TYPE_NONE);
   pic->type = GST_VAAPI_PICTURE_TYPE_P;
+
+  /* temporal_encode: all frames in highest level are not reference
+   * frames for hierarchical-p and hierarchical-b prediction mode */
+  if (encoder->temporal_levels == 1 ||
+      !is_temporal_id_max (encoder, pic->temporal_id))
+    GST_VAAPI_ENC_PICTURE_FLAG_SET (pic, GST_VAAPI_ENC_PICTURE_FLAG_REFERENCE);
 }
 
 /* Marks the supplied picture as an I-frame */
@@ -1491,6 +1554,7 @@ set_i_frame (GstVaapiEncPicture * pic, GstVaapiEncoderH265 * encoder)
 {
   g_return_if_fail (pic->type == GST_VAAPI_PICTURE_TYPE_NONE);
   pic->type = GST_VAAPI_PICTURE_TYPE_I;
+  GST_VAAPI_ENC_PICTURE_FLAG_SET (pic, GST_VAAPI_ENC_PICTURE_FLAG_REFERENCE);
 
   g_assert (pic->frame);
   GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (pic->frame);
@@ -1504,6 +1568,7 @@ set_idr_frame (GstVaapiEncPicture * pic, GstVaapiEncoderH265 * encoder)
   pic->type = GST_VAAPI_PICTURE_TYPE_I;
   pic->poc = 0;
   GST_VAAPI_ENC_PICTURE_FLAG_SET (pic, GST_VAAPI_ENC_PICTURE_FLAG_IDR);
+  GST_VAAPI_ENC_PICTURE_FLAG_SET (pic, GST_VAAPI_ENC_PICTURE_FLAG_REFERENCE);
 
   g_assert (pic->frame);
   GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (pic->frame);
@@ -1514,6 +1579,9 @@ static void
 set_key_frame (GstVaapiEncPicture * picture,
     GstVaapiEncoderH265 * encoder, gboolean is_idr)
 {
+  /* key-frames belong to the base layer */
+  picture->temporal_id = 0;
+
   if (is_idr) {
     reset_gop_start (encoder);
     set_idr_frame (picture, encoder);
@@ -1551,7 +1619,7 @@ add_packed_vps_header (GstVaapiEncoderH265 * encoder,
 
   gst_bit_writer_init_with_size (&bs, 128, FALSE);
   WRITE_UINT32 (&bs, 0x00000001, 32);   /* start code */
-  bs_write_nal_header (&bs, GST_H265_NAL_VPS);
+  bs_write_nal_header (&bs, GST_H265_NAL_VPS, 0);
 
   bs_write_vps (&bs, encoder, picture, seq_param, profile);
 
@@ -1606,7 +1674,7 @@ add_packed_sequence_header (GstVaapiEncoderH265 * encoder,
 
   gst_bit_writer_init_with_size (&bs, 128, FALSE);
   WRITE_UINT32 (&bs, 0x00000001, 32);   /* start code */
-  bs_write_nal_header (&bs, GST_H265_NAL_SPS);
+  bs_write_nal_header (&bs, GST_H265_NAL_SPS, 0);
 
   bs_write_sps (&bs, encoder, picture, seq_param, profile,
       base_encoder->rate_control, &hrd_params);
@@ -1656,7 +1724,7 @@ add_packed_picture_header (GstVaapiEncoderH265 * encoder,
 
   gst_bit_writer_init_with_size (&bs, 128, FALSE);
   WRITE_UINT32 (&bs, 0x00000001, 32);   /* start code */
-  bs_write_nal_header (&bs, GST_H265_NAL_PPS);
+  bs_write_nal_header (&bs, GST_H265_NAL_PPS, 0);
   bs_write_pps (&bs, h265_is_scc (encoder), pic_param);
   g_assert (GST_BIT_WRITER_BIT_SIZE (&bs) % 8 == 0);
   data_bit_size = GST_BIT_WRITER_BIT_SIZE (&bs);
@@ -1688,6 +1756,56 @@ bs_error:
   }
 }
 
+/* Adds a recovery point SEI message to the list of packed headers
+   to pass down as-is to the encoder */
+static gboolean
+add_packed_sei_recovery_point (GstVaapiEncoderH265 * encoder,
+    GstVaapiEncPicture * picture)
+{
+  GstVaapiEncPackedHeader *packed_sei;
+  GstBitWriter bs;
+  VAEncPackedHeaderParameterBuffer packed_sei_param = { 0 };
+  guint32 data_bit_size;
+  guint8 *data;
+
+  gst_bit_writer_init_with_size (&bs, 128, FALSE);
+  WRITE_UINT32 (&bs, 0x00000001, 32);   /* start code */
+  bs_write_nal_header (&bs, GST_H265_NAL_PREFIX_SEI, 0);
+
+  /* The picture is fully refreshed at the end of the cycle */
+  if (!bs_write_sei_recovery_point_h265 (&bs,
+          encoder->intra_refresh_period - 1))
+    goto bs_error;
+
+  bs_write_trailing_bits (&bs);
+  g_assert (GST_BIT_WRITER_BIT_SIZE (&bs) % 8 == 0);
+  data_bit_size = GST_BIT_WRITER_BIT_SIZE (&bs);
+  data = GST_BIT_WRITER_DATA (&bs);
+
+  packed_sei_param.type = VAEncPackedHeaderHEVC_SEI;
+  packed_sei_param.bit_length = data_bit_size;
+  packed_sei_param.has_emulation_bytes = 0;
+
+  packed_sei = gst_vaapi_enc_packed_header_new (GST_VAAPI_ENCODER (encoder),
+      &packed_sei_param, sizeof (packed_sei_param),
+      data, (data_bit_size + 7) / 8);
+  g_assert (packed_sei);
+
+  gst_vaapi_enc_picture_add_packed_header (picture, packed_sei);
+  gst_vaapi_codec_object_replace (&packed_sei, NULL);
+
+  gst_bit_writer_reset (&bs);
+  return TRUE;
+
+  /* ERRORS */
+bs_error:
+  {
+    GST_WARNING ("failed to write SEI NAL unit");
+    gst_bit_writer_reset (&bs);
+    return FALSE;
+  }
+}
+
 static gboolean
 get_nal_unit_type (GstVaapiEncPicture * picture, guint8 * nal_unit_type)
 {
@@ -1699,10 +1817,12 @@ get_nal_unit_type (GstVaapiEncPicture * picture, guint8 * nal_unit_type)
         *nal_unit_type = GST_H265_NAL_SLICE_TRAIL_R;
       break;
     case GST_VAAPI_PICTURE_TYPE_P:
-      *nal_unit_type = GST_H265_NAL_SLICE_TRAIL_R;
-      break;
     case GST_VAAPI_PICTURE_TYPE_B:
-      *nal_unit_type = GST_H265_NAL_SLICE_TRAIL_N;
+      /* sub-layer non-reference pictures */
+      if (GST_VAAPI_ENC_PICTURE_IS_REFRENCE (picture))
+        *nal_unit_type = GST_H265_NAL_SLICE_TRAIL_R;
+      else
+        *nal_unit_type = GST_H265_NAL_SLICE_TRAIL_N;
       break;
     default:
       return FALSE;
@@ -1729,7 +1849,7 @@ add_packed_slice_header (GstVaapiEncoderH265 * encoder,
 
   if (!get_nal_unit_type (picture, &nal_unit_type))
     goto bs_error;
-  bs_write_nal_header (&bs, nal_unit_type);
+  bs_write_nal_header (&bs, nal_unit_type, picture->temporal_id);
 
   bs_write_slice (&bs, slice_param, encoder, picture, nal_unit_type);
   data_bit_size = GST_BIT_WRITER_BIT_SIZE (&bs);
@@ -1770,6 +1890,16 @@ reference_pic_free (GstVaapiEncoderH265 * encoder, GstVaapiEncoderH265Ref * ref)
   g_slice_free (GstVaapiEncoderH265Ref, ref);
 }
 
+/* Releases all the reference pictures */
+static void
+reference_list_clear (GstVaapiEncoderH265 * encoder)
+{
+  GstVaapiH265RefPool *const ref_pool = &encoder->ref_pool;
+
+  while (!g_queue_is_empty (&ref_pool->ref_list))
+    reference_pic_free (encoder, g_queue_pop_head (&ref_pool->ref_list));
+}
+
 static inline GstVaapiEncoderH265Ref *
 reference_pic_create (GstVaapiEncoderH265 * encoder,
     GstVaapiEncPicture * picture, GstVaapiSurfaceProxy * surface)
@@ -1778,9 +1908,44 @@ reference_pic_create (GstVaapiEncoderH265 * encoder,
 
   ref->pic = surface;
   ref->poc = picture->poc;
+  ref->temporal_id = picture->temporal_id;
   return ref;
 }
 
+/* Drops the references which precede the last base layer picture, in
+   display order: in hierarchical encode, the following pictures only
+   refer to it, or to the pictures after it */
+static void
+reference_list_prune_hierarchical (GstVaapiEncoderH265 * encoder)
+{
+  GstVaapiH265RefPool *const ref_pool = &encoder->ref_pool;
+  GstVaapiEncoderH265Ref *ref;
+  GList *iter, *next;
+  guint base_poc = 0;
+  gboolean found = FALSE;
+
+  iter = g_queue_peek_tail_link (&ref_pool->ref_list);
+  for (; iter; iter = g_list_previous (iter)) {
+    ref = iter->data;
+    if (ref->temporal_id == 0) {
+      base_poc = ref->poc;
+      found = TRUE;
+      break;
+    }
+  }
+  if (!found)
+    return;
+
+  for (iter = g_queue_peek_head_link (&ref_pool->ref_list); iter; iter = next) {
+    next = g_list_next (iter);
+    ref = iter->data;
+    if (ref->poc < base_poc) {
+      g_queue_delete_link (&ref_pool->ref_list, iter);
+      reference_pic_free (encoder, ref);
+    }
+  }
+}
+
 static gboolean
 reference_list_update (GstVaapiEncoderH265 * encoder,
     GstVaapiEncPicture * picture, GstVaapiSurfaceProxy * surface)
@@ -1788,7 +1953,7 @@ reference_list_update (GstVaapiEncoderH265 * encoder,
   GstVaapiEncoderH265Ref *ref;
   GstVaapiH265RefPool *const ref_pool = &encoder->ref_pool;
 
-  if (GST_VAAPI_PICTURE_TYPE_B == picture->type) {
+  if (!GST_VAAPI_ENC_PICTURE_IS_REFRENCE (picture)) {
     gst_vaapi_encoder_release_surface (GST_VAAPI_ENCODER (encoder), surface);
     return TRUE;
   }
@@ -1796,7 +1961,12 @@ reference_list_update (GstVaapiEncoderH265 * encoder,
   if (GST_VAAPI_ENC_PICTURE_IS_IDR (picture)) {
     while (!g_queue_is_empty (&ref_pool->ref_list))
       reference_pic_free (encoder, g_queue_pop_head (&ref_pool->ref_list));
-  } else if (g_queue_get_length (&ref_pool->ref_list) >=
+  } else if (encoder->prediction_type !=
+      GST_VAAPI_ENCODER_H265_PREDICTION_DEFAULT && picture->temporal_id == 0) {
+    reference_list_prune_hierarchical (encoder);
+  }
+
+  if (g_queue_get_length (&ref_pool->ref_list) >=
       ref_pool->max_ref_frames) {
     reference_pic_free (encoder, g_queue_pop_head (&ref_pool->ref_list));
   }
@@ -1807,6 +1977,70 @@ reference_list_update (GstVaapiEncoderH265 * encoder,
   return TRUE;
 }
 
+/* update reflist0 for hierarchical-p and hierarchical-b encode: the
+   nearest past picture of a lower layer, or of the base layer */
+static void
+reflist0_init_hierarchical (GstVaapiEncoderH265 * encoder,
+    GstVaapiEncPicture * picture, GQueue * ref_list,
+    GstVaapiEncoderH265Ref ** reflist_0, guint * reflist_0_count)
+{
+  GstVaapiEncoderH265Ref *tmp, *best = NULL;
+  GList *iter;
+
+  iter = g_queue_peek_tail_link (ref_list);
+  for (; iter; iter = g_list_previous (iter)) {
+    tmp = (GstVaapiEncoderH265Ref *) iter->data;
+
+    g_assert (tmp && tmp->poc != picture->poc);
+
+    if (_poc_greater_than (picture->poc, tmp->poc, encoder->max_pic_order_cnt)
+        && ((picture->temporal_id && (tmp->temporal_id < picture->temporal_id))
+            || (!picture->temporal_id && !tmp->temporal_id))) {
+      if (!best || tmp->poc > best->poc)
+        best = tmp;
+    }
+  }
+
+  g_assert (best != NULL);
+
+  /* Only need one ref frame */
+  reflist_0[0] = best;
+  *reflist_0_count = 1;
+}
+
+/* update reflist1 for hierarchical-b encode: the nearest future
+   picture of a lower layer */
+static void
+reflist1_init_hierarchical_b (GstVaapiEncoderH265 * encoder,
+    GstVaapiEncPicture * picture, GQueue * ref_list,
+    GstVaapiEncoderH265Ref ** reflist_1, guint * reflist_1_count)
+{
+  GstVaapiEncoderH265Ref *tmp, *best = NULL;
+  GList *iter;
+
+  /* base layer should have only P frames */
+  g_assert (picture->temporal_id != 0);
+
+  iter = g_queue_peek_tail_link (ref_list);
+  for (; iter; iter = g_list_previous (iter)) {
+    tmp = (GstVaapiEncoderH265Ref *) iter->data;
+
+    g_assert (tmp && tmp->poc != picture->poc);
+
+    if (_poc_greater_than (tmp->poc, picture->poc, encoder->max_pic_order_cnt)
+        && (tmp->temporal_id < picture->temporal_id)) {
+      if (!best || tmp->poc < best->poc)
+        best = tmp;
+    }
+  }
+
+  g_assert (best != NULL);
+
+  /* Only need one ref frame */
+  reflist_1[0] = best;
+  *reflist_1_count = 1;
+}
+
 static gboolean
 reference_list_init (GstVaapiEncoderH265 * encoder,
     GstVaapiEncPicture * picture,
@@ -1824,6 +2058,16 @@ reference_list_init (GstVaapiEncoderH265 * encoder,
   if (picture->type == GST_VAAPI_PICTURE_TYPE_I)
     return TRUE;
 
+  /* reference picture handling for hierarchical encode */
+  if (encoder->prediction_type != GST_VAAPI_ENCODER_H265_PREDICTION_DEFAULT) {
+    reflist0_init_hierarchical (encoder, picture, &ref_pool->ref_list,
+        reflist_0, reflist_0_count);
+    if (picture->type == GST_VAAPI_PICTURE_TYPE_B)
+      reflist1_init_hierarchical_b (encoder, picture, &ref_pool->ref_list,
+          reflist_1, reflist_1_count);
+    return TRUE;
+  }
+
   iter = g_queue_peek_tail_link (&ref_pool->ref_list);
   for (; iter; iter = g_list_previous (iter)) {
     tmp = (GstVaapiEncoderH265Ref *) iter->data;
@@ -2026,7 +2270,7 @@ fill_picture (GstVaapiEncoderH265 * encoder, GstVaapiEncPicture * picture,
   pic_param->pic_fields.bits.idr_pic_flag =
       GST_VAAPI_ENC_PICTURE_IS_IDR (picture);
   pic_param->pic_fields.bits.coding_type = picture->type;
-  if (picture->type != GST_VAAPI_PICTURE_TYPE_B)
+  if (GST_VAAPI_ENC_PICTURE_IS_REFRENCE (picture))
     pic_param->pic_fields.bits.reference_pic_flag = TRUE;
   pic_param->pic_fields.bits.sign_data_hiding_enabled_flag = FALSE;
   pic_param->pic_fields.bits.transform_skip_enabled_flag = TRUE;
@@ -2165,21 +2409,11 @@ create_and_fill_one_slice (GstVaapiEncoderH265 * encoder,
 
   slice_param->max_num_merge_cand = 5;  /* MaxNumMergeCand      */
   slice_param->slice_qp_delta = encoder->qp_i - encoder->init_qp;
-  if (GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CQP) {
-    if (picture->type == GST_VAAPI_PICTURE_TYPE_P) {
-      slice_param->slice_qp_delta += encoder->qp_ip;
-    } else if (picture->type == GST_VAAPI_PICTURE_TYPE_B) {
-      slice_param->slice_qp_delta += encoder->qp_ib;
-    }
-    if ((gint) encoder->init_qp + slice_param->slice_qp_delta <
-        (gint) encoder->min_qp) {
-      slice_param->slice_qp_delta = encoder->min_qp - encoder->init_qp;
-    }
-    if ((gint) encoder->init_qp + slice_param->slice_qp_delta >
-        (gint) encoder->max_qp) {
-      slice_param->slice_qp_delta = encoder->max_qp - encoder->init_qp;
-    }
-  }
+  if (GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CQP)
+    slice_param->slice_qp_delta =
+        gst_vaapi_encoder_get_picture_qp (GST_VAAPI_ENCODER_CAST (encoder),
+        picture, encoder->qp_i, encoder->qp_ip, encoder->qp_ib,
+        encoder->min_qp, encoder->max_qp) - encoder->init_qp;
 
   slice_param->slice_fields.bits.slice_loop_filter_across_slices_enabled_flag =
       TRUE;
@@ -2394,10 +2628,28 @@ ensure_misc_params (GstVaapiEncoderH265 * encoder, GstVaapiEncPicture * picture)
 
   if (!gst_vaapi_encoder_ensure_param_control_rate (base_encoder, picture))
     return FALSE;
+  /* before the ROI regions, the QP map falls back on them */
+  if (!gst_vaapi_encoder_ensure_qp_map (base_encoder, picture,
+          gst_vaapi_encoder_get_picture_qp (base_encoder, picture,
+              encoder->qp_i, encoder->qp_ip, encoder->qp_ib, encoder->min_qp,
+              encoder->max_qp), encoder->min_qp, encoder->max_qp))
+    return FALSE;
   if (!gst_vaapi_encoder_ensure_param_roi_regions (base_encoder, picture))
     return FALSE;
   if (!gst_vaapi_encoder_ensure_param_quality_level (base_encoder, picture))
     return FALSE;
+  if (!gst_vaapi_encoder_ensure_param_intra_refresh (base_encoder, picture,
+          encoder->intra_refresh, encoder->intra_refresh_location,
+          encoder->intra_refresh_size))
+    return FALSE;
+
+  if (encoder->intra_refresh_start &&
+      (GST_VAAPI_ENCODER_PACKED_HEADERS (encoder) &
+          VA_ENC_PACKED_HEADER_MISC) &&
+      !add_packed_sei_recovery_point (encoder, picture)) {
+    GST_ERROR ("failed to create packed SEI header");
+    return FALSE;
+  }
   return TRUE;
 }
 
@@ -2464,7 +2716,9 @@ ensure_bitrate_hrd (GstVaapiEncoderH265 * encoder)
   GstVaapiEncoder *const base_encoder = GST_VAAPI_ENCODER_CAST (encoder);
   guint bitrate, cpb_size;
 
-  if (!base_encoder->bitrate) {
+  /* the target of the software rate control is not signalled */
+  if (!base_encoder->bitrate ||
+      GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CQP) {
     encoder->bitrate_bits = 0;
     return;
   }
@@ -2496,6 +2750,13 @@ ensure_bitrate (GstVaapiEncoderH265 * encoder)
   GstVaapiEncoder *const base_encoder = GST_VAAPI_ENCODER_CAST (encoder);
 
   switch (GST_VAAPI_ENCODER_RATE_CONTROL (encoder)) {
+    case GST_VAAPI_RATECONTROL_CQP:
+      if (!base_encoder->software_rate_control) {
+        base_encoder->bitrate = 0;
+        break;
+      }
+      /* the software rate control needs a target bitrate too */
+      /* fall through */
     case GST_VAAPI_RATECONTROL_CBR:
     case GST_VAAPI_RATECONTROL_VBR:
     case GST_VAAPI_RATECONTROL_QVBR:
@@ -2591,6 +2852,124 @@ check_ref_list (GstVaapiEncoderH265 * encoder)
   return TRUE;
 }
 
+/* Gets the number of 16x16 block columns, or rows, swept by the
+   gradual intra refresh */
+static guint
+get_intra_refresh_units (GstVaapiEncoderH265 * encoder)
+{
+  if (encoder->intra_refresh == GST_VAAPI_ENCODER_INTRA_REFRESH_COLUMN)
+    return (GST_VAAPI_ENCODER_WIDTH (encoder) + 15) / 16;
+  return (GST_VAAPI_ENCODER_HEIGHT (encoder) + 15) / 16;
+}
+
+/* Checks the gradual intra refresh settings against the driver and
+   the rest of the configuration */
+static void
+reset_intra_refresh (GstVaapiEncoderH265 * encoder)
+{
+  GstVaapiEncoder *const base_encoder = GST_VAAPI_ENCODER_CAST (encoder);
+  guint num_units;
+
+  encoder->intra_refresh_index = 0;
+  encoder->intra_refresh_size = 0;
+  encoder->intra_refresh_start = FALSE;
+  base_encoder->optional_packed_headers = 0;
+
+  if (encoder->intra_refresh == GST_VAAPI_ENCODER_INTRA_REFRESH_NONE)
+    return;
+
+  if (!gst_vaapi_encoder_ensure_intra_refresh_support (base_encoder,
+          encoder->profile, encoder->entrypoint, encoder->intra_refresh)) {
+    GST_WARNING ("Disabling intra refresh since the driver doesn't support it");
+    encoder->intra_refresh = GST_VAAPI_ENCODER_INTRA_REFRESH_NONE;
+    return;
+  }
+
+  /* the recovery point counts on every picture being a reference
+   * P-frame, coded in display order */
+  if (encoder->num_bframes > 0 || encoder->temporal_levels > 1 ||
+      encoder->prediction_type != GST_VAAPI_ENCODER_H265_PREDICTION_DEFAULT) {
+    GST_WARNING ("Disabling b-frames and temporal levels for intra refresh");
+    encoder->num_bframes = 0;
+    encoder->temporal_levels = MIN_TEMPORAL_LEVELS;
+    encoder->prediction_type = GST_VAAPI_ENCODER_H265_PREDICTION_DEFAULT;
+  }
+
+  num_units = get_intra_refresh_units (encoder);
+  if (encoder->intra_refresh_period > num_units) {
+    GST_INFO ("Lowering the intra refresh period to %d", num_units);
+    encoder->intra_refresh_period = num_units;
+  }
+
+  /* recovery_poc_cnt has to be lower than MaxPicOrderCntLsb / 2 */
+  if (encoder->idr_period < 2 * encoder->intra_refresh_period)
+    encoder->idr_period = 2 * encoder->intra_refresh_period;
+
+  /* for the recovery point SEI messages */
+  base_encoder->optional_packed_headers = VA_ENC_PACKED_HEADER_MISC;
+}
+
+/* Sets up the hierarchical prediction for the requested temporal
+   levels: the GOP is cut into mini-GOPs of 2^(temporal_levels - 1)
+   pictures, each one ending with a base layer picture */
+static void
+reset_temporal_levels (GstVaapiEncoderH265 * encoder)
+{
+  GstVaapiEncoder *const base_encoder = GST_VAAPI_ENCODER_CAST (encoder);
+  guint ip_period, d, l;
+
+  /* If temporal scalability enabled then use hierarchical-p/b
+   * according to num_bframes as default prediction */
+  if (encoder->temporal_levels > 1
+      && encoder->prediction_type ==
+      GST_VAAPI_ENCODER_H265_PREDICTION_DEFAULT) {
+    if (encoder->num_bframes > 0)
+      encoder->prediction_type =
+          GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_B;
+    else
+      encoder->prediction_type =
+          GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_P;
+  }
+
+  if (encoder->prediction_type ==
+      GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_B &&
+      base_encoder->max_num_ref_frames_1 < 1) {
+    GST_WARNING ("Using hierarchical-p since the driver doesn't support"
+        " b-frames");
+    encoder->prediction_type = GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_P;
+  }
+
+  if (encoder->prediction_type == GST_VAAPI_ENCODER_H265_PREDICTION_DEFAULT) {
+    encoder->temporal_levels = MIN_TEMPORAL_LEVELS;
+  } else {
+    /* Hierarchical prediction should have a temporal level count
+     * greater than one and we use 4 temporal levels as default */
+    if (encoder->temporal_levels <= 1)
+      encoder->temporal_levels = 4;
+
+    ip_period = 1 << (encoder->temporal_levels - 1);
+
+    /* align the idr_period to ip_period to simplify encode process */
+    encoder->idr_period = GST_ROUND_UP_N (encoder->idr_period, ip_period);
+    GST_VAAPI_ENCODER_KEYFRAME_PERIOD (base_encoder) = encoder->idr_period;
+
+    /* no b-frames in Hierarchical-P, a full pyramid in Hierarchical-B */
+    if (encoder->prediction_type ==
+        GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_P)
+      encoder->num_bframes = 0;
+    else
+      encoder->num_bframes = ip_period - 1;
+  }
+
+  /* temporal_level_div[] is helpful to find out the temporal level
+   * where each frame should belong */
+  d = 1 << (encoder->temporal_levels - 1);
+  for (l = 0; l < encoder->temporal_levels; l++) {
+    encoder->temporal_level_div[l] = d;
+    d >>= 1;
+  }
+}
+
 static GstVaapiEncoderStatus
 reset_properties (GstVaapiEncoderH265 * encoder)
 {
@@ -2600,8 +2979,7 @@ reset_properties (GstVaapiEncoderH265 * encoder)
   guint ctu_size;
   gboolean ret;
 
-  if (encoder->idr_period < base_encoder->keyframe_period)
-    encoder->idr_period = base_encoder->keyframe_period;
+  encoder->idr_period = base_encoder->keyframe_period;
 
   if (encoder->min_qp > encoder->init_qp)
     encoder->min_qp = encoder->init_qp;
@@ -2610,6 +2988,8 @@ reset_properties (GstVaapiEncoderH265 * encoder)
 
   encoder->qp_i = encoder->init_qp;
 
+  reset_intra_refresh (encoder);
+
   ctu_size = encoder->ctu_width * encoder->ctu_height;
   ret = gst_vaapi_encoder_ensure_num_slices (base_encoder, encoder->profile,
       encoder->entrypoint, (ctu_size + 1) / 2, &encoder->num_slices);
@@ -2624,6 +3004,10 @@ reset_properties (GstVaapiEncoderH265 * encoder)
   if (base_encoder->max_num_ref_frames_1 < 1 && encoder->num_bframes > 0) {
     GST_WARNING ("Disabling b-frame since the driver doesn't support it");
     encoder->num_bframes = 0;
+
+    if (encoder->prediction_type ==
+        GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_B)
+      encoder->prediction_type = GST_VAAPI_ENCODER_H265_PREDICTION_DEFAULT;
   }
 
   if (encoder->num_ref_frames > base_encoder->max_num_ref_frames_0) {
@@ -2635,6 +3019,8 @@ reset_properties (GstVaapiEncoderH265 * encoder)
   if (encoder->num_bframes > (base_encoder->keyframe_period + 1) / 2)
     encoder->num_bframes = (base_encoder->keyframe_period + 1) / 2;
 
+  reset_temporal_levels (encoder);
+
   if (encoder->num_bframes > 0 && GST_VAAPI_ENCODER_FPS_N (encoder) > 0)
     encoder->cts_offset = gst_util_uint64_scale (GST_SECOND,
         GST_VAAPI_ENCODER_FPS_D (encoder), GST_VAAPI_ENCODER_FPS_N (encoder));
@@ -2648,23 +3034,35 @@ reset_properties (GstVaapiEncoderH265 * encoder)
   encoder->max_pic_order_cnt = (1 << encoder->log2_max_pic_order_cnt);
   encoder->idr_num = 0;
 
+  ref_pool = &encoder->ref_pool;
+  if (encoder->prediction_type == GST_VAAPI_ENCODER_H265_PREDICTION_DEFAULT) {
+    ref_pool->max_reflist0_count = encoder->num_ref_frames;
+    ref_pool->max_reflist1_count = encoder->num_bframes > 0;
+    ref_pool->max_ref_frames = ref_pool->max_reflist0_count
+        + ref_pool->max_reflist1_count;
+  } else {
+    /* the last two base layer pictures, and the references of the
+     * upper layers in between */
+    ref_pool->max_ref_frames = (1 << (encoder->temporal_levels - 2)) + 1;
+    ref_pool->max_reflist0_count = 1;
+    ref_pool->max_reflist1_count = encoder->num_bframes > 0;
+    encoder->num_ref_frames = ref_pool->max_ref_frames;
+  }
+
   /* Only Supporting a maximum of two reference frames */
   if (encoder->num_bframes) {
     encoder->max_dec_pic_buffering = encoder->num_ref_frames + 2;
-    encoder->max_num_reorder_pics = 1;
+    /* the pyramid holds back one picture per upper layer */
+    encoder->max_num_reorder_pics = encoder->temporal_levels > 1 ?
+        encoder->temporal_levels - 1 : 1;
   } else {
     encoder->max_dec_pic_buffering = encoder->num_ref_frames + 1;
     encoder->max_num_reorder_pics = 0;
   }
 
-  ref_pool = &encoder->ref_pool;
-  ref_pool->max_reflist0_count = encoder->num_ref_frames;
-  ref_pool->max_reflist1_count = encoder->num_bframes > 0;
-  ref_pool->max_ref_frames = ref_pool->max_reflist0_count
-      + ref_pool->max_reflist1_count;
-
   reorder_pool = &encoder->reorder_pool;
   reorder_pool->frame_index = 0;
+  reorder_pool->key_frame_index = 0;
 
   return GST_VAAPI_ENCODER_STATUS_SUCCESS;
 }
@@ -2962,6 +3360,32 @@ ensure_tile (GstVaapiEncoderH265 * encoder)
   return GST_VAAPI_ENCODER_STATUS_SUCCESS;
 }
 
+/* Selects the intra coded region of the supplied picture */
+static void
+update_intra_refresh (GstVaapiEncoderH265 * encoder,
+    GstVaapiEncPicture * picture)
+{
+  encoder->intra_refresh_size = 0;
+  encoder->intra_refresh_start = FALSE;
+
+  if (encoder->intra_refresh == GST_VAAPI_ENCODER_INTRA_REFRESH_NONE)
+    return;
+
+  /* a key-frame refreshes the whole picture, a new cycle starts on
+   * the next frame */
+  if (picture->type == GST_VAAPI_PICTURE_TYPE_I) {
+    encoder->intra_refresh_index = 0;
+    return;
+  }
+
+  encoder->intra_refresh_start =
+      gst_vaapi_utils_h26x_get_intra_refresh_region (get_intra_refresh_units
+      (encoder), encoder->intra_refresh_period, encoder->intra_refresh_index,
+      &encoder->intra_refresh_location, &encoder->intra_refresh_size);
+  encoder->intra_refresh_index =
+      (encoder->intra_refresh_index + 1) % encoder->intra_refresh_period;
+}
+
 static GstVaapiEncoderStatus
 gst_vaapi_encoder_h265_encode (GstVaapiEncoder * base_encoder,
     GstVaapiEncPicture * picture, GstVaapiCodedBufferProxy * codedbuf)
@@ -2974,6 +3398,8 @@ gst_vaapi_encoder_h265_encode (GstVaapiEncoder * base_encoder,
 
   g_assert (GST_VAAPI_SURFACE_PROXY_SURFACE (reconstruct));
 
+  update_intra_refresh (encoder, picture);
+
   if (!ensure_sequence (encoder, picture))
     goto error;
   if (!ensure_misc_params (encoder, picture))
@@ -3030,15 +3456,37 @@ gst_vaapi_encoder_h265_get_pending_reordered (GstVaapiEncoder * base_encoder,
   if (g_queue_is_empty (&reorder_pool->reorder_frame_list))
     return FALSE;
 
-  pic = g_queue_pop_tail (&reorder_pool->reorder_frame_list);
-  g_assert (pic);
   if (iter->pic_type == GST_VAAPI_PICTURE_TYPE_P) {
-    set_p_frame (pic, encoder);
+    pic = g_queue_pop_tail (&reorder_pool->reorder_frame_list);
+    g_assert (pic);
+    /* the last queued frame gets encoded as a reference p-frame in
+     * base-layer */
+    if (encoder->prediction_type ==
+        GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_B) {
+      pic->temporal_id = 0;
+      set_p_frame (pic, encoder);
+      /* sort the queued list of frames for hierarchical-b based on
+       * temporal level where each frame belongs */
+      g_queue_foreach (&reorder_pool->reorder_frame_list,
+          (GFunc) set_b_frame, encoder);
+      g_queue_sort (&reorder_pool->reorder_frame_list,
+          gst_vaapi_utils_h26x_sort_hierarchical_b, NULL);
+    } else {
+      set_p_frame (pic, encoder);
+    }
     iter->pic_type = GST_VAAPI_PICTURE_TYPE_B;
   } else if (iter->pic_type == GST_VAAPI_PICTURE_TYPE_B) {
-    set_b_frame (pic, encoder);
+    if (encoder->prediction_type ==
+        GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_B) {
+      pic = g_queue_pop_head (&reorder_pool->reorder_frame_list);
+    } else {
+      pic = g_queue_pop_tail (&reorder_pool->reorder_frame_list);
+      set_b_frame (pic, encoder);
+    }
+    g_assert (pic);
   } else {
     GST_WARNING ("Unhandled pending picture type");
+    return FALSE;
   }
 
   if (GST_CLOCK_TIME_IS_VALID (pic->frame->pts))
@@ -3120,8 +3568,9 @@ gst_vaapi_encoder_h265_get_codec_data (GstVaapiEncoder * base_encoder,
   WRITE_UINT32 (&bs, 0x01, 3);  /* bit_depth_chroma_minus8 */
   WRITE_UINT32 (&bs, 0x00, 16); /* avgFramerate */
   WRITE_UINT32 (&bs, 0x00, 2);  /* constatnFramerate */
-  WRITE_UINT32 (&bs, 0x00, 3);  /* numTemporalLayers */
-  WRITE_UINT32 (&bs, 0x00, 1);  /* temporalIdNested */
+  WRITE_UINT32 (&bs, encoder->temporal_levels, 3);      /* numTemporalLayers */
+  /* temporalIdNested */
+  WRITE_UINT32 (&bs, get_temporal_id_nesting_flag (encoder), 1);
   WRITE_UINT32 (&bs, nal_length_size - 1, 2);   /* lengthSizeMinusOne */
   WRITE_UINT32 (&bs, 0x00, 8);  /* numOfArrays */
 
@@ -3214,10 +3663,18 @@ error_alloc_buffer:
   }
 }
 
-/* TODO */
+/* Gets the temporal id of the picture at the supplied distance from
+   the last key-frame, in display order */
+static guint32
+get_temporal_id (GstVaapiEncoderH265 * encoder, guint32 display_order)
+{
+  return gst_vaapi_utils_h26x_get_temporal_id (encoder->temporal_level_div,
+      encoder->temporal_levels, display_order);
+}
+
 /* The re-ordering algorithm is similar to what we implemented for
- * h264 encoder. But We could have a better algorithm for hevc encoder
- * by having B-frames as reference pictures */
+ * h264 encoder: in hierarchical-b mode, the B-frames of the lower
+ * temporal levels are reference pictures too */
 static GstVaapiEncoderStatus
 gst_vaapi_encoder_h265_reordering (GstVaapiEncoder * base_encoder,
     GstVideoCodecFrame * frame, GstVaapiEncPicture ** output)
@@ -3240,6 +3697,14 @@ gst_vaapi_encoder_h265_reordering (GstVaapiEncoder * base_encoder,
     g_assert (encoder->num_bframes > 0);
     g_return_val_if_fail (!g_queue_is_empty (&reorder_pool->reorder_frame_list),
         GST_VAAPI_ENCODER_STATUS_ERROR_UNKNOWN);
+
+    /* sort the queued list of frames for hierarchical-b based on
+     * temporal level where each frame belongs */
+    if (encoder->prediction_type ==
+        GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_B)
+      g_queue_sort (&reorder_pool->reorder_frame_list,
+          gst_vaapi_utils_h26x_sort_hierarchical_b, NULL);
+
     picture = g_queue_pop_head (&reorder_pool->reorder_frame_list);
     g_assert (picture);
     if (g_queue_is_empty (&reorder_pool->reorder_frame_list)) {
@@ -3256,16 +3721,26 @@ gst_vaapi_encoder_h265_reordering (GstVaapiEncoder * base_encoder,
     return GST_VAAPI_ENCODER_STATUS_ERROR_ALLOCATION_FAILED;
   }
   ++reorder_pool->cur_present_index;
-  picture->poc = ((reorder_pool->cur_present_index * 1) %
-      encoder->max_pic_order_cnt);
+  /* only the slice header carries the POC modulo MaxPicOrderCntLsb */
+  picture->poc = reorder_pool->cur_present_index;
 
-  is_idr = (reorder_pool->frame_index == 0 ||
-      reorder_pool->frame_index >= encoder->idr_period);
+  /* the mini-GOPs start over from each key-frame */
+  picture->temporal_id = get_temporal_id (encoder,
+      reorder_pool->frame_index - reorder_pool->key_frame_index);
+
+  /* with gradual intra refresh, the GOP is infinite: only the first
+   * frame, and the forced ones, are key-frames */
+  if (encoder->intra_refresh != GST_VAAPI_ENCODER_INTRA_REFRESH_NONE)
+    is_idr = (reorder_pool->frame_index == 0);
+  else
+    is_idr = (reorder_pool->frame_index == 0 ||
+        reorder_pool->frame_index >= encoder->idr_period);
 
   /* check key frames */
   if (is_idr || GST_VIDEO_CODEC_FRAME_IS_FORCE_KEYFRAME (frame) ||
-      (reorder_pool->frame_index %
-          GST_VAAPI_ENCODER_KEYFRAME_PERIOD (encoder)) == 0) {
+      (encoder->intra_refresh == GST_VAAPI_ENCODER_INTRA_REFRESH_NONE &&
+          (reorder_pool->frame_index %
+              GST_VAAPI_ENCODER_KEYFRAME_PERIOD (encoder)) == 0)) {
     ++reorder_pool->frame_index;
 
     /* b frame enabled,  check queue of reorder_frame_list */
@@ -3274,7 +3749,14 @@ gst_vaapi_encoder_h265_reordering (GstVaapiEncoder * base_encoder,
       GstVaapiEncPicture *p_pic;
 
       p_pic = g_queue_pop_tail (&reorder_pool->reorder_frame_list);
+
+      /* for hierarchical-b, make sure the most recent queued frame
+       * gets encoded as a reference p-frame in base-layer */
+      if (encoder->prediction_type ==
+          GST_VAAPI_ENCODER_H265_PREDICTION_HIERARCHICAL_B)
+        p_pic->temporal_id = 0;
       set_p_frame (p_pic, encoder);
+
       g_queue_foreach (&reorder_pool->reorder_frame_list,
           (GFunc) set_b_frame, encoder);
       set_key_frame (picture, encoder, is_idr);
@@ -3287,6 +3769,7 @@ gst_vaapi_encoder_h265_reordering (GstVaapiEncoder * base_encoder,
       if (encoder->num_bframes)
         reorder_pool->reorder_state = GST_VAAPI_ENC_H265_REORD_WAIT_FRAMES;
     }
+    reorder_pool->key_frame_index = reorder_pool->frame_index - 1;
     goto end;
   }
 
@@ -3378,36 +3861,58 @@ gst_vaapi_encoder_h265_reconfigure (GstVaapiEncoder * base_encoder)
   GstVaapiEncoderH265 *const encoder = GST_VAAPI_ENCODER_H265 (base_encoder);
   GstVaapiEncoderStatus status;
   guint luma_width, luma_height;
+  guint conf_win_right_offset, conf_win_bottom_offset;
+
+  /* start over from the requested coding structure, so that lifting a
+     constraint, such as disabling intra refresh, restores it */
+  encoder->num_bframes = encoder->prop_num_bframes;
+  encoder->temporal_levels = encoder->prop_temporal_levels;
+  encoder->prediction_type = encoder->prop_prediction_type;
+  encoder->intra_refresh = encoder->prop_intra_refresh;
+  encoder->intra_refresh_period = encoder->prop_intra_refresh_period;
 
-  luma_width = GST_VAAPI_ENCODER_WIDTH (encoder);
-  luma_height = GST_VAAPI_ENCODER_HEIGHT (encoder);
+  luma_width = GST_ROUND_UP_16 (GST_VAAPI_ENCODER_WIDTH (encoder));
+  luma_height = GST_ROUND_UP_16 (GST_VAAPI_ENCODER_HEIGHT (encoder));
 
   if (luma_width != encoder->luma_width || luma_height != encoder->luma_height) {
     GST_DEBUG ("resolution: %d %d", GST_VAAPI_ENCODER_WIDTH (encoder),
         GST_VAAPI_ENCODER_HEIGHT (encoder));
-    encoder->luma_width = GST_ROUND_UP_16 (luma_width);
-    encoder->luma_height = GST_ROUND_UP_16 (luma_height);
+    encoder->luma_width = luma_width;
+    encoder->luma_height = luma_height;
+    encoder->config_changed = TRUE;
+    /* the next picture is an IDR: the references of the previous size
+       are not needed anymore */
+    reference_list_clear (encoder);
+  }
+
+  /* Frame Cropping, checked on its own since a resolution change can
+     keep the same aligned size */
+  if ((GST_VAAPI_ENCODER_WIDTH (encoder) & 15) ||
+      (GST_VAAPI_ENCODER_HEIGHT (encoder) & 15)) {
+    /* 6.1, Table 6-1 */
+    static const guint SubWidthC[] = { 1, 2, 2, 1 };
+    static const guint SubHeightC[] = { 1, 2, 1, 1 };
+    guint index = gst_vaapi_utils_h265_get_chroma_format_idc
+        (gst_vaapi_video_format_get_chroma_type (GST_VIDEO_INFO_FORMAT
+            (GST_VAAPI_ENCODER_VIDEO_INFO (encoder))));
+
+    conf_win_right_offset = (encoder->luma_width -
+        GST_VAAPI_ENCODER_WIDTH (encoder)) / SubWidthC[index];
+    conf_win_bottom_offset = (encoder->luma_height -
+        GST_VAAPI_ENCODER_HEIGHT (encoder)) / SubHeightC[index];
+  } else {
+    conf_win_right_offset = conf_win_bottom_offset = 0;
+  }
+
+  if (conf_win_right_offset != encoder->conf_win_right_offset ||
+      conf_win_bottom_offset != encoder->conf_win_bottom_offset) {
+    encoder->conformance_window_flag = conf_win_right_offset > 0 ||
+        conf_win_bottom_offset > 0;
+    encoder->conf_win_left_offset = 0;
+    encoder->conf_win_right_offset = conf_win_right_offset;
+    encoder->conf_win_top_offset = 0;
+    encoder->conf_win_bottom_offset = conf_win_bottom_offset;
     encoder->config_changed = TRUE;
-    /* Frame Cropping */
-    if ((GST_VAAPI_ENCODER_WIDTH (encoder) & 15) ||
-        (GST_VAAPI_ENCODER_HEIGHT (encoder) & 15)) {
-      /* 6.1, Table 6-1 */
-      static const guint SubWidthC[] = { 1, 2, 2, 1 };
-      static const guint SubHeightC[] = { 1, 2, 1, 1 };
-      guint index = gst_vaapi_utils_h265_get_chroma_format_idc
-          (gst_vaapi_video_format_get_chroma_type (GST_VIDEO_INFO_FORMAT
-              (GST_VAAPI_ENCODER_VIDEO_INFO (encoder))));
-
-      encoder->conformance_window_flag = 1;
-      encoder->conf_win_left_offset = 0;
-      encoder->conf_win_right_offset =
-          (encoder->luma_width -
-          GST_VAAPI_ENCODER_WIDTH (encoder)) / SubWidthC[index];
-      encoder->conf_win_top_offset = 0;
-      encoder->conf_win_bottom_offset =
-          (encoder->luma_height -
-          GST_VAAPI_ENCODER_HEIGHT (encoder)) / SubHeightC[index];
-    }
   }
 
   status = ensure_profile_tier_level (encoder);
@@ -3431,9 +3936,27 @@ gst_vaapi_encoder_h265_reconfigure (GstVaapiEncoder * base_encoder)
   if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
     return status;
   ensure_control_rate_params (encoder);
+  gst_vaapi_encoder_ensure_sw_rate_control (base_encoder, encoder->cpb_length,
+      encoder->init_qp, encoder->min_qp, encoder->max_qp);
   return set_context_info (base_encoder);
 }
 
+/* Applies the new bitrate, framerate and QP bounds to the rate control
+ * parameters sent with the next picture. The SPS, with the new timing
+ * and HRD parameters, goes out with the next I-frame */
+static GstVaapiEncoderStatus
+gst_vaapi_encoder_h265_update_rate_control (GstVaapiEncoder * base_encoder)
+{
+  GstVaapiEncoderH265 *const encoder = GST_VAAPI_ENCODER_H265 (base_encoder);
+
+  ensure_bitrate (encoder);
+  encoder->config_changed = TRUE;
+  ensure_control_rate_params (encoder);
+  gst_vaapi_encoder_ensure_sw_rate_control (base_encoder, encoder->cpb_length,
+      encoder->init_qp, encoder->min_qp, encoder->max_qp);
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+}
+
 static void
 gst_vaapi_encoder_h265_init (GstVaapiEncoderH265 * encoder)
 {
@@ -3528,6 +4051,13 @@ gst_vaapi_encoder_h265_finalize (GObject * object)
  * @ENCODER_H265_PROP_QP_IB: Difference of QP between I and B frame.
  * @ENCODER_H265_PROP_LOW_DELAY_B: use low delay b feature.
  * @ENCODER_H265_PROP_MAX_QP: Maximal quantizer value (uint).
+ * @ENCODER_H265_PROP_INTRA_REFRESH: Gradual intra refresh mode
+ *   (#GstVaapiEncoderIntraRefresh).
+ * @ENCODER_H265_PROP_INTRA_REFRESH_PERIOD: Number of frames of an
+ *   intra refresh cycle (uint).
+ * @ENCODER_H265_PROP_TEMPORAL_LEVELS: Number of temporal levels (uint).
+ * @ENCODER_H265_PROP_PREDICTION_TYPE: Reference picture selection modes
+ *   (#GstVaapiEncoderH265PredictionType).
  *
  * The set of H.265 encoder specific configurable properties.
  */
@@ -3551,11 +4081,31 @@ enum
   ENCODER_H265_PROP_QUALITY_FACTOR,
   ENCODER_H265_PROP_NUM_TILE_COLS,
   ENCODER_H265_PROP_NUM_TILE_ROWS,
+  ENCODER_H265_PROP_INTRA_REFRESH,
+  ENCODER_H265_PROP_INTRA_REFRESH_PERIOD,
+  ENCODER_H265_PROP_TEMPORAL_LEVELS,
+  ENCODER_H265_PROP_PREDICTION_TYPE,
   ENCODER_H265_N_PROPERTIES
 };
 
 static GParamSpec *properties[ENCODER_H265_N_PROPERTIES];
 
+/* Changes the QP bounds of a running encoder, from the next picture */
+static void
+update_qp_bounds (GstVaapiEncoderH265 * encoder, guint min_qp, guint max_qp)
+{
+  if (min_qp > max_qp) {
+    GST_ERROR_OBJECT (encoder, "invalid QP bounds: [%u, %u]", min_qp, max_qp);
+    return;
+  }
+
+  GST_INFO_OBJECT (encoder, "QP bounds are changed to [%u, %u] on runtime",
+      min_qp, max_qp);
+  encoder->min_qp = min_qp;
+  encoder->max_qp = max_qp;
+  gst_vaapi_encoder_update_rate_control (GST_VAAPI_ENCODER_CAST (encoder));
+}
+
 static void
 gst_vaapi_encoder_h265_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -3564,6 +4114,15 @@ gst_vaapi_encoder_h265_set_property (GObject * object, guint prop_id,
   GstVaapiEncoderH265 *const encoder = GST_VAAPI_ENCODER_H265 (object);
 
   if (base_encoder->num_codedbuf_queued > 0) {
+    /* the QP bounds only go into the rate control parameters */
+    if (prop_id == ENCODER_H265_PROP_MIN_QP) {
+      update_qp_bounds (encoder, g_value_get_uint (value), encoder->max_qp);
+      return;
+    }
+    if (prop_id == ENCODER_H265_PROP_MAX_QP) {
+      update_qp_bounds (encoder, encoder->min_qp, g_value_get_uint (value));
+      return;
+    }
     GST_ERROR_OBJECT (object,
         "failed to set any property after encoding started");
     return;
@@ -3578,7 +4137,7 @@ gst_vaapi_encoder_h265_set_property (GObject * object, guint prop_id,
       gst_vaapi_encoder_set_tuning (base_encoder, g_value_get_enum (value));
       break;
     case ENCODER_H265_PROP_MAX_BFRAMES:
-      encoder->num_bframes = g_value_get_uint (value);
+      encoder->prop_num_bframes = g_value_get_uint (value);
       break;
     case ENCODER_H265_PROP_INIT_QP:
       encoder->init_qp = g_value_get_uint (value);
@@ -3629,6 +4188,18 @@ gst_vaapi_encoder_h265_set_property (GObject * object, guint prop_id,
     case ENCODER_H265_PROP_NUM_TILE_ROWS:
       encoder->num_tile_rows = g_value_get_uint (value);
       break;
+    case ENCODER_H265_PROP_INTRA_REFRESH:
+      encoder->prop_intra_refresh = g_value_get_enum (value);
+      break;
+    case ENCODER_H265_PROP_INTRA_REFRESH_PERIOD:
+      encoder->prop_intra_refresh_period = g_value_get_uint (value);
+      break;
+    case ENCODER_H265_PROP_TEMPORAL_LEVELS:
+      encoder->prop_temporal_levels = g_value_get_uint (value);
+      break;
+    case ENCODER_H265_PROP_PREDICTION_TYPE:
+      encoder->prop_prediction_type = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -3649,7 +4220,7 @@ gst_vaapi_encoder_h265_get_property (GObject * object, guint prop_id,
       g_value_set_enum (value, base_encoder->tune);
       break;
     case ENCODER_H265_PROP_MAX_BFRAMES:
-      g_value_set_uint (value, encoder->num_bframes);
+      g_value_set_uint (value, encoder->prop_num_bframes);
       break;
     case ENCODER_H265_PROP_INIT_QP:
       g_value_set_uint (value, encoder->init_qp);
@@ -3692,6 +4263,18 @@ gst_vaapi_encoder_h265_get_property (GObject * object, guint prop_id,
     case ENCODER_H265_PROP_NUM_TILE_ROWS:
       g_value_set_uint (value, encoder->num_tile_rows);
       break;
+    case ENCODER_H265_PROP_INTRA_REFRESH:
+      g_value_set_enum (value, encoder->prop_intra_refresh);
+      break;
+    case ENCODER_H265_PROP_INTRA_REFRESH_PERIOD:
+      g_value_set_uint (value, encoder->prop_intra_refresh_period);
+      break;
+    case ENCODER_H265_PROP_TEMPORAL_LEVELS:
+      g_value_set_uint (value, encoder->prop_temporal_levels);
+      break;
+    case ENCODER_H265_PROP_PREDICTION_TYPE:
+      g_value_set_enum (value, encoder->prop_prediction_type);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -3707,6 +4290,8 @@ gst_vaapi_encoder_h265_class_init (GstVaapiEncoderH265Class * klass)
 
   encoder_class->class_data = &g_class_data;
   encoder_class->reconfigure = gst_vaapi_encoder_h265_reconfigure;
+  encoder_class->update_rate_control =
+      gst_vaapi_encoder_h265_update_rate_control;
   encoder_class->reordering = gst_vaapi_encoder_h265_reordering;
   encoder_class->encode = gst_vaapi_encoder_h265_encode;
   encoder_class->flush = gst_vaapi_encoder_h265_flush;
@@ -3926,9 +4511,78 @@ gst_vaapi_encoder_h265_class_init (GstVaapiEncoderH265Class * klass)
       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
       GST_VAAPI_PARAM_ENCODER_EXPOSURE);
 
+  /**
+   * GstVaapiEncoderH265:intra-refresh:
+   *
+   * Refresh the picture with a column, or a row, of intra coded
+   * blocks sweeping it over #GstVaapiEncoderH265:intra-refresh-period
+   * P-frames, instead of periodic key-frames. This keeps the size of
+   * the frames even, for low latency streaming. A recovery point SEI
+   * message is inserted at the start of each refresh cycle, and the
+   * key-frame period is ignored: only the first frame and the forced
+   * key-frames are IDR. B-frames and temporal levels are disabled.
+   */
+  properties[ENCODER_H265_PROP_INTRA_REFRESH] =
+      g_param_spec_enum ("intra-refresh",
+      "Intra Refresh",
+      "Gradual intra refresh mode, replacing the periodic key-frames",
+      GST_VAAPI_TYPE_ENCODER_INTRA_REFRESH,
+      GST_VAAPI_ENCODER_INTRA_REFRESH_NONE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
+  /**
+   * GstVaapiEncoderH265:intra-refresh-period:
+   *
+   * Number of frames needed to refresh the whole picture, when
+   * #GstVaapiEncoderH265:intra-refresh is enabled. It is lowered to
+   * the number of 16x16 block columns, or rows, if needed.
+   */
+  properties[ENCODER_H265_PROP_INTRA_REFRESH_PERIOD] =
+      g_param_spec_uint ("intra-refresh-period",
+      "Intra Refresh Period",
+      "Number of frames of an intra refresh cycle",
+      2, 1024, 30,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
+  /**
+   * GstVaapiEncoderH265:temporal-levels:
+   *
+   * Number of temporal levels in the encoded stream. Each level is a
+   * temporal sub-layer, signalled in the VPS and the SPS, so that the
+   * stream can be decoded at a fraction of its frame rate by dropping
+   * the upper sub-layers.
+   */
+  properties[ENCODER_H265_PROP_TEMPORAL_LEVELS] =
+      g_param_spec_uint ("temporal-levels",
+      "temporal levels",
+      "Number of temporal levels in the encoded stream ",
+      MIN_TEMPORAL_LEVELS, MAX_TEMPORAL_LEVELS, MIN_TEMPORAL_LEVELS,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
+  /**
+   * GstVaapiEncoderH265:prediction-type:
+   *
+   * Select the reference picture selection modes. The hierarchical
+   * modes code mini-GOPs of 2^(temporal-levels - 1) frames, with a
+   * single reference per list, and override the number of B-frames.
+   */
+  properties[ENCODER_H265_PROP_PREDICTION_TYPE] =
+      g_param_spec_enum ("prediction-type",
+      "RefPic Selection",
+      "Reference Picture Selection Modes",
+      gst_vaapi_encoder_h265_prediction_type (),
+      GST_VAAPI_ENCODER_H265_PREDICTION_DEFAULT,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
   g_object_class_install_properties (object_class, ENCODER_H265_N_PROPERTIES,
       properties);
 
+  gst_type_mark_as_plugin_api (GST_VAAPI_TYPE_ENCODER_INTRA_REFRESH, 0);
+  gst_type_mark_as_plugin_api (gst_vaapi_encoder_h265_prediction_type (), 0);
   gst_type_mark_as_plugin_api (g_class_data.rate_control_get_type (), 0);
   gst_type_mark_as_plugin_api (g_class_data.encoder_tune_get_type (), 0);
 }
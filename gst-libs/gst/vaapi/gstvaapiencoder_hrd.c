@@ -0,0 +1,112 @@
+/*
+ *  gstvaapiencoder_hrd.c - HRD conformance verifier for the encoders
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include "gstvaapiencoder_hrd.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+/**
+ * gst_vaapi_hrd_verifier_init:
+ * @hrd: a #GstVaapiHrdVerifier
+ * @bitrate: the rate the bits enter the buffer, in bits per second
+ * @buffer_size: the size of the buffer, in bits
+ * @initial_fullness: the fullness of the buffer at the removal of the
+ *   first frame, in bits
+ * @constant_bitrate: whether the bits keep entering a full buffer
+ *
+ * Resets @hrd to an empty stream.
+ */
+void
+gst_vaapi_hrd_verifier_init (GstVaapiHrdVerifier * hrd, guint bitrate,
+    guint buffer_size, guint initial_fullness, gboolean constant_bitrate)
+{
+  g_return_if_fail (hrd != NULL);
+
+  memset (hrd, 0, sizeof (*hrd));
+  hrd->bitrate = bitrate;
+  hrd->buffer_size = buffer_size;
+  hrd->initial_fullness = MIN (initial_fullness, buffer_size);
+  hrd->constant_bitrate = constant_bitrate;
+  hrd->last_removal_time = GST_CLOCK_TIME_NONE;
+}
+
+/**
+ * gst_vaapi_hrd_verifier_add_frame:
+ * @hrd: a #GstVaapiHrdVerifier
+ * @removal_time: the time the frame is removed from the buffer
+ * @size: the size of the coded frame, in bits
+ * @fullness: return location for the fullness of the buffer right
+ *   before the removal of the frame, in bits, or %NULL
+ *
+ * Removes the next coded frame, in decoding order, from the buffer.
+ * On underflow, the buffer is considered empty after the frame, and
+ * on overflow, full before it, so that the following frames are
+ * verified against a buffer that recovered.
+ *
+ * Return value: whether the frame conforms to the buffer model
+ */
+GstVaapiHrdStatus
+gst_vaapi_hrd_verifier_add_frame (GstVaapiHrdVerifier * hrd,
+    GstClockTime removal_time, guint size, guint * fullness)
+{
+  GstVaapiHrdStatus status = GST_VAAPI_HRD_STATUS_OK;
+  gdouble level;
+
+  g_return_val_if_fail (hrd != NULL, GST_VAAPI_HRD_STATUS_OK);
+  g_return_val_if_fail (GST_CLOCK_TIME_IS_VALID (removal_time),
+      GST_VAAPI_HRD_STATUS_OK);
+
+  if (hrd->num_frames == 0)
+    level = hrd->initial_fullness;
+  else {
+    level = hrd->fullness;
+    if (removal_time > hrd->last_removal_time)
+      level += (gdouble) hrd->bitrate *
+          (removal_time - hrd->last_removal_time) / GST_SECOND;
+  }
+
+  if (level > hrd->buffer_size) {
+    if (hrd->constant_bitrate) {
+      status = GST_VAAPI_HRD_STATUS_OVERFLOW;
+      hrd->num_overflows++;
+    }
+    level = hrd->buffer_size;
+  }
+
+  if (fullness)
+    *fullness = (guint) level;
+
+  if (size > level) {
+    status = GST_VAAPI_HRD_STATUS_UNDERFLOW;
+    hrd->num_underflows++;
+    hrd->fullness = 0;
+  } else
+    hrd->fullness = level - size;
+
+  hrd->last_removal_time = removal_time;
+  hrd->num_frames++;
+
+  if (status != GST_VAAPI_HRD_STATUS_OK)
+    GST_DEBUG ("frame %" G_GUINT64_FORMAT ": %s, %u bits, buffer %.0f/%u",
+        hrd->num_frames, status == GST_VAAPI_HRD_STATUS_UNDERFLOW ?
+        "underflow" : "overflow", size, level, hrd->buffer_size);
+  return status;
+}
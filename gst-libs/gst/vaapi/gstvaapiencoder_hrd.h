@@ -0,0 +1,91 @@
+/*
+ *  gstvaapiencoder_hrd.h - HRD conformance verifier for the encoders
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_ENCODER_HRD_H
+#define GST_VAAPI_ENCODER_HRD_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVaapiHrdVerifier GstVaapiHrdVerifier;
+
+/**
+ * GstVaapiHrdStatus:
+ * @GST_VAAPI_HRD_STATUS_OK: the frame conforms to the buffer model
+ * @GST_VAAPI_HRD_STATUS_UNDERFLOW: the frame was not entirely in the
+ *   buffer at its removal time
+ * @GST_VAAPI_HRD_STATUS_OVERFLOW: the buffer was full before the
+ *   removal of the frame, at a constant bitrate
+ *
+ * The conformance of a coded frame to the hypothetical reference
+ * decoder buffer.
+ */
+typedef enum
+{
+  GST_VAAPI_HRD_STATUS_OK = 0,
+  GST_VAAPI_HRD_STATUS_UNDERFLOW,
+  GST_VAAPI_HRD_STATUS_OVERFLOW,
+} GstVaapiHrdStatus;
+
+/**
+ * GstVaapiHrdVerifier:
+ * @bitrate: the rate the bits enter the buffer, in bits per second
+ * @buffer_size: the size of the buffer, in bits
+ * @initial_fullness: the fullness of the buffer at the removal of the
+ *   first frame, in bits
+ * @constant_bitrate: whether the bits keep entering a full buffer
+ * @num_frames: the number of verified frames
+ * @num_underflows: the number of frames that underflowed the buffer
+ * @num_overflows: the number of frames that overflowed the buffer
+ *
+ * A model of the coded picture buffer of a decoder, fed with the
+ * sizes of the coded frames and their removal times. The bits enter
+ * the buffer at @bitrate, and each frame leaves it at once at its
+ * removal time. At a variable bitrate, the bits stop entering a full
+ * buffer instead of overflowing it.
+ */
+struct _GstVaapiHrdVerifier
+{
+  guint bitrate;
+  guint buffer_size;
+  guint initial_fullness;
+  gboolean constant_bitrate;
+
+  guint64 num_frames;
+  guint64 num_underflows;
+  guint64 num_overflows;
+
+  /*< private >*/
+  GstClockTime last_removal_time;
+  /* the fullness after the removal of the last frame, in bits */
+  gdouble fullness;
+};
+
+void
+gst_vaapi_hrd_verifier_init (GstVaapiHrdVerifier * hrd, guint bitrate,
+    guint buffer_size, guint initial_fullness, gboolean constant_bitrate);
+
+GstVaapiHrdStatus
+gst_vaapi_hrd_verifier_add_frame (GstVaapiHrdVerifier * hrd,
+    GstClockTime removal_time, guint size, guint * fullness);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_ENCODER_HRD_H */
@@ -356,6 +356,9 @@ gst_vaapi_enc_picture_destroy (GstVaapiEncPicture * picture)
   vaapi_destroy_buffer (GET_VA_DISPLAY (picture), &picture->param_id);
   picture->param = NULL;
 
+  vaapi_destroy_buffer (GET_VA_DISPLAY (picture), &picture->qp_map_id);
+  picture->qp_map = NULL;
+
   if (picture->frame) {
     gst_video_codec_frame_unref (picture->frame);
     picture->frame = NULL;
@@ -385,7 +388,12 @@ gst_vaapi_enc_picture_create (GstVaapiEncPicture * picture,
   picture->pts = GST_CLOCK_TIME_NONE;
   picture->frame_num = 0;
   picture->poc = 0;
+  picture->num_temporal_layers = 0;
+  picture->sw_rc_qp = -1;
+  picture->sw_rc_target = 0;
+  picture->submit_time = GST_CLOCK_TIME_NONE;
 
+  picture->qp_map_id = VA_INVALID_ID;
   picture->param_id = VA_INVALID_ID;
   picture->param_size = args->param_size;
   success = vaapi_create_buffer (GET_VA_DISPLAY (picture),
@@ -459,6 +467,27 @@ gst_vaapi_enc_picture_add_misc_param (GstVaapiEncPicture * picture,
   g_ptr_array_add (picture->misc_params, gst_vaapi_codec_object_ref (misc));
 }
 
+/* Creates the VA buffer holding the QP of each of the columns x rows
+   blocks, returns its mapped data. The driver chooses the pitch of
+   the rows, in bytes */
+gpointer
+gst_vaapi_enc_picture_alloc_qp_map (GstVaapiEncPicture * picture,
+    guint columns, guint rows, guint * pitch)
+{
+  g_return_val_if_fail (picture != NULL, NULL);
+  g_return_val_if_fail (columns > 0 && rows > 0, NULL);
+  g_return_val_if_fail (pitch != NULL, NULL);
+
+  vaapi_destroy_buffer (GET_VA_DISPLAY (picture), &picture->qp_map_id);
+  picture->qp_map = NULL;
+
+  if (!vaapi_create_2d_buffer (GET_VA_DISPLAY (picture),
+          GET_VA_CONTEXT (picture), VAEncQPBufferType, columns, rows,
+          &picture->qp_map_id, &picture->qp_map, pitch))
+    return NULL;
+  return picture->qp_map;
+}
+
 void
 gst_vaapi_enc_picture_add_slice (GstVaapiEncPicture * picture,
     GstVaapiEncSlice * slice)
@@ -486,7 +515,8 @@ do_encode (VADisplay dpy, VAContextID ctx, VABufferID * buf_id, void **buf_ptr)
 
   vaapi_unmap_buffer (dpy, *buf_id, buf_ptr);
 
-  status = vaRenderPicture (dpy, ctx, buf_id, 1);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_RENDER_PICTURE, status,
+      vaRenderPicture (dpy, ctx, buf_id, 1));
   if (!vaapi_check_status (status, "vaRenderPicture()"))
     return FALSE;
 
@@ -514,7 +544,8 @@ gst_vaapi_enc_picture_encode (GstVaapiEncPicture * picture)
 
   GST_DEBUG ("encode picture 0x%08x", picture->surface_id);
 
-  status = vaBeginPicture (va_display, va_context, picture->surface_id);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_BEGIN_PICTURE, status,
+      vaBeginPicture (va_display, va_context, picture->surface_id));
   if (!vaapi_check_status (status, "vaBeginPicture()"))
     return FALSE;
 
@@ -550,6 +581,11 @@ gst_vaapi_enc_picture_encode (GstVaapiEncPicture * picture)
   if (!do_encode (va_display, va_context, &picture->param_id, &picture->param))
     return FALSE;
 
+  /* Submit QP map */
+  if (picture->qp_map_id != VA_INVALID_ID && !do_encode (va_display,
+          va_context, &picture->qp_map_id, &picture->qp_map))
+    return FALSE;
+
   /* Submit Misc Params */
   for (i = 0; i < picture->misc_params->len; i++) {
     GstVaapiEncMiscParam *const misc =
@@ -576,7 +612,8 @@ gst_vaapi_enc_picture_encode (GstVaapiEncPicture * picture)
       return FALSE;
   }
 
-  status = vaEndPicture (va_display, va_context);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_END_PICTURE, status,
+      vaEndPicture (va_display, va_context));
   if (!vaapi_check_status (status, "vaEndPicture()"))
     return FALSE;
   return TRUE;
@@ -221,7 +221,9 @@ typedef enum
 {
   GST_VAAPI_ENC_PICTURE_FLAG_IDR          = (GST_VAAPI_CODEC_OBJECT_FLAG_LAST << 0),
   GST_VAAPI_ENC_PICTURE_FLAG_REFERENCE    = (GST_VAAPI_CODEC_OBJECT_FLAG_LAST << 1),
-  GST_VAAPI_ENC_PICTURE_FLAG_LAST         = (GST_VAAPI_CODEC_OBJECT_FLAG_LAST << 2),
+  GST_VAAPI_ENC_PICTURE_FLAG_LAYER_SYNC   = (GST_VAAPI_CODEC_OBJECT_FLAG_LAST << 2),
+  GST_VAAPI_ENC_PICTURE_FLAG_RATE_CONTROL = (GST_VAAPI_CODEC_OBJECT_FLAG_LAST << 3),
+  GST_VAAPI_ENC_PICTURE_FLAG_LAST         = (GST_VAAPI_CODEC_OBJECT_FLAG_LAST << 4),
 } GstVaapiEncPictureFlags;
 
 #define GST_VAAPI_ENC_PICTURE_FLAGS         GST_VAAPI_MINI_OBJECT_FLAGS
@@ -249,6 +251,8 @@ struct _GstVaapiEncPicture
   GstVaapiSurface *surface;
   VABufferID param_id;
   guint param_size;
+  VABufferID qp_map_id;
+  gpointer qp_map;
 
   /* Additional data to pass down */
   GstVaapiEncSequence *sequence;
@@ -266,7 +270,14 @@ struct _GstVaapiEncPicture
   guint frame_num;
   guint poc;
   guint temporal_id;
+  /* number of temporal layers to report, or 0 */
+  guint num_temporal_layers;
   gboolean has_roi;
+  /* QP and target size set by the software rate control, or -1 */
+  gint sw_rc_qp;
+  guint sw_rc_target;
+  /* submission time to the hardware, if the statistics are collected */
+  GstClockTime submit_time;
 };
 
 G_GNUC_INTERNAL
@@ -289,6 +300,11 @@ void
 gst_vaapi_enc_picture_add_misc_param (GstVaapiEncPicture * picture,
     GstVaapiEncMiscParam * misc);
 
+G_GNUC_INTERNAL
+gpointer
+gst_vaapi_enc_picture_alloc_qp_map (GstVaapiEncPicture * picture,
+    guint columns, guint rows, guint * pitch);
+
 G_GNUC_INTERNAL
 void
 gst_vaapi_enc_picture_add_slice (GstVaapiEncPicture * picture,
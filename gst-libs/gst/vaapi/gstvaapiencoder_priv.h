@@ -26,10 +26,13 @@
 
 #include <gst/vaapi/gstvaapiencoder.h>
 #include <gst/vaapi/gstvaapiencoder_objects.h>
+#include <gst/vaapi/gstvaapiencoder_tlayers.h>
+#include <gst/vaapi/gstvaapiencoder_swrc.h>
 #include <gst/vaapi/gstvaapicontext.h>
 #include <gst/vaapi/gstvaapivideopool.h>
 #include <gst/video/gstvideoutils.h>
 #include <gst/vaapi/gstvaapivalue.h>
+#include <gst/vaapi/gstvaapivacalls.h>
 
 G_BEGIN_DECLS
 
@@ -218,6 +221,9 @@ G_BEGIN_DECLS
 #define GST_VAAPI_TYPE_ENCODER_MBBRC \
   (gst_vaapi_encoder_mbbrc_get_type ())
 
+#define GST_VAAPI_TYPE_ENCODER_INTRA_REFRESH \
+  (gst_vaapi_encoder_intra_refresh_get_type ())
+
 typedef struct _GstVaapiEncoderClass GstVaapiEncoderClass;
 typedef struct _GstVaapiEncoderClassData GstVaapiEncoderClassData;
 
@@ -232,6 +238,11 @@ struct _GstVaapiEncoder
   GstVaapiContextInfo context_info;
   GstVaapiEncoderTune tune;
   guint packed_headers;
+  /* the packed headers supported by the driver */
+  guint va_packed_headers;
+  /* the packed headers the current configuration needs on top of the
+     codec ones */
+  guint optional_packed_headers;
 
   VADisplay va_display;
   VAContextID va_context;
@@ -259,6 +270,11 @@ struct _GstVaapiEncoder
   GstVaapiVideoPool *codedbuf_pool;
   GAsyncQueue *codedbuf_queue;
   guint32 num_codedbuf_queued;
+  /* new rate control parameters to apply from the next frame */
+  gboolean rate_control_changed;
+  /* the next picture to encode is the first one with new rate control
+     parameters */
+  gboolean rate_control_applied;
 
   guint got_packed_headers:1;
   guint got_rate_control_mask:1;
@@ -270,8 +286,26 @@ struct _GstVaapiEncoder
 
   gint8 default_roi_value;
 
+  /* size of the blocks of VAEncQPBufferType, or 0 if not supported */
+  guint qp_block_size;
+
   /* trellis quantization */
   gboolean trellis;
+
+  /* verify the output against the HRD buffer */
+  gboolean verify_hrd;
+
+  /* per-frame statistics, attached to the coded buffers and summed up
+     every stats_interval frames */
+  gboolean frame_stats;
+  guint stats_interval;
+
+  /* software rate control, in constant-qp mode */
+  gboolean software_rate_control;
+  gboolean sw_rc_active;
+  GstVaapiSwRateControl sw_rc;
+
+  GstVaapiVaCallStats va_calls;
 };
 
 struct _GstVaapiEncoderClassData
@@ -339,6 +373,10 @@ struct _GstVaapiEncoderClass
   gboolean              (*get_pending_reordered) (GstVaapiEncoder * encoder,
                                                   GstVaapiEncPicture ** picture,
                                                   gpointer * state);
+
+  /* Applies new rate control parameters to a running encoder, without
+   * reconfiguring it. Can be NULL */
+  GstVaapiEncoderStatus (*update_rate_control) (GstVaapiEncoder * encoder);
 };
 
 G_GNUC_INTERNAL
@@ -363,16 +401,48 @@ gboolean
 gst_vaapi_encoder_ensure_param_control_rate (GstVaapiEncoder * encoder,
     GstVaapiEncPicture * picture);
 
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_encoder_ensure_param_temporal_layers (GstVaapiEncoder * encoder,
+    GstVaapiEncPicture * picture, const GstVaapiTemporalLayers * layers,
+    const guint * bitrates);
+
 G_GNUC_INTERNAL
 gboolean
 gst_vaapi_encoder_ensure_param_roi_regions (GstVaapiEncoder * encoder,
     GstVaapiEncPicture * picture);
 
+G_GNUC_INTERNAL
+gint
+gst_vaapi_encoder_get_picture_qp (GstVaapiEncoder * encoder,
+    GstVaapiEncPicture * picture, gint qp_i, gint qp_ip, gint qp_ib,
+    gint min_qp, gint max_qp);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_encoder_ensure_qp_map (GstVaapiEncoder * encoder,
+    GstVaapiEncPicture * picture, gint base_qp, gint min_qp, gint max_qp);
+
+G_GNUC_INTERNAL
+GstVaapiEncoderStatus
+gst_vaapi_encoder_update_rate_control (GstVaapiEncoder * encoder);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_encoder_ensure_sw_rate_control (GstVaapiEncoder * encoder,
+    guint cpb_length, gint init_qp, gint min_qp, gint max_qp);
+
 G_GNUC_INTERNAL
 gboolean
 gst_vaapi_encoder_ensure_param_trellis (GstVaapiEncoder * encoder,
     GstVaapiEncPicture * picture);
 
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_encoder_ensure_param_intra_refresh (GstVaapiEncoder * encoder,
+    GstVaapiEncPicture * picture, GstVaapiEncoderIntraRefresh mode,
+    guint location, guint size);
+
 G_GNUC_INTERNAL
 gboolean
 gst_vaapi_encoder_ensure_num_slices (GstVaapiEncoder * encoder,
@@ -389,6 +459,12 @@ gboolean
 gst_vaapi_encoder_ensure_tile_support (GstVaapiEncoder * encoder,
     GstVaapiProfile profile, GstVaapiEntrypoint entrypoint);
 
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_encoder_ensure_intra_refresh_support (GstVaapiEncoder * encoder,
+    GstVaapiProfile profile, GstVaapiEntrypoint entrypoint,
+    GstVaapiEncoderIntraRefresh mode);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_ENCODER_PRIV_H */
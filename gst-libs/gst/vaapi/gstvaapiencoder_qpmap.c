@@ -0,0 +1,342 @@
+/*
+ *  gstvaapiencoder_qpmap.c - Per-block QP delta maps for the encoders
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include "gstvaapiencoder_qpmap.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+/* A set of 4-connected blocks whose QP deltas have the same sign */
+typedef struct
+{
+  guint first;                  /* raster index of the first block */
+  guint x0, y0, x1, y1;         /* bounding box, in blocks, inclusive */
+  gint sum;
+  guint count;
+  guint weight;                 /* sum of the absolute QP deltas */
+} QPComponent;
+
+/**
+ * gst_vaapi_qp_map_meta_get_info:
+ *
+ * Registers the #GstCustomMeta named #GST_VAAPI_QP_MAP_META_NAME, if
+ * needed.
+ *
+ * Returns: the #GstMetaInfo of the QP map meta
+ **/
+const GstMetaInfo *
+gst_vaapi_qp_map_meta_get_info (void)
+{
+  static const GstMetaInfo *meta_info = NULL;
+
+  if (g_once_init_enter (&meta_info)) {
+    const GstMetaInfo *const info =
+        gst_meta_register_custom (GST_VAAPI_QP_MAP_META_NAME, NULL, NULL,
+        NULL, NULL);
+    g_once_init_leave (&meta_info, info);
+  }
+  return meta_info;
+}
+
+/**
+ * gst_vaapi_buffer_add_qp_map:
+ * @buffer: a #GstBuffer
+ * @block_size: the width and height of the blocks, in pixels
+ * @columns: the number of blocks per row
+ * @rows: the number of block rows
+ * @delta_qp: (array): the @columns x @rows QP deltas, in raster order
+ *
+ * Attaches a copy of the supplied QP delta map to @buffer.
+ *
+ * Returns: (transfer none): the #GstCustomMeta, or %NULL on error
+ **/
+GstCustomMeta *
+gst_vaapi_buffer_add_qp_map (GstBuffer * buffer, guint block_size,
+    guint columns, guint rows, const gint8 * delta_qp)
+{
+  GstCustomMeta *meta;
+  GBytes *bytes;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (block_size > 0, NULL);
+  g_return_val_if_fail (columns > 0 && rows > 0, NULL);
+  g_return_val_if_fail (delta_qp != NULL, NULL);
+
+  gst_vaapi_qp_map_meta_get_info ();
+  meta = gst_buffer_add_custom_meta (buffer, GST_VAAPI_QP_MAP_META_NAME);
+  if (!meta)
+    return NULL;
+
+  bytes = g_bytes_new (delta_qp, columns * rows);
+  gst_structure_set (gst_custom_meta_get_structure (meta),
+      "block-size", G_TYPE_UINT, block_size,
+      "columns", G_TYPE_UINT, columns,
+      "rows", G_TYPE_UINT, rows, "delta-qp", G_TYPE_BYTES, bytes, NULL);
+  g_bytes_unref (bytes);
+  return meta;
+}
+
+/**
+ * gst_vaapi_buffer_get_qp_map:
+ * @buffer: a #GstBuffer
+ * @map: return location for the QP delta map
+ *
+ * Looks up the QP delta map attached to @buffer. The deltas are owned
+ * by the meta, and stay valid as long as it is attached to @buffer.
+ *
+ * Returns: %TRUE if @buffer carries a valid QP delta map
+ **/
+gboolean
+gst_vaapi_buffer_get_qp_map (GstBuffer * buffer, GstVaapiQPMap * map)
+{
+  GstCustomMeta *meta;
+  GstStructure *structure;
+  const GValue *value;
+  GBytes *bytes;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), FALSE);
+  g_return_val_if_fail (map != NULL, FALSE);
+
+  if (!gst_vaapi_qp_map_meta_get_info ())
+    return FALSE;
+
+  meta = gst_buffer_get_custom_meta (buffer, GST_VAAPI_QP_MAP_META_NAME);
+  if (!meta)
+    return FALSE;
+
+  structure = gst_custom_meta_get_structure (meta);
+  if (!gst_structure_get_uint (structure, "block-size", &map->block_size) ||
+      !gst_structure_get_uint (structure, "columns", &map->columns) ||
+      !gst_structure_get_uint (structure, "rows", &map->rows))
+    goto error_invalid_map;
+
+  value = gst_structure_get_value (structure, "delta-qp");
+  if (!value || !G_VALUE_HOLDS (value, G_TYPE_BYTES))
+    goto error_invalid_map;
+  bytes = g_value_get_boxed (value);
+
+  if (map->block_size == 0 || map->columns == 0 || map->rows == 0 ||
+      g_bytes_get_size (bytes) < (gsize) map->columns * map->rows)
+    goto error_invalid_map;
+
+  map->delta_qp = g_bytes_get_data (bytes, NULL);
+  return TRUE;
+
+  /* ERRORS */
+error_invalid_map:
+  {
+    GST_WARNING ("ignoring invalid QP map meta %" GST_PTR_FORMAT, structure);
+    return FALSE;
+  }
+}
+
+/* Returns the QP delta of the map block covering the pixel (x, y) */
+static inline gint
+get_delta_qp_at (const GstVaapiQPMap * map, guint x, guint y)
+{
+  const guint column = x / map->block_size;
+  const guint row = y / map->block_size;
+
+  if (column >= map->columns || row >= map->rows)
+    return 0;
+  return map->delta_qp[row * map->columns + column];
+}
+
+/**
+ * gst_vaapi_qp_map_get_block_qps:
+ * @map: a #GstVaapiQPMap
+ * @block_size: the width and height of the output blocks, in pixels
+ * @columns: the number of output blocks per row
+ * @rows: the number of output block rows
+ * @stride: the distance between two rows of @qps, in bytes
+ * @base_qp: the QP of the picture
+ * @min_qp: the minimal QP
+ * @max_qp: the maximal QP
+ * @qps: (out caller-allocates): the @rows x @stride output QPs
+ *
+ * Resamples @map to the blocks of the encoder, and converts it to
+ * absolute QP values, as expected by VAEncQPBufferType. Each output
+ * block takes the QP delta of the map block covering its centre, the
+ * blocks outside of @map keep @base_qp.
+ **/
+void
+gst_vaapi_qp_map_get_block_qps (const GstVaapiQPMap * map, guint block_size,
+    guint columns, guint rows, guint stride, gint base_qp, gint min_qp,
+    gint max_qp, guint8 * qps)
+{
+  guint i, j;
+  gint qp;
+
+  g_return_if_fail (map != NULL);
+  g_return_if_fail (block_size > 0);
+  g_return_if_fail (stride >= columns);
+  g_return_if_fail (qps != NULL);
+
+  for (j = 0; j < rows; j++) {
+    const guint y = j * block_size + block_size / 2;
+
+    for (i = 0; i < columns; i++) {
+      const guint x = i * block_size + block_size / 2;
+
+      qp = base_qp + get_delta_qp_at (map, x, y);
+      qps[j * stride + i] = CLAMP (qp, min_qp, max_qp);
+    }
+  }
+}
+
+static gint
+compare_components (gconstpointer a, gconstpointer b)
+{
+  const QPComponent *const ca = a;
+  const QPComponent *const cb = b;
+
+  if (ca->weight != cb->weight)
+    return ca->weight > cb->weight ? -1 : 1;
+  return ca->first < cb->first ? -1 : ca->first > cb->first ? 1 : 0;
+}
+
+/* Grows the component from the block at index, with a flood fill of
+   the blocks of the same sign */
+static void
+fill_component (const GstVaapiQPMap * map, guint index, guint * labels,
+    guint * stack, guint label, QPComponent * comp)
+{
+  const gboolean negative = map->delta_qp[index] < 0;
+  guint num_stacked = 0;
+
+  comp->first = index;
+  comp->x0 = comp->x1 = index % map->columns;
+  comp->y0 = comp->y1 = index / map->columns;
+  comp->sum = comp->count = comp->weight = 0;
+
+  labels[index] = label;
+  stack[num_stacked++] = index;
+
+  while (num_stacked > 0) {
+    const guint cur = stack[--num_stacked];
+    const guint x = cur % map->columns;
+    const guint y = cur / map->columns;
+    const gint delta = map->delta_qp[cur];
+    guint neighbours[4], n = 0, k;
+
+    comp->x0 = MIN (comp->x0, x);
+    comp->x1 = MAX (comp->x1, x);
+    comp->y0 = MIN (comp->y0, y);
+    comp->y1 = MAX (comp->y1, y);
+    comp->sum += delta;
+    comp->count++;
+    comp->weight += ABS (delta);
+
+    if (x > 0)
+      neighbours[n++] = cur - 1;
+    if (x + 1 < map->columns)
+      neighbours[n++] = cur + 1;
+    if (y > 0)
+      neighbours[n++] = cur - map->columns;
+    if (y + 1 < map->rows)
+      neighbours[n++] = cur + map->columns;
+
+    for (k = 0; k < n; k++) {
+      const gint8 value = map->delta_qp[neighbours[k]];
+
+      if (labels[neighbours[k]] || value == 0 || (value < 0) != negative)
+        continue;
+      labels[neighbours[k]] = label;
+      stack[num_stacked++] = neighbours[k];
+    }
+  }
+}
+
+/**
+ * gst_vaapi_qp_map_get_regions:
+ * @map: a #GstVaapiQPMap
+ * @width: the width of the picture, in pixels
+ * @height: the height of the picture, in pixels
+ * @regions: (out caller-allocates): return location for the regions
+ * @max_regions: the number of elements of @regions
+ *
+ * Collapses @map into at most @max_regions rectangles, for the
+ * encoders that only support ROI regions. Each area of adjacent
+ * blocks whose QP deltas have the same sign yields its bounding box,
+ * with the average QP delta of the area. The areas with the largest
+ * accumulated QP deltas are kept first.
+ *
+ * Returns: the number of regions written to @regions
+ **/
+guint
+gst_vaapi_qp_map_get_regions (const GstVaapiQPMap * map, guint width,
+    guint height, GstVaapiQPRegion * regions, guint max_regions)
+{
+  GArray *components;
+  guint *labels, *stack;
+  guint i, num_blocks, num_regions;
+
+  g_return_val_if_fail (map != NULL, 0);
+  g_return_val_if_fail (regions != NULL || max_regions == 0, 0);
+
+  if (max_regions == 0)
+    return 0;
+
+  num_blocks = map->columns * map->rows;
+
+  labels = g_new0 (guint, num_blocks);
+  stack = g_new (guint, num_blocks);
+  components = g_array_new (FALSE, FALSE, sizeof (QPComponent));
+
+  for (i = 0; i < num_blocks; i++) {
+    QPComponent comp;
+
+    if (labels[i] || map->delta_qp[i] == 0)
+      continue;
+    fill_component (map, i, labels, stack, components->len + 1, &comp);
+    g_array_append_val (components, comp);
+  }
+  g_array_sort (components, compare_components);
+
+  num_regions = 0;
+  for (i = 0; i < components->len && num_regions < max_regions; i++) {
+    const QPComponent *const comp =
+        &g_array_index (components, QPComponent, i);
+    GstVaapiQPRegion *const region = &regions[num_regions];
+    const guint x = comp->x0 * map->block_size;
+    const guint y = comp->y0 * map->block_size;
+    const gint count = comp->count;
+
+    if (x >= width || y >= height)
+      continue;
+
+    region->x = x;
+    region->y = y;
+    region->width = MIN ((comp->x1 + 1) * map->block_size, width) - x;
+    region->height = MIN ((comp->y1 + 1) * map->block_size, height) - y;
+
+    /* rounded away from zero: the deltas all have the same sign */
+    if (comp->sum >= 0)
+      region->delta_qp = (comp->sum + count / 2) / count;
+    else
+      region->delta_qp = -((count / 2 - comp->sum) / count);
+    num_regions++;
+  }
+
+  g_array_unref (components);
+  g_free (stack);
+  g_free (labels);
+  return num_regions;
+}
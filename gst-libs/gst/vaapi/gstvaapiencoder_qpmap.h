@@ -0,0 +1,105 @@
+/*
+ *  gstvaapiencoder_qpmap.h - Per-block QP delta maps for the encoders
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_ENCODER_QP_MAP_H
+#define GST_VAAPI_ENCODER_QP_MAP_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GST_VAAPI_QP_MAP_META_NAME:
+ *
+ * The name of the #GstCustomMeta carrying a per-block QP delta map
+ * for the encoders. Its structure holds the fields:
+ *
+ * - "block-size" (guint): the width and height of the blocks, in
+ *   pixels
+ * - "columns" (guint), "rows" (guint): the size of the map, in blocks
+ * - "delta-qp" (#GBytes): one gint8 QP delta per block, in raster
+ *   order
+ *
+ * Applications can attach it with gst_buffer_add_custom_meta() once
+ * the vaapi plugin is loaded, or with gst_vaapi_buffer_add_qp_map().
+ */
+#define GST_VAAPI_QP_MAP_META_NAME "GstVaapiQPMapMeta"
+
+typedef struct _GstVaapiQPMap GstVaapiQPMap;
+typedef struct _GstVaapiQPRegion GstVaapiQPRegion;
+
+/**
+ * GstVaapiQPMap:
+ * @block_size: the width and height of the blocks, in pixels
+ * @columns: the number of blocks per row
+ * @rows: the number of block rows
+ * @delta_qp: the QP delta of each block, in raster order
+ *
+ * A per-block QP delta map, as carried by the #GstCustomMeta named
+ * #GST_VAAPI_QP_MAP_META_NAME.
+ */
+struct _GstVaapiQPMap
+{
+  guint block_size;
+  guint columns;
+  guint rows;
+  const gint8 *delta_qp;
+};
+
+/**
+ * GstVaapiQPRegion:
+ * @x: the left edge of the region, in pixels
+ * @y: the top edge of the region, in pixels
+ * @width: the width of the region, in pixels
+ * @height: the height of the region, in pixels
+ * @delta_qp: the QP delta to apply to the region
+ *
+ * A rectangle of a #GstVaapiQPMap sharing a QP delta.
+ */
+struct _GstVaapiQPRegion
+{
+  guint x;
+  guint y;
+  guint width;
+  guint height;
+  gint delta_qp;
+};
+
+const GstMetaInfo *
+gst_vaapi_qp_map_meta_get_info (void);
+
+GstCustomMeta *
+gst_vaapi_buffer_add_qp_map (GstBuffer * buffer, guint block_size,
+    guint columns, guint rows, const gint8 * delta_qp);
+
+gboolean
+gst_vaapi_buffer_get_qp_map (GstBuffer * buffer, GstVaapiQPMap * map);
+
+void
+gst_vaapi_qp_map_get_block_qps (const GstVaapiQPMap * map, guint block_size,
+    guint columns, guint rows, guint stride, gint base_qp, gint min_qp,
+    gint max_qp, guint8 * qps);
+
+guint
+gst_vaapi_qp_map_get_regions (const GstVaapiQPMap * map, guint width,
+    guint height, GstVaapiQPRegion * regions, guint max_regions);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_ENCODER_QP_MAP_H */
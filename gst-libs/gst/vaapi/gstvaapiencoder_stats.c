@@ -0,0 +1,264 @@
+/*
+ *  gstvaapiencoder_stats.c - Per-frame statistics of the encoders
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include "gstvaapiencoder_stats.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+static const gchar *const frame_type_names[GST_VAAPI_ENCODER_FRAME_TYPES] = {
+  "I", "P", "B"
+};
+
+/**
+ * gst_vaapi_encoder_stats_meta_get_info:
+ *
+ * Registers the #GstCustomMeta named
+ * #GST_VAAPI_ENCODER_STATS_META_NAME, if needed.
+ *
+ * Returns: the #GstMetaInfo of the encoder statistics meta
+ **/
+const GstMetaInfo *
+gst_vaapi_encoder_stats_meta_get_info (void)
+{
+  static const GstMetaInfo *meta_info = NULL;
+
+  if (g_once_init_enter (&meta_info)) {
+    const GstMetaInfo *const info =
+        gst_meta_register_custom (GST_VAAPI_ENCODER_STATS_META_NAME, NULL,
+        NULL, NULL, NULL);
+    g_once_init_leave (&meta_info, info);
+  }
+  return meta_info;
+}
+
+/**
+ * gst_vaapi_buffer_add_encoder_stats:
+ * @buffer: a #GstBuffer
+ * @stats: the statistics of the coded frame
+ *
+ * Attaches the statistics of a coded frame to @buffer. The unknown
+ * quantizer and HRD buffer fullness are left out of the meta.
+ *
+ * Returns: (transfer none): the #GstCustomMeta, or %NULL on error
+ **/
+GstCustomMeta *
+gst_vaapi_buffer_add_encoder_stats (GstBuffer * buffer,
+    const GstVaapiEncoderFrameStats * stats)
+{
+  GstCustomMeta *meta;
+  GstStructure *structure;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (stats != NULL, NULL);
+  g_return_val_if_fail (stats->frame_type < GST_VAAPI_ENCODER_FRAME_TYPES,
+      NULL);
+
+  gst_vaapi_encoder_stats_meta_get_info ();
+  meta = gst_buffer_add_custom_meta (buffer,
+      GST_VAAPI_ENCODER_STATS_META_NAME);
+  if (!meta)
+    return NULL;
+
+  structure = gst_custom_meta_get_structure (meta);
+  gst_structure_set (structure,
+      "frame-type", G_TYPE_STRING, frame_type_names[stats->frame_type],
+      "coded-size", G_TYPE_UINT, stats->coded_size,
+      "encode-latency", G_TYPE_UINT64, stats->encode_latency, NULL);
+  if (stats->qp >= 0)
+    gst_structure_set (structure, "qp", G_TYPE_INT, stats->qp, NULL);
+  if (stats->hrd_fullness >= 0)
+    gst_structure_set (structure, "hrd-fullness", G_TYPE_UINT,
+        (guint) stats->hrd_fullness, NULL);
+  return meta;
+}
+
+/**
+ * gst_vaapi_buffer_get_encoder_stats:
+ * @buffer: a #GstBuffer
+ * @stats: (out caller-allocates): return location for the statistics
+ *   of the coded frame
+ *
+ * Looks up the statistics of the coded frame held by @buffer.
+ *
+ * Returns: %TRUE if @buffer carries a valid encoder statistics meta
+ **/
+gboolean
+gst_vaapi_buffer_get_encoder_stats (GstBuffer * buffer,
+    GstVaapiEncoderFrameStats * stats)
+{
+  GstCustomMeta *meta;
+  GstStructure *structure;
+  const gchar *type_name;
+  guint i, fullness;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), FALSE);
+  g_return_val_if_fail (stats != NULL, FALSE);
+
+  if (!gst_vaapi_encoder_stats_meta_get_info ())
+    return FALSE;
+
+  meta = gst_buffer_get_custom_meta (buffer,
+      GST_VAAPI_ENCODER_STATS_META_NAME);
+  if (!meta)
+    return FALSE;
+
+  structure = gst_custom_meta_get_structure (meta);
+  type_name = gst_structure_get_string (structure, "frame-type");
+  if (!type_name)
+    goto error_invalid_meta;
+  for (i = 0; i < GST_VAAPI_ENCODER_FRAME_TYPES; i++) {
+    if (g_strcmp0 (type_name, frame_type_names[i]) == 0)
+      break;
+  }
+  if (i == GST_VAAPI_ENCODER_FRAME_TYPES ||
+      !gst_structure_get_uint (structure, "coded-size", &stats->coded_size) ||
+      !gst_structure_get_uint64 (structure, "encode-latency",
+          &stats->encode_latency))
+    goto error_invalid_meta;
+  stats->frame_type = i;
+
+  if (!gst_structure_get_int (structure, "qp", &stats->qp))
+    stats->qp = -1;
+  if (gst_structure_get_uint (structure, "hrd-fullness", &fullness))
+    stats->hrd_fullness = fullness;
+  else
+    stats->hrd_fullness = -1;
+  return TRUE;
+
+  /* ERRORS */
+error_invalid_meta:
+  {
+    GST_WARNING ("ignoring invalid encoder statistics meta %" GST_PTR_FORMAT,
+        structure);
+    return FALSE;
+  }
+}
+
+/**
+ * gst_vaapi_encoder_stats_summary_reset:
+ * @summary: a #GstVaapiEncoderStatsSummary
+ *
+ * Empties @summary.
+ **/
+void
+gst_vaapi_encoder_stats_summary_reset (GstVaapiEncoderStatsSummary * summary)
+{
+  g_return_if_fail (summary != NULL);
+
+  memset (summary, 0, sizeof (*summary));
+  summary->min_qp = G_MAXINT;
+  summary->max_qp = -1;
+  summary->min_hrd_fullness = -1;
+}
+
+/**
+ * gst_vaapi_encoder_stats_summary_add:
+ * @summary: a #GstVaapiEncoderStatsSummary
+ * @stats: the statistics of a coded frame
+ * @duration: the duration of the frame, or %GST_CLOCK_TIME_NONE
+ *
+ * Accounts for a coded frame in @summary.
+ **/
+void
+gst_vaapi_encoder_stats_summary_add (GstVaapiEncoderStatsSummary * summary,
+    const GstVaapiEncoderFrameStats * stats, GstClockTime duration)
+{
+  g_return_if_fail (summary != NULL);
+  g_return_if_fail (stats != NULL);
+  g_return_if_fail (stats->frame_type < GST_VAAPI_ENCODER_FRAME_TYPES);
+
+  summary->num_frames++;
+  summary->num_frames_type[stats->frame_type]++;
+  summary->coded_size += stats->coded_size;
+  if (GST_CLOCK_TIME_IS_VALID (duration))
+    summary->duration += duration;
+
+  if (stats->qp >= 0) {
+    summary->num_qps++;
+    summary->qp_sum += stats->qp;
+    summary->min_qp = MIN (summary->min_qp, stats->qp);
+    summary->max_qp = MAX (summary->max_qp, stats->qp);
+  }
+
+  summary->latency_sum += stats->encode_latency;
+  summary->max_latency = MAX (summary->max_latency, stats->encode_latency);
+
+  if (stats->hrd_fullness >= 0 && (summary->min_hrd_fullness < 0 ||
+          stats->hrd_fullness < summary->min_hrd_fullness))
+    summary->min_hrd_fullness = stats->hrd_fullness;
+}
+
+/**
+ * gst_vaapi_encoder_stats_summary_to_structure:
+ * @summary: a #GstVaapiEncoderStatsSummary
+ *
+ * Creates a "GstVaapiEncoderStats" structure out of @summary, with
+ * the fields:
+ *
+ * - "frames", "i-frames", "p-frames" and "b-frames" (guint): the
+ *   number of frames, in all and of each coding type
+ * - "coded-size" (guint64): the size of the coded frames, in bytes
+ * - "bitrate" (guint): the bitrate of the coded frames, in bits per
+ *   second, if their duration is known
+ * - "mean-qp" (gdouble), "min-qp" and "max-qp" (gint): the quantizers
+ *   of the frames, if the driver reports them
+ * - "mean-latency" and "max-latency" (guint64): the encode latencies
+ *   of the frames, in nanoseconds
+ * - "min-hrd-fullness" (guint): the lowest fullness of the HRD buffer
+ *   before the removal of a frame, in bits, if known
+ *
+ * Returns: (transfer full): a new #GstStructure
+ **/
+GstStructure *
+gst_vaapi_encoder_stats_summary_to_structure (const
+    GstVaapiEncoderStatsSummary * summary)
+{
+  GstStructure *structure;
+
+  g_return_val_if_fail (summary != NULL, NULL);
+
+  structure = gst_structure_new ("GstVaapiEncoderStats",
+      "frames", G_TYPE_UINT, summary->num_frames,
+      "i-frames", G_TYPE_UINT,
+      summary->num_frames_type[GST_VAAPI_ENCODER_FRAME_I],
+      "p-frames", G_TYPE_UINT,
+      summary->num_frames_type[GST_VAAPI_ENCODER_FRAME_P],
+      "b-frames", G_TYPE_UINT,
+      summary->num_frames_type[GST_VAAPI_ENCODER_FRAME_B],
+      "coded-size", G_TYPE_UINT64, summary->coded_size,
+      "mean-latency", G_TYPE_UINT64, summary->num_frames > 0 ?
+      summary->latency_sum / summary->num_frames : 0,
+      "max-latency", G_TYPE_UINT64, summary->max_latency, NULL);
+
+  if (summary->duration > 0)
+    gst_structure_set (structure, "bitrate", G_TYPE_UINT,
+        (guint) gst_util_uint64_scale (summary->coded_size * 8, GST_SECOND,
+            summary->duration), NULL);
+  if (summary->num_qps > 0)
+    gst_structure_set (structure,
+        "mean-qp", G_TYPE_DOUBLE, (gdouble) summary->qp_sum / summary->num_qps,
+        "min-qp", G_TYPE_INT, summary->min_qp,
+        "max-qp", G_TYPE_INT, summary->max_qp, NULL);
+  if (summary->min_hrd_fullness >= 0)
+    gst_structure_set (structure, "min-hrd-fullness", G_TYPE_UINT,
+        (guint) summary->min_hrd_fullness, NULL);
+  return structure;
+}
@@ -0,0 +1,137 @@
+/*
+ *  gstvaapiencoder_stats.h - Per-frame statistics of the encoders
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_ENCODER_STATS_H
+#define GST_VAAPI_ENCODER_STATS_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GST_VAAPI_ENCODER_STATS_META_NAME:
+ *
+ * The name of the #GstCustomMeta the encoders attach to the coded
+ * buffers when the "frame-stats" property is set. Its structure holds
+ * the fields:
+ *
+ * - "frame-type" (gchararray): "I", "P" or "B"
+ * - "qp" (gint): the quantizer of the frame, averaged over its blocks
+ *   by the driver, if it reports it
+ * - "coded-size" (guint): the size of the coded frame, in bytes
+ * - "encode-latency" (guint64): the time elapsed between the
+ *   submission of the frame to the hardware and the availability of
+ *   its coded buffer, in nanoseconds
+ * - "hrd-fullness" (guint): the fullness of the HRD buffer right
+ *   before the removal of the frame, in bits, with the constant and
+ *   variable bitrate rate controls
+ */
+#define GST_VAAPI_ENCODER_STATS_META_NAME "GstVaapiEncoderStatsMeta"
+
+typedef struct _GstVaapiEncoderFrameStats GstVaapiEncoderFrameStats;
+typedef struct _GstVaapiEncoderStatsSummary GstVaapiEncoderStatsSummary;
+
+/**
+ * GstVaapiEncoderFrameType:
+ * @GST_VAAPI_ENCODER_FRAME_I: an intra frame
+ * @GST_VAAPI_ENCODER_FRAME_P: a predicted frame
+ * @GST_VAAPI_ENCODER_FRAME_B: a bi-directionally predicted frame
+ *
+ * The coding type of a frame.
+ */
+typedef enum
+{
+  GST_VAAPI_ENCODER_FRAME_I = 0,
+  GST_VAAPI_ENCODER_FRAME_P,
+  GST_VAAPI_ENCODER_FRAME_B,
+  GST_VAAPI_ENCODER_FRAME_TYPES
+} GstVaapiEncoderFrameType;
+
+/**
+ * GstVaapiEncoderFrameStats:
+ * @frame_type: the coding type of the frame
+ * @qp: the average quantizer of the frame, or -1 if unknown
+ * @coded_size: the size of the coded frame, in bytes
+ * @encode_latency: the time the hardware took to code the frame
+ * @hrd_fullness: the fullness of the HRD buffer right before the
+ *   removal of the frame, in bits, or -1 if unknown
+ *
+ * The statistics of a coded frame.
+ */
+struct _GstVaapiEncoderFrameStats
+{
+  GstVaapiEncoderFrameType frame_type;
+  gint qp;
+  guint coded_size;
+  GstClockTime encode_latency;
+  gint64 hrd_fullness;
+};
+
+/**
+ * GstVaapiEncoderStatsSummary:
+ * @num_frames: the number of frames
+ * @num_frames_type: the number of frames of each coding type
+ * @coded_size: the size of the coded frames, in bytes
+ * @duration: the duration of the frames
+ *
+ * The statistics of a run of coded frames.
+ */
+struct _GstVaapiEncoderStatsSummary
+{
+  guint num_frames;
+  guint num_frames_type[GST_VAAPI_ENCODER_FRAME_TYPES];
+  guint64 coded_size;
+  GstClockTime duration;
+
+  /*< private >*/
+  guint num_qps;
+  gint64 qp_sum;
+  gint min_qp;
+  gint max_qp;
+  GstClockTime latency_sum;
+  GstClockTime max_latency;
+  /* the lowest fullness of the HRD buffer, or -1 if unknown */
+  gint64 min_hrd_fullness;
+};
+
+const GstMetaInfo *
+gst_vaapi_encoder_stats_meta_get_info (void);
+
+GstCustomMeta *
+gst_vaapi_buffer_add_encoder_stats (GstBuffer * buffer,
+    const GstVaapiEncoderFrameStats * stats);
+
+gboolean
+gst_vaapi_buffer_get_encoder_stats (GstBuffer * buffer,
+    GstVaapiEncoderFrameStats * stats);
+
+void
+gst_vaapi_encoder_stats_summary_reset (GstVaapiEncoderStatsSummary * summary);
+
+void
+gst_vaapi_encoder_stats_summary_add (GstVaapiEncoderStatsSummary * summary,
+    const GstVaapiEncoderFrameStats * stats, GstClockTime duration);
+
+GstStructure *
+gst_vaapi_encoder_stats_summary_to_structure (const
+    GstVaapiEncoderStatsSummary * summary);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_ENCODER_STATS_H */
@@ -0,0 +1,223 @@
+/*
+ *  gstvaapiencoder_swrc.c - Software rate control for the encoders
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include <math.h>
+#include "gstvaapiencoder_swrc.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+/* the QP of a frame moves at most by this much from the previous
+   frame of the same type */
+#define MAX_QP_STEP 4
+
+/* the weights of the budgets of the frame types */
+static const gdouble frame_weights[GST_VAAPI_SW_RC_FRAME_TYPES] = {
+  4.0, 1.0, 0.6
+};
+
+/* The quantizer step of H.264 and H.265 doubles every 6 QP, and the
+   size of a frame is modelled as inversely proportional to it */
+static inline gdouble
+qp_to_qstep (gdouble qp)
+{
+  return pow (2.0, (qp - 4.0) / 6.0);
+}
+
+static inline gdouble
+qstep_to_qp (gdouble qstep)
+{
+  return 4.0 + 6.0 * log2 (qstep);
+}
+
+static void
+set_buffer (GstVaapiSwRateControl * rc, guint bitrate, gint fps_n,
+    gint fps_d, guint cpb_length)
+{
+  rc->bits_per_frame = (gdouble) bitrate * 1000 * fps_d / fps_n;
+  rc->buffer_size = (gdouble) bitrate * cpb_length;
+  /* the buffer has to hold a few frames to smooth anything */
+  rc->buffer_size = MAX (rc->buffer_size, 4 * rc->bits_per_frame);
+}
+
+/**
+ * gst_vaapi_sw_rate_control_init:
+ * @rc: a #GstVaapiSwRateControl
+ * @bitrate: the target bitrate, in kbps
+ * @fps_n: the framerate numerator
+ * @fps_d: the framerate denominator
+ * @cpb_length: the size of the virtual buffer, in ms
+ * @init_qp: the QP of a frame type without any history
+ * @min_qp: the minimum QP
+ * @max_qp: the maximum QP
+ *
+ * Resets @rc to target @bitrate, with a virtual buffer of
+ * @cpb_length ms, half full.
+ */
+void
+gst_vaapi_sw_rate_control_init (GstVaapiSwRateControl * rc, guint bitrate,
+    gint fps_n, gint fps_d, guint cpb_length, gint init_qp, gint min_qp,
+    gint max_qp)
+{
+  guint i;
+
+  g_return_if_fail (rc != NULL);
+  g_return_if_fail (bitrate > 0);
+  g_return_if_fail (fps_n > 0 && fps_d > 0);
+  g_return_if_fail (min_qp <= max_qp);
+
+  memset (rc, 0, sizeof (*rc));
+  set_buffer (rc, bitrate, fps_n, fps_d, cpb_length);
+  rc->init_qp = CLAMP (init_qp, min_qp, max_qp);
+  rc->min_qp = min_qp;
+  rc->max_qp = max_qp;
+
+  rc->fullness = rc->buffer_size / 2;
+  rc->mean_weight = frame_weights[GST_VAAPI_SW_RC_FRAME_P];
+  for (i = 0; i < GST_VAAPI_SW_RC_FRAME_TYPES; i++)
+    rc->last_qp[i] = -1;
+}
+
+/**
+ * gst_vaapi_sw_rate_control_set_target:
+ * @rc: a #GstVaapiSwRateControl
+ * @bitrate: the target bitrate, in kbps
+ * @fps_n: the framerate numerator
+ * @fps_d: the framerate denominator
+ * @cpb_length: the size of the virtual buffer, in ms
+ * @min_qp: the minimum QP
+ * @max_qp: the maximum QP
+ *
+ * Changes the target of a running @rc. The models of the frame types
+ * are kept, so that the QP moves smoothly to the new bitrate, and the
+ * fullness of the virtual buffer is scaled to its new size.
+ */
+void
+gst_vaapi_sw_rate_control_set_target (GstVaapiSwRateControl * rc,
+    guint bitrate, gint fps_n, gint fps_d, guint cpb_length, gint min_qp,
+    gint max_qp)
+{
+  gdouble level;
+
+  g_return_if_fail (rc != NULL);
+  g_return_if_fail (bitrate > 0);
+  g_return_if_fail (fps_n > 0 && fps_d > 0);
+  g_return_if_fail (min_qp <= max_qp);
+
+  level = rc->fullness / rc->buffer_size;
+  set_buffer (rc, bitrate, fps_n, fps_d, cpb_length);
+  rc->fullness = level * rc->buffer_size;
+
+  rc->min_qp = min_qp;
+  rc->max_qp = max_qp;
+  rc->init_qp = CLAMP (rc->init_qp, min_qp, max_qp);
+}
+
+/**
+ * gst_vaapi_sw_rate_control_get_qp:
+ * @rc: a #GstVaapiSwRateControl
+ * @type: the type of the frame to encode
+ * @target_bits: return location for the target size of the frame
+ *
+ * Picks the QP of the next frame to encode, from the model of its
+ * type and the fullness of the virtual buffer. The frame is accounted
+ * in the buffer with its target size until
+ * gst_vaapi_sw_rate_control_update() is called with its coded size,
+ * so that several frames can be in flight.
+ *
+ * Return value: the QP of the frame
+ */
+gint
+gst_vaapi_sw_rate_control_get_qp (GstVaapiSwRateControl * rc,
+    GstVaapiSwRateControlFrameType type, guint * target_bits)
+{
+  gdouble target, deviation, room;
+  gint qp, last_qp;
+
+  g_return_val_if_fail (rc != NULL, 0);
+  g_return_val_if_fail (type < GST_VAAPI_SW_RC_FRAME_TYPES, 0);
+
+  /* the share of the frame type in the average budget */
+  target = rc->bits_per_frame * frame_weights[type] / rc->mean_weight;
+
+  /* drive the buffer back to half full */
+  deviation = (rc->fullness - rc->buffer_size / 2) / (rc->buffer_size / 2);
+  target *= CLAMP (pow (2.0, -deviation), 0.25, 2.0);
+
+  /* never overflow the buffer */
+  room = rc->buffer_size - rc->fullness + rc->bits_per_frame;
+  target = CLAMP (target, rc->bits_per_frame / 8, MAX (room,
+          rc->bits_per_frame / 8));
+
+  if (rc->complexity[type] > 0)
+    qp = (gint) floor (qstep_to_qp (rc->complexity[type] / target) + 0.5);
+  else
+    qp = rc->init_qp;
+
+  last_qp = rc->last_qp[type];
+  if (last_qp >= 0)
+    qp = CLAMP (qp, last_qp - MAX_QP_STEP, last_qp + MAX_QP_STEP);
+  qp = CLAMP (qp, rc->min_qp, rc->max_qp);
+  rc->last_qp[type] = qp;
+
+  rc->fullness += target - rc->bits_per_frame;
+
+  GST_LOG ("frame type %d: qp %d, target %.0f bits, buffer %.0f/%.0f",
+      type, qp, target, rc->fullness, rc->buffer_size);
+
+  if (target_bits)
+    *target_bits = (guint) target;
+  return qp;
+}
+
+/**
+ * gst_vaapi_sw_rate_control_update:
+ * @rc: a #GstVaapiSwRateControl
+ * @type: the type of the coded frame
+ * @qp: the QP the frame was coded with
+ * @target_bits: the target size returned for the frame
+ * @coded_bits: the coded size of the frame
+ *
+ * Feeds back the coded size of a frame, in the order the frames were
+ * coded, to correct the virtual buffer and the model of its type.
+ */
+void
+gst_vaapi_sw_rate_control_update (GstVaapiSwRateControl * rc,
+    GstVaapiSwRateControlFrameType type, gint qp, guint target_bits,
+    guint coded_bits)
+{
+  gdouble complexity;
+
+  g_return_if_fail (rc != NULL);
+  g_return_if_fail (type < GST_VAAPI_SW_RC_FRAME_TYPES);
+
+  rc->fullness += (gdouble) coded_bits - target_bits;
+  rc->fullness = MAX (rc->fullness, 0);
+
+  if (coded_bits > 0) {
+    complexity = coded_bits * qp_to_qstep (qp);
+    if (rc->complexity[type] > 0)
+      rc->complexity[type] += (complexity - rc->complexity[type]) / 4;
+    else
+      rc->complexity[type] = complexity;
+  }
+
+  rc->mean_weight += (frame_weights[type] - rc->mean_weight) / 16;
+}
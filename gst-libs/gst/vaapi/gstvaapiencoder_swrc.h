@@ -0,0 +1,98 @@
+/*
+ *  gstvaapiencoder_swrc.h - Software rate control for the encoders
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_ENCODER_SWRC_H
+#define GST_VAAPI_ENCODER_SWRC_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVaapiSwRateControl GstVaapiSwRateControl;
+
+/**
+ * GstVaapiSwRateControlFrameType:
+ * @GST_VAAPI_SW_RC_FRAME_I: an intra frame
+ * @GST_VAAPI_SW_RC_FRAME_P: a predicted frame
+ * @GST_VAAPI_SW_RC_FRAME_B: a bi-directionally predicted frame
+ *
+ * The frame types the software rate controller keeps a model for.
+ */
+typedef enum
+{
+  GST_VAAPI_SW_RC_FRAME_I = 0,
+  GST_VAAPI_SW_RC_FRAME_P,
+  GST_VAAPI_SW_RC_FRAME_B,
+  GST_VAAPI_SW_RC_FRAME_TYPES
+} GstVaapiSwRateControlFrameType;
+
+/**
+ * GstVaapiSwRateControl:
+ * @bits_per_frame: the average budget of a frame, in bits
+ * @buffer_size: the size of the virtual buffer, in bits
+ * @init_qp: the QP of a frame type without any history
+ * @min_qp: the minimum QP
+ * @max_qp: the maximum QP
+ *
+ * A rate controller choosing the QP of each frame from the sizes of
+ * the previously coded frames, for a hardware encoder running in
+ * constant QP mode. It only does arithmetic on the values it is fed,
+ * so that a given sequence of calls always yields the same QPs.
+ */
+struct _GstVaapiSwRateControl
+{
+  gdouble bits_per_frame;
+  gdouble buffer_size;
+  gint init_qp;
+  gint min_qp;
+  gint max_qp;
+
+  /*< private >*/
+  /* the fullness of the virtual buffer, in bits, counting the frames
+     still being coded with their target size */
+  gdouble fullness;
+  /* the average weight of the coded frames */
+  gdouble mean_weight;
+  /* the average size of each frame type, at a quantizer step of 1 */
+  gdouble complexity[GST_VAAPI_SW_RC_FRAME_TYPES];
+  gint last_qp[GST_VAAPI_SW_RC_FRAME_TYPES];
+};
+
+void
+gst_vaapi_sw_rate_control_init (GstVaapiSwRateControl * rc, guint bitrate,
+    gint fps_n, gint fps_d, guint cpb_length, gint init_qp, gint min_qp,
+    gint max_qp);
+
+void
+gst_vaapi_sw_rate_control_set_target (GstVaapiSwRateControl * rc,
+    guint bitrate, gint fps_n, gint fps_d, guint cpb_length, gint min_qp,
+    gint max_qp);
+
+gint
+gst_vaapi_sw_rate_control_get_qp (GstVaapiSwRateControl * rc,
+    GstVaapiSwRateControlFrameType type, guint * target_bits);
+
+void
+gst_vaapi_sw_rate_control_update (GstVaapiSwRateControl * rc,
+    GstVaapiSwRateControlFrameType type, gint qp, guint target_bits,
+    guint coded_bits);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_ENCODER_SWRC_H */
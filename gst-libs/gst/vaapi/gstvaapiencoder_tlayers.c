@@ -0,0 +1,380 @@
+/*
+ *  gstvaapiencoder_tlayers.c - Temporal layer patterns for the encoders
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include "gstvaapiencoder_tlayers.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+#define LAST GST_VAAPI_REF_FRAME_LAST
+#define GOLDEN GST_VAAPI_REF_FRAME_GOLDEN
+#define ALTREF GST_VAAPI_REF_FRAME_ALTREF
+
+/* The base layer only predicts from, and updates, the "last" frame.
+   The upper layers predict from the lower ones, and keep their own
+   reference in the "golden" or "alternate" frame, so that dropping
+   them never breaks the lower layers */
+static const GstVaapiTemporalLayerFrame pattern_2_layers[] = {
+  {0, LAST, LAST},
+  {1, LAST | GOLDEN, GOLDEN},
+};
+
+static const GstVaapiTemporalLayerFrame pattern_3_layers[] = {
+  {0, LAST, LAST},
+  {2, LAST | GOLDEN, ALTREF},
+  {1, LAST | GOLDEN, GOLDEN},
+  {2, LAST | GOLDEN | ALTREF, ALTREF},
+};
+
+static const GstVaapiTemporalLayerFrame key_frame = {
+  0, 0, GST_VAAPI_REF_FRAME_ALL
+};
+
+/* Share of the bitrate of each layer, in percent */
+static const guint default_shares_2_layers[] = { 60, 40 };
+static const guint default_shares_3_layers[] = { 40, 20, 40 };
+
+/**
+ * gst_vaapi_temporal_layer_meta_get_info:
+ *
+ * Registers the #GstCustomMeta named
+ * #GST_VAAPI_TEMPORAL_LAYER_META_NAME, if needed.
+ *
+ * Returns: the #GstMetaInfo of the temporal layer meta
+ **/
+const GstMetaInfo *
+gst_vaapi_temporal_layer_meta_get_info (void)
+{
+  static const GstMetaInfo *meta_info = NULL;
+
+  if (g_once_init_enter (&meta_info)) {
+    const GstMetaInfo *const info =
+        gst_meta_register_custom (GST_VAAPI_TEMPORAL_LAYER_META_NAME, NULL,
+        NULL, NULL, NULL);
+    g_once_init_leave (&meta_info, info);
+  }
+  return meta_info;
+}
+
+/**
+ * gst_vaapi_buffer_add_temporal_layer:
+ * @buffer: a #GstBuffer
+ * @temporal_id: the temporal layer of the frame
+ * @num_layers: the number of temporal layers of the stream
+ * @layer_sync: whether the frame only references base layer frames
+ *
+ * Attaches the temporal layer of a coded frame to @buffer.
+ *
+ * Returns: (transfer none): the #GstCustomMeta, or %NULL on error
+ **/
+GstCustomMeta *
+gst_vaapi_buffer_add_temporal_layer (GstBuffer * buffer, guint temporal_id,
+    guint num_layers, gboolean layer_sync)
+{
+  GstCustomMeta *meta;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (temporal_id < num_layers, NULL);
+
+  gst_vaapi_temporal_layer_meta_get_info ();
+  meta = gst_buffer_add_custom_meta (buffer,
+      GST_VAAPI_TEMPORAL_LAYER_META_NAME);
+  if (!meta)
+    return NULL;
+
+  gst_structure_set (gst_custom_meta_get_structure (meta),
+      "temporal-id", G_TYPE_UINT, temporal_id,
+      "temporal-layers", G_TYPE_UINT, num_layers,
+      "layer-sync", G_TYPE_BOOLEAN, layer_sync, NULL);
+  return meta;
+}
+
+/**
+ * gst_vaapi_buffer_get_temporal_layer:
+ * @buffer: a #GstBuffer
+ * @temporal_id: (out) (optional): return location for the temporal
+ *   layer of the frame
+ * @num_layers: (out) (optional): return location for the number of
+ *   temporal layers of the stream
+ * @layer_sync: (out) (optional): return location for whether the
+ *   frame only references base layer frames
+ *
+ * Looks up the temporal layer of the coded frame held by @buffer.
+ *
+ * Returns: %TRUE if @buffer carries a valid temporal layer meta
+ **/
+gboolean
+gst_vaapi_buffer_get_temporal_layer (GstBuffer * buffer, guint * temporal_id,
+    guint * num_layers, gboolean * layer_sync)
+{
+  GstCustomMeta *meta;
+  GstStructure *structure;
+  guint tid, n;
+  gboolean sync;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), FALSE);
+
+  if (!gst_vaapi_temporal_layer_meta_get_info ())
+    return FALSE;
+
+  meta = gst_buffer_get_custom_meta (buffer,
+      GST_VAAPI_TEMPORAL_LAYER_META_NAME);
+  if (!meta)
+    return FALSE;
+
+  structure = gst_custom_meta_get_structure (meta);
+  if (!gst_structure_get_uint (structure, "temporal-id", &tid) ||
+      !gst_structure_get_uint (structure, "temporal-layers", &n) ||
+      !gst_structure_get_boolean (structure, "layer-sync", &sync) ||
+      tid >= n)
+    goto error_invalid_meta;
+
+  if (temporal_id)
+    *temporal_id = tid;
+  if (num_layers)
+    *num_layers = n;
+  if (layer_sync)
+    *layer_sync = sync;
+  return TRUE;
+
+  /* ERRORS */
+error_invalid_meta:
+  {
+    GST_WARNING ("ignoring invalid temporal layer meta %" GST_PTR_FORMAT,
+        structure);
+    return FALSE;
+  }
+}
+
+/**
+ * gst_vaapi_temporal_layers_init:
+ * @layers: a #GstVaapiTemporalLayers
+ * @num_layers: the number of temporal layers
+ *
+ * Selects the pattern of @num_layers temporal layers, and restarts it.
+ *
+ * Returns: %TRUE if @num_layers is supported
+ **/
+gboolean
+gst_vaapi_temporal_layers_init (GstVaapiTemporalLayers * layers,
+    guint num_layers)
+{
+  g_return_val_if_fail (layers != NULL, FALSE);
+
+  switch (num_layers) {
+    case 2:
+      layers->pattern = pattern_2_layers;
+      layers->periodicity = G_N_ELEMENTS (pattern_2_layers);
+      break;
+    case 3:
+      layers->pattern = pattern_3_layers;
+      layers->periodicity = G_N_ELEMENTS (pattern_3_layers);
+      break;
+    default:
+      return FALSE;
+  }
+
+  layers->num_layers = num_layers;
+  layers->frame_index = 0;
+  memset (layers->ref_temporal_id, 0, sizeof (layers->ref_temporal_id));
+  return TRUE;
+}
+
+/**
+ * gst_vaapi_temporal_layers_next:
+ * @layers: a #GstVaapiTemporalLayers
+ * @is_key_frame: whether the next frame is a key frame
+ * @layer_sync: (out) (optional): return location for whether the
+ *   frame only references base layer frames
+ *
+ * Advances the pattern to the next frame. A key frame restarts the
+ * pattern and updates all the reference frames.
+ *
+ * Returns: the temporal layer and references of the next frame
+ **/
+const GstVaapiTemporalLayerFrame *
+gst_vaapi_temporal_layers_next (GstVaapiTemporalLayers * layers,
+    gboolean is_key_frame, gboolean * layer_sync)
+{
+  const GstVaapiTemporalLayerFrame *frame;
+  gboolean sync = TRUE;
+  guint i;
+
+  g_return_val_if_fail (layers != NULL, NULL);
+  g_return_val_if_fail (layers->pattern != NULL, NULL);
+
+  if (is_key_frame) {
+    frame = &key_frame;
+    layers->frame_index = 1;
+  } else {
+    frame = &layers->pattern[layers->frame_index];
+    layers->frame_index = (layers->frame_index + 1) % layers->periodicity;
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (layers->ref_temporal_id); i++) {
+    if ((frame->ref_flags & (1 << i)) && layers->ref_temporal_id[i] > 0)
+      sync = FALSE;
+    if (frame->refresh_flags & (1 << i))
+      layers->ref_temporal_id[i] = frame->temporal_id;
+  }
+
+  if (layer_sync)
+    *layer_sync = sync;
+  return frame;
+}
+
+/**
+ * gst_vaapi_temporal_layers_get_bitrates:
+ * @layers: a #GstVaapiTemporalLayers
+ * @bitrate: the bitrate of the whole stream
+ * @shares: (element-type guint) (nullable): the share of @bitrate of
+ *   each layer, or %NULL for the default allocation
+ * @bitrates: (out caller-allocates): return location for the bitrate
+ *   of each layer
+ *
+ * Splits @bitrate among the temporal layers. As expected by VA-API,
+ * the bitrate of a layer accounts for the layers below it, so the top
+ * layer gets @bitrate. @shares are relative weights: they don't need
+ * to add up to 100. The default allocation is used if @shares doesn't
+ * hold one non-zero share per layer.
+ **/
+void
+gst_vaapi_temporal_layers_get_bitrates (const GstVaapiTemporalLayers * layers,
+    guint bitrate, GArray * shares, guint * bitrates)
+{
+  const guint *share;
+  guint64 total, sum;
+  guint i;
+
+  g_return_if_fail (layers != NULL);
+  g_return_if_fail (bitrates != NULL);
+
+  share = layers->num_layers == 2 ?
+      default_shares_2_layers : default_shares_3_layers;
+  if (shares && shares->len == layers->num_layers) {
+    for (i = 0; i < shares->len; i++) {
+      if (g_array_index (shares, guint, i) == 0)
+        break;
+    }
+    if (i == shares->len)
+      share = (const guint *) shares->data;
+    else
+      GST_WARNING ("ignoring temporal layer shares with a zero share");
+  } else if (shares && shares->len > 0) {
+    GST_WARNING ("%u temporal layer shares for %u layers, using defaults",
+        shares->len, layers->num_layers);
+  }
+
+  total = 0;
+  for (i = 0; i < layers->num_layers; i++)
+    total += share[i];
+
+  sum = 0;
+  for (i = 0; i < layers->num_layers; i++) {
+    sum += share[i];
+    bitrates[i] = gst_util_uint64_scale (bitrate, sum, total);
+  }
+}
+
+/**
+ * gst_vaapi_temporal_layers_get_framerate:
+ * @layers: a #GstVaapiTemporalLayers
+ * @temporal_id: a temporal layer
+ * @fps_n: the numerator of the frame rate of the stream
+ * @fps_d: the denominator of the frame rate of the stream
+ * @layer_fps_n: (out): return location for the numerator of the frame
+ *   rate of the layer
+ * @layer_fps_d: (out): return location for the denominator of the
+ *   frame rate of the layer
+ *
+ * Computes the frame rate of the stream thinned to @temporal_id, and
+ * the layers below it.
+ **/
+void
+gst_vaapi_temporal_layers_get_framerate (const GstVaapiTemporalLayers *
+    layers, guint temporal_id, gint fps_n, gint fps_d, gint * layer_fps_n,
+    gint * layer_fps_d)
+{
+  guint i, num_frames = 0;
+
+  g_return_if_fail (layers != NULL);
+  g_return_if_fail (layer_fps_n != NULL && layer_fps_d != NULL);
+
+  for (i = 0; i < layers->periodicity; i++) {
+    if (layers->pattern[i].temporal_id <= temporal_id)
+      num_frames++;
+  }
+
+  if (!gst_util_fraction_multiply (fps_n, fps_d, num_frames,
+          layers->periodicity, layer_fps_n, layer_fps_d)) {
+    *layer_fps_n = fps_n;
+    *layer_fps_d = fps_d;
+  }
+}
+
+/**
+ * gst_vaapi_value_get_temporal_layer_shares:
+ * @value: a #GValue holding a #GstValueArray of guint
+ * @shares: (element-type guint): the #GArray to fill
+ *
+ * Replaces the content of @shares with the temporal layer shares held
+ * by @value, as set to the "temporal-layer-shares" properties.
+ **/
+void
+gst_vaapi_value_get_temporal_layer_shares (const GValue * value,
+    GArray * shares)
+{
+  guint i, share, len;
+
+  g_return_if_fail (GST_VALUE_HOLDS_ARRAY (value));
+  g_return_if_fail (shares != NULL);
+
+  len = gst_value_array_get_size (value);
+  g_array_set_size (shares, 0);
+  for (i = 0; i < len; i++) {
+    share = g_value_get_uint (gst_value_array_get_value (value, i));
+    g_array_append_val (shares, share);
+  }
+}
+
+/**
+ * gst_vaapi_value_set_temporal_layer_shares:
+ * @value: a #GValue holding a #GstValueArray of guint
+ * @shares: (element-type guint): the temporal layer shares
+ *
+ * Sets @value to the temporal layer shares held by @shares.
+ **/
+void
+gst_vaapi_value_set_temporal_layer_shares (GValue * value, GArray * shares)
+{
+  GValue share = G_VALUE_INIT;
+  guint i;
+
+  g_return_if_fail (GST_VALUE_HOLDS_ARRAY (value));
+  g_return_if_fail (shares != NULL);
+
+  g_value_reset (value);
+  g_value_init (&share, G_TYPE_UINT);
+  for (i = 0; i < shares->len; i++) {
+    g_value_set_uint (&share, g_array_index (shares, guint, i));
+    gst_value_array_append_value (value, &share);
+  }
+  g_value_unset (&share);
+}
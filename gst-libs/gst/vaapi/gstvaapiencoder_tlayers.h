@@ -0,0 +1,141 @@
+/*
+ *  gstvaapiencoder_tlayers.h - Temporal layer patterns for the encoders
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_ENCODER_TEMPORAL_LAYERS_H
+#define GST_VAAPI_ENCODER_TEMPORAL_LAYERS_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GST_VAAPI_TEMPORAL_LAYER_META_NAME:
+ *
+ * The name of the #GstCustomMeta the encoders attach to the coded
+ * buffers of a stream with temporal layers. Its structure holds the
+ * fields:
+ *
+ * - "temporal-id" (guint): the temporal layer of the frame, 0 for the
+ *   base layer
+ * - "temporal-layers" (guint): the number of temporal layers of the
+ *   stream
+ * - "layer-sync" (gboolean): whether the frame only references frames
+ *   of the base layer, so that a receiver can switch up to its layer
+ *   from there
+ */
+#define GST_VAAPI_TEMPORAL_LAYER_META_NAME "GstVaapiTemporalLayerMeta"
+
+/* the VP8 and VP9 encoders support up to 3 temporal layers */
+#define GST_VAAPI_MAX_TEMPORAL_LAYERS 3
+
+typedef struct _GstVaapiTemporalLayerFrame GstVaapiTemporalLayerFrame;
+typedef struct _GstVaapiTemporalLayers GstVaapiTemporalLayers;
+
+/**
+ * GstVaapiRefFrameFlags:
+ * @GST_VAAPI_REF_FRAME_LAST: the "last" reference frame
+ * @GST_VAAPI_REF_FRAME_GOLDEN: the "golden" reference frame
+ * @GST_VAAPI_REF_FRAME_ALTREF: the "alternate" reference frame
+ *
+ * The VP8 and VP9 reference frames a frame predicts from, or updates.
+ */
+typedef enum
+{
+  GST_VAAPI_REF_FRAME_LAST = 1 << 0,
+  GST_VAAPI_REF_FRAME_GOLDEN = 1 << 1,
+  GST_VAAPI_REF_FRAME_ALTREF = 1 << 2,
+} GstVaapiRefFrameFlags;
+
+#define GST_VAAPI_REF_FRAME_ALL \
+  (GST_VAAPI_REF_FRAME_LAST | GST_VAAPI_REF_FRAME_GOLDEN | \
+   GST_VAAPI_REF_FRAME_ALTREF)
+
+/**
+ * GstVaapiTemporalLayerFrame:
+ * @temporal_id: the temporal layer of the frame
+ * @ref_flags: the reference frames the frame predicts from
+ * @refresh_flags: the reference frames the frame updates
+ *
+ * A frame of a temporal layer pattern.
+ */
+struct _GstVaapiTemporalLayerFrame
+{
+  guint temporal_id;
+  guint ref_flags;
+  guint refresh_flags;
+};
+
+/**
+ * GstVaapiTemporalLayers:
+ * @num_layers: the number of temporal layers
+ * @periodicity: the number of frames of the pattern
+ * @pattern: the @periodicity frames of the pattern
+ *
+ * The state of a temporal layer pattern, along a stream.
+ */
+struct _GstVaapiTemporalLayers
+{
+  guint num_layers;
+  guint periodicity;
+  const GstVaapiTemporalLayerFrame *pattern;
+
+  /*< private >*/
+  guint frame_index;
+  /* temporal layer of the frame held by each reference frame */
+  guint ref_temporal_id[3];
+};
+
+const GstMetaInfo *
+gst_vaapi_temporal_layer_meta_get_info (void);
+
+GstCustomMeta *
+gst_vaapi_buffer_add_temporal_layer (GstBuffer * buffer, guint temporal_id,
+    guint num_layers, gboolean layer_sync);
+
+gboolean
+gst_vaapi_buffer_get_temporal_layer (GstBuffer * buffer, guint * temporal_id,
+    guint * num_layers, gboolean * layer_sync);
+
+gboolean
+gst_vaapi_temporal_layers_init (GstVaapiTemporalLayers * layers,
+    guint num_layers);
+
+const GstVaapiTemporalLayerFrame *
+gst_vaapi_temporal_layers_next (GstVaapiTemporalLayers * layers,
+    gboolean is_key_frame, gboolean * layer_sync);
+
+void
+gst_vaapi_temporal_layers_get_bitrates (const GstVaapiTemporalLayers * layers,
+    guint bitrate, GArray * shares, guint * bitrates);
+
+void
+gst_vaapi_temporal_layers_get_framerate (const GstVaapiTemporalLayers *
+    layers, guint temporal_id, gint fps_n, gint fps_d, gint * layer_fps_n,
+    gint * layer_fps_d);
+
+void
+gst_vaapi_value_get_temporal_layer_shares (const GValue * value,
+    GArray * shares);
+
+void
+gst_vaapi_value_set_temporal_layer_shares (GValue * value, GArray * shares);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_ENCODER_TEMPORAL_LAYERS_H */
@@ -52,6 +52,7 @@
 #define DEFAULT_LOOP_FILTER_LEVEL 0
 #define DEFAULT_SHARPNESS_LEVEL 0
 #define DEFAULT_YAC_QI 40
+#define DEFAULT_TEMPORAL_LAYERS 1
 
 /* ------------------------------------------------------------------------- */
 /* --- VP8 Encoder                                                      --- */
@@ -69,6 +70,13 @@ struct _GstVaapiEncoderVP8
   GstVaapiSurfaceProxy *last_ref;
   GstVaapiSurfaceProxy *golden_ref;
   GstVaapiSurfaceProxy *alt_ref;
+
+  /* temporal scalability */
+  guint temporal_layers;
+  GArray *layer_shares;
+  GstVaapiTemporalLayers layers;
+  guint layer_bitrates[GST_VAAPI_MAX_TEMPORAL_LAYERS];
+  const GstVaapiTemporalLayerFrame *layer_frame;
 };
 
 /* Derives the profile that suits best to the configuration */
@@ -210,6 +218,77 @@ push_reference (GstVaapiEncoderVP8 * encoder, GstVaapiSurfaceProxy * ref)
   encoder->last_ref = ref;
 }
 
+/* Replaces the reference frames updated by a frame of a temporal layer
+   pattern with its reconstructed surface */
+static void
+refresh_references (GstVaapiEncoderVP8 * encoder, guint refresh_flags,
+    GstVaapiSurfaceProxy * ref)
+{
+  if (refresh_flags & GST_VAAPI_REF_FRAME_LAST) {
+    clear_ref (encoder, &encoder->last_ref);
+    encoder->last_ref = gst_vaapi_surface_proxy_ref (ref);
+  }
+  if (refresh_flags & GST_VAAPI_REF_FRAME_GOLDEN) {
+    clear_ref (encoder, &encoder->golden_ref);
+    encoder->golden_ref = gst_vaapi_surface_proxy_ref (ref);
+  }
+  if (refresh_flags & GST_VAAPI_REF_FRAME_ALTREF) {
+    clear_ref (encoder, &encoder->alt_ref);
+    encoder->alt_ref = gst_vaapi_surface_proxy_ref (ref);
+  }
+  gst_vaapi_encoder_release_surface (GST_VAAPI_ENCODER (encoder), ref);
+}
+
+static gboolean
+has_temporal_layers (GstVaapiEncoderVP8 * encoder)
+{
+  return encoder->temporal_layers > 1;
+}
+
+/* Sets up the temporal layer pattern, and splits the bitrate among the
+   layers */
+static void
+ensure_temporal_layers (GstVaapiEncoderVP8 * encoder)
+{
+  GstVaapiEncoder *const base_encoder = GST_VAAPI_ENCODER_CAST (encoder);
+
+  if (!has_temporal_layers (encoder))
+    return;
+
+  if (!gst_vaapi_temporal_layers_init (&encoder->layers,
+          encoder->temporal_layers)) {
+    GST_WARNING ("unsupported number of temporal layers %u, disabling them",
+        encoder->temporal_layers);
+    encoder->temporal_layers = 1;
+    return;
+  }
+
+  gst_vaapi_temporal_layers_get_bitrates (&encoder->layers,
+      base_encoder->bitrate, encoder->layer_shares, encoder->layer_bitrates);
+}
+
+/* Picks the temporal layer and the references of the next frame */
+static void
+set_temporal_layer (GstVaapiEncoderVP8 * encoder,
+    GstVaapiEncPicture * picture)
+{
+  gboolean layer_sync;
+
+  if (!has_temporal_layers (encoder)) {
+    encoder->layer_frame = NULL;
+    picture->temporal_id = 0;
+    return;
+  }
+
+  encoder->layer_frame = gst_vaapi_temporal_layers_next (&encoder->layers,
+      picture->type == GST_VAAPI_PICTURE_TYPE_I, &layer_sync);
+  picture->temporal_id = encoder->layer_frame->temporal_id;
+  picture->num_temporal_layers = encoder->temporal_layers;
+  if (layer_sync)
+    GST_VAAPI_ENC_PICTURE_FLAG_SET (picture,
+        GST_VAAPI_ENC_PICTURE_FLAG_LAYER_SYNC);
+}
+
 static gboolean
 fill_sequence (GstVaapiEncoderVP8 * encoder, GstVaapiEncSequence * sequence)
 {
@@ -290,7 +369,12 @@ ensure_misc_params (GstVaapiEncoderVP8 * encoder, GstVaapiEncPicture * picture)
   if (!gst_vaapi_encoder_ensure_param_quality_level (base_encoder, picture))
     return FALSE;
 
-  if (!gst_vaapi_encoder_ensure_param_control_rate (base_encoder, picture))
+  if (has_temporal_layers (encoder)) {
+    if (!gst_vaapi_encoder_ensure_param_temporal_layers (base_encoder,
+            picture, &encoder->layers, encoder->layer_bitrates))
+      return FALSE;
+  } else if (!gst_vaapi_encoder_ensure_param_control_rate (base_encoder,
+          picture))
     return FALSE;
 
   return TRUE;
@@ -317,6 +401,25 @@ fill_picture (GstVaapiEncoderVP8 * encoder,
         GST_VAAPI_SURFACE_PROXY_SURFACE_ID (encoder->golden_ref);
     pic_param->ref_last_frame =
         GST_VAAPI_SURFACE_PROXY_SURFACE_ID (encoder->last_ref);
+  }
+
+  if (picture->type == GST_VAAPI_PICTURE_TYPE_P && encoder->layer_frame) {
+    const guint ref_flags = encoder->layer_frame->ref_flags;
+    const guint refresh_flags = encoder->layer_frame->refresh_flags;
+
+    pic_param->ref_flags.bits.no_ref_last =
+        !(ref_flags & GST_VAAPI_REF_FRAME_LAST);
+    pic_param->ref_flags.bits.no_ref_gf =
+        !(ref_flags & GST_VAAPI_REF_FRAME_GOLDEN);
+    pic_param->ref_flags.bits.no_ref_arf =
+        !(ref_flags & GST_VAAPI_REF_FRAME_ALTREF);
+    pic_param->pic_flags.bits.refresh_last =
+        !!(refresh_flags & GST_VAAPI_REF_FRAME_LAST);
+    pic_param->pic_flags.bits.refresh_golden_frame =
+        !!(refresh_flags & GST_VAAPI_REF_FRAME_GOLDEN);
+    pic_param->pic_flags.bits.refresh_alternate_frame =
+        !!(refresh_flags & GST_VAAPI_REF_FRAME_ALTREF);
+  } else if (picture->type == GST_VAAPI_PICTURE_TYPE_P) {
     pic_param->pic_flags.bits.refresh_last = 1;
     pic_param->pic_flags.bits.refresh_golden_frame = 0;
     pic_param->pic_flags.bits.copy_buffer_to_golden = 1;
@@ -331,6 +434,7 @@ fill_picture (GstVaapiEncoderVP8 * encoder,
     pic_param->pic_flags.bits.refresh_alternate_frame = 1;
   }
 
+  pic_param->ref_flags.bits.temporal_id = picture->temporal_id;
   pic_param->pic_flags.bits.show_frame = 1;
 
   if (encoder->loop_filter_level) {
@@ -417,6 +521,8 @@ gst_vaapi_encoder_vp8_encode (GstVaapiEncoder * base_encoder,
 
   g_assert (GST_VAAPI_SURFACE_PROXY_SURFACE (reconstruct));
 
+  set_temporal_layer (encoder, picture);
+
   if (!ensure_sequence (encoder, picture))
     goto error;
   if (!ensure_misc_params (encoder, picture))
@@ -430,7 +536,11 @@ gst_vaapi_encoder_vp8_encode (GstVaapiEncoder * base_encoder,
   if (reconstruct) {
     if (picture->type == GST_VAAPI_PICTURE_TYPE_I)
       clear_references (encoder);
-    push_reference (encoder, reconstruct);
+    if (encoder->layer_frame)
+      refresh_references (encoder, encoder->layer_frame->refresh_flags,
+          reconstruct);
+    else
+      push_reference (encoder, reconstruct);
   }
 
   return GST_VAAPI_ENCODER_STATUS_SUCCESS;
@@ -504,6 +614,7 @@ gst_vaapi_encoder_vp8_reconfigure (GstVaapiEncoder * base_encoder)
     goto error;
 
   ensure_control_rate_params (encoder);
+  ensure_temporal_layers (encoder);
   return set_context_info (base_encoder);
 
   /* ERRORS */
@@ -528,6 +639,7 @@ gst_vaapi_encoder_vp8_init (GstVaapiEncoderVP8 * encoder)
   encoder->last_ref = NULL;
   encoder->golden_ref = NULL;
   encoder->alt_ref = NULL;
+  encoder->layer_shares = g_array_new (FALSE, FALSE, sizeof (guint));
 }
 
 static void
@@ -535,6 +647,7 @@ gst_vaapi_encoder_vp8_finalize (GObject * object)
 {
   GstVaapiEncoderVP8 *const encoder = GST_VAAPI_ENCODER_VP8 (object);
   clear_references (encoder);
+  g_array_unref (encoder->layer_shares);
   G_OBJECT_CLASS (gst_vaapi_encoder_vp8_parent_class)->finalize (object);
 }
 
@@ -544,6 +657,9 @@ gst_vaapi_encoder_vp8_finalize (GObject * object)
  * @ENCODER_VP8_PROP_LOOP_FILTER_LEVEL: Loop Filter Level(uint).
  * @ENCODER_VP8_PROP_LOOP_SHARPNESS_LEVEL: Sharpness Level(uint).
  * @ENCODER_VP8_PROP_YAC_Q_INDEX: Quantization table index for luma AC(uint).
+ * @ENCODER_VP8_PROP_TEMPORAL_LAYERS: Number of temporal layers (uint).
+ * @ENCODER_VP8_PROP_TEMPORAL_LAYER_SHARES: Share of the bitrate of each
+ *   temporal layer (#GstValueArray of uint).
  *
  * The set of VP8 encoder specific configurable properties.
  */
@@ -554,6 +670,8 @@ enum
   ENCODER_VP8_PROP_LOOP_FILTER_LEVEL,
   ENCODER_VP8_PROP_SHARPNESS_LEVEL,
   ENCODER_VP8_PROP_YAC_Q_INDEX,
+  ENCODER_VP8_PROP_TEMPORAL_LAYERS,
+  ENCODER_VP8_PROP_TEMPORAL_LAYER_SHARES,
   ENCODER_VP8_N_PROPERTIES
 };
 
@@ -589,6 +707,13 @@ gst_vaapi_encoder_vp8_set_property (GObject * object, guint prop_id,
     case ENCODER_VP8_PROP_YAC_Q_INDEX:
       encoder->yac_qi = g_value_get_uint (value);
       break;
+    case ENCODER_VP8_PROP_TEMPORAL_LAYERS:
+      encoder->temporal_layers = g_value_get_uint (value);
+      break;
+    case ENCODER_VP8_PROP_TEMPORAL_LAYER_SHARES:
+      gst_vaapi_value_get_temporal_layer_shares (value,
+          encoder->layer_shares);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -617,6 +742,13 @@ gst_vaapi_encoder_vp8_get_property (GObject * object, guint prop_id,
     case ENCODER_VP8_PROP_YAC_Q_INDEX:
       g_value_set_uint (value, encoder->yac_qi);
       break;
+    case ENCODER_VP8_PROP_TEMPORAL_LAYERS:
+      g_value_set_uint (value, encoder->temporal_layers);
+      break;
+    case ENCODER_VP8_PROP_TEMPORAL_LAYER_SHARES:
+      gst_vaapi_value_set_temporal_layer_shares (value,
+          encoder->layer_shares);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -679,6 +811,38 @@ gst_vaapi_encoder_vp8_class_init (GstVaapiEncoderVP8Class * klass)
       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
       GST_VAAPI_PARAM_ENCODER_EXPOSURE);
 
+  /**
+   * GstVaapiEncoderVP8:temporal-layers:
+   *
+   * Number of temporal layers. With more than one, the frames of the
+   * upper layers can be dropped without breaking the lower ones, and
+   * each coded buffer carries a #GST_VAAPI_TEMPORAL_LAYER_META_NAME
+   * meta.
+   */
+  properties[ENCODER_VP8_PROP_TEMPORAL_LAYERS] =
+      g_param_spec_uint ("temporal-layers", "Temporal Layers",
+      "Number of temporal layers", 1, GST_VAAPI_MAX_TEMPORAL_LAYERS,
+      DEFAULT_TEMPORAL_LAYERS,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
+  /**
+   * GstVaapiEncoderVP8:temporal-layer-shares:
+   *
+   * Share of the bitrate allocated to each temporal layer, from the
+   * base layer up, as relative weights. Empty for the default
+   * allocation.
+   */
+  properties[ENCODER_VP8_PROP_TEMPORAL_LAYER_SHARES] =
+      gst_param_spec_array ("temporal-layer-shares",
+      "Temporal Layer Shares",
+      "Share of the bitrate allocated to each temporal layer",
+      g_param_spec_uint ("temporal-layer-share", "Temporal Layer Share",
+          "Share of the bitrate of a temporal layer", 1, 100, 1,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS),
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
   g_object_class_install_properties (object_class, ENCODER_VP8_N_PROPERTIES,
       properties);
 
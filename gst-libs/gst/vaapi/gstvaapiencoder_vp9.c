@@ -56,6 +56,7 @@
 #define DEFAULT_LOOP_FILTER_LEVEL 10
 #define DEFAULT_SHARPNESS_LEVEL 0
 #define DEFAULT_YAC_QINDEX 60
+#define DEFAULT_TEMPORAL_LAYERS 1
 
 #define MAX_FRAME_WIDTH 4096
 #define MAX_FRAME_HEIGHT 4096
@@ -112,6 +113,14 @@ struct _GstVaapiEncoderVP9
   /* Bitrate contral parameters, CPB = Coded Picture Buffer */
   guint bitrate_bits;           /* bitrate (bits) */
   guint cpb_length;             /* length of CPB buffer (ms) */
+
+  /* temporal scalability, with the "last", "golden" and "alternate"
+     reference frames in the first three slots of ref_list */
+  guint temporal_layers;
+  GArray *layer_shares;
+  GstVaapiTemporalLayers layers;
+  guint layer_bitrates[GST_VAAPI_MAX_TEMPORAL_LAYERS];
+  const GstVaapiTemporalLayerFrame *layer_frame;
 };
 
 /* Estimates a good enough bitrate if none was supplied */
@@ -314,6 +323,56 @@ ensure_control_rate_params (GstVaapiEncoderVP9 * encoder)
   return TRUE;
 }
 
+static gboolean
+has_temporal_layers (GstVaapiEncoderVP9 * encoder)
+{
+  return encoder->temporal_layers > 1;
+}
+
+/* Sets up the temporal layer pattern, and splits the bitrate among the
+   layers */
+static void
+ensure_temporal_layers (GstVaapiEncoderVP9 * encoder)
+{
+  GstVaapiEncoder *const base_encoder = GST_VAAPI_ENCODER_CAST (encoder);
+
+  if (!has_temporal_layers (encoder))
+    return;
+
+  if (!gst_vaapi_temporal_layers_init (&encoder->layers,
+          encoder->temporal_layers)) {
+    GST_WARNING ("unsupported number of temporal layers %u, disabling them",
+        encoder->temporal_layers);
+    encoder->temporal_layers = 1;
+    return;
+  }
+
+  gst_vaapi_temporal_layers_get_bitrates (&encoder->layers,
+      base_encoder->bitrate, encoder->layer_shares, encoder->layer_bitrates);
+}
+
+/* Picks the temporal layer and the references of the next frame */
+static void
+set_temporal_layer (GstVaapiEncoderVP9 * encoder,
+    GstVaapiEncPicture * picture)
+{
+  gboolean layer_sync;
+
+  if (!has_temporal_layers (encoder)) {
+    encoder->layer_frame = NULL;
+    picture->temporal_id = 0;
+    return;
+  }
+
+  encoder->layer_frame = gst_vaapi_temporal_layers_next (&encoder->layers,
+      picture->type == GST_VAAPI_PICTURE_TYPE_I, &layer_sync);
+  picture->temporal_id = encoder->layer_frame->temporal_id;
+  picture->num_temporal_layers = encoder->temporal_layers;
+  if (layer_sync)
+    GST_VAAPI_ENC_PICTURE_FLAG_SET (picture,
+        GST_VAAPI_ENC_PICTURE_FLAG_LAYER_SYNC);
+}
+
 static gboolean
 ensure_misc_params (GstVaapiEncoderVP9 * encoder, GstVaapiEncPicture * picture)
 {
@@ -321,7 +380,12 @@ ensure_misc_params (GstVaapiEncoderVP9 * encoder, GstVaapiEncPicture * picture)
 
   if (!gst_vaapi_encoder_ensure_param_quality_level (base_encoder, picture))
     return FALSE;
-  if (!gst_vaapi_encoder_ensure_param_control_rate (base_encoder, picture))
+  if (has_temporal_layers (encoder)) {
+    if (!gst_vaapi_encoder_ensure_param_temporal_layers (base_encoder,
+            picture, &encoder->layers, encoder->layer_bitrates))
+      return FALSE;
+  } else if (!gst_vaapi_encoder_ensure_param_control_rate (base_encoder,
+          picture))
     return FALSE;
   return TRUE;
 }
@@ -386,7 +450,20 @@ fill_picture (GstVaapiEncoderVP9 * encoder,
 
   pic_param->pic_flags.bits.show_frame = 1;
 
-  if (picture->type == GST_VAAPI_PICTURE_TYPE_P) {
+  pic_param->ref_flags.bits.temporal_id = picture->temporal_id;
+
+  if (picture->type == GST_VAAPI_PICTURE_TYPE_P && encoder->layer_frame) {
+    pic_param->pic_flags.bits.frame_type = GST_VP9_INTER_FRAME;
+
+    /* the reference frame flags match ref_frame_ctrl_l0, and the
+       refresh flags the first three slots of refresh_frame_flags */
+    pic_param->ref_flags.bits.ref_frame_ctrl_l0 =
+        encoder->layer_frame->ref_flags;
+    pic_param->ref_flags.bits.ref_last_idx = 0;
+    pic_param->ref_flags.bits.ref_gf_idx = 1;
+    pic_param->ref_flags.bits.ref_arf_idx = 2;
+    pic_param->refresh_frame_flags = encoder->layer_frame->refresh_flags;
+  } else if (picture->type == GST_VAAPI_PICTURE_TYPE_P) {
     pic_param->pic_flags.bits.frame_type = GST_VP9_INTER_FRAME;
 
     /* use three of the reference frames (last, golden and altref)
@@ -448,6 +525,15 @@ update_ref_list (GstVaapiEncoderVP9 * encoder, GstVaapiEncPicture * picture,
     return;
   }
 
+  if (encoder->layer_frame) {
+    for (i = 0; i < 3; i++) {
+      if (encoder->layer_frame->refresh_flags & (1 << i))
+        gst_vaapi_surface_proxy_replace (&encoder->ref_list[i], ref);
+    }
+    gst_vaapi_surface_proxy_unref (ref);
+    return;
+  }
+
   switch (encoder->ref_pic_mode) {
     case GST_VAAPI_ENCODER_VP9_REF_PIC_MODE_0:
       gst_vaapi_surface_proxy_replace (&encoder->ref_list[0], ref);
@@ -477,6 +563,8 @@ gst_vaapi_encoder_vp9_encode (GstVaapiEncoder * base_encoder,
 
   g_assert (GST_VAAPI_SURFACE_PROXY_SURFACE (reconstruct));
 
+  set_temporal_layer (encoder, picture);
+
   if (!ensure_sequence (encoder, picture))
     goto error;
   if (!ensure_misc_params (encoder, picture))
@@ -561,6 +649,7 @@ gst_vaapi_encoder_vp9_reconfigure (GstVaapiEncoder * base_encoder)
   }
 
   ensure_control_rate_params (encoder);
+  ensure_temporal_layers (encoder);
   return set_context_info (base_encoder);
 }
 
@@ -588,6 +677,7 @@ gst_vaapi_encoder_vp9_init (GstVaapiEncoderVP9 * encoder)
   encoder->ref_list_idx = 0;
 
   encoder->allowed_profiles = NULL;
+  encoder->layer_shares = g_array_new (FALSE, FALSE, sizeof (guint));
 }
 
 static void
@@ -597,6 +687,7 @@ gst_vaapi_encoder_vp9_finalize (GObject * object)
 
   if (encoder->allowed_profiles)
     g_array_unref (encoder->allowed_profiles);
+  g_array_unref (encoder->layer_shares);
 
   G_OBJECT_CLASS (gst_vaapi_encoder_vp9_parent_class)->finalize (object);
 }
@@ -609,6 +700,9 @@ gst_vaapi_encoder_vp9_finalize (GObject * object)
  * @ENCODER_VP9_PROP_YAC_Q_INDEX: Quantization table index for luma AC
  * @ENCODER_VP9_PROP_REF_PIC_MODE: Reference picute selection modes
  * @ENCODER_VP9_PROP_CPB_LENGTH:Length of CPB buffer in milliseconds
+ * @ENCODER_VP9_PROP_TEMPORAL_LAYERS: Number of temporal layers (uint).
+ * @ENCODER_VP9_PROP_TEMPORAL_LAYER_SHARES: Share of the bitrate of each
+ *   temporal layer (#GstValueArray of uint).
  *
  * The set of VP9 encoder specific configurable properties.
  */
@@ -621,6 +715,8 @@ enum
   ENCODER_VP9_PROP_YAC_Q_INDEX,
   ENCODER_VP9_PROP_REF_PIC_MODE,
   ENCODER_VP9_PROP_CPB_LENGTH,
+  ENCODER_VP9_PROP_TEMPORAL_LAYERS,
+  ENCODER_VP9_PROP_TEMPORAL_LAYER_SHARES,
   ENCODER_VP9_N_PROPERTIES
 };
 
@@ -662,6 +758,13 @@ gst_vaapi_encoder_vp9_set_property (GObject * object, guint prop_id,
     case ENCODER_VP9_PROP_CPB_LENGTH:
       encoder->cpb_length = g_value_get_uint (value);
       break;
+    case ENCODER_VP9_PROP_TEMPORAL_LAYERS:
+      encoder->temporal_layers = g_value_get_uint (value);
+      break;
+    case ENCODER_VP9_PROP_TEMPORAL_LAYER_SHARES:
+      gst_vaapi_value_get_temporal_layer_shares (value,
+          encoder->layer_shares);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -696,6 +799,13 @@ gst_vaapi_encoder_vp9_get_property (GObject * object, guint prop_id,
     case ENCODER_VP9_PROP_CPB_LENGTH:
       g_value_set_uint (value, encoder->cpb_length);
       break;
+    case ENCODER_VP9_PROP_TEMPORAL_LAYERS:
+      g_value_set_uint (value, encoder->temporal_layers);
+      break;
+    case ENCODER_VP9_PROP_TEMPORAL_LAYER_SHARES:
+      gst_vaapi_value_set_temporal_layer_shares (value,
+          encoder->layer_shares);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -783,6 +893,38 @@ gst_vaapi_encoder_vp9_class_init (GstVaapiEncoderVP9Class * klass)
       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
       GST_VAAPI_PARAM_ENCODER_EXPOSURE);
 
+  /**
+   * GstVaapiEncoderVP9:temporal-layers:
+   *
+   * Number of temporal layers. With more than one, the frames of the
+   * upper layers can be dropped without breaking the lower ones, and
+   * each coded buffer carries a #GST_VAAPI_TEMPORAL_LAYER_META_NAME
+   * meta. The layer pattern overrides #GstVaapiEncoderVP9:ref-pic-mode.
+   */
+  properties[ENCODER_VP9_PROP_TEMPORAL_LAYERS] =
+      g_param_spec_uint ("temporal-layers", "Temporal Layers",
+      "Number of temporal layers", 1, GST_VAAPI_MAX_TEMPORAL_LAYERS,
+      DEFAULT_TEMPORAL_LAYERS,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
+  /**
+   * GstVaapiEncoderVP9:temporal-layer-shares:
+   *
+   * Share of the bitrate allocated to each temporal layer, from the
+   * base layer up, as relative weights. Empty for the default
+   * allocation.
+   */
+  properties[ENCODER_VP9_PROP_TEMPORAL_LAYER_SHARES] =
+      gst_param_spec_array ("temporal-layer-shares",
+      "Temporal Layer Shares",
+      "Share of the bitrate allocated to each temporal layer",
+      g_param_spec_uint ("temporal-layer-share", "Temporal Layer Share",
+          "Share of the bitrate of a temporal layer", 1, 100, 1,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS),
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
   g_object_class_install_properties (object_class, ENCODER_VP9_N_PROPERTIES,
       properties);
 
@@ -28,6 +28,7 @@
 #include "gstvaapiminiobject.h"
 #include "gstvaapidisplay_priv.h"
 #include "gstvaapisurface_priv.h"
+#include "gstvaapitrace.h"
 #include "gstvaapiutils_core.h"
 
 #define GST_VAAPI_FILTER_CAST(obj) \
@@ -58,6 +59,7 @@ struct _GstVaapiFilter
   VADisplay va_display;
   VAConfigID va_config;
   VAContextID va_context;
+  GRecMutex mutex;              /* protects va_context */
   GPtrArray *operations;
   GstVideoFormat format;
   GstVaapiScaleMethod scale_method;
@@ -78,6 +80,20 @@ struct _GstVaapiFilter
 #if VA_CHECK_VERSION(1,4,0)
   VAHdrMetaDataHDR10 hdr_meta;
 #endif
+
+  /* VPP pipeline parameters, only rebuilt when the setup changes */
+  VABufferID pipeline_buffer;
+  VAProcPipelineParameterBuffer pipeline_param;
+  VAProcPipelineCaps pipeline_caps;
+  GArray *pipeline_filters;
+  VARectangle pipeline_src_rect;
+  VARectangle pipeline_dst_rect;
+  guint pipeline_dirty:1;
+  guint pipeline_frames;
+  guint pipeline_rebuilds;
+  gint pipeline_rebuild_rate;
+
+  GstVaapiVaCallStats va_calls;
 };
 
 typedef struct _GstVaapiFilterClass GstVaapiFilterClass;
@@ -228,9 +244,9 @@ vpp_get_filters (GstVaapiFilter * filter, guint * num_filters_ptr)
 {
   VAProcFilterType *filters;
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
   filters = vpp_get_filters_unlocked (filter, num_filters_ptr);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
   return filters;
 }
 
@@ -279,9 +295,9 @@ vpp_get_filter_caps (GstVaapiFilter * filter, VAProcFilterType type,
 {
   gpointer caps;
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
   caps = vpp_get_filter_caps_unlocked (filter, type, cap_size, num_caps_ptr);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
   return caps;
 }
 
@@ -308,9 +324,9 @@ vpp_get_pipeline_caps_unlocked (GstVaapiFilter * filter)
 static void
 vpp_get_pipeline_caps (GstVaapiFilter * filter)
 {
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
   vpp_get_pipeline_caps_unlocked (filter);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -926,9 +942,10 @@ op_set_generic (GstVaapiFilter * filter, GstVaapiFilterOpData * op_data,
 {
   gboolean success = FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
+  filter->pipeline_dirty = TRUE;
   success = op_set_generic_unlocked (filter, op_data, value);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
   return success;
 }
 
@@ -1031,9 +1048,10 @@ op_set_color_balance (GstVaapiFilter * filter, GstVaapiFilterOpData * op_data,
 {
   gboolean success = FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
+  filter->pipeline_dirty = TRUE;
   success = op_set_color_balance_unlocked (filter, op_data, value);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
   return success;
 }
 
@@ -1080,9 +1098,10 @@ op_set_deinterlace (GstVaapiFilter * filter, GstVaapiFilterOpData * op_data,
 {
   gboolean success = FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
+  filter->pipeline_dirty = TRUE;
   success = op_set_deinterlace_unlocked (filter, op_data, method, flags);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
   return success;
 }
 
@@ -1113,9 +1132,10 @@ op_set_skintone_level (GstVaapiFilter * filter,
 {
   gboolean success = FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
+  filter->pipeline_dirty = TRUE;
   success = op_set_skintone_level_unlocked (filter, op_data, value);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
   return success;
 }
 
@@ -1142,9 +1162,10 @@ op_set_skintone (GstVaapiFilter * filter, GstVaapiFilterOpData * op_data,
 {
   gboolean success = FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
+  filter->pipeline_dirty = TRUE;
   success = op_set_skintone_unlocked (filter, op_data, enhance);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
   return success;
 }
 #endif
@@ -1189,9 +1210,10 @@ op_set_hdr_tone_map (GstVaapiFilter * filter, GstVaapiFilterOpData * op_data,
     gboolean value)
 {
   gboolean success = FALSE;
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
+  filter->pipeline_dirty = TRUE;
   success = op_set_hdr_tone_map_unlocked (filter, op_data, value);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
 
   return success;
 }
@@ -1272,12 +1294,18 @@ gst_vaapi_filter_init (GstVaapiFilter * filter)
   filter->va_config = VA_INVALID_ID;
   filter->va_context = VA_INVALID_ID;
   filter->format = DEFAULT_FORMAT;
+  g_rec_mutex_init (&filter->mutex);
 
   filter->forward_references =
       g_array_sized_new (FALSE, FALSE, sizeof (VASurfaceID), 4);
 
   filter->backward_references =
       g_array_sized_new (FALSE, FALSE, sizeof (VASurfaceID), 4);
+
+  filter->pipeline_buffer = VA_INVALID_ID;
+  filter->pipeline_filters = g_array_new (FALSE, FALSE, sizeof (VABufferID));
+  filter->pipeline_dirty = TRUE;
+  filter->pipeline_rebuild_rate = -1;
 }
 
 static gboolean
@@ -1313,7 +1341,7 @@ gst_vaapi_filter_finalize (GObject * object)
   if (!filter->display)
     goto bail;
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
   if (filter->operations) {
     for (i = 0; i < filter->operations->len; i++) {
       GstVaapiFilterOpData *const op_data =
@@ -1323,6 +1351,7 @@ gst_vaapi_filter_finalize (GObject * object)
     g_ptr_array_unref (filter->operations);
     filter->operations = NULL;
   }
+  vaapi_destroy_buffer (filter->va_display, &filter->pipeline_buffer);
 
   if (filter->va_context != VA_INVALID_ID) {
     vaDestroyContext (filter->va_display, filter->va_context);
@@ -1333,7 +1362,7 @@ gst_vaapi_filter_finalize (GObject * object)
     vaDestroyConfig (filter->va_display, filter->va_config);
     filter->va_config = VA_INVALID_ID;
   }
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
   gst_vaapi_display_replace (&filter->display, NULL);
 
 bail:
@@ -1352,6 +1381,13 @@ bail:
     filter->attribs = NULL;
   }
 
+  if (filter->pipeline_filters) {
+    g_array_unref (filter->pipeline_filters);
+    filter->pipeline_filters = NULL;
+  }
+
+  g_rec_mutex_clear (&filter->mutex);
+
   G_OBJECT_CLASS (gst_vaapi_filter_parent_class)->finalize (object);
 }
 
@@ -1648,6 +1684,84 @@ gst_vaapi_filter_fill_color_standards (GstVaapiFilter * filter,
 #endif
 }
 
+/* Builds the per-frame invariant part of the VPP pipeline parameters,
+ * unless the filter setup didn't change since the last frame */
+static gboolean
+ensure_pipeline (GstVaapiFilter * filter)
+{
+  VAProcPipelineParameterBuffer *const pipeline_param = &filter->pipeline_param;
+  guint i, va_mirror = 0, va_rotation = 0;
+  VAStatus va_status;
+
+  if (!filter->pipeline_dirty && filter->pipeline_buffer != VA_INVALID_ID)
+    return TRUE;
+
+  g_array_set_size (filter->pipeline_filters, 0);
+  for (i = 0; i < filter->operations->len; i++) {
+    GstVaapiFilterOpData *const op_data =
+        g_ptr_array_index (filter->operations, i);
+    if (!op_data->is_enabled)
+      continue;
+    if (op_data->va_buffer == VA_INVALID_ID) {
+      GST_ERROR ("invalid VA buffer for operation %s",
+          g_param_spec_get_name (op_data->pspec));
+      return FALSE;
+    }
+    g_array_append_val (filter->pipeline_filters, op_data->va_buffer);
+  }
+
+  /* Validate pipeline caps */
+  va_status = vaQueryVideoProcPipelineCaps (filter->va_display,
+      filter->va_context, (VABufferID *) filter->pipeline_filters->data,
+      filter->pipeline_filters->len, &filter->pipeline_caps);
+  if (!vaapi_check_status (va_status, "vaQueryVideoProcPipelineCaps()"))
+    return FALSE;
+
+  if (filter->pipeline_buffer == VA_INVALID_ID &&
+      !vaapi_create_buffer (filter->va_display, filter->va_context,
+          VAProcPipelineParameterBufferType, sizeof (*pipeline_param),
+          NULL, &filter->pipeline_buffer, NULL))
+    return FALSE;
+
+  memset (pipeline_param, 0, sizeof (*pipeline_param));
+  gst_vaapi_filter_fill_color_standards (filter, pipeline_param);
+
+  pipeline_param->surface_region = &filter->pipeline_src_rect;
+  pipeline_param->output_region = &filter->pipeline_dst_rect;
+  pipeline_param->output_background_color = 0xff000000;
+  pipeline_param->filters = (VABufferID *) filter->pipeline_filters->data;
+  pipeline_param->num_filters = filter->pipeline_filters->len;
+
+  from_GstVideoOrientationMethod (filter->video_direction, &va_mirror,
+      &va_rotation);
+
+#if VA_CHECK_VERSION(1,1,0)
+  pipeline_param->mirror_state = va_mirror;
+  pipeline_param->rotation_state = va_rotation;
+#endif
+
+  filter->pipeline_dirty = FALSE;
+  filter->pipeline_rebuilds++;
+  GST_DEBUG_OBJECT (filter, "rebuilt VPP pipeline with %u filters",
+      filter->pipeline_filters->len);
+  return TRUE;
+}
+
+/* Accounts one processed frame, and updates the number of pipeline
+ * rebuilds per 1000 frames */
+static void
+pipeline_count_frame (GstVaapiFilter * filter)
+{
+  if (++filter->pipeline_frames < 1000)
+    return;
+
+  filter->pipeline_rebuild_rate = filter->pipeline_rebuilds;
+  filter->pipeline_frames = 0;
+  filter->pipeline_rebuilds = 0;
+  GST_DEBUG_OBJECT (filter, "%d pipeline rebuilds over the last 1000 frames",
+      filter->pipeline_rebuild_rate);
+}
+
 /**
  * gst_vaapi_filter_process:
  * @filter: a #GstVaapiFilter
@@ -1667,14 +1781,11 @@ static GstVaapiFilterStatus
 gst_vaapi_filter_process_unlocked (GstVaapiFilter * filter,
     GstVaapiSurface * src_surface, GstVaapiSurface * dst_surface, guint flags)
 {
-  VAProcPipelineParameterBuffer *pipeline_param = NULL;
-  VABufferID pipeline_param_buf_id = VA_INVALID_ID;
-  VABufferID filters[N_PROPERTIES];
-  VAProcPipelineCaps pipeline_caps;
-  guint i, num_filters = 0;
+  VAProcPipelineParameterBuffer *pipeline_param;
+  const VAProcPipelineCaps *const pipeline_caps = &filter->pipeline_caps;
+  VARectangle *const src_rect = &filter->pipeline_src_rect;
+  VARectangle *const dst_rect = &filter->pipeline_dst_rect;
   VAStatus va_status;
-  VARectangle src_rect, dst_rect;
-  guint va_mirror = 0, va_rotation = 0;
 
   if (!ensure_operations (filter))
     return GST_VAAPI_FILTER_STATUS_ERROR_ALLOCATION_FAILED;
@@ -1689,15 +1800,15 @@ gst_vaapi_filter_process_unlocked (GstVaapiFilter * filter,
             GST_VAAPI_SURFACE_HEIGHT (src_surface)))
       goto error;
 
-    src_rect.x = crop_rect->x;
-    src_rect.y = crop_rect->y;
-    src_rect.width = crop_rect->width;
-    src_rect.height = crop_rect->height;
+    src_rect->x = crop_rect->x;
+    src_rect->y = crop_rect->y;
+    src_rect->width = crop_rect->width;
+    src_rect->height = crop_rect->height;
   } else {
-    src_rect.x = 0;
-    src_rect.y = 0;
-    src_rect.width = GST_VAAPI_SURFACE_WIDTH (src_surface);
-    src_rect.height = GST_VAAPI_SURFACE_HEIGHT (src_surface);
+    src_rect->x = 0;
+    src_rect->y = 0;
+    src_rect->width = GST_VAAPI_SURFACE_WIDTH (src_surface);
+    src_rect->height = GST_VAAPI_SURFACE_HEIGHT (src_surface);
   }
 
   /* Build output region (target) */
@@ -1710,61 +1821,30 @@ gst_vaapi_filter_process_unlocked (GstVaapiFilter * filter,
             GST_VAAPI_SURFACE_HEIGHT (dst_surface)))
       goto error;
 
-    dst_rect.x = target_rect->x;
-    dst_rect.y = target_rect->y;
-    dst_rect.width = target_rect->width;
-    dst_rect.height = target_rect->height;
+    dst_rect->x = target_rect->x;
+    dst_rect->y = target_rect->y;
+    dst_rect->width = target_rect->width;
+    dst_rect->height = target_rect->height;
   } else {
-    dst_rect.x = 0;
-    dst_rect.y = 0;
-    dst_rect.width = GST_VAAPI_SURFACE_WIDTH (dst_surface);
-    dst_rect.height = GST_VAAPI_SURFACE_HEIGHT (dst_surface);
-  }
-
-  for (i = 0, num_filters = 0; i < filter->operations->len; i++) {
-    GstVaapiFilterOpData *const op_data =
-        g_ptr_array_index (filter->operations, i);
-    if (!op_data->is_enabled)
-      continue;
-    if (op_data->va_buffer == VA_INVALID_ID) {
-      GST_ERROR ("invalid VA buffer for operation %s",
-          g_param_spec_get_name (op_data->pspec));
-      goto error;
-    }
-    filters[num_filters++] = op_data->va_buffer;
+    dst_rect->x = 0;
+    dst_rect->y = 0;
+    dst_rect->width = GST_VAAPI_SURFACE_WIDTH (dst_surface);
+    dst_rect->height = GST_VAAPI_SURFACE_HEIGHT (dst_surface);
   }
 
-  /* Validate pipeline caps */
-  va_status = vaQueryVideoProcPipelineCaps (filter->va_display,
-      filter->va_context, filters, num_filters, &pipeline_caps);
-  if (!vaapi_check_status (va_status, "vaQueryVideoProcPipelineCaps()"))
-    goto error;
+  if (!ensure_pipeline (filter))
+    goto error_pipeline;
 
-  if (!vaapi_create_buffer (filter->va_display, filter->va_context,
-          VAProcPipelineParameterBufferType, sizeof (*pipeline_param),
-          NULL, &pipeline_param_buf_id, (gpointer *) & pipeline_param))
-    goto error;
+  pipeline_param = vaapi_map_buffer (filter->va_display,
+      filter->pipeline_buffer);
+  if (!pipeline_param)
+    goto error_pipeline;
 
-  memset (pipeline_param, 0, sizeof (*pipeline_param));
+  /* Only patch the per-frame fields into the cached parameters */
+  *pipeline_param = filter->pipeline_param;
   pipeline_param->surface = GST_VAAPI_SURFACE_ID (src_surface);
-  pipeline_param->surface_region = &src_rect;
-
-  gst_vaapi_filter_fill_color_standards (filter, pipeline_param);
-
-  pipeline_param->output_region = &dst_rect;
-  pipeline_param->output_background_color = 0xff000000;
   pipeline_param->filter_flags = from_GstVaapiSurfaceRenderFlags (flags) |
       from_GstVaapiScaleMethod (filter->scale_method);
-  pipeline_param->filters = filters;
-  pipeline_param->num_filters = num_filters;
-
-  from_GstVideoOrientationMethod (filter->video_direction, &va_mirror,
-      &va_rotation);
-
-#if VA_CHECK_VERSION(1,1,0)
-  pipeline_param->mirror_state = va_mirror;
-  pipeline_param->rotation_state = va_rotation;
-#endif
 
   // Reference frames for advanced deinterlacing
   if (filter->forward_references->len > 0) {
@@ -1772,10 +1852,7 @@ gst_vaapi_filter_process_unlocked (GstVaapiFilter * filter,
         filter->forward_references->data;
     pipeline_param->num_forward_references =
         MIN (filter->forward_references->len,
-        pipeline_caps.num_forward_references);
-  } else {
-    pipeline_param->forward_references = NULL;
-    pipeline_param->num_forward_references = 0;
+        pipeline_caps->num_forward_references);
   }
 
   if (filter->backward_references->len > 0) {
@@ -1783,37 +1860,43 @@ gst_vaapi_filter_process_unlocked (GstVaapiFilter * filter,
         filter->backward_references->data;
     pipeline_param->num_backward_references =
         MIN (filter->backward_references->len,
-        pipeline_caps.num_backward_references);
-  } else {
-    pipeline_param->backward_references = NULL;
-    pipeline_param->num_backward_references = 0;
+        pipeline_caps->num_backward_references);
   }
 
-  vaapi_unmap_buffer (filter->va_display, pipeline_param_buf_id, NULL);
+  vaapi_unmap_buffer (filter->va_display, filter->pipeline_buffer, NULL);
 
-  va_status = vaBeginPicture (filter->va_display, filter->va_context,
-      GST_VAAPI_SURFACE_ID (dst_surface));
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_BEGIN_PICTURE, va_status,
+      vaBeginPicture (filter->va_display, filter->va_context,
+          GST_VAAPI_SURFACE_ID (dst_surface)));
   if (!vaapi_check_status (va_status, "vaBeginPicture()"))
-    goto error;
+    goto error_pipeline;
 
-  va_status = vaRenderPicture (filter->va_display, filter->va_context,
-      &pipeline_param_buf_id, 1);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_RENDER_PICTURE, va_status,
+      vaRenderPicture (filter->va_display, filter->va_context,
+          &filter->pipeline_buffer, 1));
   if (!vaapi_check_status (va_status, "vaRenderPicture()"))
-    goto error;
+    goto error_pipeline;
 
-  va_status = vaEndPicture (filter->va_display, filter->va_context);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_END_PICTURE, va_status,
+      vaEndPicture (filter->va_display, filter->va_context));
   if (!vaapi_check_status (va_status, "vaEndPicture()"))
-    goto error;
+    goto error_pipeline;
 
   deint_refs_clear_all (filter);
-  vaapi_destroy_buffer (filter->va_display, &pipeline_param_buf_id);
+  pipeline_count_frame (filter);
   return GST_VAAPI_FILTER_STATUS_SUCCESS;
 
   /* ERRORS */
+error_pipeline:
+  {
+    /* start over from a fresh parameter buffer */
+    vaapi_destroy_buffer (filter->va_display, &filter->pipeline_buffer);
+    filter->pipeline_dirty = TRUE;
+    /* fall-through */
+  }
 error:
   {
     deint_refs_clear_all (filter);
-    vaapi_destroy_buffer (filter->va_display, &pipeline_param_buf_id);
     return GST_VAAPI_FILTER_STATUS_ERROR_OPERATION_FAILED;
   }
 }
@@ -1831,10 +1914,16 @@ gst_vaapi_filter_process (GstVaapiFilter * filter,
   g_return_val_if_fail (dst_surface != NULL,
       GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER);
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  gst_vaapi_va_calls_add_frame (&filter->va_calls);
+  gst_vaapi_va_calls_push (&filter->va_calls);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
   status = gst_vaapi_filter_process_unlocked (filter,
       src_surface, dst_surface, flags);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
+  gst_vaapi_va_calls_pop ();
+
+  if (status == GST_VAAPI_FILTER_STATUS_SUCCESS)
+    GST_VAAPI_TRACE (GST_VAAPI_TRACE_VPP, filter, GST_CLOCK_TIME_NONE);
   return status;
 }
 
@@ -2195,6 +2284,7 @@ gst_vaapi_filter_set_scaling (GstVaapiFilter * filter,
   g_return_val_if_fail (filter != NULL, FALSE);
 
   filter->scale_method = method;
+  filter->pipeline_dirty = TRUE;
   return TRUE;
 }
 
@@ -2272,6 +2362,7 @@ gst_vaapi_filter_set_video_direction (GstVaapiFilter * filter,
 #endif
 
   filter->video_direction = method;
+  filter->pipeline_dirty = TRUE;
   return TRUE;
 }
 
@@ -2356,6 +2447,8 @@ gst_vaapi_filter_set_colorimetry_unlocked (GstVaapiFilter * filter,
 {
   gchar *in_color, *out_color;
 
+  filter->pipeline_dirty = TRUE;
+
   if (input)
     filter->input_colorimetry = *input;
   else
@@ -2423,13 +2516,41 @@ gst_vaapi_filter_set_colorimetry (GstVaapiFilter * filter,
 
   g_return_val_if_fail (filter != NULL, FALSE);
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
   result = gst_vaapi_filter_set_colorimetry_unlocked (filter, input, output);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
 
   return result;
 }
 
+/**
+ * gst_vaapi_filter_get_pipeline_rebuild_rate:
+ * @filter: a #GstVaapiFilter
+ *
+ * Retrieves how many times the VPP pipeline parameters had to be
+ * rebuilt, because the filter setup changed, over the last 1000
+ * processed frames. Before 1000 frames were processed, this is the
+ * number of rebuilds so far.
+ *
+ * Return value: the number of pipeline rebuilds per 1000 frames
+ */
+guint
+gst_vaapi_filter_get_pipeline_rebuild_rate (GstVaapiFilter * filter)
+{
+  guint rate;
+
+  g_return_val_if_fail (filter != NULL, 0);
+
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
+  if (filter->pipeline_rebuild_rate < 0)
+    rate = filter->pipeline_rebuilds;
+  else
+    rate = filter->pipeline_rebuild_rate;
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
+
+  return rate;
+}
+
 /**
  * gst_vaapi_filter_set_hdr_tone_map:
  * @filter: a #GstVaapiFilter
@@ -2518,10 +2639,27 @@ gst_vaapi_filter_set_hdr_tone_map_meta (GstVaapiFilter * filter,
   g_return_val_if_fail (minfo != NULL, FALSE);
   g_return_val_if_fail (linfo != NULL, FALSE);
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->mutex);
   status =
       gst_vaapi_filter_set_hdr_tone_map_meta_unlocked (filter, minfo, linfo);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->mutex);
 
   return status;
 }
+
+/**
+ * gst_vaapi_filter_get_va_call_stats:
+ * @filter: a #GstVaapiFilter
+ * @stats: (out caller-allocates): return location for the statistics
+ *
+ * Retrieves the VA calls issued by the @filter, and the number of
+ * frames it processed, while the VA call accounting was enabled.
+ */
+void
+gst_vaapi_filter_get_va_call_stats (GstVaapiFilter * filter,
+    GstVaapiVaCallStats * stats)
+{
+  g_return_if_fail (filter != NULL);
+
+  gst_vaapi_va_calls_get_stats (&filter->va_calls, stats);
+}
@@ -24,6 +24,7 @@
 #define GST_VAAPI_FILTER_H
 
 #include <gst/vaapi/gstvaapisurface.h>
+#include <gst/vaapi/gstvaapivacalls.h>
 #include <gst/vaapi/video-format.h>
 
 G_BEGIN_DECLS
@@ -320,6 +321,13 @@ gboolean
 gst_vaapi_filter_set_colorimetry (GstVaapiFilter * filter,
     GstVideoColorimetry * input, GstVideoColorimetry * output);
 
+guint
+gst_vaapi_filter_get_pipeline_rebuild_rate (GstVaapiFilter * filter);
+
+void
+gst_vaapi_filter_get_va_call_stats (GstVaapiFilter * filter,
+    GstVaapiVaCallStats * stats);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GstVaapiFilter, gst_object_unref)
 
 #endif /* GST_VAAPI_FILTER_H */
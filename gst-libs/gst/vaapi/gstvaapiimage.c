@@ -131,7 +131,8 @@ gst_vaapi_image_free (GstVaapiImage * image)
 
   if (image_id != VA_INVALID_ID) {
     GST_VAAPI_DISPLAY_LOCK (display);
-    status = vaDestroyImage (GST_VAAPI_DISPLAY_VADISPLAY (display), image_id);
+    GST_VAAPI_VA_CALL (GST_VAAPI_VA_DESTROY_IMAGE, status,
+        vaDestroyImage (GST_VAAPI_DISPLAY_VADISPLAY (display), image_id));
     GST_VAAPI_DISPLAY_UNLOCK (display);
     if (!vaapi_check_status (status, "vaDestroyImage()"))
       GST_WARNING ("failed to destroy image %" GST_VAAPI_ID_FORMAT,
@@ -159,9 +160,10 @@ _gst_vaapi_image_create (GstVaapiImage * image, GstVideoFormat format)
     return FALSE;
 
   GST_VAAPI_DISPLAY_LOCK (display);
-  status = vaCreateImage (GST_VAAPI_DISPLAY_VADISPLAY (display),
-      (VAImageFormat *) va_format,
-      image->width, image->height, &image->internal_image);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_CREATE_IMAGE, status,
+      vaCreateImage (GST_VAAPI_DISPLAY_VADISPLAY (display),
+          (VAImageFormat *) va_format,
+          image->width, image->height, &image->internal_image));
   GST_VAAPI_DISPLAY_UNLOCK (display);
   if (status != VA_STATUS_SUCCESS ||
       image->internal_image.format.fourcc != va_format->fourcc)
@@ -589,8 +591,9 @@ _gst_vaapi_image_map (GstVaapiImage * image, GstVaapiImageRaw * raw_image)
     return FALSE;
 
   GST_VAAPI_DISPLAY_LOCK (display);
-  status = vaMapBuffer (GST_VAAPI_DISPLAY_VADISPLAY (display),
-      image->image.buf, (void **) &image->image_data);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_MAP_BUFFER, status,
+      vaMapBuffer (GST_VAAPI_DISPLAY_VADISPLAY (display),
+          image->image.buf, (void **) &image->image_data));
   GST_VAAPI_DISPLAY_UNLOCK (display);
   if (!vaapi_check_status (status, "vaMapBuffer()"))
     return FALSE;
@@ -642,8 +645,9 @@ _gst_vaapi_image_unmap (GstVaapiImage * image)
     return FALSE;
 
   GST_VAAPI_DISPLAY_LOCK (display);
-  status = vaUnmapBuffer (GST_VAAPI_DISPLAY_VADISPLAY (display),
-      image->image.buf);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_UNMAP_BUFFER, status,
+      vaUnmapBuffer (GST_VAAPI_DISPLAY_VADISPLAY (display),
+          image->image.buf));
   GST_VAAPI_DISPLAY_UNLOCK (display);
   if (!vaapi_check_status (status, "vaUnmapBuffer()"))
     return FALSE;
@@ -1039,6 +1043,29 @@ gst_vaapi_image_update_from_raw (GstVaapiImage * image,
   return success;
 }
 
+/**
+ * gst_vaapi_image_raw_copy:
+ * @dst_image: the target #GstVaapiImageRaw
+ * @src_image: the source #GstVaapiImageRaw
+ * @rect: a #GstVaapiRectangle expressing a region, or %NULL for the
+ *   whole image
+ *
+ * Copies pixels data between two system memory images, as done when
+ * transferring from or to a mapped #GstVaapiImage. Both image
+ * structures shall have the same format and size.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+gst_vaapi_image_raw_copy (GstVaapiImageRaw * dst_image,
+    GstVaapiImageRaw * src_image, const GstVaapiRectangle * rect)
+{
+  g_return_val_if_fail (dst_image != NULL, FALSE);
+  g_return_val_if_fail (src_image != NULL, FALSE);
+
+  return copy_image (dst_image, src_image, rect);
+}
+
 /**
  * gst_vaapi_image_copy:
  * @dst_image: the target #GstVaapiImage
@@ -134,6 +134,14 @@ gst_vaapi_image_update_from_raw(
     GstVaapiRectangle *rect
 );
 
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_image_raw_copy(
+    GstVaapiImageRaw        *dst_image,
+    GstVaapiImageRaw        *src_image,
+    const GstVaapiRectangle *rect
+);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_IMAGE_PRIV_H */
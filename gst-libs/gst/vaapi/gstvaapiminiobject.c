@@ -23,6 +23,241 @@
 #include <string.h>
 #include "gstvaapiminiobject.h"
 
+/* Maximum number of released objects kept around per class */
+#define MINI_OBJECT_SLAB_MAX_FREE 64
+
+/* Number of slots of the table of slabs, a power of two well above
+   the number of mini object classes */
+#define MINI_OBJECT_SLAB_TABLE_SIZE 256
+
+/* ------------------------------------------------------------------------- */
+/* --- Slab allocator                                                    --- */
+/* ------------------------------------------------------------------------- */
+
+/* Mini objects are created and destroyed for every frame or slice
+ * (pictures, slices, parameter buffers, parser info, ...). Released
+ * objects are thus kept in a per-class free list, chained through
+ * their first word, so that they can be reused for the next frame
+ * without going through the memory allocator again.
+ *
+ * The slabs are looked up without any lock, in an open addressing
+ * table that is only ever appended to, and each of them is protected
+ * by its own bit lock, so that the threads working on objects of
+ * different classes never wait for each other. */
+typedef struct _GstVaapiMiniObjectSlab GstVaapiMiniObjectSlab;
+struct _GstVaapiMiniObjectSlab
+{
+  gconstpointer object_class;
+  guint size;
+  gint lock;
+  gpointer free_list;
+  GstVaapiMiniObjectStats stats;
+};
+
+static GstVaapiMiniObjectSlab *slab_table[MINI_OBJECT_SLAB_TABLE_SIZE];
+
+#define SLAB_LOCK_BIT 0
+
+static inline void
+slab_lock (GstVaapiMiniObjectSlab * slab)
+{
+  g_bit_lock (&slab->lock, SLAB_LOCK_BIT);
+}
+
+static inline void
+slab_unlock (GstVaapiMiniObjectSlab * slab)
+{
+  g_bit_unlock (&slab->lock, SLAB_LOCK_BIT);
+}
+
+/* Returns the slab of @object_class, creating it if @create is set,
+   or %NULL if the table is full */
+static GstVaapiMiniObjectSlab *
+slab_lookup (const GstVaapiMiniObjectClass * object_class, gboolean create)
+{
+  GstVaapiMiniObjectSlab *slab, *new_slab = NULL;
+  guint i, index;
+
+  index = (GPOINTER_TO_SIZE (object_class) >> 3) * 2654435761U;
+  for (i = 0; i < MINI_OBJECT_SLAB_TABLE_SIZE; i++, index++) {
+    index &= MINI_OBJECT_SLAB_TABLE_SIZE - 1;
+    slab = g_atomic_pointer_get (&slab_table[index]);
+    if (!slab) {
+      if (!create)
+        break;
+      if (!new_slab) {
+        new_slab = g_new0 (GstVaapiMiniObjectSlab, 1);
+        new_slab->object_class = object_class;
+        new_slab->size = object_class->size;
+      }
+      if (g_atomic_pointer_compare_and_exchange (&slab_table[index], NULL,
+              new_slab))
+        return new_slab;
+      /* another thread took the slot first */
+      slab = g_atomic_pointer_get (&slab_table[index]);
+    }
+    if (slab->object_class == object_class) {
+      g_free (new_slab);
+      return slab;
+    }
+  }
+  g_free (new_slab);
+  return NULL;
+}
+
+static void
+slab_update_peak_unlocked (GstVaapiMiniObjectSlab * slab)
+{
+  GstVaapiMiniObjectStats *const stats = &slab->stats;
+  const gsize footprint = (gsize) (stats->n_live + stats->n_free) * slab->size;
+
+  if (stats->peak_live < stats->n_live)
+    stats->peak_live = stats->n_live;
+  if (stats->peak_footprint < footprint)
+    stats->peak_footprint = footprint;
+}
+
+static gpointer
+slab_alloc (const GstVaapiMiniObjectClass * object_class)
+{
+  GstVaapiMiniObjectSlab *slab;
+  gpointer object;
+
+  slab = slab_lookup (object_class, TRUE);
+  if (G_UNLIKELY (!slab))
+    return g_slice_alloc (object_class->size);
+
+  slab_lock (slab);
+  object = slab->free_list;
+  if (object) {
+    slab->free_list = *(gpointer *) object;
+    slab->stats.n_free--;
+  } else
+    slab->stats.n_allocs++;
+  slab->stats.n_requests++;
+  slab->stats.n_live++;
+  slab_update_peak_unlocked (slab);
+  slab_unlock (slab);
+
+  if (!object)
+    object = g_slice_alloc (slab->size);
+  return object;
+}
+
+static void
+slab_free (const GstVaapiMiniObjectClass * object_class, gpointer object)
+{
+  GstVaapiMiniObjectSlab *slab;
+
+  slab = slab_lookup (object_class, FALSE);
+  if (G_LIKELY (slab)) {
+    slab_lock (slab);
+    slab->stats.n_live--;
+    if (slab->stats.n_free < MINI_OBJECT_SLAB_MAX_FREE) {
+      *(gpointer *) object = slab->free_list;
+      slab->free_list = object;
+      slab->stats.n_free++;
+      object = NULL;
+    }
+    slab_unlock (slab);
+  }
+
+  if (object)
+    g_slice_free1 (object_class->size, object);
+}
+
+static void
+slab_trim (GstVaapiMiniObjectSlab * slab)
+{
+  gpointer object, next;
+
+  slab_lock (slab);
+  object = slab->free_list;
+  slab->free_list = NULL;
+  slab->stats.n_free = 0;
+  slab_unlock (slab);
+
+  for (; object; object = next) {
+    next = *(gpointer *) object;
+    g_slice_free1 (slab->size, object);
+  }
+}
+
+static void
+stats_accumulate (GstVaapiMiniObjectStats * dst,
+    const GstVaapiMiniObjectStats * src)
+{
+  dst->n_live += src->n_live;
+  dst->n_free += src->n_free;
+  dst->peak_live += src->peak_live;
+  dst->peak_footprint += src->peak_footprint;
+  dst->n_requests += src->n_requests;
+  dst->n_allocs += src->n_allocs;
+}
+
+/**
+ * gst_vaapi_mini_object_get_stats:
+ * @object_class: (optional): the object class to query
+ * @stats: (out caller-allocates): the resulting #GstVaapiMiniObjectStats
+ *
+ * Fills in @stats with the allocation statistics of the objects of
+ * class @object_class. If @object_class is %NULL, the statistics of
+ * all classes are accumulated.
+ */
+void
+gst_vaapi_mini_object_get_stats (const GstVaapiMiniObjectClass * object_class,
+    GstVaapiMiniObjectStats * stats)
+{
+  GstVaapiMiniObjectSlab *slab;
+  guint i;
+
+  g_return_if_fail (stats != NULL);
+
+  memset (stats, 0, sizeof (*stats));
+
+  if (object_class) {
+    slab = slab_lookup (object_class, FALSE);
+    if (slab) {
+      slab_lock (slab);
+      *stats = slab->stats;
+      slab_unlock (slab);
+    }
+    return;
+  }
+
+  for (i = 0; i < MINI_OBJECT_SLAB_TABLE_SIZE; i++) {
+    slab = g_atomic_pointer_get (&slab_table[i]);
+    if (!slab)
+      continue;
+    slab_lock (slab);
+    stats_accumulate (stats, &slab->stats);
+    slab_unlock (slab);
+  }
+}
+
+/**
+ * gst_vaapi_mini_object_trim:
+ *
+ * Releases all the cached objects kept for reuse, of any class, back
+ * to the system. Live objects are not affected.
+ */
+void
+gst_vaapi_mini_object_trim (void)
+{
+  GstVaapiMiniObjectSlab *slab;
+  guint i;
+
+  for (i = 0; i < MINI_OBJECT_SLAB_TABLE_SIZE; i++) {
+    slab = g_atomic_pointer_get (&slab_table[i]);
+    if (slab)
+      slab_trim (slab);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Mini objects                                                      --- */
+/* ------------------------------------------------------------------------- */
+
 static void
 gst_vaapi_mini_object_free (GstVaapiMiniObject * object)
 {
@@ -34,7 +269,7 @@ gst_vaapi_mini_object_free (GstVaapiMiniObject * object)
     klass->finalize (object);
 
   if (G_LIKELY (g_atomic_int_dec_and_test (&object->ref_count)))
-    g_slice_free1 (klass->size, object);
+    slab_free (klass, object);
 }
 
 /**
@@ -46,7 +281,8 @@ gst_vaapi_mini_object_free (GstVaapiMiniObject * object)
  * If @object_class is not NULL, typically when a sub-class is implemented,
  * that pointer shall reference a statically allocated descriptor.
  *
- * This function does *not* zero-initialize the derived object data,
+ * Objects are recycled from a per-class free list when available, so
+ * this function does *not* zero-initialize the derived object data,
  * use gst_vaapi_mini_object_new0() to fill this purpose.
  *
  * Returns: The newly allocated #GstVaapiMiniObject
@@ -65,7 +301,7 @@ gst_vaapi_mini_object_new (const GstVaapiMiniObjectClass * object_class)
 
   g_return_val_if_fail (object_class->size >= sizeof (*object), NULL);
 
-  object = g_slice_alloc (object_class->size);
+  object = slab_alloc (object_class);
   if (!object)
     return NULL;
 
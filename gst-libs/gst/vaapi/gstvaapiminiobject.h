@@ -29,6 +29,7 @@ G_BEGIN_DECLS
 
 typedef struct _GstVaapiMiniObject              GstVaapiMiniObject;
 typedef struct _GstVaapiMiniObjectClass         GstVaapiMiniObjectClass;
+typedef struct _GstVaapiMiniObjectStats         GstVaapiMiniObjectStats;
 
 /**
  * GST_VAAPI_MINI_OBJECT:
@@ -141,6 +142,27 @@ struct _GstVaapiMiniObjectClass
   GDestroyNotify finalize;
 };
 
+/**
+ * GstVaapiMiniObjectStats:
+ * @n_live: number of objects currently in use
+ * @n_free: number of released objects kept for reuse
+ * @peak_live: maximum number of objects in use at the same time
+ * @peak_footprint: maximum memory held (live + cached), in bytes
+ * @n_requests: total number of objects created
+ * @n_allocs: number of objects that required a new memory allocation
+ *
+ * Allocation statistics of #GstVaapiMiniObject classes.
+ */
+struct _GstVaapiMiniObjectStats
+{
+  guint n_live;
+  guint n_free;
+  guint peak_live;
+  gsize peak_footprint;
+  guint64 n_requests;
+  guint64 n_allocs;
+};
+
 GstVaapiMiniObject *
 gst_vaapi_mini_object_new (const GstVaapiMiniObjectClass * object_class);
 
@@ -157,6 +179,13 @@ void
 gst_vaapi_mini_object_replace (GstVaapiMiniObject ** old_object_ptr,
     GstVaapiMiniObject * new_object);
 
+void
+gst_vaapi_mini_object_get_stats (const GstVaapiMiniObjectClass * object_class,
+    GstVaapiMiniObjectStats * stats);
+
+void
+gst_vaapi_mini_object_trim (void);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_MINI_OBJECT_H */
@@ -0,0 +1,297 @@
+/*
+ *  gstvaapisubpicturecache.c - VA subpicture cache
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:gstvaapisubpicturecache
+ * @short_description: VA subpicture cache for overlay rectangles
+ *
+ * Overlay compositions (subtitles, OSD) usually carry the very same
+ * #GstVideoOverlayRectangle over many frames. A #GstVaapiSubpictureCache
+ * keeps the subpictures uploaded for recent rectangles, so that they
+ * only need to be associated again with the next surfaces.
+ *
+ * Entries are keyed by the rectangle seqnum, which changes whenever
+ * its pixels or its global alpha change, and are checked against the
+ * identity of the rectangle pixel buffer. The least recently used
+ * entries are evicted once the cached pixel data exceeds the maximum
+ * size.
+ */
+
+#include "sysdeps.h"
+#include "gstvaapisubpicturecache.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+typedef struct _GstVaapiSubpictureCacheEntry GstVaapiSubpictureCacheEntry;
+struct _GstVaapiSubpictureCacheEntry
+{
+  guint seqnum;
+  GstVaapiDisplay *display;     /* not referenced, subpicture holds it */
+  gconstpointer pixels;         /* identity only, never dereferenced */
+  guint flags;
+  gfloat global_alpha;
+  gsize size;
+  GstVaapiSubpicture *subpicture;
+  GList link;
+};
+
+/**
+ * GstVaapiSubpictureCache:
+ *
+ * A bounded cache of VA subpictures made from overlay rectangles.
+ */
+struct _GstVaapiSubpictureCache
+{
+  GstObject parent_instance;
+
+  /*< private > */
+  GMutex lock;
+  GHashTable *entries;
+  GQueue lru;                   /* most recently used first */
+  gsize max_size;
+  GstVaapiSubpictureCacheStats stats;
+};
+
+/**
+ * GstVaapiSubpictureCacheClass:
+ *
+ * A bounded cache of VA subpictures made from overlay rectangles.
+ */
+struct _GstVaapiSubpictureCacheClass
+{
+  GstObjectClass parent_class;
+};
+
+G_DEFINE_TYPE (GstVaapiSubpictureCache, gst_vaapi_subpicture_cache,
+    GST_TYPE_OBJECT);
+
+static void
+entry_free (GstVaapiSubpictureCacheEntry * entry)
+{
+  gst_vaapi_subpicture_unref (entry->subpicture);
+  g_slice_free (GstVaapiSubpictureCacheEntry, entry);
+}
+
+static void
+cache_remove_entry (GstVaapiSubpictureCache * cache,
+    GstVaapiSubpictureCacheEntry * entry)
+{
+  g_queue_unlink (&cache->lru, &entry->link);
+  cache->stats.size -= entry->size;
+  cache->stats.num_entries--;
+  g_hash_table_remove (cache->entries, GUINT_TO_POINTER (entry->seqnum));
+}
+
+static void
+gst_vaapi_subpicture_cache_init (GstVaapiSubpictureCache * cache)
+{
+  g_mutex_init (&cache->lock);
+  cache->entries = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) entry_free);
+  g_queue_init (&cache->lru);
+  cache->max_size = GST_VAAPI_SUBPICTURE_CACHE_DEFAULT_MAX_SIZE;
+}
+
+static void
+gst_vaapi_subpicture_cache_finalize (GObject * object)
+{
+  GstVaapiSubpictureCache *const cache = GST_VAAPI_SUBPICTURE_CACHE (object);
+
+  GST_DEBUG ("subpicture cache: %" G_GUINT64_FORMAT " hits, %"
+      G_GUINT64_FORMAT " misses, %" G_GUINT64_FORMAT " evictions",
+      cache->stats.hits, cache->stats.misses, cache->stats.evictions);
+
+  g_hash_table_destroy (cache->entries);
+  g_mutex_clear (&cache->lock);
+
+  G_OBJECT_CLASS (gst_vaapi_subpicture_cache_parent_class)->finalize (object);
+}
+
+static void
+gst_vaapi_subpicture_cache_class_init (GstVaapiSubpictureCacheClass * klass)
+{
+  GObjectClass *const object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = gst_vaapi_subpicture_cache_finalize;
+}
+
+/**
+ * gst_vaapi_subpicture_cache_new:
+ * @max_size: the maximum amount of pixel data to keep, in bytes, or
+ *   zero for %GST_VAAPI_SUBPICTURE_CACHE_DEFAULT_MAX_SIZE
+ *
+ * Creates a subpicture cache.
+ *
+ * Return value: the newly created #GstVaapiSubpictureCache object
+ */
+GstVaapiSubpictureCache *
+gst_vaapi_subpicture_cache_new (gsize max_size)
+{
+  GstVaapiSubpictureCache *cache;
+
+  cache = g_object_new (GST_TYPE_VAAPI_SUBPICTURE_CACHE, NULL);
+  if (max_size > 0)
+    cache->max_size = max_size;
+  return cache;
+}
+
+/* Drops the least recently used entries until @extra_size more bytes
+ * fit in the cache */
+static void
+cache_evict (GstVaapiSubpictureCache * cache, gsize extra_size)
+{
+  GstVaapiSubpictureCacheEntry *entry;
+
+  while (cache->lru.tail && cache->stats.size + extra_size > cache->max_size) {
+    entry = cache->lru.tail->data;
+    GST_DEBUG ("evicting subpicture %" GST_VAAPI_ID_FORMAT,
+        GST_VAAPI_ID_ARGS (GST_VAAPI_SUBPICTURE_ID (entry->subpicture)));
+    cache->stats.evictions++;
+    cache_remove_entry (cache, entry);
+  }
+}
+
+/**
+ * gst_vaapi_subpicture_cache_acquire:
+ * @cache: a #GstVaapiSubpictureCache
+ * @display: a #GstVaapiDisplay
+ * @rect: a #GstVideoOverlayRectangle
+ *
+ * Looks up the subpicture made from @rect on @display, or creates and
+ * uploads a new one and adds it to the @cache.
+ *
+ * Return value: (transfer full): a #GstVaapiSubpicture, or %NULL on
+ *   failure
+ */
+GstVaapiSubpicture *
+gst_vaapi_subpicture_cache_acquire (GstVaapiSubpictureCache * cache,
+    GstVaapiDisplay * display, GstVideoOverlayRectangle * rect)
+{
+  GstVaapiSubpictureCacheEntry *entry;
+  GstVaapiSubpicture *subpicture;
+  GstVaapiImage *image;
+  GstBuffer *pixels;
+  guint seqnum, flags;
+  gfloat global_alpha;
+
+  g_return_val_if_fail (cache != NULL, NULL);
+  g_return_val_if_fail (display != NULL, NULL);
+  g_return_val_if_fail (GST_IS_VIDEO_OVERLAY_RECTANGLE (rect), NULL);
+
+  seqnum = gst_video_overlay_rectangle_get_seqnum (rect);
+  flags = gst_video_overlay_rectangle_get_flags (rect);
+  global_alpha = gst_video_overlay_rectangle_get_global_alpha (rect);
+  pixels = gst_video_overlay_rectangle_get_pixels_unscaled_argb (rect, flags);
+
+  g_mutex_lock (&cache->lock);
+  entry = g_hash_table_lookup (cache->entries, GUINT_TO_POINTER (seqnum));
+  if (entry && entry->display == display && entry->pixels == pixels &&
+      entry->flags == flags && entry->global_alpha == global_alpha) {
+    g_queue_unlink (&cache->lru, &entry->link);
+    g_queue_push_head_link (&cache->lru, &entry->link);
+    cache->stats.hits++;
+    subpicture = (GstVaapiSubpicture *)
+        gst_mini_object_ref (GST_MINI_OBJECT_CAST (entry->subpicture));
+    g_mutex_unlock (&cache->lock);
+    return subpicture;
+  }
+  if (entry)
+    cache_remove_entry (cache, entry);
+  cache->stats.misses++;
+  g_mutex_unlock (&cache->lock);
+
+  subpicture = gst_vaapi_subpicture_new_from_overlay_rectangle (display, rect);
+  if (!subpicture)
+    return NULL;
+
+  entry = g_slice_new0 (GstVaapiSubpictureCacheEntry);
+  entry->seqnum = seqnum;
+  entry->display = display;
+  entry->pixels = pixels;
+  entry->flags = flags;
+  entry->global_alpha = global_alpha;
+  entry->subpicture = (GstVaapiSubpicture *)
+      gst_mini_object_ref (GST_MINI_OBJECT_CAST (subpicture));
+  entry->link.data = entry;
+
+  image = gst_vaapi_subpicture_get_image (subpicture);
+  entry->size = image ? gst_vaapi_image_get_data_size (image) : 0;
+
+  g_mutex_lock (&cache->lock);
+  cache_evict (cache, entry->size);
+  if (entry->size > cache->max_size) {
+    /* would not fit, even in an empty cache */
+    g_mutex_unlock (&cache->lock);
+    entry_free (entry);
+    return subpicture;
+  }
+
+  /* another thread may have uploaded the same rectangle meanwhile */
+  if (g_hash_table_contains (cache->entries, GUINT_TO_POINTER (seqnum)))
+    cache_remove_entry (cache, g_hash_table_lookup (cache->entries,
+            GUINT_TO_POINTER (seqnum)));
+
+  g_hash_table_insert (cache->entries, GUINT_TO_POINTER (seqnum), entry);
+  g_queue_push_head_link (&cache->lru, &entry->link);
+  cache->stats.size += entry->size;
+  cache->stats.num_entries++;
+  g_mutex_unlock (&cache->lock);
+
+  return subpicture;
+}
+
+/**
+ * gst_vaapi_subpicture_cache_reset:
+ * @cache: a #GstVaapiSubpictureCache
+ *
+ * Removes all the subpictures from the @cache. The statistics are
+ * kept.
+ */
+void
+gst_vaapi_subpicture_cache_reset (GstVaapiSubpictureCache * cache)
+{
+  g_return_if_fail (cache != NULL);
+
+  g_mutex_lock (&cache->lock);
+  g_queue_init (&cache->lru);
+  g_hash_table_remove_all (cache->entries);
+  cache->stats.size = 0;
+  cache->stats.num_entries = 0;
+  g_mutex_unlock (&cache->lock);
+}
+
+/**
+ * gst_vaapi_subpicture_cache_get_stats:
+ * @cache: a #GstVaapiSubpictureCache
+ * @stats: (out caller-allocates): return location for the statistics
+ *
+ * Retrieves the usage statistics of the @cache.
+ */
+void
+gst_vaapi_subpicture_cache_get_stats (GstVaapiSubpictureCache * cache,
+    GstVaapiSubpictureCacheStats * stats)
+{
+  g_return_if_fail (cache != NULL);
+  g_return_if_fail (stats != NULL);
+
+  g_mutex_lock (&cache->lock);
+  *stats = cache->stats;
+  g_mutex_unlock (&cache->lock);
+}
@@ -0,0 +1,85 @@
+/*
+ *  gstvaapisubpicturecache.h - VA subpicture cache
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_SUBPICTURE_CACHE_H
+#define GST_VAAPI_SUBPICTURE_CACHE_H
+
+#include <gst/vaapi/gstvaapisubpicture.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVaapiSubpictureCache GstVaapiSubpictureCache;
+typedef struct _GstVaapiSubpictureCacheClass GstVaapiSubpictureCacheClass;
+typedef struct _GstVaapiSubpictureCacheStats GstVaapiSubpictureCacheStats;
+
+#define GST_TYPE_VAAPI_SUBPICTURE_CACHE \
+  (gst_vaapi_subpicture_cache_get_type ())
+#define GST_VAAPI_SUBPICTURE_CACHE(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_VAAPI_SUBPICTURE_CACHE, \
+      GstVaapiSubpictureCache))
+
+/**
+ * GST_VAAPI_SUBPICTURE_CACHE_DEFAULT_MAX_SIZE:
+ *
+ * Default amount of subpicture pixel data, in bytes, kept by a
+ * #GstVaapiSubpictureCache.
+ */
+#define GST_VAAPI_SUBPICTURE_CACHE_DEFAULT_MAX_SIZE (16 * 1024 * 1024)
+
+/**
+ * GstVaapiSubpictureCacheStats:
+ * @hits: number of subpictures reused from the cache
+ * @misses: number of subpictures created and uploaded
+ * @evictions: number of subpictures dropped to honour the size limit
+ * @num_entries: number of subpictures currently cached
+ * @size: amount of pixel data currently cached, in bytes
+ *
+ * Usage statistics of a #GstVaapiSubpictureCache.
+ */
+struct _GstVaapiSubpictureCacheStats
+{
+  guint64 hits;
+  guint64 misses;
+  guint64 evictions;
+  guint num_entries;
+  gsize size;
+};
+
+GstVaapiSubpictureCache *
+gst_vaapi_subpicture_cache_new (gsize max_size);
+
+GstVaapiSubpicture *
+gst_vaapi_subpicture_cache_acquire (GstVaapiSubpictureCache * cache,
+    GstVaapiDisplay * display, GstVideoOverlayRectangle * rect);
+
+void
+gst_vaapi_subpicture_cache_reset (GstVaapiSubpictureCache * cache);
+
+void
+gst_vaapi_subpicture_cache_get_stats (GstVaapiSubpictureCache * cache,
+    GstVaapiSubpictureCacheStats * stats);
+
+GType
+gst_vaapi_subpicture_cache_get_type (void) G_GNUC_CONST;
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GstVaapiSubpictureCache, gst_object_unref)
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_SUBPICTURE_CACHE_H */
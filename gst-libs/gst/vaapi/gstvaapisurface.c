@@ -36,6 +36,8 @@
 #include "gstvaapiimage.h"
 #include "gstvaapiimage_priv.h"
 #include "gstvaapibufferproxy_priv.h"
+#include "gstvaapidisplay_priv.h"
+#include "gstvaapitrace.h"
 
 #define DEBUG 1
 #include "gstvaapidebug.h"
@@ -56,6 +58,22 @@ destroy_subpicture_cb (gpointer subpicture, gpointer surface)
   gst_vaapi_subpicture_unref (subpicture);
 }
 
+/* VA surfaces allocated by the process, and the highest count */
+static gint num_allocated_surfaces;
+static gint max_allocated_surfaces;
+
+static void
+surface_allocated (void)
+{
+  const gint n = g_atomic_int_add (&num_allocated_surfaces, 1) + 1;
+  gint max;
+
+  do {
+    max = g_atomic_int_get (&max_allocated_surfaces);
+  } while (n > max &&
+      !g_atomic_int_compare_and_exchange (&max_allocated_surfaces, max, n));
+}
+
 static void
 gst_vaapi_surface_destroy_subpictures (GstVaapiSurface * surface)
 {
@@ -86,6 +104,7 @@ gst_vaapi_surface_free (GstVaapiSurface * surface)
       GST_WARNING ("failed to destroy surface %" GST_VAAPI_ID_FORMAT,
           GST_VAAPI_ID_ARGS (surface_id));
     GST_VAAPI_SURFACE_ID (surface) = VA_INVALID_SURFACE;
+    g_atomic_int_add (&num_allocated_surfaces, -1);
   }
   gst_vaapi_buffer_proxy_replace (&surface->extbuf_proxy, NULL);
   gst_vaapi_display_replace (&GST_VAAPI_SURFACE_DISPLAY (surface), NULL);
@@ -120,6 +139,7 @@ gst_vaapi_surface_init (GstVaapiSurface * surface,
 
   GST_DEBUG ("surface %" GST_VAAPI_ID_FORMAT, GST_VAAPI_ID_ARGS (surface_id));
   GST_VAAPI_SURFACE_ID (surface) = surface_id;
+  surface_allocated ();
   return TRUE;
 
   /* ERRORS */
@@ -231,6 +251,7 @@ gst_vaapi_surface_init_full (GstVaapiSurface * surface,
 
   GST_DEBUG ("surface %" GST_VAAPI_ID_FORMAT, GST_VAAPI_ID_ARGS (surface_id));
   GST_VAAPI_SURFACE_ID (surface) = surface_id;
+  surface_allocated ();
   return TRUE;
 
   /* ERRORS */
@@ -316,6 +337,7 @@ gst_vaapi_surface_init_from_buffer_proxy (GstVaapiSurface * surface,
 
   GST_DEBUG ("surface %" GST_VAAPI_ID_FORMAT, GST_VAAPI_ID_ARGS (surface_id));
   GST_VAAPI_SURFACE_ID (surface) = surface_id;
+  surface_allocated ();
   return TRUE;
 
   /* ERRORS */
@@ -346,6 +368,25 @@ gst_vaapi_surface_create (GstVaapiDisplay * display)
   return surface;
 }
 
+/**
+ * gst_vaapi_surface_get_num_allocated:
+ * @max_surfaces: (out) (optional): return location for the highest
+ *   number of surfaces allocated at once
+ *
+ * Counts the VA surfaces currently allocated by the process, on all
+ * displays. This is mostly useful to check the memory footprint of
+ * many concurrent streams.
+ *
+ * Return value: the number of allocated VA surfaces
+ */
+guint
+gst_vaapi_surface_get_num_allocated (guint * max_surfaces)
+{
+  if (max_surfaces)
+    *max_surfaces = g_atomic_int_get (&max_allocated_surfaces);
+  return g_atomic_int_get (&num_allocated_surfaces);
+}
+
 /**
  * gst_vaapi_surface_get_display:
  * @surface: a #GstVaapiSurface
@@ -663,8 +704,9 @@ gst_vaapi_surface_derive_image (GstVaapiSurface * surface)
   va_image.buf = VA_INVALID_ID;
 
   GST_VAAPI_DISPLAY_LOCK (display);
-  status = vaDeriveImage (GST_VAAPI_DISPLAY_VADISPLAY (display),
-      GST_VAAPI_SURFACE_ID (surface), &va_image);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_DERIVE_IMAGE, status,
+      vaDeriveImage (GST_VAAPI_DISPLAY_VADISPLAY (display),
+          GST_VAAPI_SURFACE_ID (surface), &va_image));
   GST_VAAPI_DISPLAY_UNLOCK (display);
   if (!vaapi_check_status (status, "vaDeriveImage()"))
     return NULL;
@@ -713,8 +755,9 @@ gst_vaapi_surface_get_image (GstVaapiSurface * surface, GstVaapiImage * image)
     return FALSE;
 
   GST_VAAPI_DISPLAY_LOCK (display);
-  status = vaGetImage (GST_VAAPI_DISPLAY_VADISPLAY (display),
-      GST_VAAPI_SURFACE_ID (surface), 0, 0, width, height, image_id);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_GET_IMAGE, status,
+      vaGetImage (GST_VAAPI_DISPLAY_VADISPLAY (display),
+          GST_VAAPI_SURFACE_ID (surface), 0, 0, width, height, image_id));
   GST_VAAPI_DISPLAY_UNLOCK (display);
   if (!vaapi_check_status (status, "vaGetImage()"))
     return FALSE;
@@ -758,9 +801,10 @@ gst_vaapi_surface_put_image (GstVaapiSurface * surface, GstVaapiImage * image)
     return FALSE;
 
   GST_VAAPI_DISPLAY_LOCK (display);
-  status = vaPutImage (GST_VAAPI_DISPLAY_VADISPLAY (display),
-      GST_VAAPI_SURFACE_ID (surface), image_id, 0, 0, width, height, 0, 0,
-      width, height);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_PUT_IMAGE, status,
+      vaPutImage (GST_VAAPI_DISPLAY_VADISPLAY (display),
+          GST_VAAPI_SURFACE_ID (surface), image_id, 0, 0, width, height, 0, 0,
+          width, height));
   GST_VAAPI_DISPLAY_UNLOCK (display);
   if (!vaapi_check_status (status, "vaPutImage()"))
     return FALSE;
@@ -858,12 +902,13 @@ _gst_vaapi_surface_associate_subpicture (GstVaapiSurface * surface,
   }
 
   GST_VAAPI_DISPLAY_LOCK (display);
-  status = vaAssociateSubpicture (GST_VAAPI_DISPLAY_VADISPLAY (display),
-      GST_VAAPI_SUBPICTURE_ID (subpicture), &surface_id, 1,
-      src_rect->x, src_rect->y, src_rect->width, src_rect->height,
-      dst_rect->x, dst_rect->y, dst_rect->width, dst_rect->height,
-      from_GstVaapiSubpictureFlags (gst_vaapi_subpicture_get_flags
-          (subpicture)));
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_ASSOCIATE_SUBPICTURE, status,
+      vaAssociateSubpicture (GST_VAAPI_DISPLAY_VADISPLAY (display),
+          GST_VAAPI_SUBPICTURE_ID (subpicture), &surface_id, 1,
+          src_rect->x, src_rect->y, src_rect->width, src_rect->height,
+          dst_rect->x, dst_rect->y, dst_rect->width, dst_rect->height,
+          from_GstVaapiSubpictureFlags (gst_vaapi_subpicture_get_flags
+              (subpicture))));
   GST_VAAPI_DISPLAY_UNLOCK (display);
   if (!vaapi_check_status (status, "vaAssociateSubpicture()"))
     return FALSE;
@@ -923,8 +968,9 @@ _gst_vaapi_surface_deassociate_subpicture (GstVaapiSurface * surface,
     return FALSE;
 
   GST_VAAPI_DISPLAY_LOCK (display);
-  status = vaDeassociateSubpicture (GST_VAAPI_DISPLAY_VADISPLAY (display),
-      GST_VAAPI_SUBPICTURE_ID (subpicture), &surface_id, 1);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_DEASSOCIATE_SUBPICTURE, status,
+      vaDeassociateSubpicture (GST_VAAPI_DISPLAY_VADISPLAY (display),
+          GST_VAAPI_SUBPICTURE_ID (subpicture), &surface_id, 1));
   GST_VAAPI_DISPLAY_UNLOCK (display);
   if (!vaapi_check_status (status, "vaDeassociateSubpicture()"))
     return FALSE;
@@ -953,13 +999,16 @@ gst_vaapi_surface_sync (GstVaapiSurface * surface)
   if (!display)
     return FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (display);
-  status = vaSyncSurface (GST_VAAPI_DISPLAY_VADISPLAY (display),
-      GST_VAAPI_SURFACE_ID (surface));
-  GST_VAAPI_DISPLAY_UNLOCK (display);
+  /* no need to block other contexts while waiting on thread-safe drivers */
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (display, NULL);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_SYNC_SURFACE, status,
+      vaSyncSurface (GST_VAAPI_DISPLAY_VADISPLAY (display),
+          GST_VAAPI_SURFACE_ID (surface)));
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (display, NULL);
   if (!vaapi_check_status (status, "vaSyncSurface()"))
     return FALSE;
 
+  GST_VAAPI_TRACE (GST_VAAPI_TRACE_SURFACE_SYNC, NULL, GST_CLOCK_TIME_NONE);
   return TRUE;
 }
 
@@ -984,8 +1033,9 @@ gst_vaapi_surface_query_status (GstVaapiSurface * surface,
   g_return_val_if_fail (surface != NULL, FALSE);
 
   GST_VAAPI_DISPLAY_LOCK (display);
-  status = vaQuerySurfaceStatus (GST_VAAPI_DISPLAY_VADISPLAY (display),
-      GST_VAAPI_SURFACE_ID (surface), &surface_status);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_QUERY_SURFACE_STATUS, status,
+      vaQuerySurfaceStatus (GST_VAAPI_DISPLAY_VADISPLAY (display),
+          GST_VAAPI_SURFACE_ID (surface), &surface_status));
   GST_VAAPI_DISPLAY_UNLOCK (display);
   if (!vaapi_check_status (status, "vaQuerySurfaceStatus()"))
     return FALSE;
@@ -1009,6 +1059,27 @@ gst_vaapi_surface_query_status (GstVaapiSurface * surface,
 gboolean
 gst_vaapi_surface_set_subpictures_from_composition (GstVaapiSurface * surface,
     GstVideoOverlayComposition * composition)
+{
+  return gst_vaapi_surface_set_subpictures_from_composition_full (surface,
+      composition, NULL);
+}
+
+/**
+ * gst_vaapi_surface_set_subpictures_from_composition_full:
+ * @surface: a #GstVaapiSurface
+ * @compostion: a #GstVideoOverlayCompositon
+ * @cache: (nullable): a #GstVaapiSubpictureCache
+ *
+ * Same as gst_vaapi_surface_set_subpictures_from_composition(), but
+ * the subpictures of the rectangles already seen are taken from
+ * @cache instead of being uploaded again.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+gst_vaapi_surface_set_subpictures_from_composition_full (GstVaapiSurface *
+    surface, GstVideoOverlayComposition * composition,
+    GstVaapiSubpictureCache * cache)
 {
   GstVaapiDisplay *display;
   guint n, nb_rectangles;
@@ -1034,8 +1105,11 @@ gst_vaapi_surface_set_subpictures_from_composition (GstVaapiSurface * surface,
     GstVaapiSubpicture *subpicture;
 
     rect = gst_video_overlay_composition_get_rectangle (composition, n);
-    subpicture = gst_vaapi_subpicture_new_from_overlay_rectangle (display,
-        rect);
+    if (cache)
+      subpicture = gst_vaapi_subpicture_cache_acquire (cache, display, rect);
+    else
+      subpicture = gst_vaapi_subpicture_new_from_overlay_rectangle (display,
+          rect);
     if (subpicture == NULL) {
       GST_WARNING ("could not create subpicture for rectangle %p", rect);
       return FALSE;
@@ -28,6 +28,7 @@
 #include <gst/vaapi/gstvaapidisplay.h>
 #include <gst/vaapi/gstvaapiimage.h>
 #include <gst/vaapi/gstvaapisubpicture.h>
+#include <gst/vaapi/gstvaapisubpicturecache.h>
 #include <gst/vaapi/gstvaapibufferproxy.h>
 #include <gst/video/video.h>
 #include <gst/video/video-overlay-composition.h>
@@ -206,6 +207,9 @@ gst_vaapi_surface_unref (GstVaapiSurface * surface)
   gst_mini_object_unref (GST_MINI_OBJECT_CAST (surface));
 }
 
+guint
+gst_vaapi_surface_get_num_allocated (guint * max_surfaces);
+
 GstVaapiDisplay *
 gst_vaapi_surface_get_display (GstVaapiSurface * surface);
 
@@ -274,6 +278,11 @@ gboolean
 gst_vaapi_surface_set_subpictures_from_composition (GstVaapiSurface * surface,
     GstVideoOverlayComposition * composition);
 
+gboolean
+gst_vaapi_surface_set_subpictures_from_composition_full (GstVaapiSurface *
+    surface, GstVideoOverlayComposition * composition,
+    GstVaapiSubpictureCache * cache);
+
 void
 gst_vaapi_surface_set_buffer_proxy (GstVaapiSurface * surface,
     GstVaapiBufferProxy * proxy);
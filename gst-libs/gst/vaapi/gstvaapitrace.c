@@ -0,0 +1,85 @@
+/*
+ *  gstvaapitrace.c - Per-frame trace points
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include "gstvaapitrace.h"
+
+gpointer _gst_vaapi_trace_func = NULL;
+static gpointer trace_user_data = NULL;
+
+static const gchar *const trace_point_names[GST_VAAPI_TRACE_N_POINTS] = {
+  "parse-done",
+  "va-submit",
+  "surface-sync",
+  "vpp",
+  "encode-submit",
+  "coded-ready",
+};
+
+/**
+ * gst_vaapi_trace_point:
+ * @point: the #GstVaapiTracePoint reached
+ * @object: (nullable): the decoder, encoder or filter involved
+ * @pts: the frame presentation timestamp, or %GST_CLOCK_TIME_NONE
+ *
+ * Reports @point to the installed trace function. Use the
+ * GST_VAAPI_TRACE() macro instead, which skips the call when tracing
+ * is disabled.
+ */
+void
+gst_vaapi_trace_point (GstVaapiTracePoint point, gpointer object,
+    GstClockTime pts)
+{
+  GstVaapiTraceFunc const func =
+      g_atomic_pointer_get (&_gst_vaapi_trace_func);
+
+  if (func)
+    func (point, object, pts, g_atomic_pointer_get (&trace_user_data));
+}
+
+/**
+ * gst_vaapi_trace_set_func:
+ * @func: (nullable): the #GstVaapiTraceFunc to install
+ * @user_data: data passed to @func
+ *
+ * Installs @func as the receiver of all the trace points, or disables
+ * tracing if @func is %NULL. Only one function can be installed at a
+ * time.
+ */
+void
+gst_vaapi_trace_set_func (GstVaapiTraceFunc func, gpointer user_data)
+{
+  g_atomic_pointer_set (&_gst_vaapi_trace_func, NULL);
+  g_atomic_pointer_set (&trace_user_data, user_data);
+  g_atomic_pointer_set (&_gst_vaapi_trace_func, func);
+}
+
+/**
+ * gst_vaapi_trace_point_get_name:
+ * @point: a #GstVaapiTracePoint
+ *
+ * Return value: a short name for @point
+ */
+const gchar *
+gst_vaapi_trace_point_get_name (GstVaapiTracePoint point)
+{
+  g_return_val_if_fail (point < GST_VAAPI_TRACE_N_POINTS, NULL);
+
+  return trace_point_names[point];
+}
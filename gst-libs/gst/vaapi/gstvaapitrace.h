@@ -0,0 +1,83 @@
+/*
+ *  gstvaapitrace.h - Per-frame trace points
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_TRACE_H
+#define GST_VAAPI_TRACE_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GstVaapiTracePoint:
+ * @GST_VAAPI_TRACE_PARSE_DONE: a complete frame was parsed
+ * @GST_VAAPI_TRACE_VA_SUBMIT: a frame was submitted for decoding
+ * @GST_VAAPI_TRACE_SURFACE_SYNC: a surface finished rendering
+ * @GST_VAAPI_TRACE_VPP: a frame went through video processing
+ * @GST_VAAPI_TRACE_ENCODE_SUBMIT: a picture was submitted for encoding
+ * @GST_VAAPI_TRACE_CODED_READY: a coded buffer is ready
+ *
+ * The steps of a frame lifetime that can be traced.
+ */
+typedef enum
+{
+  GST_VAAPI_TRACE_PARSE_DONE = 0,
+  GST_VAAPI_TRACE_VA_SUBMIT,
+  GST_VAAPI_TRACE_SURFACE_SYNC,
+  GST_VAAPI_TRACE_VPP,
+  GST_VAAPI_TRACE_ENCODE_SUBMIT,
+  GST_VAAPI_TRACE_CODED_READY,
+
+  GST_VAAPI_TRACE_N_POINTS
+} GstVaapiTracePoint;
+
+/**
+ * GstVaapiTraceFunc:
+ * @point: the #GstVaapiTracePoint reached
+ * @object: (nullable): the decoder, encoder or filter involved
+ * @pts: the presentation timestamp of the frame, or
+ *   %GST_CLOCK_TIME_NONE for the frame processed by the calling thread
+ * @user_data: the data passed to gst_vaapi_trace_set_func()
+ *
+ * Function called when a trace point is reached.
+ */
+typedef void (*GstVaapiTraceFunc) (GstVaapiTracePoint point, gpointer object,
+    GstClockTime pts, gpointer user_data);
+
+extern gpointer _gst_vaapi_trace_func;
+
+/* Costs a single pointer test while no tracer is installed */
+#define GST_VAAPI_TRACE(point, object, pts) G_STMT_START {      \
+    if (G_UNLIKELY (_gst_vaapi_trace_func != NULL))             \
+      gst_vaapi_trace_point (point, object, pts);               \
+  } G_STMT_END
+
+void
+gst_vaapi_trace_point (GstVaapiTracePoint point, gpointer object,
+    GstClockTime pts);
+
+void
+gst_vaapi_trace_set_func (GstVaapiTraceFunc func, gpointer user_data);
+
+const gchar *
+gst_vaapi_trace_point_get_name (GstVaapiTracePoint point);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_TRACE_H */
@@ -98,7 +98,8 @@ gst_vaapi_log (
 #endif
 
 gboolean
-vaapi_initialize (VADisplay dpy)
+vaapi_initialize (VADisplay dpy, gint * major_version_ptr,
+    gint * minor_version_ptr)
 {
   gint major_version, minor_version;
   VAStatus status;
@@ -120,6 +121,10 @@ vaapi_initialize (VADisplay dpy)
     return FALSE;
 
   GST_INFO ("VA-API version %d.%d", major_version, minor_version);
+  if (major_version_ptr)
+    *major_version_ptr = major_version;
+  if (minor_version_ptr)
+    *minor_version_ptr = minor_version;
   return TRUE;
 }
 
@@ -141,7 +146,8 @@ vaapi_map_buffer (VADisplay dpy, VABufferID buf_id)
   VAStatus status;
   gpointer data = NULL;
 
-  status = vaMapBuffer (dpy, buf_id, &data);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_MAP_BUFFER, status,
+      vaMapBuffer (dpy, buf_id, &data));
   if (!vaapi_check_status (status, "vaMapBuffer()"))
     return NULL;
   return data;
@@ -156,7 +162,8 @@ vaapi_unmap_buffer (VADisplay dpy, VABufferID buf_id, gpointer * pbuf)
   if (pbuf)
     *pbuf = NULL;
 
-  status = vaUnmapBuffer (dpy, buf_id);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_UNMAP_BUFFER, status,
+      vaUnmapBuffer (dpy, buf_id));
   if (!vaapi_check_status (status, "vaUnmapBuffer()"))
     return;
 }
@@ -179,7 +186,8 @@ vaapi_create_n_elements_buffer (VADisplay dpy, VAContextID ctx, int type,
   VAStatus status;
   gpointer data = (gpointer) buf;
 
-  status = vaCreateBuffer (dpy, ctx, type, size, num_elements, data, &buf_id);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_CREATE_BUFFER, status,
+      vaCreateBuffer (dpy, ctx, type, size, num_elements, data, &buf_id));
   if (!vaapi_check_status (status, "vaCreateBuffer()"))
     return FALSE;
 
@@ -201,14 +209,52 @@ error:
   }
 }
 
+/* Creates and maps a VA buffer of height rows of width elements,
+   whose rows are pitch bytes apart */
+gboolean
+vaapi_create_2d_buffer (VADisplay dpy, VAContextID ctx, int type,
+    guint width, guint height, VABufferID * buf_id_ptr,
+    gpointer * mapped_data, guint * pitch_ptr)
+{
+  VABufferID buf_id;
+  VAStatus status;
+  unsigned int unit_size, pitch;
+  gpointer data;
+
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_CREATE_BUFFER, status,
+      vaCreateBuffer2D (dpy, ctx, type, width, height, &unit_size, &pitch,
+          &buf_id));
+  if (!vaapi_check_status (status, "vaCreateBuffer2D()"))
+    return FALSE;
+
+  data = vaapi_map_buffer (dpy, buf_id);
+  if (!data)
+    goto error;
+
+  *buf_id_ptr = buf_id;
+  *mapped_data = data;
+  *pitch_ptr = pitch;
+  return TRUE;
+
+  /* ERRORS */
+error:
+  {
+    vaapi_destroy_buffer (dpy, &buf_id);
+    return FALSE;
+  }
+}
+
 /* Destroy VA buffer */
 void
 vaapi_destroy_buffer (VADisplay dpy, VABufferID * buf_id_ptr)
 {
+  VAStatus G_GNUC_UNUSED status;
+
   if (!buf_id_ptr || *buf_id_ptr == VA_INVALID_ID)
     return;
 
-  vaDestroyBuffer (dpy, *buf_id_ptr);
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_DESTROY_BUFFER, status,
+      vaDestroyBuffer (dpy, *buf_id_ptr));
   *buf_id_ptr = VA_INVALID_ID;
 }
 
@@ -28,11 +28,14 @@
 #include <glib.h>
 #include <gst/video/video.h>
 #include <va/va.h>
+#include "gstvaapivacalls.h"
 
-/** calls vaInitialize() redirecting the logging mechanism */
+/** calls vaInitialize() redirecting the logging mechanism, and returns
+    the version of the VA-API runtime */
 G_GNUC_INTERNAL
 gboolean
-vaapi_initialize (VADisplay dpy);
+vaapi_initialize (VADisplay dpy, gint * major_version_ptr,
+    gint * minor_version_ptr);
 
 /** Check VA status for success or print out an error */
 G_GNUC_INTERNAL
@@ -61,6 +64,12 @@ vaapi_create_n_elements_buffer (VADisplay dpy, VAContextID ctx, int type,
     guint size, gconstpointer data, VABufferID * buf_id, gpointer * mapped_data,
     int num_elements);
 
+G_GNUC_INTERNAL
+gboolean
+vaapi_create_2d_buffer (VADisplay dpy, VAContextID ctx, int type,
+    guint width, guint height, VABufferID * buf_id, gpointer * mapped_data,
+    guint * pitch);
+
 /** Destroy VA buffer */
 G_GNUC_INTERNAL
 void
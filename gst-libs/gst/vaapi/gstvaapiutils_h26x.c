@@ -24,6 +24,9 @@
  */
 
 #include "gstvaapiutils_h26x_priv.h"
+#include "gstvaapiencoder_objects.h"
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
 
 /* Write an unsigned integer Exp-Golomb-coded syntax element. i.e. ue(v) */
 gboolean
@@ -145,3 +148,290 @@ bs_error:
     return FALSE;
   }
 }
+
+/* Write a SEI message, byte aligning the supplied payload */
+static gboolean
+bs_write_sei_message (GstBitWriter * bs, guint payload_type,
+    GstBitWriter * payload)
+{
+  guint payload_size;
+
+  if (GST_BIT_WRITER_BIT_SIZE (payload) % 8 != 0) {
+    /* bit_equal_to_one, then bit_equal_to_zero up to the byte boundary */
+    WRITE_UINT32 (payload, 1, 1);
+    gst_bit_writer_align_bytes_unchecked (payload, 0);
+  }
+  payload_size = GST_BIT_WRITER_BIT_SIZE (payload) / 8;
+  g_assert (payload_size < 0xff);
+
+  WRITE_UINT32 (bs, payload_type, 8);
+  WRITE_UINT32 (bs, payload_size, 8);
+  if (!gst_bit_writer_put_bytes (bs, GST_BIT_WRITER_DATA (payload),
+          payload_size))
+    goto bs_error;
+  return TRUE;
+
+  /* ERRORS */
+bs_error:
+  {
+    GST_WARNING ("failed to write SEI message");
+    return FALSE;
+  }
+}
+
+/* Write a H.264 recovery point SEI message (D.1.8) */
+gboolean
+bs_write_sei_recovery_point_h264 (GstBitWriter * bs, guint recovery_frame_cnt)
+{
+  GstBitWriter payload;
+  gboolean success;
+
+  gst_bit_writer_init_with_size (&payload, 16, FALSE);
+
+  /* recovery_frame_cnt */
+  WRITE_UE (&payload, recovery_frame_cnt);
+  /* exact_match_flag: the motion vectors are not constrained to the
+     refreshed area, so the recovered pictures are only approximate */
+  WRITE_UINT32 (&payload, 0, 1);
+  /* broken_link_flag */
+  WRITE_UINT32 (&payload, 0, 1);
+  /* changing_slice_group_idc */
+  WRITE_UINT32 (&payload, 0, 2);
+
+  success = bs_write_sei_message (bs, GST_H264_SEI_RECOVERY_POINT, &payload);
+  gst_bit_writer_reset (&payload);
+  return success;
+
+  /* ERRORS */
+bs_error:
+  {
+    GST_WARNING ("failed to write Recovery Point SEI message");
+    gst_bit_writer_reset (&payload);
+    return FALSE;
+  }
+}
+
+/* Write a H.265 recovery point SEI message (D.2.8) */
+gboolean
+bs_write_sei_recovery_point_h265 (GstBitWriter * bs, gint32 recovery_poc_cnt)
+{
+  GstBitWriter payload;
+  gboolean success;
+
+  gst_bit_writer_init_with_size (&payload, 16, FALSE);
+
+  /* recovery_poc_cnt */
+  WRITE_SE (&payload, recovery_poc_cnt);
+  /* exact_match_flag */
+  WRITE_UINT32 (&payload, 0, 1);
+  /* broken_link_flag */
+  WRITE_UINT32 (&payload, 0, 1);
+
+  success = bs_write_sei_message (bs, GST_H265_SEI_RECOVERY_POINT, &payload);
+  gst_bit_writer_reset (&payload);
+  return success;
+
+  /* ERRORS */
+bs_error:
+  {
+    GST_WARNING ("failed to write Recovery Point SEI message");
+    gst_bit_writer_reset (&payload);
+    return FALSE;
+  }
+}
+
+/**
+ * gst_vaapi_utils_h26x_get_intra_refresh_region:
+ * @num_units: the number of columns, or rows, of blocks in the picture
+ * @period: the number of pictures in a refresh cycle
+ * @index: the position of the picture in the refresh cycle
+ * @location_ptr: return location for the first intra coded column, or row
+ * @size_ptr: return location for the number of intra coded columns, or rows
+ *
+ * Splits the picture into @period regions of even sizes, and returns
+ * the one to intra code in the picture at @index of the refresh
+ * cycle. A @period greater than @num_units yields empty regions.
+ *
+ * Returns: %TRUE if the picture starts a new refresh cycle.
+ **/
+gboolean
+gst_vaapi_utils_h26x_get_intra_refresh_region (guint num_units, guint period,
+    guint index, guint * location_ptr, guint * size_ptr)
+{
+  guint start, end;
+
+  g_return_val_if_fail (period > 0, FALSE);
+
+  index %= period;
+  start = (guint64) num_units * index / period;
+  end = (guint64) num_units * (index + 1) / period;
+
+  if (location_ptr)
+    *location_ptr = start;
+  if (size_ptr)
+    *size_ptr = end - start;
+  return index == 0;
+}
+
+/* Checks whether the picture of order cnt poc is in the first count
+   entries of the reference picture list */
+static gboolean
+ref_pic_list_has_poc (const VAPictureHEVC * ref_pic_list, guint count,
+    guint poc)
+{
+  guint i;
+
+  for (i = 0; i < count; i++) {
+    if (ref_pic_list[i].picture_id == VA_INVALID_SURFACE)
+      break;
+    if ((guint) ref_pic_list[i].pic_order_cnt == poc)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/* Inserts the reference of order cnt poc in the set of pictures,
+   sorted by increasing distance to the current picture */
+static void
+ref_pic_set_insert (guint * pocs, guint * num_pocs, guint poc,
+    guint cur_poc)
+{
+  const guint distance = ABS ((gint) (poc - cur_poc));
+  guint i;
+
+  for (i = *num_pocs; i > 0; i--) {
+    if (ABS ((gint) (pocs[i - 1] - cur_poc)) < distance)
+      break;
+    pocs[i] = pocs[i - 1];
+  }
+  pocs[i] = poc;
+  (*num_pocs)++;
+}
+
+/* Write short_term_ref_pic_set(0) of the picture of order cnt poc.
+   Every picture of the reference pool is listed, since the decoder
+   drops the pictures missing from the set: only the ones of the
+   reference lists are marked as used by the current picture */
+gboolean
+bs_write_short_term_ref_pic_set_h265 (GstBitWriter * bs,
+    const VAEncSliceParameterBufferHEVC * slice_param, guint poc,
+    const guint * ref_pocs, guint num_refs)
+{
+  guint negative_pocs[16], positive_pocs[16];
+  guint num_negative_pics = 0, num_positive_pics = 0;
+  guint num_l0 = 0, num_l1 = 0;
+  guint prev_poc, i;
+  gboolean used;
+
+  g_return_val_if_fail (num_refs <= G_N_ELEMENTS (negative_pocs), FALSE);
+
+  if (slice_param->slice_type != GST_H265_I_SLICE)
+    num_l0 = slice_param->num_ref_idx_l0_active_minus1 + 1;
+  if (slice_param->slice_type == GST_H265_B_SLICE)
+    num_l1 = slice_param->num_ref_idx_l1_active_minus1 + 1;
+
+  for (i = 0; i < num_refs; i++) {
+    g_assert (ref_pocs[i] != poc);
+
+    if (ref_pocs[i] < poc)
+      ref_pic_set_insert (negative_pocs, &num_negative_pics, ref_pocs[i], poc);
+    else
+      ref_pic_set_insert (positive_pocs, &num_positive_pics, ref_pocs[i], poc);
+  }
+
+  /* num_negative_pics */
+  WRITE_UE (bs, num_negative_pics);
+  /* num_positive_pics */
+  WRITE_UE (bs, num_positive_pics);
+
+  prev_poc = poc;
+  for (i = 0; i < num_negative_pics; i++) {
+    used = ref_pic_list_has_poc (slice_param->ref_pic_list0, num_l0,
+        negative_pocs[i]) || ref_pic_list_has_poc (slice_param->ref_pic_list1,
+        num_l1, negative_pocs[i]);
+    /* delta_poc_s0_minus1 */
+    WRITE_UE (bs, prev_poc - negative_pocs[i] - 1);
+    /* used_by_curr_pic_s0_flag */
+    WRITE_UINT32 (bs, used, 1);
+    prev_poc = negative_pocs[i];
+  }
+
+  prev_poc = poc;
+  for (i = 0; i < num_positive_pics; i++) {
+    used = ref_pic_list_has_poc (slice_param->ref_pic_list0, num_l0,
+        positive_pocs[i]) || ref_pic_list_has_poc (slice_param->ref_pic_list1,
+        num_l1, positive_pocs[i]);
+    /* delta_poc_s1_minus1 */
+    WRITE_UE (bs, positive_pocs[i] - prev_poc - 1);
+    /* used_by_curr_pic_s1_flag */
+    WRITE_UINT32 (bs, used, 1);
+    prev_poc = positive_pocs[i];
+  }
+
+  return TRUE;
+
+  /* ERRORS */
+bs_error:
+  {
+    GST_WARNING ("failed to write short-term reference picture set");
+    return FALSE;
+  }
+}
+
+/**
+ * gst_vaapi_utils_h26x_get_temporal_id:
+ * @level_div: the distance between two pictures of each temporal
+ *   level, from the base layer
+ * @num_levels: the number of temporal levels
+ * @display_order: the distance of the picture from the last
+ *   key-frame, in display order
+ *
+ * Finds the temporal level of a picture of the hierarchical
+ * prediction structures.
+ *
+ * Returns: the temporal id of the picture
+ **/
+guint
+gst_vaapi_utils_h26x_get_temporal_id (const guint * level_div,
+    guint num_levels, guint display_order)
+{
+  guint l;
+
+  for (l = 0; l < num_levels; l++) {
+    if ((display_order % level_div[l]) == 0)
+      return l;
+  }
+
+  GST_WARNING ("Couldn't find valid temporal id");
+  return 0;
+}
+
+/**
+ * gst_vaapi_utils_h26x_sort_hierarchical_b:
+ * @a: a #GstVaapiEncPicture
+ * @b: a #GstVaapiEncPicture
+ * @user_data: unused
+ *
+ * Sorts the reordered pictures of hierarchical-b encode: the B
+ * pictures come first, by increasing temporal level then display
+ * order, the other pictures last.
+ *
+ * Returns: a negative value if @a comes first, a positive one
+ *   otherwise
+ **/
+gint
+gst_vaapi_utils_h26x_sort_hierarchical_b (gconstpointer a, gconstpointer b,
+    gpointer user_data)
+{
+  const GstVaapiEncPicture *const pic1 = a;
+  const GstVaapiEncPicture *const pic2 = b;
+
+  if (pic1->type != GST_VAAPI_PICTURE_TYPE_B)
+    return 1;
+  if (pic2->type != GST_VAAPI_PICTURE_TYPE_B)
+    return -1;
+  if (pic1->temporal_id == pic2->temporal_id)
+    return pic1->poc - pic2->poc;
+  else
+    return pic1->temporal_id - pic2->temporal_id;
+}
@@ -26,6 +26,7 @@
 #define GST_VAAPI_UTILS_H26X_PRIV_H
 
 #include <gst/base/gstbitwriter.h>
+#include <va/va.h>
 
 G_BEGIN_DECLS
 
@@ -82,6 +83,39 @@ G_GNUC_INTERNAL
 gboolean
 gst_vaapi_utils_h26x_write_nal_unit (GstBitWriter * bs, guint8 * nal, guint nal_size);
 
+/* Write a recovery point SEI message, payload type and size included */
+G_GNUC_INTERNAL
+gboolean
+bs_write_sei_recovery_point_h264 (GstBitWriter * bs, guint recovery_frame_cnt);
+
+G_GNUC_INTERNAL
+gboolean
+bs_write_sei_recovery_point_h265 (GstBitWriter * bs, gint32 recovery_poc_cnt);
+
+/* Write the short-term reference picture set of a H.265 slice */
+G_GNUC_INTERNAL
+gboolean
+bs_write_short_term_ref_pic_set_h265 (GstBitWriter * bs,
+    const VAEncSliceParameterBufferHEVC * slice_param, guint poc,
+    const guint * ref_pocs, guint num_refs);
+
+/* Hierarchical prediction */
+G_GNUC_INTERNAL
+guint
+gst_vaapi_utils_h26x_get_temporal_id (const guint * level_div,
+    guint num_levels, guint display_order);
+
+G_GNUC_INTERNAL
+gint
+gst_vaapi_utils_h26x_sort_hierarchical_b (gconstpointer a, gconstpointer b,
+    gpointer user_data);
+
+/* Gradual intra refresh */
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_utils_h26x_get_intra_refresh_region (guint num_units, guint period,
+    guint index, guint * location_ptr, guint * size_ptr);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_UTILS_H26X_PRIV_H */
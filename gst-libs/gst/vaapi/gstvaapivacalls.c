@@ -0,0 +1,230 @@
+/*
+ *  gstvaapivacalls.c - VA call accounting
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:gstvaapivacalls
+ * @short_description: VA call accounting
+ *
+ * Counts and times the VA calls issued on the frame processing paths,
+ * in order to spot the ones that issue too many driver calls per
+ * frame.
+ *
+ * The decoders, encoders and filters push their #GstVaapiVaCallStats
+ * on the calling thread with gst_vaapi_va_calls_push() while they
+ * process a frame, so that all the VA calls wrapped with
+ * GST_VAAPI_VA_CALL() meanwhile are attributed to them. The calls
+ * issued out of any such scope, for example image uploads made by the
+ * elements, are attributed to a process-wide #GstVaapiVaCallStats,
+ * which is retrieved by passing %NULL to gst_vaapi_va_calls_get_stats().
+ *
+ * Accounting is disabled by default, and then only costs a test per
+ * VA call.
+ */
+
+#include "sysdeps.h"
+#include "gstvaapivacalls.h"
+
+gint _gst_vaapi_va_calls_enabled = FALSE;
+
+/* protects all the statistics, which are updated from any thread */
+static GMutex stats_lock;
+static GstVaapiVaCallStats unattributed_stats;
+
+static GPrivate stats_stack = G_PRIVATE_INIT ((GDestroyNotify)
+    g_ptr_array_unref);
+
+static const gchar *const va_call_names[GST_VAAPI_VA_N_CALLS] = {
+  "create-buffer",
+  "map-buffer",
+  "unmap-buffer",
+  "destroy-buffer",
+  "begin-picture",
+  "render-picture",
+  "end-picture",
+  "sync-surface",
+  "query-surface-status",
+  "create-image",
+  "destroy-image",
+  "derive-image",
+  "get-image",
+  "put-image",
+  "associate-subpicture",
+  "deassociate-subpicture",
+};
+
+static GPtrArray *
+get_stats_stack (void)
+{
+  GPtrArray *stack = g_private_get (&stats_stack);
+
+  if (!stack) {
+    stack = g_ptr_array_new ();
+    g_private_set (&stats_stack, stack);
+  }
+  return stack;
+}
+
+/**
+ * gst_vaapi_va_calls_set_enabled:
+ * @enabled: whether to account the VA calls
+ *
+ * Enables or disables the VA call accounting, for the whole process.
+ */
+void
+gst_vaapi_va_calls_set_enabled (gboolean enabled)
+{
+  g_atomic_int_set (&_gst_vaapi_va_calls_enabled, enabled ? TRUE : FALSE);
+}
+
+/**
+ * gst_vaapi_va_calls_get_enabled:
+ *
+ * Return value: %TRUE if the VA calls are accounted
+ */
+gboolean
+gst_vaapi_va_calls_get_enabled (void)
+{
+  return g_atomic_int_get (&_gst_vaapi_va_calls_enabled);
+}
+
+/**
+ * gst_vaapi_va_calls_record:
+ * @call: the #GstVaapiVaCall that completed
+ * @start: the time the call was issued
+ *
+ * Accounts @call to the #GstVaapiVaCallStats of the current thread.
+ * This is normally called through GST_VAAPI_VA_CALL().
+ */
+void
+gst_vaapi_va_calls_record (GstVaapiVaCall call, GstClockTime start)
+{
+  const GstClockTime now = gst_util_get_timestamp ();
+  GPtrArray *const stack = get_stats_stack ();
+  GstVaapiVaCallStats *stats;
+
+  g_return_if_fail (call < GST_VAAPI_VA_N_CALLS);
+
+  stats = stack->len > 0 ? g_ptr_array_index (stack, stack->len - 1) :
+      &unattributed_stats;
+
+  g_mutex_lock (&stats_lock);
+  stats->calls[call].count++;
+  if (now > start)
+    stats->calls[call].time += now - start;
+  g_mutex_unlock (&stats_lock);
+}
+
+/**
+ * gst_vaapi_va_calls_push:
+ * @stats: the #GstVaapiVaCallStats of a decoder, encoder or filter
+ *
+ * Attributes the VA calls issued by the current thread to @stats,
+ * until the matching gst_vaapi_va_calls_pop().
+ */
+void
+gst_vaapi_va_calls_push (GstVaapiVaCallStats * stats)
+{
+  g_return_if_fail (stats != NULL);
+
+  g_ptr_array_add (get_stats_stack (), stats);
+}
+
+/**
+ * gst_vaapi_va_calls_pop:
+ *
+ * Restores the attribution of the VA calls in effect before the last
+ * gst_vaapi_va_calls_push() made by the current thread.
+ */
+void
+gst_vaapi_va_calls_pop (void)
+{
+  GPtrArray *const stack = get_stats_stack ();
+
+  g_return_if_fail (stack->len > 0);
+
+  g_ptr_array_set_size (stack, stack->len - 1);
+}
+
+/**
+ * gst_vaapi_va_calls_add_frame:
+ * @stats: a #GstVaapiVaCallStats
+ *
+ * Counts one more frame processed by the owner of @stats, if the
+ * accounting is enabled.
+ */
+void
+gst_vaapi_va_calls_add_frame (GstVaapiVaCallStats * stats)
+{
+  g_return_if_fail (stats != NULL);
+
+  if (G_LIKELY (!_gst_vaapi_va_calls_enabled))
+    return;
+
+  g_mutex_lock (&stats_lock);
+  stats->num_frames++;
+  g_mutex_unlock (&stats_lock);
+}
+
+/**
+ * gst_vaapi_va_calls_get_stats:
+ * @stats: (nullable): a #GstVaapiVaCallStats
+ * @out_stats: (out caller-allocates): return location for a copy
+ *
+ * Takes a consistent copy of @stats, or of the calls that could not
+ * be attributed if @stats is %NULL.
+ */
+void
+gst_vaapi_va_calls_get_stats (const GstVaapiVaCallStats * stats,
+    GstVaapiVaCallStats * out_stats)
+{
+  g_return_if_fail (out_stats != NULL);
+
+  g_mutex_lock (&stats_lock);
+  *out_stats = stats ? *stats : unattributed_stats;
+  g_mutex_unlock (&stats_lock);
+}
+
+/**
+ * gst_vaapi_va_calls_reset:
+ * @stats: (nullable): a #GstVaapiVaCallStats
+ *
+ * Clears @stats, or the calls that could not be attributed if @stats
+ * is %NULL.
+ */
+void
+gst_vaapi_va_calls_reset (GstVaapiVaCallStats * stats)
+{
+  g_mutex_lock (&stats_lock);
+  memset (stats ? stats : &unattributed_stats, 0, sizeof (*stats));
+  g_mutex_unlock (&stats_lock);
+}
+
+/**
+ * gst_vaapi_va_call_get_name:
+ * @call: a #GstVaapiVaCall
+ *
+ * Return value: a short name for @call
+ */
+const gchar *
+gst_vaapi_va_call_get_name (GstVaapiVaCall call)
+{
+  g_return_val_if_fail (call < GST_VAAPI_VA_N_CALLS, NULL);
+
+  return va_call_names[call];
+}
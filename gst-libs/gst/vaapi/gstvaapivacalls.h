@@ -0,0 +1,138 @@
+/*
+ *  gstvaapivacalls.h - VA call accounting
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_VA_CALLS_H
+#define GST_VAAPI_VA_CALLS_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVaapiVaCallCounter GstVaapiVaCallCounter;
+typedef struct _GstVaapiVaCallStats GstVaapiVaCallStats;
+
+/**
+ * GstVaapiVaCall:
+ *
+ * The VA calls issued on the frame processing paths, as accounted by
+ * #GstVaapiVaCallStats.
+ */
+typedef enum
+{
+  GST_VAAPI_VA_CREATE_BUFFER = 0,
+  GST_VAAPI_VA_MAP_BUFFER,
+  GST_VAAPI_VA_UNMAP_BUFFER,
+  GST_VAAPI_VA_DESTROY_BUFFER,
+  GST_VAAPI_VA_BEGIN_PICTURE,
+  GST_VAAPI_VA_RENDER_PICTURE,
+  GST_VAAPI_VA_END_PICTURE,
+  GST_VAAPI_VA_SYNC_SURFACE,
+  GST_VAAPI_VA_QUERY_SURFACE_STATUS,
+  GST_VAAPI_VA_CREATE_IMAGE,
+  GST_VAAPI_VA_DESTROY_IMAGE,
+  GST_VAAPI_VA_DERIVE_IMAGE,
+  GST_VAAPI_VA_GET_IMAGE,
+  GST_VAAPI_VA_PUT_IMAGE,
+  GST_VAAPI_VA_ASSOCIATE_SUBPICTURE,
+  GST_VAAPI_VA_DEASSOCIATE_SUBPICTURE,
+
+  GST_VAAPI_VA_N_CALLS
+} GstVaapiVaCall;
+
+/**
+ * GstVaapiVaCallCounter:
+ * @count: number of calls
+ * @time: accumulated time spent in the calls
+ *
+ * Accounting of one #GstVaapiVaCall.
+ */
+struct _GstVaapiVaCallCounter
+{
+  guint64 count;
+  GstClockTime time;
+};
+
+/**
+ * GstVaapiVaCallStats:
+ * @num_frames: number of frames processed by the owner
+ * @calls: accounting of each #GstVaapiVaCall
+ *
+ * The VA calls issued by a decoder, an encoder or a filter, while
+ * accounting is enabled with gst_vaapi_va_calls_set_enabled().
+ */
+struct _GstVaapiVaCallStats
+{
+  guint64 num_frames;
+  GstVaapiVaCallCounter calls[GST_VAAPI_VA_N_CALLS];
+};
+
+extern gint _gst_vaapi_va_calls_enabled;
+
+#define GST_VAAPI_VA_CALL_START()                                       \
+  (G_UNLIKELY (_gst_vaapi_va_calls_enabled) ?                           \
+      gst_util_get_timestamp () : GST_CLOCK_TIME_NONE)
+
+/**
+ * GST_VAAPI_VA_CALL:
+ * @call: the #GstVaapiVaCall
+ * @status: the variable receiving the #VAStatus
+ * @expr: the VA call expression
+ *
+ * Evaluates @expr into @status, accounting it as @call to the
+ * #GstVaapiVaCallStats of the current thread when accounting is
+ * enabled.
+ */
+#define GST_VAAPI_VA_CALL(call, status, expr) G_STMT_START {           \
+    const GstClockTime _va_call_start = GST_VAAPI_VA_CALL_START ();     \
+    status = (expr);                                                    \
+    if (G_UNLIKELY (_va_call_start != GST_CLOCK_TIME_NONE))             \
+      gst_vaapi_va_calls_record (call, _va_call_start);                 \
+  } G_STMT_END
+
+void
+gst_vaapi_va_calls_set_enabled (gboolean enabled);
+
+gboolean
+gst_vaapi_va_calls_get_enabled (void);
+
+void
+gst_vaapi_va_calls_record (GstVaapiVaCall call, GstClockTime start);
+
+void
+gst_vaapi_va_calls_push (GstVaapiVaCallStats * stats);
+
+void
+gst_vaapi_va_calls_pop (void);
+
+void
+gst_vaapi_va_calls_add_frame (GstVaapiVaCallStats * stats);
+
+void
+gst_vaapi_va_calls_get_stats (const GstVaapiVaCallStats * stats,
+    GstVaapiVaCallStats * out_stats);
+
+void
+gst_vaapi_va_calls_reset (GstVaapiVaCallStats * stats);
+
+const gchar *
+gst_vaapi_va_call_get_name (GstVaapiVaCall call);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_VA_CALLS_H */
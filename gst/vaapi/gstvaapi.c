@@ -26,10 +26,14 @@
 #include "gstvaapidecode.h"
 #include "gstvaapioverlay.h"
 #include "gstvaapipostproc.h"
+#include "gstvaapiscaleladder.h"
 #include "gstvaapisink.h"
 #include "gstvaapidecodebin.h"
+#include "gstvaapilatencytracer.h"
 
 #if USE_ENCODERS
+#include <gst/vaapi/gstvaapiencoder_qpmap.h>
+#include <gst/vaapi/gstvaapiencoder_tlayers.h>
 #include "gstvaapiencode_h264.h"
 #include "gstvaapiencode_mpeg2.h"
 #include "gstvaapiencode_jpeg.h"
@@ -187,6 +191,7 @@ plugin_init (GstPlugin * plugin)
   guint rank;
 
   plugin_add_dependencies (plugin);
+  gst_vaapi_plugin_base_init_va_calls ();
 
   display = gst_vaapi_create_test_display ();
   if (!display)
@@ -203,8 +208,11 @@ plugin_init (GstPlugin * plugin)
     g_array_unref (decoders);
   }
 
-  if (_gst_vaapi_has_video_processing)
+  if (_gst_vaapi_has_video_processing) {
     gst_vaapioverlay_register (plugin, display);
+    gst_element_register (plugin, "vaapiscaleladder",
+        GST_RANK_NONE, GST_TYPE_VAAPI_SCALE_LADDER);
+  }
 
   gst_element_register (plugin, "vaapipostproc",
       GST_RANK_NONE, GST_TYPE_VAAPIPOSTPROC);
@@ -218,9 +226,18 @@ plugin_init (GstPlugin * plugin)
   gst_element_register (plugin, "vaapisink", rank, GST_TYPE_VAAPISINK);
 
 #if USE_ENCODERS
+  /* so that applications can attach QP maps, and look up the temporal
+     layers of the coded frames, by name */
+  gst_vaapi_qp_map_meta_get_info ();
+  gst_vaapi_temporal_layer_meta_get_info ();
   gst_vaapiencode_register (plugin, display);
 #endif
 
+#ifndef GST_DISABLE_GST_TRACER_HOOKS
+  gst_tracer_register (plugin, "vaapilatency",
+      GST_TYPE_VAAPI_LATENCY_TRACER);
+#endif
+
   gst_object_unref (display);
 
   return TRUE;
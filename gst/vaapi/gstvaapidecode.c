@@ -773,6 +773,14 @@ gst_vaapidecode_handle_frame (GstVideoDecoder * vdec,
     break;
   }
 
+  if (gst_vaapi_va_calls_get_enabled ()) {
+    GstVaapiVaCallStats stats;
+
+    gst_vaapi_decoder_get_va_call_stats (decode->decoder, &stats);
+    gst_vaapi_plugin_base_post_va_calls (GST_VAAPI_PLUGIN_BASE (decode),
+        &stats);
+  }
+
   /* Note that gst_vaapi_decoder_decode cannot return success without
      completing the decode and pushing all decoded frames into the output
      queue */
@@ -25,6 +25,7 @@
 #include <gst/vaapi/gstvaapivalue.h>
 #include <gst/vaapi/gstvaapidisplay.h>
 #include <gst/vaapi/gstvaapiprofilecaps.h>
+#include <gst/vaapi/gstvaapiencoder_tlayers.h>
 #include "gstvaapiencode.h"
 #include "gstvaapipluginutil.h"
 #include "gstvaapivideometa.h"
@@ -209,6 +210,114 @@ error_copy_buffer:
   }
 }
 
+static void
+ensure_frame_stats (GstVaapiEncode * encode)
+{
+  g_object_get (encode->encoder, "frame-stats", &encode->frame_stats,
+      "stats-interval", &encode->stats_interval, NULL);
+  gst_vaapi_encoder_stats_summary_reset (&encode->stats_summary);
+}
+
+/* Resets the model of the decoder buffer, if the output is to be
+   verified against it, or its fullness reported in the statistics */
+static void
+ensure_hrd_verifier (GstVaapiEncode * encode)
+{
+  guint bitrate, buffer_size, initial_fullness;
+  gboolean constant_bitrate, enabled = FALSE;
+
+  g_object_get (encode->encoder, "verify-hrd", &enabled, NULL);
+  encode->verify_hrd = enabled;
+  encode->model_hrd = (enabled || encode->frame_stats ||
+      encode->stats_interval > 0) &&
+      gst_vaapi_encoder_get_hrd_params (encode->encoder, &bitrate,
+      &buffer_size, &initial_fullness, &constant_bitrate);
+  if (!encode->model_hrd) {
+    if (enabled)
+      GST_WARNING_OBJECT (encode, "no HRD buffer to verify, the rate control "
+          "has to be cbr or vbr");
+    return;
+  }
+
+  gst_vaapi_hrd_verifier_init (&encode->hrd, bitrate, buffer_size,
+      initial_fullness, constant_bitrate);
+  GST_INFO_OBJECT (encode, "verifying a HRD buffer of %u bits at %u bps",
+      buffer_size, bitrate);
+}
+
+/* Feeds a coded frame to the model of the decoder buffer, and posts a
+   "GstVaapiHrdViolation" element message if it does not conform. Returns
+   the fullness of the buffer before the frame, or -1 */
+static gint64
+verify_hrd (GstVaapiEncode * encode, GstVideoCodecFrame * frame, gsize size)
+{
+  const GstVideoInfo *const vip = &encode->input_state->info;
+  GstVaapiHrdStatus status;
+  GstClockTime removal_time;
+  GstStructure *structure;
+  guint fullness;
+
+  /* the frames leave the buffer in decoding order, at the frame rate */
+  if (GST_VIDEO_INFO_FPS_N (vip) > 0) {
+    removal_time = gst_util_uint64_scale (encode->hrd.num_frames,
+        GST_VIDEO_INFO_FPS_D (vip) * GST_SECOND, GST_VIDEO_INFO_FPS_N (vip));
+  } else
+    removal_time = frame->pts;
+  if (!GST_CLOCK_TIME_IS_VALID (removal_time))
+    return -1;
+
+  status = gst_vaapi_hrd_verifier_add_frame (&encode->hrd, removal_time,
+      size * 8, &fullness);
+  GST_LOG_OBJECT (encode, "HRD buffer at %u/%u bits before frame %"
+      GST_TIME_FORMAT " (%" G_GSIZE_FORMAT " bits)", fullness,
+      encode->hrd.buffer_size, GST_TIME_ARGS (frame->pts), size * 8);
+  if (status == GST_VAAPI_HRD_STATUS_OK || !encode->verify_hrd)
+    return fullness;
+
+  GST_WARNING_OBJECT (encode, "HRD buffer %s at frame %" GST_TIME_FORMAT,
+      status == GST_VAAPI_HRD_STATUS_UNDERFLOW ? "underflow" : "overflow",
+      GST_TIME_ARGS (frame->pts));
+
+  structure = gst_structure_new ("GstVaapiHrdViolation",
+      "event", G_TYPE_STRING,
+      status == GST_VAAPI_HRD_STATUS_UNDERFLOW ? "underflow" : "overflow",
+      "pts", G_TYPE_UINT64, frame->pts,
+      "frame-size", G_TYPE_UINT, (guint) (size * 8),
+      "fullness", G_TYPE_UINT, fullness,
+      "buffer-size", G_TYPE_UINT, encode->hrd.buffer_size,
+      "underflows", G_TYPE_UINT64, encode->hrd.num_underflows,
+      "overflows", G_TYPE_UINT64, encode->hrd.num_overflows, NULL);
+  gst_element_post_message (GST_ELEMENT_CAST (encode),
+      gst_message_new_element (GST_OBJECT_CAST (encode), structure));
+  return fullness;
+}
+
+/* Attaches the statistics of a coded frame to its buffer, and posts
+   them summed up as a "GstVaapiEncoderStats" element message every
+   stats-interval frames */
+static void
+report_frame_stats (GstVaapiEncode * encode, GstVideoCodecFrame * frame,
+    GstBuffer * buffer, const GstVaapiEncoderFrameStats * stats)
+{
+  GstVaapiEncoderStatsSummary *const summary = &encode->stats_summary;
+  GstStructure *structure;
+
+  if (encode->frame_stats)
+    gst_vaapi_buffer_add_encoder_stats (buffer, stats);
+
+  if (encode->stats_interval == 0)
+    return;
+
+  gst_vaapi_encoder_stats_summary_add (summary, stats, frame->duration);
+  if (summary->num_frames < encode->stats_interval)
+    return;
+
+  structure = gst_vaapi_encoder_stats_summary_to_structure (summary);
+  gst_vaapi_encoder_stats_summary_reset (summary);
+  gst_element_post_message (GST_ELEMENT_CAST (encode),
+      gst_message_new_element (GST_OBJECT_CAST (encode), structure));
+}
+
 static gboolean
 ensure_output_state (GstVaapiEncode * encode)
 {
@@ -239,6 +348,9 @@ ensure_output_state (GstVaapiEncode * encode)
   if (!gst_video_encoder_negotiate (venc))
     return FALSE;
 
+  ensure_frame_stats (encode);
+  ensure_hrd_verifier (encode);
+
   encode->input_state_changed = FALSE;
   return TRUE;
 }
@@ -253,6 +365,10 @@ gst_vaapiencode_push_frame (GstVaapiEncode * encode, gint64 timeout)
   GstVaapiEncoderStatus status;
   GstBuffer *out_buffer;
   GstFlowReturn ret;
+  GstVaapiEncoderFrameStats stats;
+  guint temporal_id, num_layers;
+  gboolean layer_sync;
+  gint64 hrd_fullness = -1;
 
   status = gst_vaapi_encoder_get_buffer_with_timeout (encode->encoder,
       &codedbuf_proxy, timeout);
@@ -278,6 +394,29 @@ gst_vaapiencode_push_frame (GstVaapiEncode * encode, gint64 timeout)
   ret = klass->alloc_buffer (encode,
       GST_VAAPI_CODED_BUFFER_PROXY_BUFFER (codedbuf_proxy), &out_buffer);
 
+  if (ret == GST_FLOW_OK &&
+      gst_vaapi_coded_buffer_proxy_get_temporal_layer (codedbuf_proxy,
+          &temporal_id, &num_layers, &layer_sync))
+    gst_vaapi_buffer_add_temporal_layer (out_buffer, temporal_id, num_layers,
+        layer_sync);
+
+  /* the decoder buffer changes with the new rate control parameters */
+  if (gst_vaapi_coded_buffer_proxy_has_new_rate_control (codedbuf_proxy)) {
+    GST_INFO_OBJECT (encode, "rate control updated at %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (out_frame->pts));
+    ensure_hrd_verifier (encode);
+  }
+
+  if (ret == GST_FLOW_OK && encode->model_hrd)
+    hrd_fullness = verify_hrd (encode, out_frame,
+        gst_buffer_get_size (out_buffer));
+
+  if (ret == GST_FLOW_OK &&
+      gst_vaapi_coded_buffer_proxy_get_stats (codedbuf_proxy, &stats)) {
+    stats.hrd_fullness = hrd_fullness;
+    report_frame_stats (encode, out_frame, out_buffer, &stats);
+  }
+
   gst_vaapi_coded_buffer_proxy_replace (&codedbuf_proxy, NULL);
   if (ret != GST_FLOW_OK)
     goto error_allocate_buffer;
@@ -557,6 +696,44 @@ set_codec_state (GstVaapiEncode * encode, GstVideoCodecState * state)
   return TRUE;
 }
 
+/* Codes the pending frames and pushes all of them downstream, with the
+   current output state, so that the stream goes on after a
+   reconfiguration of the encoder */
+static gboolean
+drain_encoder (GstVaapiEncode * encode)
+{
+  GstVaapiEncoderStatus status;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  GST_VIDEO_ENCODER_STREAM_UNLOCK (encode);
+  status = gst_vaapi_encoder_flush (encode->encoder);
+  gst_pad_pause_task (GST_VAAPI_PLUGIN_BASE_SRC_PAD (encode));
+  GST_VIDEO_ENCODER_STREAM_LOCK (encode);
+  if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
+    return FALSE;
+
+  while (ret == GST_FLOW_OK)
+    ret = gst_vaapiencode_push_frame (encode, 0);
+  return ret == GST_VAAPI_ENCODE_FLOW_TIMEOUT;
+}
+
+/* Checks whether the new input only differs in framerate, which the
+   encoder applies without being drained */
+static gboolean
+is_framerate_change (GstVaapiEncode * encode, GstVideoCodecState * state)
+{
+  GstVideoInfo info;
+
+  if (!encode->input_state || GST_VIDEO_INFO_FPS_N (&state->info) <= 0
+      || GST_VIDEO_INFO_FPS_D (&state->info) <= 0)
+    return FALSE;
+
+  info = encode->input_state->info;
+  GST_VIDEO_INFO_FPS_N (&info) = GST_VIDEO_INFO_FPS_N (&state->info);
+  GST_VIDEO_INFO_FPS_D (&info) = GST_VIDEO_INFO_FPS_D (&state->info);
+  return gst_video_info_is_equal (&info, &state->info);
+}
+
 static gboolean
 gst_vaapiencode_set_format (GstVideoEncoder * venc, GstVideoCodecState * state)
 {
@@ -565,20 +742,38 @@ gst_vaapiencode_set_format (GstVideoEncoder * venc, GstVideoCodecState * state)
 
   g_return_val_if_fail (state->caps != NULL, FALSE);
 
-  if (!set_codec_state (encode, state))
-    return FALSE;
+  if (is_framerate_change (encode, state)) {
+    GST_INFO_OBJECT (encode, "framerate changed to %d/%d",
+        GST_VIDEO_INFO_FPS_N (&state->info),
+        GST_VIDEO_INFO_FPS_D (&state->info));
+    status = gst_vaapi_encoder_set_codec_state (encode->encoder, state);
+    if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
+      return FALSE;
 
-  if (!gst_vaapi_plugin_base_set_caps (GST_VAAPI_PLUGIN_BASE (encode),
-          state->caps, NULL))
-    return FALSE;
+    if (!gst_vaapi_plugin_base_set_caps (GST_VAAPI_PLUGIN_BASE (encode),
+            state->caps, NULL))
+      return FALSE;
+  } else {
+    /* a new resolution starts with an IDR frame, after the frames
+       coded at the previous one */
+    if (encode->input_state && !drain_encoder (encode))
+      return FALSE;
 
-  GST_VIDEO_ENCODER_STREAM_UNLOCK (encode);
-  status = gst_vaapi_encoder_flush (encode->encoder);
-  GST_VIDEO_ENCODER_STREAM_LOCK (encode);
-  if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
-    return FALSE;
+    if (!set_codec_state (encode, state))
+      return FALSE;
 
-  gst_vaapiencode_purge (encode);
+    if (!gst_vaapi_plugin_base_set_caps (GST_VAAPI_PLUGIN_BASE (encode),
+            state->caps, NULL))
+      return FALSE;
+
+    GST_VIDEO_ENCODER_STREAM_UNLOCK (encode);
+    status = gst_vaapi_encoder_flush (encode->encoder);
+    GST_VIDEO_ENCODER_STREAM_LOCK (encode);
+    if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
+      return FALSE;
+
+    gst_vaapiencode_purge (encode);
+  }
 
   if (encode->input_state)
     gst_video_codec_state_unref (encode->input_state);
@@ -659,6 +854,14 @@ gst_vaapiencode_handle_frame (GstVideoEncoder * venc,
   if (status < GST_VAAPI_ENCODER_STATUS_SUCCESS)
     goto error_encode_frame;
 
+  if (gst_vaapi_va_calls_get_enabled ()) {
+    GstVaapiVaCallStats stats;
+
+    gst_vaapi_encoder_get_va_call_stats (encode->encoder, &stats);
+    gst_vaapi_plugin_base_post_va_calls (GST_VAAPI_PLUGIN_BASE (encode),
+        &stats);
+  }
+
   gst_video_codec_frame_unref (frame);
   return GST_FLOW_OK;
 
@@ -26,6 +26,8 @@
 
 #include "gstvaapipluginbase.h"
 #include <gst/vaapi/gstvaapiencoder.h>
+#include <gst/vaapi/gstvaapiencoder_hrd.h>
+#include <gst/vaapi/gstvaapiencoder_stats.h>
 
 G_BEGIN_DECLS
 
@@ -174,6 +176,16 @@ struct _GstVaapiEncode
   GstVideoCodecState *output_state;
   GPtrArray *prop_values;
   GstCaps *allowed_sinkpad_caps;
+  /* model of the decoder buffer, if verify-hrd is set or the frame
+     statistics are collected */
+  gboolean model_hrd;
+  gboolean verify_hrd;
+  GstVaapiHrdVerifier hrd;
+  /* statistics of the coded frames, if frame-stats or stats-interval
+     is set */
+  gboolean frame_stats;
+  guint stats_interval;
+  GstVaapiEncoderStatsSummary stats_summary;
 };
 
 struct _GstVaapiEncodeClass
@@ -0,0 +1,597 @@
+/*
+ *  gstvaapilatencytracer.c - Per-frame latency tracer for VA-API elements
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+*/
+
+/**
+ * SECTION:tracer-vaapilatency
+ * @title: vaapilatency
+ * @short_description: Per-frame latency of the VA-API elements
+ *
+ * The vaapilatency tracer measures, for every VA-API element, the time
+ * elapsed between the arrival of a frame on its sink pad and each step
+ * of its processing: parse done, VA submission, surface sync, video
+ * processing, encode submission, coded buffer ready and finally the
+ * push of the resulting buffer downstream.
+ *
+ * The latencies are accumulated in log-scale histograms, and their
+ * mean, 50th, 90th and 99th percentiles and maximum, in nanoseconds,
+ * are logged as "vaapi-latency" tracer records once the element goes
+ * back to the NULL state. Each non-empty bucket of the histograms is
+ * then logged as a "vaapi-latency-bucket" record, with the largest
+ * latency of the bucket and the number of frames that fell in it.
+ *
+ * Steps reached from another thread than the one that brought the
+ * frame in, such as the encoder output thread, are matched with it
+ * through the frame presentation timestamp.
+ *
+ * ## Example launch line
+ *
+ * |[
+ *   GST_TRACERS=vaapilatency GST_DEBUG=GST_TRACER:7 \
+ *     gst-launch-1.0 filesrc location=in.mp4 ! qtdemux ! vaapih264dec \
+ *     ! vaapipostproc width=640 height=360 ! vaapih264enc ! fakesink
+ * ]|
+ */
+
+#include "gstcompat.h"
+#include <gst/vaapi/gstvaapitrace.h>
+
+#include "gstvaapilatencytracer.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_vaapi_latency_tracer);
+#define GST_CAT_DEFAULT gst_debug_vaapi_latency_tracer
+
+/* the frame leaves the element: last stage after the lib trace points */
+#define STAGE_PUSH              GST_VAAPI_TRACE_N_POINTS
+#define N_STAGES                (GST_VAAPI_TRACE_N_POINTS + 1)
+
+/* latencies are binned in microseconds, with 8 linear sub-buckets per
+ * power of two, i.e. less than 12.5% error, up to G_MAXUINT32 */
+#define HISTOGRAM_SUB_BITS      3
+#define HISTOGRAM_SUB_BUCKETS   (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_N_BUCKETS     (30 * HISTOGRAM_SUB_BUCKETS)
+
+/* bounds the pending frames of the elements that never push them */
+#define MAX_PENDING_FRAMES      256
+
+typedef struct _Histogram Histogram;
+struct _Histogram
+{
+  guint64 count;
+  guint64 sum;
+  guint64 max;
+  guint32 buckets[HISTOGRAM_N_BUCKETS];
+};
+
+typedef struct _PendingFrame PendingFrame;
+struct _PendingFrame
+{
+  GstClockTime pts;             /* hash table key */
+  GstClockTime arrival;
+};
+
+typedef struct _ElementStats ElementStats;
+struct _ElementStats
+{
+  gchar *name;
+  GHashTable *frames;           /* pts -> PendingFrame */
+  Histogram stages[N_STAGES];
+};
+
+/* the frame the calling thread is pushing into a VA-API element */
+typedef struct _FrameContext FrameContext;
+struct _FrameContext
+{
+  ElementStats *stats;
+  GstClockTime arrival;
+};
+
+static const gchar *const stage_push_name = "push";
+
+static GstTracerRecord *tr_latency;
+static GstTracerRecord *tr_latency_bucket;
+
+static GPrivate frame_contexts = G_PRIVATE_INIT ((GDestroyNotify)
+    g_array_unref);
+
+#define gst_vaapi_latency_tracer_parent_class parent_class
+G_DEFINE_TYPE (GstVaapiLatencyTracer, gst_vaapi_latency_tracer,
+    GST_TYPE_TRACER);
+
+static inline guint
+histogram_get_bucket (guint64 value)
+{
+  guint shift;
+
+  if (value < HISTOGRAM_SUB_BUCKETS)
+    return value;
+
+  value = MIN (value, G_MAXUINT32);
+  shift = g_bit_storage (value) - 1 - HISTOGRAM_SUB_BITS;
+  return MIN ((shift + 1) * HISTOGRAM_SUB_BUCKETS +
+      ((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1)),
+      HISTOGRAM_N_BUCKETS - 1);
+}
+
+/* Returns the largest value that falls in @bucket */
+static inline guint64
+histogram_get_bucket_limit (guint bucket)
+{
+  guint shift, sub;
+
+  if (bucket < HISTOGRAM_SUB_BUCKETS)
+    return bucket;
+
+  shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+  sub = bucket % HISTOGRAM_SUB_BUCKETS;
+  return (((guint64) HISTOGRAM_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+static void
+histogram_add (Histogram * histogram, GstClockTime latency)
+{
+  const guint64 value = latency / GST_USECOND;
+
+  histogram->count++;
+  histogram->sum += value;
+  histogram->max = MAX (histogram->max, value);
+  histogram->buckets[histogram_get_bucket (value)]++;
+}
+
+static guint64
+histogram_get_percentile (const Histogram * histogram, guint percent)
+{
+  guint64 rank, count = 0;
+  guint i;
+
+  rank = MAX ((histogram->count * percent + 99) / 100, 1);
+  for (i = 0; i < HISTOGRAM_N_BUCKETS; i++) {
+    count += histogram->buckets[i];
+    if (count >= rank)
+      break;
+  }
+  return MIN (histogram_get_bucket_limit (i), histogram->max);
+}
+
+static ElementStats *
+element_stats_new (GstElement * element)
+{
+  ElementStats *const stats = g_new0 (ElementStats, 1);
+
+  stats->name = gst_object_get_name (GST_OBJECT_CAST (element));
+  stats->frames = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+      NULL, g_free);
+  return stats;
+}
+
+static void
+element_stats_free (ElementStats * stats)
+{
+  g_hash_table_destroy (stats->frames);
+  g_free (stats->name);
+  g_free (stats);
+}
+
+static void
+element_stats_report (ElementStats * stats)
+{
+  guint i, j;
+
+  for (i = 0; i < N_STAGES; i++) {
+    const Histogram *const histogram = &stats->stages[i];
+    const gchar *stage;
+
+    if (histogram->count == 0)
+      continue;
+
+    if (i == STAGE_PUSH)
+      stage = stage_push_name;
+    else
+      stage = gst_vaapi_trace_point_get_name (i);
+    gst_tracer_record_log (tr_latency, stats->name, stage, histogram->count,
+        histogram->sum / histogram->count * GST_USECOND,
+        histogram_get_percentile (histogram, 50) * GST_USECOND,
+        histogram_get_percentile (histogram, 90) * GST_USECOND,
+        histogram_get_percentile (histogram, 99) * GST_USECOND,
+        histogram->max * GST_USECOND);
+
+    for (j = 0; j < HISTOGRAM_N_BUCKETS; j++) {
+      if (histogram->buckets[j] == 0)
+        continue;
+      gst_tracer_record_log (tr_latency_bucket, stats->name, stage,
+          (histogram_get_bucket_limit (j) + 1) * GST_USECOND - 1,
+          (guint64) histogram->buckets[j]);
+    }
+  }
+}
+
+static GstClockTime
+element_stats_lookup_frame (ElementStats * stats, GstClockTime pts)
+{
+  PendingFrame *const frame = g_hash_table_lookup (stats->frames, &pts);
+
+  return frame ? frame->arrival : GST_CLOCK_TIME_NONE;
+}
+
+/* Records the push of the frame @pts out of the element, and forgets
+   the frame */
+static void
+element_stats_push_frame (ElementStats * stats, GstClockTime pts,
+    GstClockTime ts)
+{
+  PendingFrame *const frame = g_hash_table_lookup (stats->frames, &pts);
+
+  if (!frame)
+    return;
+
+  if (ts >= frame->arrival)
+    histogram_add (&stats->stages[STAGE_PUSH], ts - frame->arrival);
+  g_hash_table_remove (stats->frames, &pts);
+}
+
+static void
+element_stats_add_frame (ElementStats * stats, GstClockTime pts,
+    GstClockTime ts)
+{
+  PendingFrame *frame;
+
+  if (g_hash_table_size (stats->frames) >= MAX_PENDING_FRAMES)
+    g_hash_table_remove_all (stats->frames);
+
+  frame = g_new (PendingFrame, 1);
+  frame->pts = pts;
+  frame->arrival = ts;
+  g_hash_table_replace (stats->frames, &frame->pts, frame);
+}
+
+static gboolean
+is_vaapi_element (GstObject * object)
+{
+  GstElementFactory *factory;
+
+  if (!GST_IS_ELEMENT (object) || GST_IS_BIN (object))
+    return FALSE;
+
+  factory = gst_element_get_factory (GST_ELEMENT_CAST (object));
+  if (!factory)
+    return FALSE;
+  return g_str_has_prefix (GST_OBJECT_NAME (factory), "vaapi");
+}
+
+/* Called with the tracer lock held */
+static ElementStats *
+get_element_stats (GstVaapiLatencyTracer * tracer, GstObject * object)
+{
+  ElementStats *stats;
+
+  if (!is_vaapi_element (object))
+    return NULL;
+
+  stats = g_hash_table_lookup (tracer->elements, object);
+  if (!stats) {
+    stats = element_stats_new (GST_ELEMENT_CAST (object));
+    g_hash_table_insert (tracer->elements, object, stats);
+  }
+  return stats;
+}
+
+static void
+lib_object_finalized (gpointer data, GObject * object)
+{
+  GstVaapiLatencyTracer *const tracer = data;
+
+  g_mutex_lock (&tracer->lock);
+  g_hash_table_remove (tracer->objects, object);
+  g_mutex_unlock (&tracer->lock);
+}
+
+/* Attributes the lib @object to @stats, until @object is finalized.
+   Called with the tracer lock held */
+static void
+set_lib_object_stats (GstVaapiLatencyTracer * tracer, gpointer object,
+    ElementStats * stats)
+{
+  if (!g_hash_table_contains (tracer->objects, object))
+    g_object_weak_ref (object, lib_object_finalized, tracer);
+  g_hash_table_insert (tracer->objects, object, stats);
+}
+
+/* Forgets the lib objects attributed to @stats, or all of them if
+   @stats is %NULL. Called with the tracer lock held */
+static void
+remove_lib_objects (GstVaapiLatencyTracer * tracer, ElementStats * stats)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_hash_table_iter_init (&iter, tracer->objects);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    if (stats && value != stats)
+      continue;
+    g_object_weak_unref (key, lib_object_finalized, tracer);
+    g_hash_table_iter_remove (&iter);
+  }
+}
+
+static GArray *
+get_frame_contexts (void)
+{
+  GArray *contexts = g_private_get (&frame_contexts);
+
+  if (!contexts) {
+    contexts = g_array_new (FALSE, FALSE, sizeof (FrameContext));
+    g_private_set (&frame_contexts, contexts);
+  }
+  return contexts;
+}
+
+/* Records the frames of @list, or @buffer, leaving the element of
+   @pad for its peer element */
+static void
+push_frames_pre (GstVaapiLatencyTracer * tracer, GstClockTime ts,
+    GstPad * pad, GstBuffer * buffer, GstBufferList * list)
+{
+  GArray *const contexts = get_frame_contexts ();
+  FrameContext context = { NULL, ts };
+  GstObject *const object = GST_OBJECT_PARENT (pad);
+  GstObject *parent;
+  GstPad *peer;
+  ElementStats *stats;
+  guint i, n_buffers;
+
+  peer = gst_pad_get_peer (pad);
+  parent = peer ? gst_object_get_parent (GST_OBJECT_CAST (peer)) : NULL;
+  n_buffers = list ? gst_buffer_list_length (list) : 1;
+
+  g_mutex_lock (&tracer->lock);
+
+  stats = get_element_stats (tracer, object);
+  if (parent)
+    context.stats = get_element_stats (tracer, parent);
+
+  for (i = 0; i < n_buffers; i++) {
+    GstBuffer *const buf = list ? gst_buffer_list_get (list, i) : buffer;
+    const GstClockTime pts = GST_BUFFER_PTS (buf);
+
+    if (!GST_CLOCK_TIME_IS_VALID (pts))
+      continue;
+
+    /* the frame leaves the pushing element */
+    if (stats)
+      element_stats_push_frame (stats, pts, ts);
+
+    /* ... and enters the peer element, from this thread */
+    if (context.stats)
+      element_stats_add_frame (context.stats, pts, ts);
+  }
+
+  g_mutex_unlock (&tracer->lock);
+
+  /* pushed unconditionally, to be balanced by push_frames_post() */
+  g_array_append_val (contexts, context);
+
+  if (parent)
+    gst_object_unref (parent);
+  if (peer)
+    gst_object_unref (peer);
+}
+
+static void
+push_frames_post (void)
+{
+  GArray *const contexts = get_frame_contexts ();
+
+  if (contexts->len > 0)
+    g_array_set_size (contexts, contexts->len - 1);
+}
+
+static void
+do_push_buffer_pre (GstVaapiLatencyTracer * tracer, GstClockTime ts,
+    GstPad * pad, GstBuffer * buffer)
+{
+  push_frames_pre (tracer, ts, pad, buffer, NULL);
+}
+
+static void
+do_push_buffer_post (GstVaapiLatencyTracer * tracer, GstClockTime ts,
+    GstPad * pad, GstFlowReturn res)
+{
+  push_frames_post ();
+}
+
+static void
+do_push_buffer_list_pre (GstVaapiLatencyTracer * tracer, GstClockTime ts,
+    GstPad * pad, GstBufferList * list)
+{
+  push_frames_pre (tracer, ts, pad, NULL, list);
+}
+
+static void
+do_push_buffer_list_post (GstVaapiLatencyTracer * tracer, GstClockTime ts,
+    GstPad * pad, GstFlowReturn res)
+{
+  push_frames_post ();
+}
+
+static void
+do_element_change_state_post (GstVaapiLatencyTracer * tracer,
+    GstClockTime ts, GstElement * element, GstStateChange transition,
+    GstStateChangeReturn result)
+{
+  ElementStats *stats;
+
+  if (transition != GST_STATE_CHANGE_READY_TO_NULL)
+    return;
+
+  g_mutex_lock (&tracer->lock);
+  stats = g_hash_table_lookup (tracer->elements, element);
+  if (stats) {
+    remove_lib_objects (tracer, stats);
+    g_hash_table_steal (tracer->elements, element);
+  }
+  g_mutex_unlock (&tracer->lock);
+
+  if (stats) {
+    element_stats_report (stats);
+    element_stats_free (stats);
+  }
+}
+
+/* Receives the trace points of the VA-API library */
+static void
+trace_point_cb (GstVaapiTracePoint point, gpointer object, GstClockTime pts,
+    gpointer user_data)
+{
+  GstVaapiLatencyTracer *const tracer = user_data;
+  const GstClockTime ts = gst_util_get_timestamp ();
+  GArray *const contexts = get_frame_contexts ();
+  FrameContext *context = NULL;
+  ElementStats *stats;
+  GstClockTime arrival = GST_CLOCK_TIME_NONE;
+
+  if (contexts->len > 0)
+    context = &g_array_index (contexts, FrameContext, contexts->len - 1);
+
+  g_mutex_lock (&tracer->lock);
+
+  /* learn which element drives the lib object, so that the trace
+   * points reached later from its other threads can be attributed */
+  if (context && context->stats) {
+    stats = context->stats;
+    if (object)
+      set_lib_object_stats (tracer, object, stats);
+  } else {
+    stats = object ? g_hash_table_lookup (tracer->objects, object) : NULL;
+  }
+  if (!stats)
+    goto done;
+
+  if (GST_CLOCK_TIME_IS_VALID (pts))
+    arrival = element_stats_lookup_frame (stats, pts);
+  if (!GST_CLOCK_TIME_IS_VALID (arrival) && context && context->stats == stats)
+    arrival = context->arrival;
+  if (GST_CLOCK_TIME_IS_VALID (arrival) && ts >= arrival)
+    histogram_add (&stats->stages[point], ts - arrival);
+
+done:
+  g_mutex_unlock (&tracer->lock);
+}
+
+static void
+gst_vaapi_latency_tracer_finalize (GObject * object)
+{
+  GstVaapiLatencyTracer *const tracer = GST_VAAPI_LATENCY_TRACER (object);
+  GHashTableIter iter;
+  gpointer value;
+
+  gst_vaapi_trace_set_func (NULL, NULL);
+
+  g_hash_table_iter_init (&iter, tracer->elements);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    element_stats_report (value);
+
+  g_mutex_lock (&tracer->lock);
+  remove_lib_objects (tracer, NULL);
+  g_mutex_unlock (&tracer->lock);
+  g_hash_table_destroy (tracer->objects);
+  g_hash_table_destroy (tracer->elements);
+  g_mutex_clear (&tracer->lock);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_vaapi_latency_tracer_class_init (GstVaapiLatencyTracerClass * klass)
+{
+  GObjectClass *const object_class = G_OBJECT_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_debug_vaapi_latency_tracer, "vaapilatency",
+      0, "VA-API latency tracer");
+
+  object_class->finalize = gst_vaapi_latency_tracer_finalize;
+
+#define UINT64_VALUE(desc) \
+  gst_structure_new ("value", \
+      "type", G_TYPE_GTYPE, G_TYPE_UINT64, \
+      "description", G_TYPE_STRING, desc, \
+      "min", G_TYPE_UINT64, G_GUINT64_CONSTANT (0), \
+      "max", G_TYPE_UINT64, G_MAXUINT64, NULL)
+
+  tr_latency = gst_tracer_record_new ("vaapi-latency.class",
+      "element", GST_TYPE_STRUCTURE, gst_structure_new ("scope",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "related-to", GST_TYPE_TRACER_VALUE_SCOPE,
+          GST_TRACER_VALUE_SCOPE_ELEMENT, NULL),
+      "stage", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "description", G_TYPE_STRING, "processing step of the frames",
+          NULL),
+      "count", GST_TYPE_STRUCTURE, UINT64_VALUE ("number of frames"),
+      "mean", GST_TYPE_STRUCTURE, UINT64_VALUE ("mean latency in ns"),
+      "p50", GST_TYPE_STRUCTURE, UINT64_VALUE ("median latency in ns"),
+      "p90", GST_TYPE_STRUCTURE,
+      UINT64_VALUE ("90th percentile latency in ns"),
+      "p99", GST_TYPE_STRUCTURE,
+      UINT64_VALUE ("99th percentile latency in ns"),
+      "max", GST_TYPE_STRUCTURE, UINT64_VALUE ("maximum latency in ns"),
+      NULL);
+  GST_OBJECT_FLAG_SET (tr_latency, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+
+  tr_latency_bucket = gst_tracer_record_new ("vaapi-latency-bucket.class",
+      "element", GST_TYPE_STRUCTURE, gst_structure_new ("scope",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "related-to", GST_TYPE_TRACER_VALUE_SCOPE,
+          GST_TRACER_VALUE_SCOPE_ELEMENT, NULL),
+      "stage", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "description", G_TYPE_STRING, "processing step of the frames",
+          NULL),
+      "upper", GST_TYPE_STRUCTURE,
+      UINT64_VALUE ("largest latency of the bucket in ns"),
+      "count", GST_TYPE_STRUCTURE,
+      UINT64_VALUE ("number of frames in the bucket"), NULL);
+  GST_OBJECT_FLAG_SET (tr_latency_bucket, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+
+#undef UINT64_VALUE
+}
+
+static void
+gst_vaapi_latency_tracer_init (GstVaapiLatencyTracer * tracer)
+{
+  GstTracer *const base = GST_TRACER (tracer);
+
+  g_mutex_init (&tracer->lock);
+  tracer->elements = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) element_stats_free);
+  tracer->objects = g_hash_table_new (NULL, NULL);
+
+#ifndef GST_DISABLE_GST_TRACER_HOOKS
+  gst_tracing_register_hook (base, "pad-push-pre",
+      G_CALLBACK (do_push_buffer_pre));
+  gst_tracing_register_hook (base, "pad-push-post",
+      G_CALLBACK (do_push_buffer_post));
+  gst_tracing_register_hook (base, "pad-push-list-pre",
+      G_CALLBACK (do_push_buffer_list_pre));
+  gst_tracing_register_hook (base, "pad-push-list-post",
+      G_CALLBACK (do_push_buffer_list_post));
+  gst_tracing_register_hook (base, "element-change-state-post",
+      G_CALLBACK (do_element_change_state_post));
+#endif
+
+  gst_vaapi_trace_set_func (trace_point_cb, tracer);
+}
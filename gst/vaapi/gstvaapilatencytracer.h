@@ -0,0 +1,57 @@
+/*
+ *  gstvaapilatencytracer.h - Per-frame latency tracer for VA-API elements
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+*/
+
+#ifndef GST_VAAPI_LATENCY_TRACER_H
+#define GST_VAAPI_LATENCY_TRACER_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_VAAPI_LATENCY_TRACER \
+  (gst_vaapi_latency_tracer_get_type ())
+#define GST_VAAPI_LATENCY_TRACER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_VAAPI_LATENCY_TRACER, \
+      GstVaapiLatencyTracer))
+#define GST_IS_VAAPI_LATENCY_TRACER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_TYPE_VAAPI_LATENCY_TRACER))
+
+typedef struct _GstVaapiLatencyTracer GstVaapiLatencyTracer;
+typedef struct _GstVaapiLatencyTracerClass GstVaapiLatencyTracerClass;
+
+struct _GstVaapiLatencyTracer
+{
+  GstTracer parent_instance;
+
+  GMutex lock;
+  GHashTable *elements;         /* GstElement -> ElementStats */
+  GHashTable *objects;          /* weak lib object -> ElementStats */
+};
+
+struct _GstVaapiLatencyTracerClass
+{
+  GstTracerClass parent_class;
+};
+
+GType
+gst_vaapi_latency_tracer_get_type (void) G_GNUC_CONST;
+
+G_END_DECLS
+
+#endif
@@ -31,6 +31,11 @@
  *
  * Currently this element only works with iHD driver.
  *
+ * Layers that did not change since the previous output frame (same
+ * input buffer, position, size and alpha) are not blended again: the
+ * lowest run of unchanged layers is kept composed in an intermediate
+ * surface, on top of which only the changed layers are blended.
+ *
  * ## Example launch line
  *
  * |[
@@ -87,18 +92,33 @@ static GstStaticPadTemplate gst_vaapi_overlay_src_factory =
 G_DEFINE_TYPE (GstVaapiOverlaySinkPad, gst_vaapi_overlay_sink_pad,
     GST_TYPE_VIDEO_AGGREGATOR_PAD);
 
+typedef struct _GstVaapiOverlayLayer GstVaapiOverlayLayer;
+struct _GstVaapiOverlayLayer
+{
+  GstBuffer *inbuf;             /* NULL if the sink pad has no buffer */
+  GstVaapiBlendSurface blend_surface;
+};
+
 typedef struct _GstVaapiOverlaySurfaceGenerator GstVaapiOverlaySurfaceGenerator;
 struct _GstVaapiOverlaySurfaceGenerator
 {
-  GstVaapiOverlay *overlay;
-  GList *current;
-  GstVaapiBlendSurface blend_surface;
+  GstVaapiBlendSurface *base;
+  GstVaapiOverlayLayer *layers;
+  guint current;
+  guint end;
+  guint count;
 };
 
 #define DEFAULT_PAD_XPOS   0
 #define DEFAULT_PAD_YPOS   0
 #define DEFAULT_PAD_ALPHA  1.0
 
+enum
+{
+  PROP_0,
+  PROP_STATS,
+};
+
 enum
 {
   PROP_PAD_0,
@@ -154,7 +174,10 @@ gst_vaapi_overlay_sink_pad_set_property (GObject * object, guint prop_id,
 static void
 gst_vaapi_overlay_sink_pad_finalize (GObject * object)
 {
-  gst_vaapi_pad_private_finalize (GST_VAAPI_OVERLAY_SINK_PAD (object)->priv);
+  GstVaapiOverlaySinkPad *const pad = GST_VAAPI_OVERLAY_SINK_PAD (object);
+
+  gst_buffer_replace (&pad->last_buffer, NULL);
+  gst_vaapi_pad_private_finalize (pad->priv);
 
   G_OBJECT_CLASS (gst_vaapi_overlay_sink_pad_parent_class)->finalize (object);
 }
@@ -188,6 +211,7 @@ gst_vaapi_overlay_sink_pad_init (GstVaapiOverlaySinkPad * pad)
   pad->xpos = DEFAULT_PAD_XPOS;
   pad->ypos = DEFAULT_PAD_YPOS;
   pad->alpha = DEFAULT_PAD_ALPHA;
+  pad->last_index = -1;
   pad->priv = gst_vaapi_pad_private_new ();
 }
 
@@ -209,11 +233,13 @@ gst_vaapi_overlay_request_new_pad (GstElement * element, GstPadTemplate * templ,
       (gst_vaapi_overlay_parent_class)->request_new_pad (element, templ,
           req_name, caps));
 
-  if (!newpad)
+  if (!newpad) {
     GST_DEBUG_OBJECT (element, "could not create/add pad");
-  else
+  } else {
     gst_child_proxy_child_added (GST_CHILD_PROXY (element), G_OBJECT (newpad),
         GST_OBJECT_NAME (newpad));
+    g_atomic_int_set (&GST_VAAPI_OVERLAY (element)->cache_reset, TRUE);
+  }
 
   return newpad;
 }
@@ -225,6 +251,7 @@ gst_vaapi_overlay_release_pad (GstElement * element, GstPad * pad)
 
   gst_child_proxy_child_removed (GST_CHILD_PROXY (overlay), G_OBJECT (pad),
       GST_OBJECT_NAME (pad));
+  g_atomic_int_set (&overlay->cache_reset, TRUE);
 
   GST_ELEMENT_CLASS (gst_vaapi_overlay_parent_class)->release_pad (element,
       pad);
@@ -304,16 +331,51 @@ gst_vaapi_overlay_start (GstAggregator * agg)
 static gboolean
 _reset_sinkpad_private (GstElement * element, GstPad * pad, gpointer user_data)
 {
-  gst_vaapi_pad_private_reset (GST_VAAPI_OVERLAY_SINK_PAD (pad)->priv);
+  GstVaapiOverlaySinkPad *const sinkpad = GST_VAAPI_OVERLAY_SINK_PAD (pad);
+
+  gst_buffer_replace (&sinkpad->last_buffer, NULL);
+  sinkpad->last_index = -1;
+  gst_vaapi_pad_private_reset (sinkpad->priv);
 
   return TRUE;
 }
 
+static void
+gst_vaapi_overlay_drop_cache (GstVaapiOverlay * overlay)
+{
+  if (overlay->cache_proxy) {
+    GST_OBJECT_LOCK (overlay);
+    overlay->num_cache_drops++;
+    GST_OBJECT_UNLOCK (overlay);
+  }
+  gst_vaapi_surface_proxy_replace (&overlay->cache_proxy, NULL);
+  overlay->cache_layers = 0;
+}
+
 static gboolean
 gst_vaapi_overlay_stop (GstAggregator * agg)
 {
   GstVaapiOverlay *const overlay = GST_VAAPI_OVERLAY (agg);
 
+  gst_vaapi_overlay_drop_cache (overlay);
+
+  GST_OBJECT_LOCK (overlay);
+  if (overlay->num_frames > 0) {
+    GST_INFO_OBJECT (overlay, "blended %" G_GUINT64_FORMAT " surfaces for %"
+        G_GUINT64_FORMAT " layers in %" G_GUINT64_FORMAT " frames, %u cache "
+        "updates, %u cache drops", overlay->num_blended, overlay->num_layers,
+        overlay->num_frames, overlay->num_cache_builds,
+        overlay->num_cache_drops);
+  }
+  overlay->num_frames = 0;
+  overlay->num_layers = 0;
+  overlay->num_blended = 0;
+  overlay->num_cache_builds = 0;
+  overlay->num_cache_hits = 0;
+  overlay->num_cache_drops = 0;
+  GST_OBJECT_UNLOCK (overlay);
+
+  g_array_set_size (overlay->layers, 0);
   gst_vaapi_video_pool_replace (&overlay->blend_pool, NULL);
   gst_vaapi_blend_replace (&overlay->blend, NULL);
 
@@ -339,6 +401,8 @@ gst_vaapi_overlay_finalize (GObject * object)
   GstVaapiOverlay *const overlay = GST_VAAPI_OVERLAY (object);
 
   gst_vaapi_overlay_destroy (overlay);
+  gst_vaapi_overlay_drop_cache (overlay);
+  g_array_unref (overlay->layers);
   gst_vaapi_plugin_base_finalize (GST_VAAPI_PLUGIN_BASE (overlay));
 
   G_OBJECT_CLASS (gst_vaapi_overlay_parent_class)->finalize (object);
@@ -359,47 +423,97 @@ gst_vaapi_overlay_decide_allocation (GstAggregator * agg, GstQuery * query)
       (GST_VAAPI_PLUGIN_BASE (agg), query);
 }
 
-static GstVaapiBlendSurface *
-gst_vaapi_overlay_surface_next (gpointer data)
+static void
+gst_vaapi_overlay_layer_clear (GstVaapiOverlayLayer * layer)
 {
-  GstVaapiOverlaySurfaceGenerator *generator;
-  GstVideoAggregatorPad *vagg_pad;
-  GstVaapiOverlaySinkPad *pad;
-  GstVideoFrame *inframe;
-  GstBuffer *inbuf;
-  GstBuffer *buf;
-  GstVaapiVideoMeta *inbuf_meta;
-  GstVaapiBlendSurface *blend_surface;
+  gst_buffer_replace (&layer->inbuf, NULL);
+}
 
-  generator = (GstVaapiOverlaySurfaceGenerator *) data;
+static inline gboolean
+rectangle_equal (const GstVaapiRectangle * a, const GstVaapiRectangle * b)
+{
+  return a->x == b->x && a->y == b->y &&
+      a->width == b->width && a->height == b->height;
+}
 
-  /* at the end of the generator? */
-  while (generator->current) {
-    /* get the current video aggregator sinkpad */
-    vagg_pad = GST_VIDEO_AGGREGATOR_PAD (generator->current->data);
+/* Records @layer, made from @buf, as the last layer blended from @pad
+ * at position @index, and returns whether it changed since the
+ * previous frame. A layer moved by a zorder change counts as changed */
+static gboolean
+gst_vaapi_overlay_sink_pad_update (GstVaapiOverlaySinkPad * pad,
+    GstBuffer * buf, const GstVaapiOverlayLayer * layer, gint index)
+{
+  const GstVaapiBlendSurface *const blend_surface = &layer->blend_surface;
+  GstVaapiRectangle crop = { 0, };
+  gboolean changed;
+
+  if (buf && blend_surface->crop)
+    crop = *blend_surface->crop;
+
+  /* the last buffer is kept alive, so a new buffer cannot reuse it */
+  changed = buf != pad->last_buffer || index != pad->last_index;
+  if (buf && !changed) {
+    changed = !rectangle_equal (&crop, &pad->last_crop) ||
+        !rectangle_equal (&blend_surface->target, &pad->last_target) ||
+        blend_surface->alpha != pad->last_alpha;
+  }
+
+  gst_buffer_replace (&pad->last_buffer, buf);
+  pad->last_crop = crop;
+  pad->last_target = blend_surface->target;
+  pad->last_alpha = blend_surface->alpha;
+  pad->last_index = index;
+  return changed;
+}
+
+/* Fetches the current layer of every sink pad, from the bottom to the
+ * top, and the number of lowest layers unchanged since the previous
+ * frame */
+static gboolean
+gst_vaapi_overlay_collect_layers (GstVaapiOverlay * overlay,
+    guint * num_stable_ptr)
+{
+  GArray *const layers = overlay->layers;
+  guint num_stable = 0;
+  gboolean stable = TRUE;
+  gboolean success = FALSE;
+  GList *l, *pads;
+
+  g_array_set_size (layers, 0);
+
+  /* the sink pads get reordered on zorder changes */
+  GST_OBJECT_LOCK (overlay);
+  pads = g_list_copy_deep (GST_ELEMENT (overlay)->sinkpads,
+      (GCopyFunc) gst_object_ref, NULL);
+  GST_OBJECT_UNLOCK (overlay);
 
-    /* increment list pointer */
-    generator->current = generator->current->next;
+  for (l = pads; l; l = l->next) {
+    GstVideoAggregatorPad *const vagg_pad = l->data;
+    GstVaapiOverlaySinkPad *const pad = GST_VAAPI_OVERLAY_SINK_PAD (vagg_pad);
+    GstVaapiOverlayLayer *layer;
+    GstVaapiBlendSurface *blend_surface;
+    GstVaapiVideoMeta *inbuf_meta;
+    GstVideoFrame *inframe;
+    GstBuffer *buf = NULL;
 
-    /* recycle the blend surface from the overlay surface generator */
-    blend_surface = &generator->blend_surface;
-    blend_surface->surface = NULL;
+    g_array_set_size (layers, layers->len + 1);
+    layer = &g_array_index (layers, GstVaapiOverlayLayer, layers->len - 1);
+    blend_surface = &layer->blend_surface;
 
     /* Current sinkpad may not be queueing buffers yet (e.g. timestamp-offset)
      * or it may have reached EOS */
-    if (!gst_video_aggregator_pad_has_current_buffer (vagg_pad))
-      continue;
+    if (gst_video_aggregator_pad_has_current_buffer (vagg_pad)) {
+      inframe = gst_video_aggregator_pad_get_prepared_frame (vagg_pad);
+      buf = gst_video_aggregator_pad_get_current_buffer (vagg_pad);
 
-    inframe = gst_video_aggregator_pad_get_prepared_frame (vagg_pad);
-    buf = gst_video_aggregator_pad_get_current_buffer (vagg_pad);
-    pad = GST_VAAPI_OVERLAY_SINK_PAD (vagg_pad);
+      if (gst_vaapi_plugin_base_pad_get_input_buffer (GST_VAAPI_PLUGIN_BASE
+              (overlay), GST_PAD (pad), buf, &layer->inbuf) != GST_FLOW_OK)
+        goto done;
 
-    if (gst_vaapi_plugin_base_pad_get_input_buffer (GST_VAAPI_PLUGIN_BASE
-            (generator->overlay), GST_PAD (pad), buf, &inbuf) != GST_FLOW_OK)
-      return blend_surface;
+      inbuf_meta = gst_buffer_get_vaapi_video_meta (layer->inbuf);
+      if (!inbuf_meta)
+        goto done;
 
-    inbuf_meta = gst_buffer_get_vaapi_video_meta (inbuf);
-    if (inbuf_meta) {
       blend_surface->surface = gst_vaapi_video_meta_get_surface (inbuf_meta);
       blend_surface->crop = gst_vaapi_video_meta_get_render_rect (inbuf_meta);
       blend_surface->target.x = pad->xpos;
@@ -409,13 +523,129 @@ gst_vaapi_overlay_surface_next (gpointer data)
       blend_surface->alpha = pad->alpha;
     }
 
-    gst_buffer_unref (inbuf);
+    /* keep updating the upper pads, they may be stable next frame */
+    if (gst_vaapi_overlay_sink_pad_update (pad, buf, layer, layers->len - 1))
+      stable = FALSE;
+    else if (stable)
+      num_stable++;
+  }
+  success = TRUE;
+
+done:
+  g_list_free_full (pads, gst_object_unref);
+  *num_stable_ptr = num_stable;
+  return success;
+}
+
+static guint
+gst_vaapi_overlay_count_layers (GstVaapiOverlay * overlay, guint start,
+    guint end)
+{
+  guint i, count = 0;
+
+  for (i = start; i < end; i++) {
+    if (g_array_index (overlay->layers, GstVaapiOverlayLayer, i).inbuf)
+      count++;
+  }
+  return count;
+}
+
+static GstVaapiBlendSurface *
+gst_vaapi_overlay_surface_next (gpointer data)
+{
+  GstVaapiOverlaySurfaceGenerator *generator;
+  GstVaapiBlendSurface *blend_surface;
+  GstVaapiOverlayLayer *layer;
+
+  generator = (GstVaapiOverlaySurfaceGenerator *) data;
+
+  /* the cached lower layers go first */
+  if (generator->base) {
+    blend_surface = generator->base;
+    generator->base = NULL;
+    generator->count++;
     return blend_surface;
   }
 
+  /* at the end of the generator? */
+  while (generator->current < generator->end) {
+    layer = &generator->layers[generator->current++];
+    if (!layer->inbuf)
+      continue;
+
+    generator->count++;
+    return &layer->blend_surface;
+  }
+
   return NULL;
 }
 
+/* Blends the cached lower layers, if any, then the layers from @start
+ * to @end onto @output */
+static gboolean
+gst_vaapi_overlay_blend_layers (GstVaapiOverlay * overlay,
+    GstVaapiSurface * output, guint start, guint end, guint * count_ptr)
+{
+  const GstVideoInfo *const vip = GST_VAAPI_PLUGIN_BASE_SRC_PAD_INFO (overlay);
+  GstVaapiOverlaySurfaceGenerator generator = { NULL, };
+  GstVaapiBlendSurface base = { NULL, };
+
+  if (overlay->cache_proxy) {
+    base.surface = GST_VAAPI_SURFACE_PROXY_SURFACE (overlay->cache_proxy);
+    base.target.width = GST_VIDEO_INFO_WIDTH (vip);
+    base.target.height = GST_VIDEO_INFO_HEIGHT (vip);
+    base.alpha = 1.0;
+    generator.base = &base;
+  }
+
+  /* initialize the surface generator */
+  generator.layers = (GstVaapiOverlayLayer *) overlay->layers->data;
+  generator.current = start;
+  generator.end = end;
+
+  if (!gst_vaapi_blend_process (overlay->blend, output,
+          gst_vaapi_overlay_surface_next, &generator))
+    return FALSE;
+
+  *count_ptr += generator.count;
+  return TRUE;
+}
+
+/* Composes the lowest @num_stable layers into a new cache surface,
+ * when that saves blending at least two layers per frame */
+static gboolean
+gst_vaapi_overlay_update_cache (GstVaapiOverlay * overlay, guint num_stable,
+    guint * count_ptr)
+{
+  GstVaapiSurfaceProxy *proxy;
+  gboolean success;
+
+  if (overlay->cache_layers > num_stable)
+    gst_vaapi_overlay_drop_cache (overlay);
+
+  if (gst_vaapi_overlay_count_layers (overlay, overlay->cache_layers,
+          num_stable) < 2)
+    return TRUE;
+
+  proxy = gst_vaapi_surface_proxy_new_from_pool
+      (GST_VAAPI_SURFACE_POOL (overlay->blend_pool));
+  if (!proxy)
+    return FALSE;
+
+  success = gst_vaapi_overlay_blend_layers (overlay,
+      GST_VAAPI_SURFACE_PROXY_SURFACE (proxy), overlay->cache_layers,
+      num_stable, count_ptr);
+  if (success) {
+    gst_vaapi_surface_proxy_replace (&overlay->cache_proxy, proxy);
+    overlay->cache_layers = num_stable;
+    GST_OBJECT_LOCK (overlay);
+    overlay->num_cache_builds++;
+    GST_OBJECT_UNLOCK (overlay);
+  }
+  gst_vaapi_surface_proxy_unref (proxy);
+  return success;
+}
+
 static GstFlowReturn
 gst_vaapi_overlay_aggregate_frames (GstVideoAggregator * vagg,
     GstBuffer * outbuf)
@@ -424,7 +654,8 @@ gst_vaapi_overlay_aggregate_frames (GstVideoAggregator * vagg,
   GstVaapiVideoMeta *outbuf_meta;
   GstVaapiSurface *outbuf_surface;
   GstVaapiSurfaceProxy *proxy;
-  GstVaapiOverlaySurfaceGenerator generator;
+  GstFlowReturn ret = GST_FLOW_ERROR;
+  guint num_stable, num_layers, num_cache_builds, count = 0;
 
   if (!overlay->blend_pool) {
     GstVaapiVideoPool *pool =
@@ -452,15 +683,38 @@ gst_vaapi_overlay_aggregate_frames (GstVideoAggregator * vagg,
 
   outbuf_surface = gst_vaapi_video_meta_get_surface (outbuf_meta);
 
-  /* initialize the surface generator */
-  generator.overlay = overlay;
-  generator.current = GST_ELEMENT (overlay)->sinkpads;
+  if (g_atomic_int_compare_and_exchange (&overlay->cache_reset, TRUE, FALSE))
+    gst_vaapi_overlay_drop_cache (overlay);
 
-  if (!gst_vaapi_blend_process (overlay->blend, outbuf_surface,
-          gst_vaapi_overlay_surface_next, &generator))
-    return GST_FLOW_ERROR;
+  if (!gst_vaapi_overlay_collect_layers (overlay, &num_stable))
+    goto done;
+  num_layers = overlay->layers->len;
 
-  return GST_FLOW_OK;
+  num_cache_builds = overlay->num_cache_builds;
+  if (!gst_vaapi_overlay_update_cache (overlay, num_stable, &count))
+    goto done;
+
+  if (!gst_vaapi_overlay_blend_layers (overlay, outbuf_surface,
+          overlay->cache_layers, num_layers, &count))
+    goto done;
+
+  GST_OBJECT_LOCK (overlay);
+  overlay->num_frames++;
+  overlay->num_layers += gst_vaapi_overlay_count_layers (overlay, 0,
+      num_layers);
+  overlay->num_blended += count;
+  if (overlay->cache_proxy && overlay->num_cache_builds == num_cache_builds)
+    overlay->num_cache_hits++;
+  GST_OBJECT_UNLOCK (overlay);
+
+  GST_LOG_OBJECT (overlay, "blended %u surfaces, %u lower layers cached",
+      count, overlay->cache_layers);
+
+  ret = GST_FLOW_OK;
+
+done:
+  g_array_set_size (overlay->layers, 0);
+  return ret;
 }
 
 static GstFlowReturn
@@ -495,6 +749,8 @@ gst_vaapi_overlay_negotiated_src_caps (GstAggregator * agg, GstCaps * caps)
   if (!gst_vaapi_plugin_base_set_caps (GST_VAAPI_PLUGIN_BASE (agg), NULL, caps))
     return FALSE;
 
+  g_atomic_int_set (&GST_VAAPI_OVERLAY (agg)->cache_reset, TRUE);
+
   return
       GST_AGGREGATOR_CLASS (gst_vaapi_overlay_parent_class)->negotiated_src_caps
       (agg, caps);
@@ -560,6 +816,30 @@ gst_vaapi_overlay_fixate_src_caps (GstAggregator * agg, GstCaps * caps)
   return gst_caps_fixate (ret);
 }
 
+static void
+gst_vaapi_overlay_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstVaapiOverlay *const overlay = GST_VAAPI_OVERLAY (object);
+
+  switch (prop_id) {
+    case PROP_STATS:
+      GST_OBJECT_LOCK (overlay);
+      g_value_take_boxed (value, gst_structure_new ("GstVaapiOverlayStats",
+              "frames", G_TYPE_UINT64, overlay->num_frames,
+              "layers", G_TYPE_UINT64, overlay->num_layers,
+              "blended", G_TYPE_UINT64, overlay->num_blended,
+              "cache-builds", G_TYPE_UINT, overlay->num_cache_builds,
+              "cache-hits", G_TYPE_UINT, overlay->num_cache_hits,
+              "cache-drops", G_TYPE_UINT, overlay->num_cache_drops, NULL));
+      GST_OBJECT_UNLOCK (overlay);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static GstVaapiPadPrivate *
 gst_vaapi_overlay_get_vaapi_pad_private (GstVaapiPluginBase * plugin,
     GstPad * pad)
@@ -589,6 +869,26 @@ gst_vaapi_overlay_class_init (GstVaapiOverlayClass * klass)
       GST_DEBUG_FUNCPTR (gst_vaapi_overlay_get_vaapi_pad_private);
 
   object_class->finalize = GST_DEBUG_FUNCPTR (gst_vaapi_overlay_finalize);
+  object_class->get_property = gst_vaapi_overlay_get_property;
+
+  /**
+   * GstVaapiOverlay:stats:
+   *
+   * The blend statistics since the element started, as a
+   * "GstVaapiOverlayStats" structure with the fields:
+   *
+   * - "frames", "layers" and "blended" (guint64): the number of output
+   *   frames, of input layers and of blended surfaces
+   * - "cache-builds" (guint): the number of times the lower layers
+   *   were composed into the cache surface
+   * - "cache-hits" (guint): the number of frames blended on top of
+   *   the cache surface without rebuilding it
+   * - "cache-drops" (guint): the number of times the cache surface was
+   *   invalidated
+   */
+  g_object_class_install_property (object_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics", "Blend statistics",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
   agg_class->sink_query = GST_DEBUG_FUNCPTR (gst_vaapi_overlay_sink_query);
   agg_class->src_query = GST_DEBUG_FUNCPTR (gst_vaapi_overlay_src_query);
@@ -630,6 +930,10 @@ static void
 gst_vaapi_overlay_init (GstVaapiOverlay * overlay)
 {
   gst_vaapi_plugin_base_init (GST_VAAPI_PLUGIN_BASE (overlay), GST_CAT_DEFAULT);
+
+  overlay->layers = g_array_new (FALSE, TRUE, sizeof (GstVaapiOverlayLayer));
+  g_array_set_clear_func (overlay->layers,
+      (GDestroyNotify) gst_vaapi_overlay_layer_clear);
 }
 
 /* GstChildProxy implementation */
@@ -67,6 +67,20 @@ struct _GstVaapiOverlay
 
   GstVaapiBlend *blend;
   GstVaapiVideoPool *blend_pool;
+
+  /* damage tracking: composition of the lowest unchanged layers */
+  GArray *layers;
+  GstVaapiSurfaceProxy *cache_proxy;
+  guint cache_layers;
+  gint cache_reset;             /* atomic */
+
+  /* blend statistics */
+  guint64 num_frames;
+  guint64 num_layers;
+  guint64 num_blended;
+  guint num_cache_builds;
+  guint num_cache_hits;
+  guint num_cache_drops;
 };
 
 struct _GstVaapiOverlayClass
@@ -81,6 +95,13 @@ struct _GstVaapiOverlaySinkPad
   gint xpos, ypos;
   gdouble alpha;
 
+  /* damage tracking: the layer blended in the previous frame */
+  GstBuffer *last_buffer;
+  GstVaapiRectangle last_crop;
+  GstVaapiRectangle last_target;
+  gdouble last_alpha;
+  gint last_index;              /* position in the zorder */
+
   GstVaapiPadPrivate *priv;
 };
 
@@ -40,6 +40,11 @@ GST_DEBUG_CATEGORY_STATIC (CAT_PERFORMANCE);
 
 #define BUFFER_POOL_SINK_MIN_BUFFERS 2
 
+/* Constraints on system memory buffers to be imported as VA surfaces
+ * through VA_SURFACE_ATTRIB_MEM_TYPE_USER_PTR */
+#define USERPTR_BASE_ALIGNMENT   4096
+#define USERPTR_PITCH_ALIGNMENT  64
+
 #define GST_VAAPI_PAD_PRIVATE(pad) \
   (GST_VAAPI_PLUGIN_BASE_GET_CLASS(plugin)->get_vaapi_pad_private(plugin, pad))
 
@@ -66,6 +71,7 @@ gst_vaapi_pad_private_reset (GstVaapiPadPrivate * priv)
 
   priv->buffer_size = 0;
   priv->caps_is_raw = FALSE;
+  priv->userptr_failed = FALSE;
 
   gst_clear_object (&priv->other_allocator);
 }
@@ -260,6 +266,180 @@ error_create_proxy:
   }
 }
 
+static GstVaapiSurface *
+_get_cached_userptr_surface (GstMemory * mem, gconstpointer data)
+{
+  GstVaapiSurface *surface;
+  GstVaapiBufferProxy *proxy;
+
+  surface = gst_mini_object_get_qdata (GST_MINI_OBJECT (mem),
+      g_quark_from_static_string ("GstVaapiUserPtrSurface"));
+  if (!surface)
+    return NULL;
+
+  /* the cache is keyed by the pointer the surface was created from */
+  proxy = gst_vaapi_surface_peek_buffer_proxy (surface);
+  if (!proxy || GST_VAAPI_BUFFER_PROXY_HANDLE (proxy) != (guintptr) data)
+    return NULL;
+  return surface;
+}
+
+static void
+_set_cached_userptr_surface (GstMemory * mem, GstVaapiSurface * surface)
+{
+  gst_mini_object_set_qdata (GST_MINI_OBJECT (mem),
+      g_quark_from_static_string ("GstVaapiUserPtrSurface"), surface,
+      (GDestroyNotify) gst_vaapi_surface_unref);
+}
+
+/* Checks whether the system memory of @inbuf can be wrapped as-is
+ * into a VA surface, i.e. it is a single, CPU-addressable chunk
+ * whose base address, plane offsets and pitches satisfy the usual
+ * driver alignment constraints */
+static gboolean
+is_userptr_importable (GstBuffer * inbuf, const GstVideoInfo * vip,
+    gpointer * data_ptr)
+{
+  GstMemory *mem;
+  GstMapInfo map_info;
+  guint i;
+
+  if (gst_buffer_n_memory (inbuf) != 1)
+    return FALSE;
+
+  mem = gst_buffer_peek_memory (inbuf, 0);
+  if (!mem || !gst_memory_is_type (mem, GST_ALLOCATOR_SYSMEM))
+    return FALSE;
+
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (vip); i++) {
+    if (GST_VIDEO_INFO_PLANE_STRIDE (vip, i) % USERPTR_PITCH_ALIGNMENT)
+      return FALSE;
+    if (GST_VIDEO_INFO_PLANE_OFFSET (vip, i) % USERPTR_PITCH_ALIGNMENT)
+      return FALSE;
+  }
+
+  if (!gst_memory_map (mem, &map_info, GST_MAP_READ))
+    return FALSE;
+  /* system memory is not moved around while the memory is alive */
+  gst_memory_unmap (mem, &map_info);
+
+  if (((guintptr) map_info.data) % USERPTR_BASE_ALIGNMENT)
+    return FALSE;
+  if (map_info.size < GST_VIDEO_INFO_SIZE (vip))
+    return FALSE;
+
+  *data_ptr = map_info.data;
+  return TRUE;
+}
+
+/* Returns the size spanned by the planes of @vip, up to the end of the
+   one that ends the farthest, with their own offsets and strides */
+static gsize
+get_padded_size (const GstVideoInfo * vip)
+{
+  gint comp[GST_VIDEO_MAX_COMPONENTS];
+  gsize size = 0, plane_end;
+  guint i;
+
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (vip); i++) {
+    gst_video_format_info_component (vip->finfo, i, comp);
+    plane_end = GST_VIDEO_INFO_PLANE_OFFSET (vip, i) +
+        (gsize) GST_VIDEO_INFO_PLANE_STRIDE (vip, i) *
+        GST_VIDEO_INFO_COMP_HEIGHT (vip, comp[0]);
+    size = MAX (size, plane_end);
+  }
+  return size;
+}
+
+static GstVaapiSurface *
+plugin_create_userptr_surface (GstVaapiPluginBase * plugin, gpointer data,
+    const GstVideoInfo * vip)
+{
+  GstVaapiBufferProxy *proxy;
+  GstVaapiSurface *surface;
+
+  proxy = gst_vaapi_buffer_proxy_new ((guintptr) data,
+      GST_VAAPI_BUFFER_MEMORY_TYPE_USER_PTR, GST_VIDEO_INFO_SIZE (vip), NULL,
+      NULL);
+  if (!proxy)
+    return NULL;
+
+  surface = gst_vaapi_surface_new_from_buffer_proxy (plugin->display, proxy,
+      vip);
+  /* Surface holds proxy's reference */
+  gst_vaapi_buffer_proxy_unref (proxy);
+  return surface;
+}
+
+/* Wraps the system memory of @inbuf into a VA surface without any
+ * copy. Returns %FALSE if the buffer is not suitable, in which case
+ * the caller is expected to fallback to the regular upload path */
+static gboolean
+plugin_bind_userptr_to_vaapi_buffer (GstVaapiPluginBase * plugin,
+    GstPad * sinkpad, GstBuffer * inbuf, GstBuffer * outbuf)
+{
+  GstVaapiPadPrivate *sinkpriv = GST_VAAPI_PAD_PRIVATE (sinkpad);
+  GstVideoInfo vi = sinkpriv->info;
+  GstVaapiVideoMeta *meta;
+  GstVaapiSurface *surface;
+  GstVaapiSurfaceProxy *proxy;
+  GstVideoMeta *vmeta;
+  GstMemory *mem;
+  gpointer data = NULL;
+  guint i;
+
+  if (sinkpriv->userptr_failed)
+    return FALSE;
+
+  vmeta = gst_buffer_get_video_meta (inbuf);
+  if (vmeta) {
+    if (GST_VIDEO_INFO_FORMAT (&vi) != vmeta->format ||
+        GST_VIDEO_INFO_WIDTH (&vi) != vmeta->width ||
+        GST_VIDEO_INFO_HEIGHT (&vi) != vmeta->height ||
+        GST_VIDEO_INFO_N_PLANES (&vi) != vmeta->n_planes)
+      return FALSE;
+    for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&vi); i++) {
+      GST_VIDEO_INFO_PLANE_OFFSET (&vi, i) = vmeta->offset[i];
+      GST_VIDEO_INFO_PLANE_STRIDE (&vi, i) = vmeta->stride[i];
+    }
+    GST_VIDEO_INFO_SIZE (&vi) = get_padded_size (&vi);
+  }
+
+  if (!is_userptr_importable (inbuf, &vi, &data))
+    return FALSE;
+
+  meta = gst_buffer_get_vaapi_video_meta (outbuf);
+  g_return_val_if_fail (meta != NULL, FALSE);
+
+  /* Check for a VASurface cached in the memory */
+  mem = gst_buffer_peek_memory (inbuf, 0);
+  surface = _get_cached_userptr_surface (mem, data);
+  if (!surface) {
+    surface = plugin_create_userptr_surface (plugin, data, &vi);
+    if (!surface)
+      goto error_create_surface;
+    _set_cached_userptr_surface (mem, surface);
+  }
+
+  proxy = gst_vaapi_surface_proxy_new (surface);
+  if (!proxy)
+    return FALSE;
+  gst_vaapi_video_meta_set_surface_proxy (meta, proxy);
+  gst_vaapi_surface_proxy_unref (proxy);
+  gst_buffer_add_parent_buffer_meta (outbuf, inbuf);
+  return TRUE;
+
+  /* ERRORS */
+error_create_surface:
+  {
+    /* don't retry for every frame if the driver refuses user pointers */
+    GST_INFO_OBJECT (plugin, "failed to import user pointer as VA surface, "
+        "falling back to system memory copies");
+    sinkpriv->userptr_failed = TRUE;
+    return FALSE;
+  }
+}
+
 static void
 plugin_reset_texture_map (GstVaapiPluginBase * plugin)
 {
@@ -965,22 +1145,21 @@ gst_vaapi_plugin_base_propose_allocation (GstVaapiPluginBase * plugin,
 }
 
 /**
- * gst_vaapi_plugin_base_decide_allocation:
+ * gst_vaapi_plugin_base_pad_decide_allocation:
  * @plugin: a #GstVaapiPluginBase
+ * @srcpad: the srcpad to decide the allocation on
  * @query: the allocation query to parse
- * @feature: the desired #GstVaapiCapsFeature, or zero to find the
- *   preferred one
  *
- * Decides allocation parameters for the downstream elements on the base
- * plugin static srcpad.
+ * Decides allocation parameters for the downstream elements on the
+ * requested srcpad.
  *
  * Returns: %TRUE if successful, %FALSE otherwise.
  */
 gboolean
-gst_vaapi_plugin_base_decide_allocation (GstVaapiPluginBase * plugin,
-    GstQuery * query)
+gst_vaapi_plugin_base_pad_decide_allocation (GstVaapiPluginBase * plugin,
+    GstPad * srcpad, GstQuery * query)
 {
-  GstVaapiPadPrivate *srcpriv = GST_VAAPI_PAD_PRIVATE (plugin->srcpad);
+  GstVaapiPadPrivate *srcpriv = GST_VAAPI_PAD_PRIVATE (srcpad);
   GstCaps *caps = NULL;
   GstBufferPool *pool;
   GstVideoInfo vi;
@@ -1095,7 +1274,7 @@ gst_vaapi_plugin_base_decide_allocation (GstVaapiPluginBase * plugin,
   }
 
   if (!pool) {
-    if (!ensure_srcpad_allocator (plugin, plugin->srcpad, &vi, caps))
+    if (!ensure_srcpad_allocator (plugin, srcpad, &vi, caps))
       goto error;
     size = GST_VIDEO_INFO_SIZE (&vi);   /* size might be updated by
                                          * allocator */
@@ -1128,7 +1307,8 @@ gst_vaapi_plugin_base_decide_allocation (GstVaapiPluginBase * plugin,
   /* if downstream doesn't support GstVideoMeta, and the negotiated
    * caps are raw video, and the used allocator is the VA-API one, we
    * should copy the VA-API frame into a dumb buffer */
-  plugin->copy_output_frame = gst_vaapi_video_buffer_pool_copy_buffer (pool);
+  if (srcpad == plugin->srcpad)
+    plugin->copy_output_frame = gst_vaapi_video_buffer_pool_copy_buffer (pool);
 
   return TRUE;
 
@@ -1156,6 +1336,24 @@ error:
   }
 }
 
+/**
+ * gst_vaapi_plugin_base_decide_allocation:
+ * @plugin: a #GstVaapiPluginBase
+ * @query: the allocation query to parse
+ *
+ * Decides allocation parameters for the downstream elements on the base
+ * plugin static srcpad.
+ *
+ * Returns: %TRUE if successful, %FALSE otherwise.
+ */
+gboolean
+gst_vaapi_plugin_base_decide_allocation (GstVaapiPluginBase * plugin,
+    GstQuery * query)
+{
+  return gst_vaapi_plugin_base_pad_decide_allocation (plugin, plugin->srcpad,
+      query);
+}
+
 /**
  * gst_vaapi_plugin_base_pad_get_input_buffer:
  * @plugin: a #GstVaapiPluginBase
@@ -1210,6 +1408,9 @@ gst_vaapi_plugin_base_pad_get_input_buffer (GstVaapiPluginBase * plugin,
     goto done;
   }
 
+  if (plugin_bind_userptr_to_vaapi_buffer (plugin, sinkpad, inbuf, outbuf))
+    goto done;
+
   if (!gst_video_frame_map (&src_frame, &sinkpriv->info, inbuf, GST_MAP_READ))
     goto error_map_src_buffer;
 
@@ -1605,3 +1806,73 @@ gst_vaapi_plugin_copy_va_buffer (GstVaapiPluginBase * plugin,
 
   return success;
 }
+
+/* VA call statistics are posted every that many frames */
+static guint va_calls_interval;
+
+/**
+ * gst_vaapi_plugin_base_init_va_calls:
+ *
+ * Enables the VA call accounting if the GST_VAAPI_VA_CALLS environment
+ * variable is set to a number of frames. The elements then post a
+ * "GstVaapiVaCalls" element message with the VA calls they issued,
+ * every such number of frames.
+ **/
+void
+gst_vaapi_plugin_base_init_va_calls (void)
+{
+  const gchar *const env = g_getenv ("GST_VAAPI_VA_CALLS");
+
+  if (!env)
+    return;
+
+  va_calls_interval = g_ascii_strtoull (env, NULL, 10);
+  gst_vaapi_va_calls_set_enabled (va_calls_interval > 0);
+}
+
+/**
+ * gst_vaapi_plugin_base_post_va_calls:
+ * @plugin: a #GstVaapiPluginBase
+ * @stats: the #GstVaapiVaCallStats of the @plugin decoder, encoder or
+ *   filter
+ *
+ * Posts @stats as a "GstVaapiVaCalls" element message on the bus, if
+ * enough frames were processed since the last one. The message holds
+ * the number of "frames", and for each VA call issued, its count and
+ * its accumulated "-time" in nanoseconds.
+ **/
+void
+gst_vaapi_plugin_base_post_va_calls (GstVaapiPluginBase * plugin,
+    const GstVaapiVaCallStats * stats)
+{
+  GstStructure *structure;
+  guint i;
+
+  /* the decoder, encoder or filter was re-created */
+  if (stats->num_frames < plugin->va_calls_posted)
+    plugin->va_calls_posted = 0;
+
+  if (va_calls_interval == 0 ||
+      stats->num_frames < plugin->va_calls_posted + va_calls_interval)
+    return;
+  plugin->va_calls_posted = stats->num_frames;
+
+  structure = gst_structure_new ("GstVaapiVaCalls",
+      "frames", G_TYPE_UINT64, stats->num_frames, NULL);
+  for (i = 0; i < GST_VAAPI_VA_N_CALLS; i++) {
+    const gchar *const name = gst_vaapi_va_call_get_name (i);
+    gchar *time_name;
+
+    if (stats->calls[i].count == 0)
+      continue;
+
+    time_name = g_strconcat (name, "-time", NULL);
+    gst_structure_set (structure,
+        name, G_TYPE_UINT64, stats->calls[i].count,
+        time_name, G_TYPE_UINT64, stats->calls[i].time, NULL);
+    g_free (time_name);
+  }
+
+  gst_element_post_message (GST_ELEMENT_CAST (plugin),
+      gst_message_new_element (GST_OBJECT_CAST (plugin), structure));
+}
@@ -30,6 +30,7 @@
 #include <gst/video/gstvideoencoder.h>
 #include <gst/video/gstvideosink.h>
 #include <gst/vaapi/gstvaapidisplay.h>
+#include <gst/vaapi/gstvaapivacalls.h>
 
 G_BEGIN_DECLS
 
@@ -133,6 +134,7 @@ struct _GstVaapiPadPrivate
   gboolean caps_is_raw;
 
   gboolean can_dmabuf;
+  gboolean userptr_failed;
 
   GstAllocator *other_allocator;
   GstAllocationParams other_allocator_params;
@@ -184,6 +186,8 @@ struct _GstVaapiPluginBase
 
   gboolean enable_direct_rendering;
   gboolean copy_output_frame;
+
+  guint64 va_calls_posted;
 };
 
 struct _GstVaapiPluginBaseClass
@@ -273,6 +277,11 @@ gboolean
 gst_vaapi_plugin_base_decide_allocation (GstVaapiPluginBase * plugin,
     GstQuery * query);
 
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_plugin_base_pad_decide_allocation (GstVaapiPluginBase * plugin,
+    GstPad * srcpad, GstQuery * query);
+
 G_GNUC_INTERNAL
 GstFlowReturn
 gst_vaapi_plugin_base_get_input_buffer (GstVaapiPluginBase * plugin,
@@ -311,6 +320,15 @@ gboolean
 gst_vaapi_plugin_copy_va_buffer (GstVaapiPluginBase * plugin,
     GstBuffer * inbuf, GstBuffer * outbuf);
 
+G_GNUC_INTERNAL
+void
+gst_vaapi_plugin_base_init_va_calls (void);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_plugin_base_post_va_calls (GstVaapiPluginBase * plugin,
+    const GstVaapiVaCallStats * stats);
+
 
 G_END_DECLS
 
@@ -480,7 +480,8 @@ gst_vaapi_append_surface_caps (GstCaps * out_caps, GstCaps * in_caps)
 }
 
 gboolean
-gst_vaapi_apply_composition (GstVaapiSurface * surface, GstBuffer * buffer)
+gst_vaapi_apply_composition (GstVaapiSurface * surface, GstBuffer * buffer,
+    GstVaapiSubpictureCache * cache)
 {
   GstVideoOverlayCompositionMeta *const cmeta =
       gst_buffer_get_video_overlay_composition_meta (buffer);
@@ -488,8 +489,8 @@ gst_vaapi_apply_composition (GstVaapiSurface * surface, GstBuffer * buffer)
 
   if (cmeta)
     composition = cmeta->overlay;
-  return gst_vaapi_surface_set_subpictures_from_composition (surface,
-      composition);
+  return gst_vaapi_surface_set_subpictures_from_composition_full (surface,
+      composition, cache);
 }
 
 gboolean
@@ -47,7 +47,8 @@ gst_vaapi_append_surface_caps (GstCaps * out_caps, GstCaps * in_caps);
 
 G_GNUC_INTERNAL
 gboolean
-gst_vaapi_apply_composition (GstVaapiSurface * surface, GstBuffer * buffer);
+gst_vaapi_apply_composition (GstVaapiSurface * surface, GstBuffer * buffer,
+    GstVaapiSubpictureCache * cache);
 
 #ifndef G_PRIMITIVE_SWAP
 #define G_PRIMITIVE_SWAP(type, a, b) do {       \
@@ -1580,6 +1580,13 @@ gst_vaapipostproc_transform (GstBaseTransform * trans, GstBuffer * inbuf,
 done:
   gst_buffer_unref (buf);
 
+  if (gst_vaapi_va_calls_get_enabled () && postproc->filter) {
+    GstVaapiVaCallStats stats;
+
+    gst_vaapi_filter_get_va_call_stats (postproc->filter, &stats);
+    gst_vaapi_plugin_base_post_va_calls (plugin, &stats);
+  }
+
   if (sys_buf) {
     if (!gst_vaapi_plugin_copy_va_buffer (plugin, outbuf, sys_buf))
       return GST_FLOW_ERROR;
@@ -0,0 +1,913 @@
+/*
+ *  gstvaapiscaleladder.c - VA-API multi-resolution video scaler
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+*/
+
+/**
+ * SECTION:element-vaapiscaleladder
+ * @title: vaapiscaleladder
+ * @short_description: A VA-API multi-resolution video scaler
+ *
+ * vaapiscaleladder scales each input frame into several renditions,
+ * one per requested src pad, as used for adaptive bitrate
+ * streaming. The resolution and the format of every rendition are
+ * negotiated with the downstream elements of its src pad.
+ *
+ * All the renditions of a frame are produced in one go, by a single
+ * VA video processing context. With the #GstVaapiScaleLadder:cascade
+ * property enabled, every rendition is scaled down from the smallest
+ * rendition already produced that is at least as large, rather than
+ * from the input frame, which cuts the memory bandwidth.
+ *
+ * ## Example launch line
+ *
+ * |[
+ *   gst-launch-1.0 filesrc location=in.mp4 ! qtdemux ! vaapih264dec     \
+ *     ! vaapiscaleladder name=ladder                                     \
+ *     ladder.src_0 ! video/x-raw(memory:VASurface),width=1280,height=720 \
+ *       ! vaapih264enc ! fakesink                                        \
+ *     ladder.src_1 ! video/x-raw(memory:VASurface),width=640,height=360  \
+ *       ! vaapih264enc ! fakesink
+ * ]|
+ */
+
+#include "gstcompat.h"
+#include <gst/video/video.h>
+
+#include "gstvaapiscaleladder.h"
+#include "gstvaapipluginutil.h"
+#include "gstvaapivideobufferpool.h"
+#include "gstvaapivideometa.h"
+
+#define GST_PLUGIN_NAME "vaapiscaleladder"
+#define GST_PLUGIN_DESC "A VA-API multi-resolution video scaler"
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_vaapi_scale_ladder);
+#ifndef GST_DISABLE_GST_DEBUG
+#define GST_CAT_DEFAULT gst_debug_vaapi_scale_ladder
+#else
+#define GST_CAT_DEFAULT NULL
+#endif
+
+/* Default templates */
+/* *INDENT-OFF* */
+static const char gst_vaapi_scale_ladder_sink_caps_str[] =
+  GST_VAAPI_MAKE_SURFACE_CAPS ";"
+  GST_VIDEO_CAPS_MAKE (GST_VAAPI_FORMATS_ALL);
+/* *INDENT-ON* */
+
+/* *INDENT-OFF* */
+static const char gst_vaapi_scale_ladder_src_caps_str[] =
+  GST_VAAPI_MAKE_SURFACE_CAPS;
+/* *INDENT-ON* */
+
+/* *INDENT-OFF* */
+static GstStaticPadTemplate gst_vaapi_scale_ladder_sink_factory =
+  GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (gst_vaapi_scale_ladder_sink_caps_str));
+/* *INDENT-ON* */
+
+/* *INDENT-OFF* */
+static GstStaticPadTemplate gst_vaapi_scale_ladder_src_factory =
+  GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (gst_vaapi_scale_ladder_src_caps_str));
+/* *INDENT-ON* */
+
+#define DEFAULT_CASCADE TRUE
+
+enum
+{
+  PROP_0,
+  PROP_CASCADE,
+};
+
+/* A rendition to produce for the current input frame */
+typedef struct
+{
+  GstVaapiScaleLadderSrcPad *pad;
+  GstBuffer *outbuf;
+  GstVaapiSurface *surface;
+  guint width;
+  guint height;
+} GstVaapiScaleLadderRendition;
+
+G_DEFINE_TYPE (GstVaapiScaleLadderSrcPad, gst_vaapi_scale_ladder_src_pad,
+    GST_TYPE_PAD);
+
+static void
+gst_vaapi_scale_ladder_src_pad_reset (GstVaapiScaleLadderSrcPad * pad)
+{
+  gst_vaapi_pad_private_reset (pad->priv);
+  gst_vaapi_video_pool_replace (&pad->surface_pool, NULL);
+}
+
+static void
+gst_vaapi_scale_ladder_src_pad_finalize (GObject * object)
+{
+  GstVaapiScaleLadderSrcPad *const pad =
+      GST_VAAPI_SCALE_LADDER_SRC_PAD (object);
+
+  gst_vaapi_video_pool_replace (&pad->surface_pool, NULL);
+  gst_vaapi_pad_private_finalize (pad->priv);
+
+  G_OBJECT_CLASS (gst_vaapi_scale_ladder_src_pad_parent_class)->finalize
+      (object);
+}
+
+static void
+gst_vaapi_scale_ladder_src_pad_class_init (GstVaapiScaleLadderSrcPadClass *
+    klass)
+{
+  GObjectClass *const gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = gst_vaapi_scale_ladder_src_pad_finalize;
+}
+
+static void
+gst_vaapi_scale_ladder_src_pad_init (GstVaapiScaleLadderSrcPad * pad)
+{
+  pad->priv = gst_vaapi_pad_private_new ();
+}
+
+G_DEFINE_TYPE_WITH_CODE (GstVaapiScaleLadder, gst_vaapi_scale_ladder,
+    GST_TYPE_ELEMENT, GST_VAAPI_PLUGIN_BASE_INIT_INTERFACES);
+
+GST_VAAPI_PLUGIN_BASE_DEFINE_SET_CONTEXT (gst_vaapi_scale_ladder_parent_class);
+
+/* Returns a new list with a reference to every src pad */
+static GList *
+get_src_pads (GstVaapiScaleLadder * ladder)
+{
+  GList *pads;
+
+  GST_OBJECT_LOCK (ladder);
+  pads = g_list_copy_deep (GST_ELEMENT (ladder)->srcpads,
+      (GCopyFunc) gst_object_ref, NULL);
+  GST_OBJECT_UNLOCK (ladder);
+
+  return pads;
+}
+
+static GstFlowReturn
+update_flow (GstVaapiScaleLadder * ladder, GstPad * pad, GstFlowReturn ret)
+{
+  GST_OBJECT_LOCK (ladder);
+  ret = gst_flow_combiner_update_pad_flow (ladder->flow_combiner, pad, ret);
+  GST_OBJECT_UNLOCK (ladder);
+
+  return ret;
+}
+
+typedef struct
+{
+  GstPad *srcpad;
+  gboolean after_caps;
+} ReplayEventsData;
+
+static gboolean
+replay_sticky_event (GstPad * pad, GstEvent ** event, gpointer user_data)
+{
+  ReplayEventsData *const data = user_data;
+  const GstEventType type = GST_EVENT_TYPE (*event);
+
+  if (type == GST_EVENT_CAPS || type == GST_EVENT_EOS)
+    return TRUE;
+
+  if ((type > GST_EVENT_CAPS) == data->after_caps)
+    gst_pad_push_event (data->srcpad, gst_event_ref (*event));
+  return TRUE;
+}
+
+/* Pushes the sink pad sticky events that are ordered before (or after)
+ * the caps, to @srcpad */
+static void
+replay_sticky_events (GstVaapiScaleLadder * ladder, GstPad * srcpad,
+    gboolean after_caps)
+{
+  ReplayEventsData data = { srcpad, after_caps };
+
+  gst_pad_sticky_events_foreach (GST_VAAPI_PLUGIN_BASE_SINK_PAD (ladder),
+      replay_sticky_event, &data);
+}
+
+static gboolean
+gst_vaapi_scale_ladder_negotiate_pad (GstVaapiScaleLadder * ladder,
+    GstVaapiScaleLadderSrcPad * srcpad)
+{
+  GstVaapiPluginBase *const plugin = GST_VAAPI_PLUGIN_BASE (ladder);
+  GstPad *const pad = GST_PAD (srcpad);
+  const GstVideoInfo *const vip = GST_VAAPI_PLUGIN_BASE_SINK_PAD_INFO (ladder);
+  GstCaps *caps, *peercaps;
+  GstStructure *structure;
+  GstQuery *query;
+  gboolean configured, success;
+
+  if (!GST_VAAPI_PLUGIN_BASE_SINK_PAD_CAPS (ladder))
+    return FALSE;
+
+  caps = gst_pad_get_pad_template_caps (pad);
+  caps = gst_caps_make_writable (caps);
+  gst_caps_set_simple (caps, "framerate", GST_TYPE_FRACTION,
+      GST_VIDEO_INFO_FPS_N (vip), GST_VIDEO_INFO_FPS_D (vip), NULL);
+  peercaps = gst_pad_peer_query_caps (pad, caps);
+  gst_caps_unref (caps);
+  if (gst_caps_is_empty (peercaps))
+    goto error_no_caps;
+
+  /* Default to the input size and format */
+  caps = gst_caps_truncate (peercaps);
+  caps = gst_caps_make_writable (caps);
+  structure = gst_caps_get_structure (caps, 0);
+  gst_structure_fixate_field_nearest_int (structure, "width",
+      GST_VIDEO_INFO_WIDTH (vip));
+  gst_structure_fixate_field_nearest_int (structure, "height",
+      GST_VIDEO_INFO_HEIGHT (vip));
+  gst_structure_fixate_field_string (structure, "format",
+      gst_video_format_to_string (GST_VIDEO_INFO_FORMAT (vip)));
+  caps = gst_caps_fixate (caps);
+
+  GST_DEBUG_OBJECT (pad, "negotiated %" GST_PTR_FORMAT, caps);
+
+  if (!gst_vaapi_plugin_base_pad_set_caps (plugin, NULL, NULL, pad, caps))
+    goto error_invalid_caps;
+
+  /* a pad that already has caps got the other sticky events from
+   * forward_event() */
+  configured = gst_pad_has_current_caps (pad);
+  if (!configured)
+    replay_sticky_events (ladder, pad, FALSE);
+  if (!gst_pad_push_event (pad, gst_event_new_caps (caps)))
+    goto error_invalid_caps;
+  if (!configured)
+    replay_sticky_events (ladder, pad, TRUE);
+
+  query = gst_query_new_allocation (caps, TRUE);
+  if (!gst_pad_peer_query (pad, query))
+    GST_DEBUG_OBJECT (pad, "peer allocation query failed");
+  success = gst_vaapi_plugin_base_pad_decide_allocation (plugin, pad, query);
+  gst_query_unref (query);
+  gst_caps_unref (caps);
+
+  /* the output surfaces size might have changed */
+  gst_vaapi_video_pool_replace (&srcpad->surface_pool, NULL);
+  return success;
+
+  /* ERRORS */
+error_no_caps:
+  {
+    GST_WARNING_OBJECT (pad, "no compatible downstream caps");
+    gst_caps_unref (peercaps);
+    return FALSE;
+  }
+error_invalid_caps:
+  {
+    GST_WARNING_OBJECT (pad, "failed to set caps %" GST_PTR_FORMAT, caps);
+    gst_caps_unref (caps);
+    return FALSE;
+  }
+}
+
+static GstBuffer *
+create_output_buffer (GstVaapiScaleLadder * ladder,
+    GstVaapiScaleLadderSrcPad * srcpad)
+{
+  GstBufferPool *const pool = srcpad->priv->buffer_pool;
+  GstVaapiVideoMeta *meta;
+  GstVaapiSurfaceProxy *proxy;
+  GstBuffer *outbuf = NULL;
+
+  g_return_val_if_fail (pool != NULL, NULL);
+
+  if (!gst_buffer_pool_is_active (pool) &&
+      !gst_buffer_pool_set_active (pool, TRUE))
+    goto error_activate_pool;
+
+  if (gst_buffer_pool_acquire_buffer (pool, &outbuf, NULL) != GST_FLOW_OK
+      || !outbuf)
+    goto error_create_buffer;
+
+  meta = gst_buffer_get_vaapi_video_meta (outbuf);
+  if (!meta)
+    goto error_create_buffer;
+
+  if (!gst_vaapi_video_meta_get_surface_proxy (meta)) {
+    if (!srcpad->surface_pool) {
+      srcpad->surface_pool =
+          gst_vaapi_surface_pool_new_full (GST_VAAPI_PLUGIN_BASE_DISPLAY
+          (ladder), &srcpad->priv->info, 0);
+      if (!srcpad->surface_pool)
+        goto error_create_buffer;
+    }
+
+    proxy = gst_vaapi_surface_proxy_new_from_pool (GST_VAAPI_SURFACE_POOL
+        (srcpad->surface_pool));
+    if (!proxy)
+      goto error_create_buffer;
+    gst_vaapi_video_meta_set_surface_proxy (meta, proxy);
+    gst_vaapi_surface_proxy_unref (proxy);
+  }
+
+  return outbuf;
+
+  /* ERRORS */
+error_activate_pool:
+  {
+    GST_ERROR_OBJECT (srcpad, "failed to activate output video buffer pool");
+    return NULL;
+  }
+error_create_buffer:
+  {
+    GST_ERROR_OBJECT (srcpad, "failed to create output video buffer");
+    gst_buffer_replace (&outbuf, NULL);
+    return NULL;
+  }
+}
+
+static gint
+compare_renditions (gconstpointer a, gconstpointer b)
+{
+  const GstVaapiScaleLadderRendition *const ra = a;
+  const GstVaapiScaleLadderRendition *const rb = b;
+  const guint64 area_a = (guint64) ra->width * ra->height;
+  const guint64 area_b = (guint64) rb->width * rb->height;
+
+  /* largest first */
+  return (area_a < area_b) - (area_a > area_b);
+}
+
+/* Collects the renditions to produce, from the largest to the
+ * smallest, and negotiates the src pads if needed */
+static GArray *
+collect_renditions (GstVaapiScaleLadder * ladder)
+{
+  GArray *renditions;
+  GList *l, *pads;
+
+  renditions = g_array_new (FALSE, TRUE,
+      sizeof (GstVaapiScaleLadderRendition));
+
+  pads = get_src_pads (ladder);
+  for (l = pads; l; l = l->next) {
+    GstVaapiScaleLadderSrcPad *const srcpad = l->data;
+    GstPad *const pad = GST_PAD (srcpad);
+    GstVaapiScaleLadderRendition rendition = { NULL, };
+
+    if (!gst_pad_is_linked (pad)) {
+      update_flow (ladder, pad, GST_FLOW_NOT_LINKED);
+      continue;
+    }
+
+    if ((gst_pad_check_reconfigure (pad) || !gst_pad_has_current_caps (pad))
+        && !gst_vaapi_scale_ladder_negotiate_pad (ladder, srcpad)) {
+      gst_pad_mark_reconfigure (pad);
+      update_flow (ladder, pad, GST_FLOW_NOT_NEGOTIATED);
+      continue;
+    }
+
+    rendition.pad = gst_object_ref (srcpad);
+    rendition.width = GST_VIDEO_INFO_WIDTH (&srcpad->priv->info);
+    rendition.height = GST_VIDEO_INFO_HEIGHT (&srcpad->priv->info);
+    g_array_append_val (renditions, rendition);
+  }
+  g_list_free_full (pads, gst_object_unref);
+
+  g_array_sort (renditions, compare_renditions);
+  return renditions;
+}
+
+static void
+free_renditions (GArray * renditions)
+{
+  guint i;
+
+  for (i = 0; i < renditions->len; i++) {
+    GstVaapiScaleLadderRendition *const r =
+        &g_array_index (renditions, GstVaapiScaleLadderRendition, i);
+
+    gst_buffer_replace (&r->outbuf, NULL);
+    gst_object_unref (r->pad);
+  }
+  g_array_unref (renditions);
+}
+
+/* Looks for the smallest rendition produced so far that covers the
+ * size of rendition @index */
+static const GstVaapiScaleLadderRendition *
+find_cascade_source (GArray * renditions, guint index)
+{
+  const GstVaapiScaleLadderRendition *const r =
+      &g_array_index (renditions, GstVaapiScaleLadderRendition, index);
+  const GstVaapiScaleLadderRendition *source = NULL;
+  guint i;
+
+  for (i = 0; i < index; i++) {
+    const GstVaapiScaleLadderRendition *const prev =
+        &g_array_index (renditions, GstVaapiScaleLadderRendition, i);
+
+    if (prev->surface && prev->width >= r->width && prev->height >= r->height)
+      source = prev;
+  }
+  return source;
+}
+
+static GstFlowReturn
+gst_vaapi_scale_ladder_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buf)
+{
+  GstVaapiScaleLadder *const ladder = GST_VAAPI_SCALE_LADDER (parent);
+  GstVaapiPluginBase *const plugin = GST_VAAPI_PLUGIN_BASE (ladder);
+  GstVaapiVideoMeta *inbuf_meta, *outbuf_meta;
+  GstVaapiSurface *inbuf_surface;
+  const GstVaapiRectangle *inbuf_crop_rect;
+  GstVaapiRectangle cascade_rect;
+  GstVaapiFilterStatus status;
+  GArray *renditions;
+  GstBuffer *inbuf;
+  GstFlowReturn ret;
+  GstVideoFormat format;
+  gboolean cascade;
+  guint i, flags;
+
+  ret = gst_vaapi_plugin_base_pad_get_input_buffer (plugin, pad, buf, &inbuf);
+  gst_buffer_unref (buf);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  inbuf_meta = gst_buffer_get_vaapi_video_meta (inbuf);
+  if (!inbuf_meta)
+    goto error_invalid_buffer;
+  inbuf_surface = gst_vaapi_video_meta_get_surface (inbuf_meta);
+  inbuf_crop_rect = gst_vaapi_video_meta_get_render_rect (inbuf_meta);
+  flags = (gst_vaapi_video_meta_get_render_flags (inbuf_meta) &
+      ~GST_VAAPI_PICTURE_STRUCTURE_MASK) | GST_VAAPI_PICTURE_STRUCTURE_FRAME;
+
+  GST_OBJECT_LOCK (ladder);
+  cascade = ladder->cascade;
+  GST_OBJECT_UNLOCK (ladder);
+
+  renditions = collect_renditions (ladder);
+
+  /* Produce all the renditions first, so that the larger ones can
+   * serve as sources for the smaller ones */
+  for (i = 0; i < renditions->len; i++) {
+    GstVaapiScaleLadderRendition *const r =
+        &g_array_index (renditions, GstVaapiScaleLadderRendition, i);
+    const GstVaapiScaleLadderRendition *source = NULL;
+    GstVaapiSurface *src_surface = inbuf_surface;
+    const GstVaapiRectangle *src_rect = inbuf_crop_rect;
+
+    r->outbuf = create_output_buffer (ladder, r->pad);
+    if (!r->outbuf)
+      goto error_create_buffer;
+
+    outbuf_meta = gst_buffer_get_vaapi_video_meta (r->outbuf);
+    r->surface = gst_vaapi_video_meta_get_surface (outbuf_meta);
+
+    if (cascade)
+      source = find_cascade_source (renditions, i);
+    if (source) {
+      cascade_rect.x = 0;
+      cascade_rect.y = 0;
+      cascade_rect.width = source->width;
+      cascade_rect.height = source->height;
+      src_surface = source->surface;
+      src_rect = &cascade_rect;
+    }
+
+    GST_LOG_OBJECT (r->pad, "scaling to %ux%u from %s", r->width, r->height,
+        source ? GST_PAD_NAME (source->pad) : "input");
+
+    /* the renditions usually share their format, so the filter only
+     * needs to be reconfigured when their caps change */
+    format = GST_VIDEO_INFO_FORMAT (&r->pad->priv->info);
+    if (format != ladder->filter_format) {
+      if (!gst_vaapi_filter_set_format (ladder->filter, format))
+        goto error_process_vpp;
+      ladder->filter_format = format;
+    }
+    gst_vaapi_filter_set_cropping_rectangle (ladder->filter, src_rect);
+    status = gst_vaapi_filter_process (ladder->filter, src_surface,
+        r->surface, flags);
+    if (status != GST_VAAPI_FILTER_STATUS_SUCCESS)
+      goto error_process_vpp;
+
+    gst_buffer_copy_into (r->outbuf, inbuf,
+        GST_BUFFER_COPY_TIMESTAMPS | GST_BUFFER_COPY_FLAGS, 0, -1);
+  }
+
+  ret = update_flow (ladder, NULL, GST_FLOW_OK);
+  for (i = 0; i < renditions->len; i++) {
+    GstVaapiScaleLadderRendition *const r =
+        &g_array_index (renditions, GstVaapiScaleLadderRendition, i);
+    GstBuffer *const outbuf = r->outbuf;
+
+    r->outbuf = NULL;
+    ret = update_flow (ladder, GST_PAD (r->pad),
+        gst_pad_push (GST_PAD (r->pad), outbuf));
+  }
+
+  free_renditions (renditions);
+  gst_buffer_unref (inbuf);
+  return ret;
+
+  /* ERRORS */
+error_invalid_buffer:
+  {
+    GST_ELEMENT_ERROR (ladder, STREAM, FAILED,
+        ("failed to validate source buffer"), (NULL));
+    gst_buffer_unref (inbuf);
+    return GST_FLOW_ERROR;
+  }
+error_create_buffer:
+  {
+    GST_ELEMENT_ERROR (ladder, STREAM, FAILED,
+        ("failed to create output buffer"), (NULL));
+    free_renditions (renditions);
+    gst_buffer_unref (inbuf);
+    return GST_FLOW_ERROR;
+  }
+error_process_vpp:
+  {
+    GST_ELEMENT_ERROR (ladder, STREAM, FAILED,
+        ("failed to apply VPP filters"), (NULL));
+    free_renditions (renditions);
+    gst_buffer_unref (inbuf);
+    return GST_FLOW_ERROR;
+  }
+}
+
+/* Forwards @event to the src pads. Sticky events are held back from
+ * the pads that are not negotiated yet, replay_sticky_events() pushes
+ * them in order around their caps */
+static gboolean
+forward_event (GstVaapiScaleLadder * ladder, GstEvent * event)
+{
+  const GstEventType type = GST_EVENT_TYPE (event);
+  const gboolean needs_caps = GST_EVENT_IS_STICKY (event)
+      && type != GST_EVENT_EOS;
+  GList *l, *pads;
+  gboolean ret = TRUE;
+
+  pads = get_src_pads (ladder);
+  for (l = pads; l; l = l->next) {
+    GstPad *const srcpad = l->data;
+
+    if (needs_caps && !gst_pad_has_current_caps (srcpad))
+      continue;
+    if (!gst_pad_push_event (srcpad, gst_event_ref (event)))
+      ret = FALSE;
+  }
+  g_list_free_full (pads, gst_object_unref);
+
+  gst_event_unref (event);
+  return ret;
+}
+
+static gboolean
+gst_vaapi_scale_ladder_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstVaapiScaleLadder *const ladder = GST_VAAPI_SCALE_LADDER (parent);
+  GstVaapiPluginBase *const plugin = GST_VAAPI_PLUGIN_BASE (ladder);
+
+  GST_DEBUG_OBJECT (ladder, "handling %s event", GST_EVENT_TYPE_NAME (event));
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:{
+      GstCaps *caps;
+      GList *l, *pads;
+      gboolean ret;
+
+      gst_event_parse_caps (event, &caps);
+      ret = gst_vaapi_plugin_base_pad_set_caps (plugin, pad, caps, NULL, NULL);
+      gst_event_unref (event);
+      if (!ret)
+        return FALSE;
+
+      /* the src pads are negotiated with the next buffer */
+      pads = get_src_pads (ladder);
+      for (l = pads; l; l = l->next)
+        gst_pad_mark_reconfigure (l->data);
+      g_list_free_full (pads, gst_object_unref);
+      return TRUE;
+    }
+    case GST_EVENT_FLUSH_STOP:
+      GST_OBJECT_LOCK (ladder);
+      gst_flow_combiner_reset (ladder->flow_combiner);
+      GST_OBJECT_UNLOCK (ladder);
+      break;
+    default:
+      break;
+  }
+
+  return forward_event (ladder, event);
+}
+
+static gboolean
+gst_vaapi_scale_ladder_sink_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstVaapiScaleLadder *const ladder = GST_VAAPI_SCALE_LADDER (parent);
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CONTEXT:
+      if (gst_vaapi_handle_context_query (GST_ELEMENT (ladder), query)) {
+        GST_DEBUG_OBJECT (ladder, "sharing display %" GST_PTR_FORMAT,
+            GST_VAAPI_PLUGIN_BASE_DISPLAY (ladder));
+        return TRUE;
+      }
+      break;
+    case GST_QUERY_ALLOCATION:
+      return gst_vaapi_plugin_base_pad_propose_allocation
+          (GST_VAAPI_PLUGIN_BASE (ladder), pad, query);
+    default:
+      break;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+static gboolean
+gst_vaapi_scale_ladder_src_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstVaapiScaleLadder *const ladder = GST_VAAPI_SCALE_LADDER (parent);
+
+  if (GST_QUERY_TYPE (query) == GST_QUERY_CONTEXT) {
+    if (gst_vaapi_handle_context_query (GST_ELEMENT (ladder), query)) {
+      GST_DEBUG_OBJECT (ladder, "sharing display %" GST_PTR_FORMAT,
+          GST_VAAPI_PLUGIN_BASE_DISPLAY (ladder));
+      return TRUE;
+    }
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+static GstPad *
+gst_vaapi_scale_ladder_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * req_name, const GstCaps * caps)
+{
+  GstVaapiScaleLadder *const ladder = GST_VAAPI_SCALE_LADDER (element);
+  GstPad *pad;
+  gchar *name;
+  guint pad_id;
+
+  GST_OBJECT_LOCK (ladder);
+  if (req_name && sscanf (req_name, "src_%u", &pad_id) == 1) {
+    if (pad_id >= ladder->next_pad_id)
+      ladder->next_pad_id = pad_id + 1;
+  } else {
+    pad_id = ladder->next_pad_id++;
+  }
+  GST_OBJECT_UNLOCK (ladder);
+
+  name = g_strdup_printf ("src_%u", pad_id);
+  pad = g_object_new (GST_TYPE_VAAPI_SCALE_LADDER_SRC_PAD, "name", name,
+      "direction", GST_PAD_SRC, "template", templ, NULL);
+  g_free (name);
+
+  gst_pad_set_query_function (pad,
+      GST_DEBUG_FUNCPTR (gst_vaapi_scale_ladder_src_query));
+
+  if (!gst_element_add_pad (element, pad)) {
+    GST_DEBUG_OBJECT (element, "could not add pad src_%u", pad_id);
+    gst_object_unref (pad);
+    return NULL;
+  }
+
+  GST_OBJECT_LOCK (ladder);
+  gst_flow_combiner_add_pad (ladder->flow_combiner, pad);
+  GST_OBJECT_UNLOCK (ladder);
+
+  return pad;
+}
+
+static void
+gst_vaapi_scale_ladder_release_pad (GstElement * element, GstPad * pad)
+{
+  GstVaapiScaleLadder *const ladder = GST_VAAPI_SCALE_LADDER (element);
+
+  GST_OBJECT_LOCK (ladder);
+  gst_flow_combiner_remove_pad (ladder->flow_combiner, pad);
+  GST_OBJECT_UNLOCK (ladder);
+
+  gst_pad_set_active (pad, FALSE);
+  gst_element_remove_pad (element, pad);
+}
+
+static gboolean
+gst_vaapi_scale_ladder_start (GstVaapiScaleLadder * ladder)
+{
+  GstVaapiPluginBase *const plugin = GST_VAAPI_PLUGIN_BASE (ladder);
+
+  if (!gst_vaapi_plugin_base_open (plugin))
+    return FALSE;
+
+  if (!gst_vaapi_plugin_base_ensure_display (plugin))
+    return FALSE;
+
+  ladder->filter =
+      gst_vaapi_filter_new (GST_VAAPI_PLUGIN_BASE_DISPLAY (plugin));
+  if (!ladder->filter)
+    return FALSE;
+  ladder->filter_format = GST_VIDEO_FORMAT_UNKNOWN;
+
+  GST_OBJECT_LOCK (ladder);
+  gst_flow_combiner_reset (ladder->flow_combiner);
+  GST_OBJECT_UNLOCK (ladder);
+  return TRUE;
+}
+
+static void
+gst_vaapi_scale_ladder_stop (GstVaapiScaleLadder * ladder)
+{
+  GList *l, *pads;
+
+  pads = get_src_pads (ladder);
+  for (l = pads; l; l = l->next)
+    gst_vaapi_scale_ladder_src_pad_reset (l->data);
+  g_list_free_full (pads, gst_object_unref);
+
+  gst_vaapi_filter_replace (&ladder->filter, NULL);
+  gst_vaapi_plugin_base_close (GST_VAAPI_PLUGIN_BASE (ladder));
+}
+
+static GstStateChangeReturn
+gst_vaapi_scale_ladder_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstVaapiScaleLadder *const ladder = GST_VAAPI_SCALE_LADDER (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      if (!gst_vaapi_scale_ladder_start (ladder))
+        return GST_STATE_CHANGE_FAILURE;
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (gst_vaapi_scale_ladder_parent_class)->change_state
+      (element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_vaapi_scale_ladder_stop (ladder);
+      break;
+    default:
+      break;
+  }
+  return ret;
+}
+
+static GstVaapiPadPrivate *
+gst_vaapi_scale_ladder_get_vaapi_pad_private (GstVaapiPluginBase * plugin,
+    GstPad * pad)
+{
+  if (GST_IS_VAAPI_SCALE_LADDER_SRC_PAD (pad))
+    return GST_VAAPI_SCALE_LADDER_SRC_PAD (pad)->priv;
+
+  g_assert (GST_VAAPI_PLUGIN_BASE_SINK_PAD (plugin) == pad);
+  return GST_VAAPI_PLUGIN_BASE_SINK_PAD_PRIVATE (plugin);
+}
+
+static void
+gst_vaapi_scale_ladder_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstVaapiScaleLadder *const ladder = GST_VAAPI_SCALE_LADDER (object);
+
+  switch (prop_id) {
+    case PROP_CASCADE:
+      GST_OBJECT_LOCK (ladder);
+      ladder->cascade = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (ladder);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_vaapi_scale_ladder_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstVaapiScaleLadder *const ladder = GST_VAAPI_SCALE_LADDER (object);
+
+  switch (prop_id) {
+    case PROP_CASCADE:
+      GST_OBJECT_LOCK (ladder);
+      g_value_set_boolean (value, ladder->cascade);
+      GST_OBJECT_UNLOCK (ladder);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_vaapi_scale_ladder_finalize (GObject * object)
+{
+  GstVaapiScaleLadder *const ladder = GST_VAAPI_SCALE_LADDER (object);
+
+  gst_vaapi_filter_replace (&ladder->filter, NULL);
+  gst_flow_combiner_free (ladder->flow_combiner);
+  gst_vaapi_plugin_base_finalize (GST_VAAPI_PLUGIN_BASE (ladder));
+
+  G_OBJECT_CLASS (gst_vaapi_scale_ladder_parent_class)->finalize (object);
+}
+
+static void
+gst_vaapi_scale_ladder_class_init (GstVaapiScaleLadderClass * klass)
+{
+  GObjectClass *const object_class = G_OBJECT_CLASS (klass);
+  GstElementClass *const element_class = GST_ELEMENT_CLASS (klass);
+  GstVaapiPluginBaseClass *plugin_class = GST_VAAPI_PLUGIN_BASE_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_debug_vaapi_scale_ladder,
+      GST_PLUGIN_NAME, 0, GST_PLUGIN_DESC);
+
+  gst_vaapi_plugin_base_class_init (plugin_class);
+  plugin_class->get_vaapi_pad_private =
+      GST_DEBUG_FUNCPTR (gst_vaapi_scale_ladder_get_vaapi_pad_private);
+
+  object_class->finalize = gst_vaapi_scale_ladder_finalize;
+  object_class->set_property = gst_vaapi_scale_ladder_set_property;
+  object_class->get_property = gst_vaapi_scale_ladder_get_property;
+
+  /**
+   * GstVaapiScaleLadder:cascade:
+   *
+   * Whether to scale every rendition from the smallest larger
+   * rendition, instead of the input frame.
+   */
+  g_object_class_install_property (object_class, PROP_CASCADE,
+      g_param_spec_boolean ("cascade", "Cascade",
+          "Scale each rendition from the next larger one",
+          DEFAULT_CASCADE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  element_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_vaapi_scale_ladder_change_state);
+  element_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_vaapi_scale_ladder_request_new_pad);
+  element_class->release_pad =
+      GST_DEBUG_FUNCPTR (gst_vaapi_scale_ladder_release_pad);
+  element_class->set_context = GST_DEBUG_FUNCPTR (gst_vaapi_base_set_context);
+
+  gst_element_class_add_static_pad_template (element_class,
+      &gst_vaapi_scale_ladder_sink_factory);
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &gst_vaapi_scale_ladder_src_factory,
+      GST_TYPE_VAAPI_SCALE_LADDER_SRC_PAD);
+
+  gst_element_class_set_static_metadata (element_class,
+      "VA-API scale ladder",
+      "Filter/Converter/Video/Scaler/Hardware",
+      GST_PLUGIN_DESC, "The GStreamer VA-API team");
+}
+
+static void
+gst_vaapi_scale_ladder_init (GstVaapiScaleLadder * ladder)
+{
+  GstPad *sinkpad;
+
+  sinkpad = gst_pad_new_from_static_template
+      (&gst_vaapi_scale_ladder_sink_factory, "sink");
+  gst_pad_set_chain_function (sinkpad,
+      GST_DEBUG_FUNCPTR (gst_vaapi_scale_ladder_chain));
+  gst_pad_set_event_function (sinkpad,
+      GST_DEBUG_FUNCPTR (gst_vaapi_scale_ladder_sink_event));
+  gst_pad_set_query_function (sinkpad,
+      GST_DEBUG_FUNCPTR (gst_vaapi_scale_ladder_sink_query));
+  gst_element_add_pad (GST_ELEMENT (ladder), sinkpad);
+
+  gst_vaapi_plugin_base_init (GST_VAAPI_PLUGIN_BASE (ladder),
+      GST_CAT_DEFAULT);
+
+  ladder->flow_combiner = gst_flow_combiner_new ();
+  ladder->cascade = DEFAULT_CASCADE;
+}
@@ -1295,10 +1295,21 @@ gst_vaapisink_stop (GstBaseSink * base_sink)
 {
   GstVaapiSink *const sink = GST_VAAPISINK_CAST (base_sink);
 
+  GstVaapiSubpictureCacheStats stats;
+
   gst_vaapisink_set_event_handling (sink, FALSE);
   gst_buffer_replace (&sink->video_buffer, NULL);
   gst_vaapi_window_replace (&sink->window, NULL);
 
+  /* cached subpictures hold the display */
+  gst_vaapi_subpicture_cache_get_stats (sink->subpicture_cache, &stats);
+  if (stats.hits + stats.misses > 0) {
+    GST_INFO_OBJECT (sink, "subpicture cache: %" G_GUINT64_FORMAT " hits, %"
+        G_GUINT64_FORMAT " misses, %" G_GUINT64_FORMAT " evictions",
+        stats.hits, stats.misses, stats.evictions);
+  }
+  gst_vaapi_subpicture_cache_reset (sink->subpicture_cache);
+
   gst_vaapi_plugin_base_close (GST_VAAPI_PLUGIN_BASE (sink));
   return TRUE;
 }
@@ -1516,7 +1527,8 @@ gst_vaapisink_show_frame_unlocked (GstVaapiSink * sink, GstBuffer * src_buffer)
   if (!(flags & GST_VAAPI_COLOR_STANDARD_MASK))
     flags |= sink->color_standard;
 
-  if (!gst_vaapi_apply_composition (surface, src_buffer))
+  if (!gst_vaapi_apply_composition (surface, src_buffer,
+          sink->subpicture_cache))
     GST_WARNING ("could not update subtitles");
 
   if (!sink->backend->render_surface (sink, surface, surface_rect, flags))
@@ -1621,6 +1633,7 @@ gst_vaapisink_destroy (GstVaapiSink * sink)
   cb_channels_finalize (sink);
   gst_buffer_replace (&sink->video_buffer, NULL);
   gst_caps_replace (&sink->caps, NULL);
+  gst_clear_object (&sink->subpicture_cache);
 }
 
 static void
@@ -1985,6 +1998,7 @@ gst_vaapisink_init (GstVaapiSink * sink)
   sink->rotation_tag = DEFAULT_ROTATION;
   sink->keep_aspect = TRUE;
   sink->signal_handoffs = DEFAULT_SIGNAL_HANDOFFS;
+  sink->subpicture_cache = gst_vaapi_subpicture_cache_new (0);
   gst_video_info_init (&sink->video_info);
 
   for (i = 0; i < G_N_ELEMENTS (sink->cb_values); i++)
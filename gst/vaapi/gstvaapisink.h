@@ -27,6 +27,7 @@
 
 #include "gstvaapipluginbase.h"
 #include <gst/vaapi/gstvaapiwindow.h>
+#include <gst/vaapi/gstvaapisubpicturecache.h>
 #include "gstvaapipluginutil.h"
 
 G_BEGIN_DECLS
@@ -100,6 +101,7 @@ struct _GstVaapiSink
   gint32 view_id;
   GThread *event_thread;
   gboolean event_thread_cancel;
+  GstVaapiSubpictureCache *subpicture_cache;
 
   /* Color balance values */
   guint cb_changed;
@@ -0,0 +1,92 @@
+/*
+ *  bench-bitwriter.c - Packed headers bit writing benchmarks
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/vaapi/gstvaapiutils_h26x_priv.h>
+#include "bench.h"
+
+/* syntax elements written per header, about a slice header worth */
+#define NUM_SYNTAX_ELEMENTS 64
+
+/* size of the NAL unit payload to escape, about a SPS with VUI */
+#define NAL_PAYLOAD_SIZE 256
+
+/* Writes a header made of Exp-Golomb and fixed size syntax elements,
+   as the H.264 and H.265 encoders do for their packed headers */
+static gboolean
+write_exp_golomb (gpointer user_data)
+{
+  GstBitWriter bs;
+  guint i;
+
+  gst_bit_writer_init_with_size (&bs, 128, FALSE);
+  for (i = 0; i < NUM_SYNTAX_ELEMENTS; i++) {
+    WRITE_UE (&bs, i * 37);
+    WRITE_SE (&bs, (gint32) (i * 13) - 400);
+    WRITE_UINT32 (&bs, i & 1, 1);
+  }
+
+  /* rbsp_trailing_bits() */
+  WRITE_UINT32 (&bs, 1, 1);
+  gst_bit_writer_align_bytes (&bs, 0);
+  gst_bit_writer_reset (&bs);
+  return TRUE;
+
+  /* ERRORS */
+bs_error:
+  {
+    gst_bit_writer_reset (&bs);
+    return FALSE;
+  }
+}
+
+/* Escapes a NAL unit full of start code emulations, as done when
+   writing the codec_data */
+static gboolean
+write_nal_unit (gpointer user_data)
+{
+  guint8 *const payload = user_data;
+  GstBitWriter bs;
+  gboolean success;
+
+  gst_bit_writer_init_with_size (&bs, 2 * NAL_PAYLOAD_SIZE, FALSE);
+  success = gst_vaapi_utils_h26x_write_nal_unit (&bs, payload,
+      NAL_PAYLOAD_SIZE);
+  gst_bit_writer_reset (&bs);
+  return success;
+}
+
+int
+main (int argc, char *argv[])
+{
+  guint8 payload[NAL_PAYLOAD_SIZE];
+  guint i;
+
+  if (!bench_init (&argc, &argv, "bitwriter"))
+    return 1;
+
+  /* a zero run every 4 bytes, hence an emulation prevention byte */
+  for (i = 0; i < NAL_PAYLOAD_SIZE; i++)
+    payload[i] = (i % 4) < 2 ? 0x00 : 0x01;
+
+  bench_run ("exp-golomb", write_exp_golomb, NULL, 0);
+  bench_run ("nal-unit", write_nal_unit, payload, NAL_PAYLOAD_SIZE);
+
+  return bench_finish ();
+}
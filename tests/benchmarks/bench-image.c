@@ -0,0 +1,135 @@
+/*
+ *  bench-image.c - System memory image copy benchmarks
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Times the copies done by gst_vaapi_image_get_buffer() and friends,
+ * between two system memory images laid out as VA images usually are */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/vaapi/gstvaapiimage_priv.h>
+#include "bench.h"
+
+#define IMAGE_WIDTH 1920
+#define IMAGE_HEIGHT 1080
+
+/* VA images usually have their pitches aligned to 64 bytes */
+#define PITCH_ALIGN 64
+
+typedef struct
+{
+  GstVaapiImageRaw dst_image;
+  GstVaapiImageRaw src_image;
+  GstVaapiRectangle rect;
+  guint64 data_size;
+  gpointer data;
+} ImageCopy;
+
+static gboolean
+copy_image (gpointer user_data)
+{
+  ImageCopy *const copy = user_data;
+
+  return gst_vaapi_image_raw_copy (&copy->dst_image, &copy->src_image,
+      &copy->rect);
+}
+
+static void
+image_raw_init (GstVaapiImageRaw * image, GstVideoFormat format,
+    guint8 * data)
+{
+  GstVideoInfo vi;
+  guint i, offset = 0;
+
+  gst_video_info_set_format (&vi, format, IMAGE_WIDTH, IMAGE_HEIGHT);
+
+  image->format = format;
+  image->width = IMAGE_WIDTH;
+  image->height = IMAGE_HEIGHT;
+  image->num_planes = GST_VIDEO_INFO_N_PLANES (&vi);
+  for (i = 0; i < image->num_planes; i++) {
+    image->stride[i] = GST_ROUND_UP_N (GST_VIDEO_INFO_PLANE_STRIDE (&vi, i),
+        PITCH_ALIGN);
+    image->pixels[i] = data + offset;
+    offset += image->stride[i] * GST_VIDEO_INFO_COMP_HEIGHT (&vi, i);
+  }
+}
+
+static guint64
+image_data_size (GstVideoFormat format)
+{
+  GstVideoInfo vi;
+  guint64 size = 0;
+  guint i;
+
+  gst_video_info_set_format (&vi, format, IMAGE_WIDTH, IMAGE_HEIGHT);
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&vi); i++)
+    size += (guint64) GST_ROUND_UP_N (GST_VIDEO_INFO_PLANE_STRIDE (&vi, i),
+        PITCH_ALIGN) * GST_VIDEO_INFO_COMP_HEIGHT (&vi, i);
+  return size;
+}
+
+static void
+run_copy (GstVideoFormat format, gboolean subregion)
+{
+  ImageCopy copy;
+  gchar *name;
+  guint8 *data;
+  guint64 bytes;
+
+  copy.data_size = image_data_size (format);
+  copy.data = data = g_malloc (2 * copy.data_size);
+  memset (data, 0x80, 2 * copy.data_size);
+  image_raw_init (&copy.src_image, format, data);
+  image_raw_init (&copy.dst_image, format, data + copy.data_size);
+
+  /* the subregion is the kind of rectangle an overlay update touches */
+  copy.rect.x = subregion ? IMAGE_WIDTH / 4 : 0;
+  copy.rect.y = subregion ? IMAGE_HEIGHT / 4 : 0;
+  copy.rect.width = subregion ? IMAGE_WIDTH / 2 : IMAGE_WIDTH;
+  copy.rect.height = subregion ? IMAGE_HEIGHT / 2 : IMAGE_HEIGHT;
+  bytes = gst_util_uint64_scale (copy.data_size,
+      copy.rect.width * copy.rect.height, IMAGE_WIDTH * IMAGE_HEIGHT);
+
+  name = g_strdup_printf ("copy-%s%s", gst_video_format_to_string (format),
+      subregion ? "-rect" : "");
+  bench_run (name, copy_image, &copy, bytes);
+  g_free (name);
+  g_free (copy.data);
+}
+
+int
+main (int argc, char *argv[])
+{
+  static const GstVideoFormat formats[] = {
+    GST_VIDEO_FORMAT_NV12,
+    GST_VIDEO_FORMAT_I420,
+    GST_VIDEO_FORMAT_YUY2,
+    GST_VIDEO_FORMAT_RGBA,
+  };
+  guint i;
+
+  if (!bench_init (&argc, &argv, "image"))
+    return 1;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    run_copy (formats[i], FALSE);
+    run_copy (formats[i], TRUE);
+  }
+
+  return bench_finish ();
+}
@@ -0,0 +1,236 @@
+/*
+ *  bench-parse.c - Bitstream parsing benchmarks
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Splits the embedded test clips into units, parsing the headers the
+ * decoders parse on their parse() stage, with the same codecparsers */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gstjpegparser.h>
+#include <gst/codecparsers/gstmpegvideoparser.h>
+#include <gst/codecparsers/gstmpeg4parser.h>
+#include <gst/codecparsers/gstvc1parser.h>
+#include <gst/codecparsers/gstav1parser.h>
+#include "bench.h"
+#include "test-h264.h"
+#include "test-jpeg.h"
+#include "test-mpeg2.h"
+#include "test-mpeg4.h"
+#include "test-vc1.h"
+
+/* number of padding OBUs in the synthesized AV1 temporal unit */
+#define AV1_NUM_OBUS 64
+#define AV1_OBU_PAYLOAD_SIZE 200
+
+static gboolean
+parse_h264 (gpointer user_data)
+{
+  const VideoDecodeInfo *const info = user_data;
+  GstH264NalParser *const parser = gst_h264_nal_parser_new ();
+  GstH264ParserResult result;
+  GstH264NalUnit nalu;
+  GstH264SliceHdr slice_hdr;
+  guint offset = 0, num_units = 0;
+
+  do {
+    result = gst_h264_parser_identify_nalu (parser, info->data, offset,
+        info->data_size, &nalu);
+    if (result != GST_H264_PARSER_OK && result != GST_H264_PARSER_NO_NAL_END)
+      break;
+
+    switch (nalu.type) {
+      case GST_H264_NAL_SLICE:
+      case GST_H264_NAL_SLICE_IDR:
+        gst_h264_parser_parse_slice_hdr (parser, &nalu, &slice_hdr, TRUE,
+            TRUE);
+        break;
+      default:
+        gst_h264_parser_parse_nal (parser, &nalu);
+        break;
+    }
+    num_units++;
+    offset = nalu.offset + nalu.size;
+  } while (result == GST_H264_PARSER_OK && offset < info->data_size);
+
+  gst_h264_nal_parser_free (parser);
+  return num_units > 0;
+}
+
+static gboolean
+parse_mpeg2 (gpointer user_data)
+{
+  const VideoDecodeInfo *const info = user_data;
+  GstMpegVideoPacket packet;
+  GstMpegVideoSequenceHdr seq_hdr;
+  GstMpegVideoPictureHdr pic_hdr;
+  guint offset = 0, num_units = 0;
+
+  while (gst_mpeg_video_parse (&packet, info->data, info->data_size, offset)) {
+    switch (packet.type) {
+      case GST_MPEG_VIDEO_PACKET_SEQUENCE:
+        gst_mpeg_video_packet_parse_sequence_header (&packet, &seq_hdr);
+        break;
+      case GST_MPEG_VIDEO_PACKET_PICTURE:
+        gst_mpeg_video_packet_parse_picture_header (&packet, &pic_hdr);
+        break;
+      default:
+        break;
+    }
+    num_units++;
+    if (packet.size < 0)
+      break;
+    offset = packet.offset + packet.size;
+  }
+  return num_units > 0;
+}
+
+static gboolean
+parse_mpeg4 (gpointer user_data)
+{
+  const VideoDecodeInfo *const info = user_data;
+  GstMpeg4Packet packet;
+  GstMpeg4ParseResult result;
+  guint offset = 0, num_units = 0;
+
+  do {
+    result = gst_mpeg4_parse (&packet, FALSE, NULL, info->data, offset,
+        info->data_size);
+    if (result != GST_MPEG4_PARSER_OK &&
+        result != GST_MPEG4_PARSER_NO_PACKET_END)
+      break;
+    num_units++;
+    offset = packet.offset + packet.size;
+  } while (result == GST_MPEG4_PARSER_OK && offset < info->data_size);
+
+  return num_units > 0;
+}
+
+static gboolean
+parse_jpeg (gpointer user_data)
+{
+  const VideoDecodeInfo *const info = user_data;
+  GstJpegSegment seg;
+  guint offset = 0, num_units = 0;
+
+  while (gst_jpeg_parse (&seg, info->data, info->data_size, offset)) {
+    num_units++;
+    if (seg.size < 0)
+      break;
+    offset = seg.offset + seg.size;
+  }
+  return num_units > 0;
+}
+
+static gboolean
+parse_vc1 (gpointer user_data)
+{
+  const VideoDecodeInfo *const info = user_data;
+  const guint8 *data = info->data;
+  gsize size = info->data_size;
+  GstVC1ParserResult result;
+  GstVC1BDU bdu;
+  guint num_units = 0;
+
+  do {
+    result = gst_vc1_identify_next_bdu (data, size, &bdu);
+    if (result != GST_VC1_PARSER_OK && result != GST_VC1_PARSER_NO_BDU_END)
+      break;
+    num_units++;
+    data += bdu.offset + bdu.size;
+    size -= bdu.offset + bdu.size;
+  } while (result == GST_VC1_PARSER_OK && size > 0);
+
+  return num_units > 0;
+}
+
+static gboolean
+parse_av1 (gpointer user_data)
+{
+  const GByteArray *const tu = user_data;
+  GstAV1Parser *const parser = gst_av1_parser_new ();
+  GstAV1ParserResult result;
+  GstAV1OBU obu;
+  guint32 offset = 0, consumed;
+  guint num_units = 0;
+
+  while (offset < tu->len) {
+    result = gst_av1_parser_identify_one_obu (parser, tu->data + offset,
+        tu->len - offset, &obu, &consumed);
+    if (result != GST_AV1_PARSER_OK && result != GST_AV1_PARSER_DROP)
+      break;
+    num_units++;
+    offset += consumed;
+  }
+
+  gst_av1_parser_free (parser);
+  return num_units > 0;
+}
+
+/* There is no embedded AV1 clip: synthesize a temporal unit of padding
+   OBUs, which only exercises the OBU framing */
+static GByteArray *
+make_av1_temporal_unit (void)
+{
+  static const guint8 temporal_delimiter[] = { 0x12, 0x00 };
+  guint8 payload[AV1_OBU_PAYLOAD_SIZE], header[3];
+  GByteArray *tu;
+  guint i;
+
+  memset (payload, 0x80, sizeof (payload));
+  header[0] = (GST_AV1_OBU_PADDING << 3) | 0x02;        /* obu_has_size */
+  header[1] = (AV1_OBU_PAYLOAD_SIZE & 0x7f) | 0x80;     /* leb128 */
+  header[2] = AV1_OBU_PAYLOAD_SIZE >> 7;
+
+  tu = g_byte_array_new ();
+  g_byte_array_append (tu, temporal_delimiter, sizeof (temporal_delimiter));
+  for (i = 0; i < AV1_NUM_OBUS; i++) {
+    g_byte_array_append (tu, header, sizeof (header));
+    g_byte_array_append (tu, payload, sizeof (payload));
+  }
+  return tu;
+}
+
+int
+main (int argc, char *argv[])
+{
+  VideoDecodeInfo h264, mpeg2, mpeg4, jpeg, vc1;
+  GByteArray *av1;
+  gint ret;
+
+  if (!bench_init (&argc, &argv, "parse"))
+    return 1;
+
+  h264_get_video_info (&h264);
+  mpeg2_get_video_info (&mpeg2);
+  mpeg4_get_video_info (&mpeg4);
+  jpeg_get_video_info (&jpeg);
+  vc1_get_video_info (&vc1);
+  av1 = make_av1_temporal_unit ();
+
+  bench_run ("h264-annexb", parse_h264, &h264, h264.data_size);
+  bench_run ("mpeg2", parse_mpeg2, &mpeg2, mpeg2.data_size);
+  bench_run ("mpeg4", parse_mpeg4, &mpeg4, mpeg4.data_size);
+  bench_run ("jpeg", parse_jpeg, &jpeg, jpeg.data_size);
+  bench_run ("vc1", parse_vc1, &vc1, vc1.data_size);
+  bench_run ("av1-obu-framing", parse_av1, av1, av1->len);
+
+  ret = bench_finish ();
+  g_byte_array_unref (av1);
+  return ret;
+}
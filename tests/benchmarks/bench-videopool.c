@@ -0,0 +1,120 @@
+/*
+ *  bench-videopool.c - Video object pool benchmarks
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Times the GstVaapiVideoPool bookkeeping alone: the pool is a
+ * subclass without display, holding plain buffers in place of VA
+ * surfaces */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/vaapi/gstvaapivideopool.h>
+#include <gst/vaapi/gstvaapivideopool_priv.h>
+#include "bench.h"
+
+/* about the number of surfaces a H.264 decoder allocates */
+#define POOL_SIZE 24
+
+typedef struct
+{
+  GstVaapiVideoPool *pool;
+  gpointer objects[POOL_SIZE];
+} PoolCycle;
+
+static gpointer
+fake_pool_alloc_object (GstVaapiVideoPool * pool)
+{
+  return gst_buffer_new ();
+}
+
+static const GstVaapiMiniObjectClass *
+fake_pool_class (void)
+{
+  static const GstVaapiVideoPoolClass FakePoolClass = {
+    {sizeof (GstVaapiVideoPool),
+        (GDestroyNotify) gst_vaapi_video_pool_finalize}
+    ,
+    .alloc_object = fake_pool_alloc_object
+  };
+  return GST_VAAPI_MINI_OBJECT_CLASS (&FakePoolClass);
+}
+
+static GstVaapiVideoPool *
+fake_pool_new (void)
+{
+  GstVaapiVideoPool *pool;
+
+  pool = (GstVaapiVideoPool *) gst_vaapi_mini_object_new (fake_pool_class ());
+  if (!pool)
+    return NULL;
+
+  gst_vaapi_video_pool_init (pool, NULL,
+      GST_VAAPI_VIDEO_POOL_OBJECT_TYPE_SURFACE);
+  gst_vaapi_video_pool_set_capacity (pool, POOL_SIZE);
+  return pool;
+}
+
+/* One frame in the steady state: get a free object, release it */
+static gboolean
+get_put_one (gpointer user_data)
+{
+  PoolCycle *const cycle = user_data;
+  gpointer object;
+
+  object = gst_vaapi_video_pool_get_object (cycle->pool);
+  if (!object)
+    return FALSE;
+  gst_vaapi_video_pool_put_object (cycle->pool, object);
+  return TRUE;
+}
+
+/* The whole pool in use, as with a full DPB, then released in
+   allocation order, the worst case of the used objects lookup */
+static gboolean
+get_put_all (gpointer user_data)
+{
+  PoolCycle *const cycle = user_data;
+  guint i;
+
+  for (i = 0; i < POOL_SIZE; i++) {
+    cycle->objects[i] = gst_vaapi_video_pool_get_object (cycle->pool);
+    if (!cycle->objects[i])
+      return FALSE;
+  }
+  for (i = 0; i < POOL_SIZE; i++)
+    gst_vaapi_video_pool_put_object (cycle->pool, cycle->objects[i]);
+  return TRUE;
+}
+
+int
+main (int argc, char *argv[])
+{
+  PoolCycle cycle = { NULL, };
+
+  if (!bench_init (&argc, &argv, "videopool"))
+    return 1;
+
+  cycle.pool = fake_pool_new ();
+  if (!cycle.pool)
+    return 1;
+
+  bench_run ("get-put", get_put_one, &cycle, 0);
+  bench_run ("get-put-full", get_put_all, &cycle, 0);
+
+  gst_vaapi_video_pool_unref (cycle.pool);
+  return bench_finish ();
+}
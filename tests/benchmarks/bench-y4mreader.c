@@ -0,0 +1,167 @@
+/*
+ *  bench-y4mreader.c - Y4M reader benchmarks
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Reads back a generated clip, as simple-encoder does, into a system
+ * memory frame with the pitches of a VA image. The clip is small enough
+ * to stay in the page cache: this is the reader cost alone */
+
+#include "gst/vaapi/sysdeps.h"
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include "bench.h"
+#include "y4mreader.h"
+
+#define CLIP_WIDTH 1280
+#define CLIP_HEIGHT 720
+#define CLIP_FRAMES 8
+
+#define FRAME_SIZE (CLIP_WIDTH * CLIP_HEIGHT * 3 / 2)
+
+typedef struct
+{
+  const gchar *filename;
+  guint8 *planes[3];
+  guint pitches[3];
+} ClipReader;
+
+static gboolean
+read_clip (gpointer user_data)
+{
+  ClipReader *const reader = user_data;
+  Y4MReader *file;
+  guint i;
+
+  file = y4m_reader_open (reader->filename);
+  if (!file)
+    return FALSE;
+
+  for (i = 0; i < CLIP_FRAMES; i++) {
+    if (!y4m_reader_load_frame (file, reader->planes, reader->pitches))
+      break;
+  }
+  y4m_reader_close (file);
+  return i == CLIP_FRAMES;
+}
+
+/* Same, through the frame views, without copying */
+static gboolean
+view_clip (gpointer user_data)
+{
+  ClipReader *const reader = user_data;
+  Y4MReader *file;
+  Y4MFrame frame;
+  guint i;
+
+  file = y4m_reader_open (reader->filename);
+  if (!file)
+    return FALSE;
+
+  for (i = 0; i < CLIP_FRAMES; i++) {
+    if (!y4m_reader_get_frame (file, &frame))
+      break;
+  }
+  y4m_reader_close (file);
+  return i == CLIP_FRAMES;
+}
+
+static gchar *
+write_clip (void)
+{
+  GError *error = NULL;
+  gchar *filename;
+  guint8 *frame;
+  FILE *fp;
+  gint fd;
+  guint i;
+
+  fd = g_file_open_tmp ("bench-XXXXXX.y4m", &filename, &error);
+  if (fd < 0) {
+    g_printerr ("failed to create clip: %s\n", error->message);
+    g_error_free (error);
+    return NULL;
+  }
+
+  fp = fdopen (fd, "w");
+  if (!fp) {
+    close (fd);
+    goto error;
+  }
+
+  frame = g_malloc (FRAME_SIZE);
+  for (i = 0; i < FRAME_SIZE; i++)
+    frame[i] = i & 0xff;
+
+  fprintf (fp, "YUV4MPEG2 W%d H%d F30:1 Ip A1:1 C420jpeg\n", CLIP_WIDTH,
+      CLIP_HEIGHT);
+  for (i = 0; i < CLIP_FRAMES; i++) {
+    fprintf (fp, "FRAME\n");
+    fwrite (frame, 1, FRAME_SIZE, fp);
+  }
+  g_free (frame);
+
+  if (fclose (fp) != 0)
+    goto error;
+  return filename;
+
+  /* ERRORS */
+error:
+  {
+    g_printerr ("failed to write clip %s\n", filename);
+    g_unlink (filename);
+    g_free (filename);
+    return NULL;
+  }
+}
+
+int
+main (int argc, char *argv[])
+{
+  ClipReader reader;
+  gchar *filename;
+  guint8 *data;
+  gint ret;
+
+  if (!bench_init (&argc, &argv, "y4mreader"))
+    return 1;
+
+  filename = write_clip ();
+  if (!filename)
+    return 1;
+
+  /* I420 frame, with the pitches aligned as VA images have */
+  reader.filename = filename;
+  reader.pitches[0] = GST_ROUND_UP_64 (CLIP_WIDTH);
+  reader.pitches[1] = reader.pitches[2] = GST_ROUND_UP_64 (CLIP_WIDTH / 2);
+  data = g_malloc (reader.pitches[0] * CLIP_HEIGHT +
+      reader.pitches[1] * CLIP_HEIGHT);
+  reader.planes[0] = data;
+  reader.planes[1] = reader.planes[0] + reader.pitches[0] * CLIP_HEIGHT;
+  reader.planes[2] = reader.planes[1] + reader.pitches[1] * CLIP_HEIGHT / 2;
+
+  bench_run ("read-i420", read_clip, &reader,
+      (guint64) CLIP_FRAMES * FRAME_SIZE);
+  bench_run ("view-i420", view_clip, &reader,
+      (guint64) CLIP_FRAMES * FRAME_SIZE);
+
+  ret = bench_finish ();
+  g_free (data);
+  g_unlink (filename);
+  g_free (filename);
+  return ret;
+}
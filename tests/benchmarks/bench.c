@@ -0,0 +1,203 @@
+/*
+ *  bench.c - Micro-benchmark helpers
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Every benchmark is first calibrated so that one sample lasts about
+ * min-time / samples, then timed over a number of samples. The median
+ * of the samples is reported, along with the fastest and the slowest
+ * ones, as a single JSON document:
+ *
+ *   { "suite": "parse", "results": [ { "name": "h264", "iterations": 512,
+ *     "ns_per_op": 1234.5, "min_ns_per_op": ..., "max_ns_per_op": ...,
+ *     "bytes_per_op": 65536, "mb_per_s": 53.1 }, ... ] }
+ */
+
+#include "gst/vaapi/sysdeps.h"
+#include "bench.h"
+
+#define MAX_SAMPLES 64
+
+static gchar *g_output_file_name;
+static gchar *g_filter;
+static gint g_min_time = 500;
+static gint g_num_samples = 5;
+
+static GOptionEntry g_options[] = {
+  {"output", 'o', 0, G_OPTION_ARG_FILENAME, &g_output_file_name,
+      "write the JSON results to this file instead of stdout", NULL},
+  {"filter", 'f', 0, G_OPTION_ARG_STRING, &g_filter,
+      "only run the benchmarks whose name contains this string", NULL},
+  {"min-time", 't', 0, G_OPTION_ARG_INT, &g_min_time,
+      "minimal time spent in each benchmark, in milliseconds", NULL},
+  {"samples", 's', 0, G_OPTION_ARG_INT, &g_num_samples,
+      "number of timed samples per benchmark", NULL},
+  {NULL}
+};
+
+static gchar *g_suite;
+static GString *g_results;
+static guint g_num_results;
+static gboolean g_failed;
+
+static gint
+compare_doubles (gconstpointer a, gconstpointer b)
+{
+  const gdouble va = *(const gdouble *) a;
+  const gdouble vb = *(const gdouble *) b;
+
+  return va < vb ? -1 : va > vb ? 1 : 0;
+}
+
+/* Runs func() iterations times, returns the elapsed time in ns */
+static GstClockTime
+run_batch (BenchFunc func, gpointer user_data, guint64 iterations)
+{
+  GstClockTime start;
+  guint64 i;
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < iterations; i++) {
+    if (!func (user_data))
+      return GST_CLOCK_TIME_NONE;
+  }
+  return gst_util_get_timestamp () - start;
+}
+
+static void
+append_double (const gchar * key, gdouble value)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_string_append_printf (g_results, ", \"%s\": %s", key,
+      g_ascii_formatd (buf, sizeof (buf), "%.1f", value));
+}
+
+gboolean
+bench_init (gint * argc, gchar *** argv, const gchar * suite)
+{
+  GOptionContext *ctx;
+  gboolean success;
+
+  ctx = g_option_context_new ("- micro-benchmarks");
+  if (!ctx)
+    return FALSE;
+
+  g_option_context_add_main_entries (ctx, g_options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  success = g_option_context_parse (ctx, argc, argv, NULL);
+  g_option_context_free (ctx);
+  if (!success) {
+    g_printerr ("option parsing failed\n");
+    return FALSE;
+  }
+
+  g_num_samples = CLAMP (g_num_samples, 1, MAX_SAMPLES);
+  g_min_time = MAX (g_min_time, 1);
+
+  g_suite = g_strdup (suite);
+  g_results = g_string_new (NULL);
+  return TRUE;
+}
+
+void
+bench_run (const gchar * name, BenchFunc func, gpointer user_data,
+    guint64 bytes_per_op)
+{
+  const GstClockTime sample_time =
+      g_min_time * GST_MSECOND / g_num_samples;
+  gdouble samples[MAX_SAMPLES], median;
+  GstClockTime elapsed;
+  guint64 iterations;
+  gint i;
+
+  g_return_if_fail (func != NULL);
+
+  if (g_filter && !strstr (name, g_filter))
+    return;
+
+  /* warm up the caches, and grow the iterations count until a batch
+     is long enough to be timed accurately */
+  iterations = 1;
+  for (;;) {
+    elapsed = run_batch (func, user_data, iterations);
+    if (elapsed == GST_CLOCK_TIME_NONE)
+      goto error;
+    if (elapsed >= sample_time / 8)
+      break;
+    iterations *= 2;
+  }
+  iterations = MAX (1, gst_util_uint64_scale (iterations, sample_time,
+          MAX (elapsed, 1)));
+
+  for (i = 0; i < g_num_samples; i++) {
+    elapsed = run_batch (func, user_data, iterations);
+    if (elapsed == GST_CLOCK_TIME_NONE)
+      goto error;
+    samples[i] = (gdouble) elapsed / iterations;
+  }
+  qsort (samples, g_num_samples, sizeof (samples[0]), compare_doubles);
+  median = samples[g_num_samples / 2];
+
+  g_string_append_printf (g_results,
+      "%s\n    { \"name\": \"%s\", \"iterations\": %" G_GUINT64_FORMAT,
+      g_num_results++ > 0 ? "," : "", name, iterations);
+  append_double ("ns_per_op", median);
+  append_double ("min_ns_per_op", samples[0]);
+  append_double ("max_ns_per_op", samples[g_num_samples - 1]);
+  if (bytes_per_op > 0) {
+    g_string_append_printf (g_results, ", \"bytes_per_op\": %"
+        G_GUINT64_FORMAT, bytes_per_op);
+    append_double ("mb_per_s", bytes_per_op * 1000.0 / median);
+  }
+  g_string_append (g_results, " }");
+  return;
+
+  /* ERRORS */
+error:
+  {
+    g_printerr ("benchmark %s/%s failed\n", g_suite, name);
+    g_failed = TRUE;
+    return;
+  }
+}
+
+gint
+bench_finish (void)
+{
+  FILE *out = stdout;
+
+  if (g_output_file_name) {
+    out = fopen (g_output_file_name, "w");
+    if (!out) {
+      g_printerr ("failed to open output file %s\n", g_output_file_name);
+      return 1;
+    }
+  }
+
+  fprintf (out, "{ \"suite\": \"%s\", \"results\": [%s\n  ] }\n",
+      g_suite, g_results->str);
+
+  if (out != stdout)
+    fclose (out);
+
+  g_string_free (g_results, TRUE);
+  g_free (g_suite);
+  g_free (g_output_file_name);
+  g_free (g_filter);
+  return g_failed ? 1 : 0;
+}
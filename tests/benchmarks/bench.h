@@ -0,0 +1,38 @@
+/*
+ *  bench.h - Micro-benchmark helpers
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <gst/gst.h>
+
+/* One operation of a benchmark. Returns FALSE on failure */
+typedef gboolean (*BenchFunc) (gpointer user_data);
+
+gboolean
+bench_init (gint * argc, gchar *** argv, const gchar * suite);
+
+void
+bench_run (const gchar * name, BenchFunc func, gpointer user_data,
+    guint64 bytes_per_op);
+
+gint
+bench_finish (void);
+
+#endif /* BENCH_H */
@@ -0,0 +1,162 @@
+/*
+ *  vaapilatencytracer.c - GStreamer unit test for the vaapilatency tracer
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define NUM_BUFFERS 5
+#define FRAME_DURATION (GST_SECOND / 30)
+
+static GMutex records_lock;
+static GList *records;
+
+/* Keeps the vaapi-latency tracer records */
+static void
+tracer_log_func (GstDebugCategory * category, GstDebugLevel level,
+    const gchar * file, const gchar * function, gint line, GObject * object,
+    GstDebugMessage * message, gpointer user_data)
+{
+  const gchar *const text = gst_debug_message_get (message);
+  GstStructure *record;
+
+  if (level != GST_LEVEL_TRACE ||
+      g_strcmp0 (gst_debug_category_get_name (category), "GST_TRACER") != 0 ||
+      !g_str_has_prefix (text, "vaapi-latency"))
+    return;
+
+  record = gst_structure_from_string (text, NULL);
+  if (!record)
+    return;
+
+  g_mutex_lock (&records_lock);
+  records = g_list_append (records, record);
+  g_mutex_unlock (&records_lock);
+}
+
+static void
+clear_records (void)
+{
+  g_mutex_lock (&records_lock);
+  g_list_free_full (records, (GDestroyNotify) gst_structure_free);
+  records = NULL;
+  g_mutex_unlock (&records_lock);
+}
+
+/* Returns the number of frames of the @name record for the @stage of
+ * @element, or of all its buckets for a bucket record */
+static guint64
+get_record_count (const gchar * name, const gchar * element,
+    const gchar * stage)
+{
+  guint64 count, total = 0;
+  GList *l;
+
+  g_mutex_lock (&records_lock);
+  for (l = records; l; l = l->next) {
+    const GstStructure *const record = l->data;
+
+    if (!gst_structure_has_name (record, name) ||
+        g_strcmp0 (gst_structure_get_string (record, "element"), element) ||
+        g_strcmp0 (gst_structure_get_string (record, "stage"), stage))
+      continue;
+    if (gst_structure_get_uint64 (record, "count", &count))
+      total += count;
+  }
+  g_mutex_unlock (&records_lock);
+
+  return total;
+}
+
+GST_START_TEST (test_latency_buffer_list)
+{
+  GstHarness *h;
+  GstBufferList *list;
+  GstBuffer *buffer;
+  gchar *name;
+  guint i;
+
+  h = gst_harness_new ("vaapipostproc");
+  gst_harness_set_src_caps_str (h, "video/x-raw,format=NV12,width=320,"
+      "height=240,framerate=30/1");
+
+  /* the frames come in as a single buffer list */
+  list = gst_buffer_list_new ();
+  for (i = 0; i < NUM_BUFFERS; i++) {
+    buffer = gst_harness_create_buffer (h, 320 * 240 * 3 / 2);
+    GST_BUFFER_PTS (buffer) = i * FRAME_DURATION;
+    GST_BUFFER_DURATION (buffer) = FRAME_DURATION;
+    gst_buffer_list_add (list, buffer);
+  }
+  fail_unless_equals_int (gst_pad_push_list (h->srcpad, list), GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_buffers_received (h), NUM_BUFFERS);
+
+  name = gst_element_get_name (h->element);
+
+  clear_records ();
+  gst_harness_teardown (h);
+
+  /* every frame was tracked, and lands in one histogram bucket */
+  fail_unless_equals_uint64 (get_record_count ("vaapi-latency", name,
+          "push"), NUM_BUFFERS);
+  fail_unless_equals_uint64 (get_record_count ("vaapi-latency-bucket", name,
+          "push"), NUM_BUFFERS);
+  g_free (name);
+  clear_records ();
+}
+
+GST_END_TEST;
+
+static Suite *
+vaapilatencytracer_suite (void)
+{
+  Suite *s = suite_create ("vaapilatencytracer");
+  TCase *tc_chain = tcase_create ("general");
+  GstElementFactory *factory;
+
+  suite_add_tcase (s, tc_chain);
+
+  /* vaapipostproc is only registered when a VA display is available */
+  factory = gst_element_factory_find ("vaapipostproc");
+  if (factory) {
+    tcase_add_test (tc_chain, test_latency_buffer_list);
+    gst_object_unref (factory);
+  } else {
+    g_print ("Skipping test_latency_buffer_list: no vaapipostproc\n");
+  }
+
+  return s;
+}
+
+int
+main (int argc, char **argv)
+{
+  /* the tracers are set up by gst_init() */
+  g_setenv ("GST_TRACERS", "vaapilatency", TRUE);
+  gst_check_init (&argc, &argv);
+
+  gst_debug_set_threshold_for_name ("GST_TRACER", GST_LEVEL_TRACE);
+  gst_debug_add_log_function (tracer_log_func, NULL, NULL);
+
+  return gst_check_run_suite (vaapilatencytracer_suite (),
+      "vaapilatencytracer", __FILE__);
+}
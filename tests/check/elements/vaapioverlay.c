@@ -76,6 +76,52 @@ on_handoff (GstElement * element, GstBuffer * buffer, GstPad * pad,
 #define TEST_PATTERN_RED 4
 #define TEST_PATTERN_GREEN 5
 
+/* Checks that @frame is green, except for the 20x20 red squares whose
+ * top-left corners are given in @squares */
+static void
+check_red_squares (GstVideoFrame * frame, const guint squares[][2],
+    guint n_squares)
+{
+  guint i, j, k, n_planes, plane;
+  n_planes = GST_VIDEO_FRAME_N_PLANES (frame);
+
+  for (plane = 0; plane < n_planes; plane++) {
+    gpointer pd = GST_VIDEO_FRAME_PLANE_DATA (frame, plane);
+    gint w = GST_VIDEO_FRAME_COMP_WIDTH (frame, plane)
+        * GST_VIDEO_FRAME_COMP_PSTRIDE (frame, plane);
+    gint h = GST_VIDEO_FRAME_COMP_HEIGHT (frame, plane);
+    gint ps = GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane);
+
+    for (j = 0; j < h; ++j) {
+      for (i = 0; i < w; ++i) {
+        guint8 actual = GST_READ_UINT8 (pd + i);
+        guint8 expect = 0xff;
+        gboolean red = FALSE;
+
+        for (k = 0; k < n_squares; k++) {
+          guint x = squares[k][0], y = squares[k][1];
+          if (plane == 0)
+            red |= i >= x && i < x + 20 && j >= y && j < y + 20;
+          else
+            red |= i >= x && i < x + 20 && j >= y / 2 && j < (y + 20) / 2;
+        }
+
+        if (plane == 0)
+          expect = red ? 0x51 : 0x91;
+        else if (red)
+          expect = (i % 2) ? 0xf0 : 0x5a;
+        else
+          expect = (i % 2) ? 0x22 : 0x36;
+
+        fail_unless (actual == expect,
+            "Expected 0x%02x but got 0x%02x at (%u,%u,%u)", expect, actual,
+            plane, i, j);
+      }
+      pd += ps;
+    }
+  }
+}
+
 GST_START_TEST (test_overlay_position)
 {
   GstElement *bin, *src1, *filter1, *src2, *filter2, *overlay, *sink;
@@ -84,6 +130,7 @@ GST_START_TEST (test_overlay_position)
   GstCaps *caps;
   GstVideoFrame frame;
   GstVideoInfo vinfo;
+  static const guint red_squares[][2] = { {10, 10} };
 
   /* Check if vaapioverlay is available, since it is only available
    * for iHD vaapi driver */
@@ -157,40 +204,223 @@ GST_START_TEST (test_overlay_position)
   gst_object_unref (pad);
 
   gst_video_frame_map (&frame, &vinfo, handoff_buffer, GST_MAP_READ);
-  {
-    guint i, j, n_planes, plane;
-    n_planes = GST_VIDEO_FRAME_N_PLANES (&frame);
-
-    for (plane = 0; plane < n_planes; plane++) {
-      gpointer pd = GST_VIDEO_FRAME_PLANE_DATA (&frame, plane);
-      gint w = GST_VIDEO_FRAME_COMP_WIDTH (&frame, plane)
-          * GST_VIDEO_FRAME_COMP_PSTRIDE (&frame, plane);
-      gint h = GST_VIDEO_FRAME_COMP_HEIGHT (&frame, plane);
-      gint ps = GST_VIDEO_FRAME_PLANE_STRIDE (&frame, plane);
-
-      for (j = 0; j < h; ++j) {
-        for (i = 0; i < w; ++i) {
-          guint8 actual = GST_READ_UINT8 (pd + i);
-          guint8 expect = 0xff;
-          if (plane == 0) {
-            if (i >= 10 && i < 30 && j >= 10 && j < 30)
-              expect = 0x51;
-            else
-              expect = 0x91;
-          } else {
-            if (i >= 10 && i < 30 && j >= 5 && j < 15)
-              expect = (i % 2) ? 0xf0 : 0x5a;
-            else
-              expect = (i % 2) ? 0x22 : 0x36;
-          }
-          fail_unless (actual == expect,
-              "Expected 0x%02x but got 0x%02x at (%u,%u,%u)", expect, actual,
-              plane, i, j);
-        }
-        pd += ps;
-      }
-    }
-  }
+  check_red_squares (&frame, red_squares, G_N_ELEMENTS (red_squares));
+  gst_video_frame_unmap (&frame);
+
+  /* cleanup */
+  gst_buffer_replace (&handoff_buffer, NULL);
+  gst_element_set_state (bin, GST_STATE_NULL);
+  g_main_loop_unref (main_loop);
+  gst_bus_remove_signal_watch (bus);
+  gst_object_unref (bus);
+  gst_object_unref (bin);
+}
+
+GST_END_TEST;
+
+static void
+add_overlay_source (GstElement * bin, GstElement * overlay, gint pattern,
+    gint num_buffers, gint width, gint height, gint xpos, gint ypos)
+{
+  GstElement *src, *filter;
+  GstPad *srcpad, *sinkpad;
+  GstCaps *caps;
+
+  src = gst_element_factory_make ("videotestsrc", NULL);
+  g_object_set (src, "num-buffers", num_buffers, "pattern", pattern, NULL);
+  filter = gst_element_factory_make ("capsfilter", NULL);
+  caps = gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING, "NV12",
+      "width", G_TYPE_INT, width, "height", G_TYPE_INT, height, NULL);
+  g_object_set (filter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  gst_bin_add_many (GST_BIN (bin), src, filter, NULL);
+  gst_element_link (src, filter);
+
+  /* single buffer sources stay on screen until the last frame */
+  srcpad = gst_element_get_static_pad (filter, "src");
+  sinkpad = gst_element_request_pad_simple (overlay, "sink_%u");
+  g_object_set (sinkpad, "xpos", xpos, "ypos", ypos, "alpha", 1.0,
+      "repeat-after-eos", num_buffers == 1, NULL);
+  gst_pad_link (srcpad, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (srcpad);
+}
+
+GST_START_TEST (test_overlay_static_layers)
+{
+  GstElement *bin, *overlay, *sink;
+  GstBus *bus;
+  GstPad *pad;
+  GstCaps *caps;
+  GstVideoFrame frame;
+  GstVideoInfo vinfo;
+  static const guint red_squares[][2] = { {10, 10}, {50, 50} };
+
+  overlay = gst_element_factory_make ("vaapioverlay", "overlay");
+  if (!overlay)
+    return;
+
+  /* build pipeline: the two lowest layers are static, so they get
+   * cached while the top one keeps changing */
+  bin = gst_pipeline_new ("pipeline");
+  bus = gst_element_get_bus (bin);
+  gst_bus_add_signal_watch_full (bus, G_PRIORITY_HIGH);
+
+  sink = gst_element_factory_make ("vaapisink", "sink");
+  g_object_set (sink, "display", 4, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (on_handoff), NULL);
+
+  gst_bin_add_many (GST_BIN (bin), overlay, sink, NULL);
+  gst_element_link (overlay, sink);
+
+  add_overlay_source (bin, overlay, TEST_PATTERN_GREEN, 1, 320, 240, 0, 0);
+  add_overlay_source (bin, overlay, TEST_PATTERN_RED, 1, 20, 20, 10, 10);
+  add_overlay_source (bin, overlay, TEST_PATTERN_RED, 5, 20, 20, 50, 50);
+
+  /* setup and run the main loop */
+  main_loop = g_main_loop_new (NULL, FALSE);
+  g_signal_connect (bus, "message::error", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::warning", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::eos", (GCallback) message_received, bin);
+  gst_element_set_state (bin, GST_STATE_PLAYING);
+  g_main_loop_run (main_loop);
+
+  /* validate the last output buffer */
+  fail_unless (handoff_buffer != NULL);
+  pad = gst_element_get_static_pad (sink, "sink");
+  caps = gst_pad_get_current_caps (pad);
+  gst_video_info_from_caps (&vinfo, caps);
+  gst_caps_unref (caps);
+  gst_object_unref (pad);
+
+  gst_video_frame_map (&frame, &vinfo, handoff_buffer, GST_MAP_READ);
+  check_red_squares (&frame, red_squares, G_N_ELEMENTS (red_squares));
+  gst_video_frame_unmap (&frame);
+
+  /* cleanup */
+  gst_buffer_replace (&handoff_buffer, NULL);
+  gst_element_set_state (bin, GST_STATE_NULL);
+  g_main_loop_unref (main_loop);
+  gst_bus_remove_signal_watch (bus);
+  gst_object_unref (bus);
+  gst_object_unref (bin);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  GstElement *overlay;
+  guint num_frames;
+  guint cache_hits;             /* before the reordering */
+} ReorderData;
+
+static void
+get_overlay_stats (GstElement * overlay, guint * builds, guint * hits,
+    guint * drops)
+{
+  GstStructure *stats;
+
+  g_object_get (overlay, "stats", &stats, NULL);
+  fail_unless (stats != NULL);
+  fail_unless (gst_structure_get (stats, "cache-builds", G_TYPE_UINT, builds,
+          "cache-hits", G_TYPE_UINT, hits, "cache-drops", G_TYPE_UINT, drops,
+          NULL));
+  gst_structure_free (stats);
+}
+
+/* Swaps the zorder of the two static red squares after the third
+ * output frame */
+static GstPadProbeReturn
+reorder_layers_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  ReorderData *const data = user_data;
+  GstPad *pad1, *pad2;
+  guint builds, drops;
+
+  if (++data->num_frames != 3)
+    return GST_PAD_PROBE_OK;
+
+  get_overlay_stats (data->overlay, &builds, &data->cache_hits, &drops);
+
+  pad1 = gst_element_get_static_pad (data->overlay, "sink_1");
+  pad2 = gst_element_get_static_pad (data->overlay, "sink_2");
+  g_object_set (pad1, "zorder", 2, NULL);
+  g_object_set (pad2, "zorder", 1, NULL);
+  gst_object_unref (pad1);
+  gst_object_unref (pad2);
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_overlay_reorder_static_layers)
+{
+  GstElement *bin, *overlay, *sink;
+  GstBus *bus;
+  GstPad *pad;
+  GstCaps *caps;
+  GstVideoFrame frame;
+  GstVideoInfo vinfo;
+  ReorderData data = { NULL, };
+  guint builds, hits, drops;
+  static const guint red_squares[][2] = { {10, 10}, {50, 50}, {100, 100} };
+
+  overlay = gst_element_factory_make ("vaapioverlay", "overlay");
+  if (!overlay)
+    return;
+
+  /* build pipeline: three static layers under a changing one */
+  bin = gst_pipeline_new ("pipeline");
+  bus = gst_element_get_bus (bin);
+  gst_bus_add_signal_watch_full (bus, G_PRIORITY_HIGH);
+
+  sink = gst_element_factory_make ("vaapisink", "sink");
+  g_object_set (sink, "display", 4, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (on_handoff), NULL);
+
+  gst_bin_add_many (GST_BIN (bin), overlay, sink, NULL);
+  gst_element_link (overlay, sink);
+
+  add_overlay_source (bin, overlay, TEST_PATTERN_GREEN, 1, 320, 240, 0, 0);
+  add_overlay_source (bin, overlay, TEST_PATTERN_RED, 1, 20, 20, 10, 10);
+  add_overlay_source (bin, overlay, TEST_PATTERN_RED, 1, 20, 20, 50, 50);
+  add_overlay_source (bin, overlay, TEST_PATTERN_RED, 8, 20, 20, 100, 100);
+
+  data.overlay = overlay;
+  pad = gst_element_get_static_pad (overlay, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, reorder_layers_probe,
+      &data, NULL);
+  gst_object_unref (pad);
+
+  /* setup and run the main loop */
+  main_loop = g_main_loop_new (NULL, FALSE);
+  g_signal_connect (bus, "message::error", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::warning", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::eos", (GCallback) message_received, bin);
+  gst_element_set_state (bin, GST_STATE_PLAYING);
+  g_main_loop_run (main_loop);
+
+  /* the cache was used before the reordering, then invalidated and
+   * built again */
+  fail_unless (data.num_frames > 3);
+  fail_unless (data.cache_hits > 0);
+  get_overlay_stats (overlay, &builds, &hits, &drops);
+  fail_unless_equals_int (builds, 2);
+  fail_unless_equals_int (drops, 1);
+  fail_unless (hits > data.cache_hits);
+
+  /* the swapped squares don't overlap, the output is unchanged */
+  fail_unless (handoff_buffer != NULL);
+  pad = gst_element_get_static_pad (sink, "sink");
+  caps = gst_pad_get_current_caps (pad);
+  gst_video_info_from_caps (&vinfo, caps);
+  gst_caps_unref (caps);
+  gst_object_unref (pad);
+
+  gst_video_frame_map (&frame, &vinfo, handoff_buffer, GST_MAP_READ);
+  check_red_squares (&frame, red_squares, G_N_ELEMENTS (red_squares));
+  gst_video_frame_unmap (&frame);
 
   /* cleanup */
   gst_buffer_replace (&handoff_buffer, NULL);
@@ -211,6 +441,8 @@ vaapioverlay_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_overlay_position);
+  tcase_add_test (tc_chain, test_overlay_static_layers);
+  tcase_add_test (tc_chain, test_overlay_reorder_static_layers);
 
   return s;
 }
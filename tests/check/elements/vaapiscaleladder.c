@@ -0,0 +1,200 @@
+/*
+ *  vaapiscaleladder.c - GStreamer unit test for the vaapiscaleladder element
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+#define NUM_BUFFERS 5
+#define NUM_RENDITIONS 3
+
+static const gint rendition_sizes[NUM_RENDITIONS][2] = {
+  {320, 240}, {160, 120}, {80, 60},
+};
+
+static GMainLoop *main_loop;
+static void
+message_received (GstBus * bus, GstMessage * message, GstPipeline * bin)
+{
+  GST_INFO ("bus message from \"%" GST_PTR_FORMAT "\": %" GST_PTR_FORMAT,
+      GST_MESSAGE_SRC (message), message);
+
+  switch (message->type) {
+    case GST_MESSAGE_EOS:
+      g_main_loop_quit (main_loop);
+      break;
+    case GST_MESSAGE_WARNING:{
+      GError *gerror;
+      gchar *debug;
+
+      gst_message_parse_warning (message, &gerror, &debug);
+      gst_object_default_error (GST_MESSAGE_SRC (message), gerror, debug);
+      g_error_free (gerror);
+      g_free (debug);
+      break;
+    }
+    case GST_MESSAGE_ERROR:{
+      GError *gerror;
+      gchar *debug;
+
+      gst_message_parse_error (message, &gerror, &debug);
+      gst_object_default_error (GST_MESSAGE_SRC (message), gerror, debug);
+      g_error_free (gerror);
+      g_free (debug);
+      g_main_loop_quit (main_loop);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+static guint handoff_count[NUM_RENDITIONS];
+static void
+on_handoff (GstElement * element, GstBuffer * buffer, GstPad * pad,
+    gpointer data)
+{
+  g_atomic_int_inc (&handoff_count[GPOINTER_TO_UINT (data)]);
+}
+
+static void
+run_scale_ladder (gboolean cascade)
+{
+  GstElement *bin, *src, *filter, *ladder;
+  GstElement *filters[NUM_RENDITIONS], *sinks[NUM_RENDITIONS];
+  GstBus *bus;
+  GstPad *pad, *srcpad, *sinkpad;
+  GstCaps *caps;
+  GstVideoInfo vinfo;
+  guint i;
+
+  /* Check if vaapiscaleladder is available, since it requires video
+   * processing support from the driver */
+  ladder = gst_element_factory_make ("vaapiscaleladder", "ladder");
+  if (!ladder)
+    return;
+  g_object_set (ladder, "cascade", cascade, NULL);
+
+  /* build pipeline */
+  bin = gst_pipeline_new ("pipeline");
+  bus = gst_element_get_bus (bin);
+  gst_bus_add_signal_watch_full (bus, G_PRIORITY_HIGH);
+
+  src = gst_element_factory_make ("videotestsrc", "src");
+  g_object_set (src, "num-buffers", NUM_BUFFERS, NULL);
+  filter = gst_element_factory_make ("capsfilter", "filter");
+  caps = gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING, "NV12",
+      "width", G_TYPE_INT, 640, "height", G_TYPE_INT, 480, NULL);
+  g_object_set (filter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  gst_bin_add_many (GST_BIN (bin), src, filter, ladder, NULL);
+  gst_element_link_many (src, filter, ladder, NULL);
+
+  for (i = 0; i < NUM_RENDITIONS; i++) {
+    handoff_count[i] = 0;
+
+    filters[i] = gst_element_factory_make ("capsfilter", NULL);
+    caps = gst_caps_from_string ("video/x-raw(memory:VASurface)");
+    gst_caps_set_simple (caps, "width", G_TYPE_INT, rendition_sizes[i][0],
+        "height", G_TYPE_INT, rendition_sizes[i][1], NULL);
+    g_object_set (filters[i], "caps", caps, NULL);
+    gst_caps_unref (caps);
+
+    sinks[i] = gst_element_factory_make ("fakesink", NULL);
+    g_object_set (sinks[i], "signal-handoffs", TRUE, NULL);
+    g_signal_connect (sinks[i], "handoff", G_CALLBACK (on_handoff),
+        GUINT_TO_POINTER (i));
+
+    gst_bin_add_many (GST_BIN (bin), filters[i], sinks[i], NULL);
+    gst_element_link (filters[i], sinks[i]);
+
+    srcpad = gst_element_request_pad_simple (ladder, "src_%u");
+    fail_unless (srcpad != NULL);
+    sinkpad = gst_element_get_static_pad (filters[i], "sink");
+    fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK);
+    gst_object_unref (sinkpad);
+    gst_object_unref (srcpad);
+  }
+
+  /* setup and run the main loop */
+  main_loop = g_main_loop_new (NULL, FALSE);
+  g_signal_connect (bus, "message::error", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::warning", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::eos", (GCallback) message_received, bin);
+  gst_element_set_state (bin, GST_STATE_PLAYING);
+  g_main_loop_run (main_loop);
+
+  /* validate every rendition */
+  for (i = 0; i < NUM_RENDITIONS; i++) {
+    fail_unless_equals_int (handoff_count[i], NUM_BUFFERS);
+
+    pad = gst_element_get_static_pad (sinks[i], "sink");
+    caps = gst_pad_get_current_caps (pad);
+    fail_unless (caps != NULL);
+    fail_unless (gst_video_info_from_caps (&vinfo, caps));
+    fail_unless_equals_int (GST_VIDEO_INFO_WIDTH (&vinfo),
+        rendition_sizes[i][0]);
+    fail_unless_equals_int (GST_VIDEO_INFO_HEIGHT (&vinfo),
+        rendition_sizes[i][1]);
+    fail_unless (gst_caps_features_contains (gst_caps_get_features (caps, 0),
+            "memory:VASurface"));
+    gst_caps_unref (caps);
+    gst_object_unref (pad);
+  }
+
+  /* cleanup */
+  gst_element_set_state (bin, GST_STATE_NULL);
+  g_main_loop_unref (main_loop);
+  gst_bus_remove_signal_watch (bus);
+  gst_object_unref (bus);
+  gst_object_unref (bin);
+}
+
+GST_START_TEST (test_scale_ladder_direct)
+{
+  run_scale_ladder (FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_scale_ladder_cascade)
+{
+  run_scale_ladder (TRUE);
+}
+
+GST_END_TEST;
+
+static Suite *
+vaapiscaleladder_suite (void)
+{
+  Suite *s = suite_create ("vaapiscaleladder");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_scale_ladder_direct);
+  tcase_add_test (tc_chain, test_scale_ladder_cascade);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vaapiscaleladder);
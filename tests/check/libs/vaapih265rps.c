@@ -0,0 +1,148 @@
+/*
+ *  vaapih265rps.c - GStreamer unit test for the H.265 hierarchical-b
+ *                   reference picture sets
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/codecparsers/gsth265parser.h>
+#include <gst/vaapi/gstvaapiencoder_objects.h>
+#include <gst/vaapi/gstvaapiutils_h26x_priv.h>
+
+/* A mini-GOP of 3 temporal levels: I0 B1 B2 B3 P4 in display order */
+static const guint level_div[] = { 4, 2, 1 };
+
+GST_START_TEST (test_temporal_id)
+{
+  static const guint expected[] = { 0, 2, 1, 2, 0, 2, 1, 2, 0 };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (expected); i++) {
+    fail_unless_equals_int (gst_vaapi_utils_h26x_get_temporal_id (level_div,
+            G_N_ELEMENTS (level_div), i), expected[i]);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sort_hierarchical_b)
+{
+  /* the B pictures of the lower temporal levels are coded first, as
+     the higher ones reference them */
+  static const guint expected_pocs[] = { 6, 5, 7, 8 };
+  GstVaapiEncPicture pictures[4];
+  GQueue queue = G_QUEUE_INIT;
+  GstVaapiEncPicture *picture;
+  guint i;
+
+  memset (pictures, 0, sizeof (pictures));
+  for (i = 0; i < G_N_ELEMENTS (pictures); i++) {
+    pictures[i].poc = 5 + i;
+    pictures[i].temporal_id = gst_vaapi_utils_h26x_get_temporal_id (level_div,
+        G_N_ELEMENTS (level_div), 1 + i);
+    pictures[i].type = i < 3 ? GST_VAAPI_PICTURE_TYPE_B :
+        GST_VAAPI_PICTURE_TYPE_P;
+    g_queue_push_tail (&queue, &pictures[i]);
+  }
+
+  g_queue_sort (&queue, gst_vaapi_utils_h26x_sort_hierarchical_b, NULL);
+  for (i = 0; i < G_N_ELEMENTS (expected_pocs); i++) {
+    picture = g_queue_pop_head (&queue);
+    fail_unless_equals_int (picture->poc, expected_pocs[i]);
+  }
+  fail_unless (g_queue_is_empty (&queue));
+}
+
+GST_END_TEST;
+
+static void
+init_slice_param (VAEncSliceParameterBufferHEVC * slice_param,
+    guint8 slice_type, gint poc_l0, gint poc_l1)
+{
+  guint i;
+
+  memset (slice_param, 0, sizeof (*slice_param));
+  slice_param->slice_type = slice_type;
+  for (i = 0; i < G_N_ELEMENTS (slice_param->ref_pic_list0); i++) {
+    slice_param->ref_pic_list0[i].picture_id = VA_INVALID_SURFACE;
+    slice_param->ref_pic_list1[i].picture_id = VA_INVALID_SURFACE;
+  }
+  slice_param->ref_pic_list0[0].picture_id = 0;
+  slice_param->ref_pic_list0[0].pic_order_cnt = poc_l0;
+  if (poc_l1 >= 0) {
+    slice_param->ref_pic_list1[0].picture_id = 1;
+    slice_param->ref_pic_list1[0].pic_order_cnt = poc_l1;
+  }
+}
+
+GST_START_TEST (test_short_term_ref_pic_set)
+{
+  /* P4 references I0: num_negative_pics ue(1) = 010, num_positive_pics
+     ue(0) = 1, delta_poc_s0_minus1 ue(3) = 00100, used 1 */
+  static const guint8 expected_p4[] = { 0x52, 0x40 };
+  static const guint p4_refs[] = { 0 };
+  /* B1 references I0 and B2, P4 is kept for the next pictures:
+     num_negative_pics ue(1) = 010, num_positive_pics ue(2) = 011,
+     I0: ue(0) = 1, used 1, B2: ue(0) = 1, used 1, P4: ue(1) = 010,
+     unused 0 */
+  static const guint8 expected_b1[] = { 0x4f, 0xd0 };
+  static const guint b1_refs[] = { 0, 4, 2 };
+  VAEncSliceParameterBufferHEVC slice_param;
+  GstBitWriter bs;
+
+  init_slice_param (&slice_param, GST_H265_P_SLICE, 0, -1);
+  gst_bit_writer_init_with_size (&bs, 16, FALSE);
+  fail_unless (bs_write_short_term_ref_pic_set_h265 (&bs, &slice_param, 4,
+          p4_refs, G_N_ELEMENTS (p4_refs)));
+  fail_unless_equals_int (GST_BIT_WRITER_BIT_SIZE (&bs), 10);
+  fail_unless (gst_bit_writer_align_bytes (&bs, 0));
+  fail_unless (memcmp (GST_BIT_WRITER_DATA (&bs), expected_p4,
+          sizeof (expected_p4)) == 0);
+  gst_bit_writer_reset (&bs);
+
+  init_slice_param (&slice_param, GST_H265_B_SLICE, 0, 2);
+  gst_bit_writer_init_with_size (&bs, 16, FALSE);
+  fail_unless (bs_write_short_term_ref_pic_set_h265 (&bs, &slice_param, 1,
+          b1_refs, G_N_ELEMENTS (b1_refs)));
+  fail_unless_equals_int (GST_BIT_WRITER_BIT_SIZE (&bs), 14);
+  fail_unless (gst_bit_writer_align_bytes (&bs, 0));
+  fail_unless (memcmp (GST_BIT_WRITER_DATA (&bs), expected_b1,
+          sizeof (expected_b1)) == 0);
+  gst_bit_writer_reset (&bs);
+}
+
+GST_END_TEST;
+
+static Suite *
+vaapih265rps_suite (void)
+{
+  Suite *s = suite_create ("vaapih265rps");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_temporal_id);
+  tcase_add_test (tc_chain, test_sort_hierarchical_b);
+  tcase_add_test (tc_chain, test_short_term_ref_pic_set);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vaapih265rps);
@@ -0,0 +1,118 @@
+/*
+ *  vaapihrd.c - GStreamer unit test for the HRD conformance verifier
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/vaapi/gstvaapiencoder_hrd.h>
+
+/* 25 fps at 1 Mbps, with a buffer of 1 second */
+#define BITRATE 1000000
+#define BITS_PER_FRAME (BITRATE / 25)
+#define FRAME_DURATION (GST_SECOND / 25)
+
+GST_START_TEST (test_hrd_steady)
+{
+  GstVaapiHrdVerifier hrd;
+  guint i, fullness;
+
+  gst_vaapi_hrd_verifier_init (&hrd, BITRATE, BITRATE, BITRATE / 2, TRUE);
+
+  /* frames of the average size keep the buffer at its initial level */
+  for (i = 0; i < 100; i++) {
+    fail_unless_equals_int (gst_vaapi_hrd_verifier_add_frame (&hrd,
+            i * FRAME_DURATION, BITS_PER_FRAME, &fullness),
+        GST_VAAPI_HRD_STATUS_OK);
+    fail_unless_equals_int (fullness, BITRATE / 2);
+  }
+  fail_unless_equals_int (hrd.num_frames, 100);
+  fail_unless_equals_int (hrd.num_underflows, 0);
+  fail_unless_equals_int (hrd.num_overflows, 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_hrd_underflow)
+{
+  GstVaapiHrdVerifier hrd;
+  guint fullness;
+
+  gst_vaapi_hrd_verifier_init (&hrd, BITRATE, BITRATE, BITRATE / 2, TRUE);
+
+  /* a frame larger than the initial fullness is late */
+  fail_unless_equals_int (gst_vaapi_hrd_verifier_add_frame (&hrd, 0,
+          BITRATE / 2 + 1, &fullness), GST_VAAPI_HRD_STATUS_UNDERFLOW);
+  fail_unless_equals_int (fullness, BITRATE / 2);
+
+  /* the buffer restarts empty */
+  fail_unless_equals_int (gst_vaapi_hrd_verifier_add_frame (&hrd,
+          FRAME_DURATION, BITS_PER_FRAME, &fullness),
+      GST_VAAPI_HRD_STATUS_OK);
+  fail_unless_equals_int (fullness, BITS_PER_FRAME);
+  fail_unless_equals_int (hrd.num_underflows, 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_hrd_overflow)
+{
+  GstVaapiHrdVerifier cbr, vbr;
+  GstVaapiHrdStatus status;
+  guint i, fullness;
+
+  gst_vaapi_hrd_verifier_init (&cbr, BITRATE, BITRATE, BITRATE / 2, TRUE);
+  gst_vaapi_hrd_verifier_init (&vbr, BITRATE, BITRATE, BITRATE / 2, FALSE);
+
+  /* small frames fill the buffer up in 0.5 second */
+  for (i = 0; i < 25; i++) {
+    status = gst_vaapi_hrd_verifier_add_frame (&cbr, i * FRAME_DURATION, 0,
+        &fullness);
+    fail_unless_equals_int (status, i < 13 ? GST_VAAPI_HRD_STATUS_OK :
+        GST_VAAPI_HRD_STATUS_OVERFLOW);
+    fail_unless (fullness <= BITRATE);
+
+    /* at a variable bitrate, the bits wait for room instead */
+    status = gst_vaapi_hrd_verifier_add_frame (&vbr, i * FRAME_DURATION, 0,
+        &fullness);
+    fail_unless_equals_int (status, GST_VAAPI_HRD_STATUS_OK);
+  }
+  fail_unless_equals_int (fullness, BITRATE);
+  fail_unless_equals_int (cbr.num_overflows, 12);
+  fail_unless_equals_int (vbr.num_overflows, 0);
+}
+
+GST_END_TEST;
+
+static Suite *
+vaapihrd_suite (void)
+{
+  Suite *s = suite_create ("vaapihrd");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_hrd_steady);
+  tcase_add_test (tc_chain, test_hrd_underflow);
+  tcase_add_test (tc_chain, test_hrd_overflow);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vaapihrd);
@@ -0,0 +1,140 @@
+/*
+ *  vaapiintrarefresh.c - GStreamer unit test for the gradual intra refresh
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/vaapi/gstvaapiutils_h26x_priv.h>
+#include "test-h264.h"
+
+/* The refresh regions of a cycle sweep the picture exactly once */
+GST_START_TEST (test_intra_refresh_region)
+{
+  static const guint periods[] = { 2, 7, 30, 45, 68 };
+  guint i, j, location, size, next;
+  gboolean start;
+
+  for (i = 0; i < G_N_ELEMENTS (periods); i++) {
+    /* 1080p: 68 rows of 16x16 blocks */
+    next = 0;
+    for (j = 0; j < periods[i]; j++) {
+      start = gst_vaapi_utils_h26x_get_intra_refresh_region (68, periods[i],
+          j, &location, &size);
+      fail_unless_equals_int (start, j == 0);
+      fail_unless_equals_int (location, next);
+      fail_unless (size > 0);
+      next = location + size;
+    }
+    fail_unless_equals_int (next, 68);
+
+    /* the next cycle starts over */
+    start = gst_vaapi_utils_h26x_get_intra_refresh_region (68, periods[i],
+        periods[i], &location, &size);
+    fail_unless (start);
+    fail_unless_equals_int (location, 0);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sei_recovery_point_h264)
+{
+  GstH264NalParser *parser;
+  GstH264NalUnit nalu;
+  GstH264SPS sps;
+  GstH264SEIMessage *sei;
+  GArray *messages = NULL;
+  VideoDecodeInfo info;
+  GstBitWriter bs;
+  guint size;
+
+  /* the recovery point refers to the active SPS */
+  h264_get_video_info (&info);
+  parser = gst_h264_nal_parser_new ();
+  fail_unless_equals_int (gst_h264_parser_identify_nalu (parser, info.data,
+          0, info.data_size, &nalu), GST_H264_PARSER_OK);
+  fail_unless_equals_int (nalu.type, GST_H264_NAL_SPS);
+  fail_unless_equals_int (gst_h264_parser_parse_sps (parser, &nalu, &sps),
+      GST_H264_PARSER_OK);
+
+  gst_bit_writer_init_with_size (&bs, 32, FALSE);
+  fail_unless (gst_bit_writer_put_bits_uint32 (&bs, 0x00000001, 32));
+  fail_unless (gst_bit_writer_put_bits_uint32 (&bs, GST_H264_NAL_SEI, 8));
+  fail_unless (bs_write_sei_recovery_point_h264 (&bs, 7));
+  /* rbsp_trailing_bits */
+  fail_unless (gst_bit_writer_put_bits_uint32 (&bs, 0x80, 8));
+  size = GST_BIT_WRITER_BIT_SIZE (&bs) / 8;
+
+  fail_unless_equals_int (gst_h264_parser_identify_nalu_unchecked (parser,
+          GST_BIT_WRITER_DATA (&bs), 0, size, &nalu), GST_H264_PARSER_OK);
+  fail_unless_equals_int (nalu.type, GST_H264_NAL_SEI);
+  fail_unless_equals_int (gst_h264_parser_parse_sei (parser, &nalu,
+          &messages), GST_H264_PARSER_OK);
+  fail_unless_equals_int (messages->len, 1);
+
+  sei = &g_array_index (messages, GstH264SEIMessage, 0);
+  fail_unless_equals_int (sei->payloadType, GST_H264_SEI_RECOVERY_POINT);
+  fail_unless_equals_int (sei->payload.recovery_point.recovery_frame_cnt, 7);
+  fail_unless_equals_int (sei->payload.recovery_point.exact_match_flag, 0);
+  fail_unless_equals_int (sei->payload.recovery_point.broken_link_flag, 0);
+
+  g_array_unref (messages);
+  gst_bit_writer_reset (&bs);
+  gst_h264_sps_clear (&sps);
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sei_recovery_point_h265)
+{
+  /* payloadType 6, payloadSize 2, se(7) = 0001110, two zero flags,
+     then the payload alignment bits */
+  static const guint8 expected[] = { 0x06, 0x02, 0x1c, 0x40 };
+  GstBitWriter bs;
+
+  gst_bit_writer_init_with_size (&bs, 32, FALSE);
+  fail_unless (bs_write_sei_recovery_point_h265 (&bs, 7));
+  fail_unless_equals_int (GST_BIT_WRITER_BIT_SIZE (&bs),
+      sizeof (expected) * 8);
+  fail_unless (memcmp (GST_BIT_WRITER_DATA (&bs), expected,
+          sizeof (expected)) == 0);
+  gst_bit_writer_reset (&bs);
+}
+
+GST_END_TEST;
+
+static Suite *
+vaapiintrarefresh_suite (void)
+{
+  Suite *s = suite_create ("vaapiintrarefresh");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_intra_refresh_region);
+  tcase_add_test (tc_chain, test_sei_recovery_point_h264);
+  tcase_add_test (tc_chain, test_sei_recovery_point_h265);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vaapiintrarefresh);
@@ -0,0 +1,185 @@
+/*
+ *  vaapiminiobject.c - GStreamer unit test for GstVaapiMiniObject allocations
+ *
+ *  Copyright (C) 2021 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/base/gstadapter.h>
+#include <gst/vaapi/gstvaapiminiobject.h>
+#include <gst/vaapi/gstvaapidecoder_h264.h>
+#if USE_DRM
+# include <gst/vaapi/gstvaapidisplay_drm.h>
+#endif
+#include "test-h264.h"
+
+#define NUM_ITERATIONS 100
+
+typedef struct
+{
+  GstVaapiMiniObject parent_instance;
+  guint8 payload[40];
+} TestObject;
+
+static const GstVaapiMiniObjectClass TestObjectClass = {
+  .size = sizeof (TestObject),
+};
+
+GST_START_TEST (test_mini_object_reuse)
+{
+  GstVaapiMiniObject *objects[4];
+  GstVaapiMiniObjectStats stats;
+  guint i, j;
+
+  for (i = 0; i < NUM_ITERATIONS; i++) {
+    for (j = 0; j < G_N_ELEMENTS (objects); j++) {
+      objects[j] = gst_vaapi_mini_object_new0 (&TestObjectClass);
+      fail_unless (objects[j] != NULL);
+    }
+    for (j = 0; j < G_N_ELEMENTS (objects); j++)
+      gst_vaapi_mini_object_unref (objects[j]);
+  }
+
+  gst_vaapi_mini_object_get_stats (&TestObjectClass, &stats);
+  fail_unless_equals_int (stats.n_live, 0);
+  fail_unless_equals_int (stats.peak_live, G_N_ELEMENTS (objects));
+  fail_unless_equals_uint64 (stats.n_requests,
+      NUM_ITERATIONS * G_N_ELEMENTS (objects));
+  /* only the first iteration allocates memory */
+  fail_unless_equals_uint64 (stats.n_allocs, G_N_ELEMENTS (objects));
+  fail_unless_equals_int (stats.peak_footprint,
+      G_N_ELEMENTS (objects) * sizeof (TestObject));
+
+  gst_vaapi_mini_object_trim ();
+  gst_vaapi_mini_object_get_stats (&TestObjectClass, &stats);
+  fail_unless_equals_int (stats.n_free, 0);
+}
+
+GST_END_TEST;
+
+#if USE_DRM
+/* Parses one complete frame out of @adapter, without decoding it */
+static gboolean
+parse_frame (GstVaapiDecoder * decoder, GstAdapter * adapter)
+{
+  GstVideoCodecFrame *frame;
+  GstVaapiDecoderStatus status;
+  guint got_unit_size;
+  gboolean got_frame = FALSE;
+
+  frame = g_slice_new0 (GstVideoCodecFrame);
+  frame->ref_count = 1;
+
+  do {
+    status = gst_vaapi_decoder_parse (decoder, frame, adapter, TRUE,
+        &got_unit_size, &got_frame);
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+      break;
+    gst_adapter_flush (adapter, got_unit_size);
+  } while (!got_frame);
+
+  gst_video_codec_frame_unref (frame);
+  return got_frame;
+}
+
+GST_START_TEST (test_decoder_parse_allocations)
+{
+  GstVaapiDisplay *display;
+  GstVaapiDecoder *decoder;
+  GstVaapiMiniObjectStats warmup_stats, stats;
+  VideoDecodeInfo info;
+  GstAdapter *adapter;
+  GstCaps *caps;
+  guint i;
+
+  display = gst_vaapi_display_drm_new (NULL);
+  fail_unless (display != NULL);
+
+  h264_get_video_info (&info);
+  caps = gst_caps_new_simple ("video/x-h264",
+      "width", G_TYPE_INT, info.width, "height", G_TYPE_INT, info.height,
+      "stream-format", G_TYPE_STRING, "byte-stream",
+      "alignment", G_TYPE_STRING, "au", NULL);
+  decoder = gst_vaapi_decoder_h264_new (display, caps);
+  gst_caps_unref (caps);
+  fail_unless (decoder != NULL);
+
+  adapter = gst_adapter_new ();
+
+  /* warm up the free lists with the first frame */
+  gst_adapter_push (adapter, gst_buffer_new_wrapped_full
+      (GST_MEMORY_FLAG_READONLY, (gpointer) info.data, info.data_size, 0,
+          info.data_size, NULL, NULL));
+  fail_unless (parse_frame (decoder, adapter));
+  gst_vaapi_mini_object_get_stats (NULL, &warmup_stats);
+
+  for (i = 0; i < NUM_ITERATIONS; i++) {
+    gst_adapter_push (adapter, gst_buffer_new_wrapped_full
+        (GST_MEMORY_FLAG_READONLY, (gpointer) info.data, info.data_size, 0,
+            info.data_size, NULL, NULL));
+    fail_unless (parse_frame (decoder, adapter));
+  }
+
+  gst_vaapi_mini_object_get_stats (NULL, &stats);
+  fail_unless (stats.n_requests > warmup_stats.n_requests);
+  /* steady state frames must not hit the memory allocator */
+  fail_unless_equals_uint64 (stats.n_allocs, warmup_stats.n_allocs);
+  fail_unless_equals_int (stats.n_live, warmup_stats.n_live);
+
+  g_object_unref (adapter);
+  gst_object_unref (decoder);
+  gst_object_unref (display);
+}
+
+GST_END_TEST;
+
+static gboolean
+has_va_display (void)
+{
+  GstVaapiDisplay *const display = gst_vaapi_display_drm_new (NULL);
+
+  if (!display)
+    return FALSE;
+  gst_object_unref (display);
+  return TRUE;
+}
+#endif
+
+static Suite *
+vaapiminiobject_suite (void)
+{
+  Suite *s = suite_create ("vaapiminiobject");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_mini_object_reuse);
+#if USE_DRM
+  if (has_va_display ())
+    tcase_add_test (tc_chain, test_decoder_parse_allocations);
+  else
+    g_print ("Skipping test_decoder_parse_allocations: no VA display\n");
+#endif
+
+  return s;
+}
+
+GST_CHECK_MAIN (vaapiminiobject);
@@ -0,0 +1,151 @@
+/*
+ *  vaapiqpmap.c - GStreamer unit test for the encoder QP delta maps
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/vaapi/gstvaapiencoder_qpmap.h>
+
+/* A 6x4 map of 16x16 blocks: a salient area to the left, a background
+   area to the right */
+static const gint8 test_map[] = {
+  -4, -2, 0, 0, 0, 0,
+  -3, -3, 0, 0, 6, 6,
+  0, -1, 0, 0, 6, 6,
+  0, 0, 0, 3, 0, 0,
+};
+
+static void
+init_test_map (GstVaapiQPMap * map)
+{
+  map->block_size = 16;
+  map->columns = 6;
+  map->rows = 4;
+  map->delta_qp = test_map;
+}
+
+GST_START_TEST (test_qp_map_meta)
+{
+  GstBuffer *buffer, *copy;
+  GstVaapiQPMap map;
+
+  buffer = gst_buffer_new ();
+  fail_if (gst_vaapi_buffer_get_qp_map (buffer, &map));
+
+  fail_unless (gst_vaapi_buffer_add_qp_map (buffer, 16, 6, 4, test_map));
+  fail_unless (gst_vaapi_buffer_get_qp_map (buffer, &map));
+  fail_unless_equals_int (map.block_size, 16);
+  fail_unless_equals_int (map.columns, 6);
+  fail_unless_equals_int (map.rows, 4);
+  fail_unless (memcmp (map.delta_qp, test_map, sizeof (test_map)) == 0);
+
+  /* the map follows the buffer through the upload copies */
+  copy = gst_buffer_copy (buffer);
+  gst_buffer_unref (buffer);
+  fail_unless (gst_vaapi_buffer_get_qp_map (copy, &map));
+  fail_unless (memcmp (map.delta_qp, test_map, sizeof (test_map)) == 0);
+  gst_buffer_unref (copy);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_qp_map_block_qps)
+{
+  /* 32x32 blocks of a 100x64 picture, clamped to QP 30 */
+  static const guint8 expected[] = {
+    23, 26, 30, 26,
+    26, 29, 26, 26,
+  };
+  GstVaapiQPMap map;
+  guint8 qps[16];
+
+  init_test_map (&map);
+  gst_vaapi_qp_map_get_block_qps (&map, 32, 4, 2, 4, 26, 10, 30, qps);
+  fail_unless (memcmp (qps, expected, sizeof (expected)) == 0);
+
+  /* the rows follow the pitch of the VA buffer, the padding is left
+     untouched */
+  memset (qps, 0xff, sizeof (qps));
+  gst_vaapi_qp_map_get_block_qps (&map, 32, 4, 2, 8, 26, 10, 30, qps);
+  fail_unless (memcmp (qps, expected, 4) == 0);
+  fail_unless (memcmp (qps + 8, expected + 4, 4) == 0);
+  fail_unless_equals_int (qps[4], 0xff);
+  fail_unless_equals_int (qps[7], 0xff);
+  fail_unless_equals_int (qps[15], 0xff);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_qp_map_regions)
+{
+  GstVaapiQPRegion regions[4];
+  GstVaapiQPMap map;
+  guint num_regions;
+
+  init_test_map (&map);
+
+  /* 88x64 picture: the last column of blocks is cropped to 8 pixels */
+  num_regions = gst_vaapi_qp_map_get_regions (&map, 88, 64, regions, 4);
+  fail_unless_equals_int (num_regions, 3);
+
+  /* the heaviest area first: 6 + 6 + 6 + 6 */
+  fail_unless_equals_int (regions[0].x, 64);
+  fail_unless_equals_int (regions[0].y, 16);
+  fail_unless_equals_int (regions[0].width, 24);
+  fail_unless_equals_int (regions[0].height, 32);
+  fail_unless_equals_int (regions[0].delta_qp, 6);
+
+  /* -13 over 5 blocks, rounded away from zero */
+  fail_unless_equals_int (regions[1].x, 0);
+  fail_unless_equals_int (regions[1].y, 0);
+  fail_unless_equals_int (regions[1].width, 32);
+  fail_unless_equals_int (regions[1].height, 48);
+  fail_unless_equals_int (regions[1].delta_qp, -3);
+
+  fail_unless_equals_int (regions[2].x, 48);
+  fail_unless_equals_int (regions[2].y, 48);
+  fail_unless_equals_int (regions[2].width, 16);
+  fail_unless_equals_int (regions[2].height, 16);
+  fail_unless_equals_int (regions[2].delta_qp, 3);
+
+  /* only the heaviest areas are kept */
+  num_regions = gst_vaapi_qp_map_get_regions (&map, 88, 64, regions, 1);
+  fail_unless_equals_int (num_regions, 1);
+  fail_unless_equals_int (regions[0].delta_qp, 6);
+}
+
+GST_END_TEST;
+
+static Suite *
+vaapiqpmap_suite (void)
+{
+  Suite *s = suite_create ("vaapiqpmap");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_qp_map_meta);
+  tcase_add_test (tc_chain, test_qp_map_block_qps);
+  tcase_add_test (tc_chain, test_qp_map_regions);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vaapiqpmap);
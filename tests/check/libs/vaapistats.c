@@ -0,0 +1,142 @@
+/*
+ *  vaapistats.c - GStreamer unit test for the encoder statistics
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/vaapi/gstvaapiencoder_stats.h>
+
+#define FRAME_DURATION (GST_SECOND / 25)
+
+GST_START_TEST (test_encoder_stats_meta)
+{
+  GstVaapiEncoderFrameStats stats = { GST_VAAPI_ENCODER_FRAME_B, 31, 1200,
+    2 * GST_MSECOND, 40000
+  };
+  GstVaapiEncoderFrameStats out_stats;
+  GstBuffer *buffer, *copy;
+
+  buffer = gst_buffer_new ();
+  fail_if (gst_vaapi_buffer_get_encoder_stats (buffer, &out_stats));
+
+  fail_unless (gst_vaapi_buffer_add_encoder_stats (buffer, &stats));
+
+  /* the meta follows the buffer through copies */
+  copy = gst_buffer_copy (buffer);
+  gst_buffer_unref (buffer);
+  fail_unless (gst_vaapi_buffer_get_encoder_stats (copy, &out_stats));
+  fail_unless_equals_int (out_stats.frame_type, GST_VAAPI_ENCODER_FRAME_B);
+  fail_unless_equals_int (out_stats.qp, 31);
+  fail_unless_equals_int (out_stats.coded_size, 1200);
+  fail_unless_equals_uint64 (out_stats.encode_latency, 2 * GST_MSECOND);
+  fail_unless_equals_int64 (out_stats.hrd_fullness, 40000);
+  gst_buffer_unref (copy);
+
+  /* the unknown values are left out */
+  stats.qp = -1;
+  stats.hrd_fullness = -1;
+  buffer = gst_buffer_new ();
+  fail_unless (gst_vaapi_buffer_add_encoder_stats (buffer, &stats));
+  fail_unless (gst_vaapi_buffer_get_encoder_stats (buffer, &out_stats));
+  fail_unless_equals_int (out_stats.qp, -1);
+  fail_unless_equals_int64 (out_stats.hrd_fullness, -1);
+  gst_buffer_unref (buffer);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_encoder_stats_summary)
+{
+  GstVaapiEncoderStatsSummary summary;
+  GstVaapiEncoderFrameStats stats;
+  GstStructure *structure;
+  guint i, value;
+  guint64 value64;
+  gint min_qp, max_qp;
+  gdouble mean_qp;
+
+  gst_vaapi_encoder_stats_summary_reset (&summary);
+
+  /* one I frame of 10000 bytes and 24 P frames of 2500 bytes, coded
+     in 1 to 25 ms: 560 kbps over 1 second */
+  for (i = 0; i < 25; i++) {
+    stats.frame_type = i == 0 ? GST_VAAPI_ENCODER_FRAME_I :
+        GST_VAAPI_ENCODER_FRAME_P;
+    stats.qp = i == 0 ? 20 : 30;
+    stats.coded_size = i == 0 ? 10000 : 2500;
+    stats.encode_latency = (i + 1) * GST_MSECOND;
+    stats.hrd_fullness = i == 0 ? -1 : 500000 - i * 1000;
+    gst_vaapi_encoder_stats_summary_add (&summary, &stats, FRAME_DURATION);
+  }
+
+  structure = gst_vaapi_encoder_stats_summary_to_structure (&summary);
+  fail_unless (gst_structure_has_name (structure, "GstVaapiEncoderStats"));
+  fail_unless (gst_structure_get_uint (structure, "frames", &value));
+  fail_unless_equals_int (value, 25);
+  fail_unless (gst_structure_get_uint (structure, "i-frames", &value));
+  fail_unless_equals_int (value, 1);
+  fail_unless (gst_structure_get_uint (structure, "p-frames", &value));
+  fail_unless_equals_int (value, 24);
+  fail_unless (gst_structure_get_uint (structure, "bitrate", &value));
+  fail_unless_equals_int (value, 560000);
+  fail_unless (gst_structure_get (structure, "mean-qp", G_TYPE_DOUBLE,
+          &mean_qp, "min-qp", G_TYPE_INT, &min_qp, "max-qp", G_TYPE_INT,
+          &max_qp, NULL));
+  fail_unless (mean_qp > 29.5 && mean_qp < 29.7);
+  fail_unless_equals_int (min_qp, 20);
+  fail_unless_equals_int (max_qp, 30);
+  fail_unless (gst_structure_get_uint64 (structure, "mean-latency",
+          &value64));
+  fail_unless_equals_uint64 (value64, 13 * GST_MSECOND);
+  fail_unless (gst_structure_get_uint64 (structure, "max-latency", &value64));
+  fail_unless_equals_uint64 (value64, 25 * GST_MSECOND);
+  fail_unless (gst_structure_get_uint (structure, "min-hrd-fullness",
+          &value));
+  fail_unless_equals_int (value, 476000);
+  gst_structure_free (structure);
+
+  /* an empty summary has no bitrate nor QP */
+  gst_vaapi_encoder_stats_summary_reset (&summary);
+  structure = gst_vaapi_encoder_stats_summary_to_structure (&summary);
+  fail_unless (gst_structure_get_uint (structure, "frames", &value));
+  fail_unless_equals_int (value, 0);
+  fail_if (gst_structure_has_field (structure, "bitrate"));
+  fail_if (gst_structure_has_field (structure, "mean-qp"));
+  fail_if (gst_structure_has_field (structure, "min-hrd-fullness"));
+  gst_structure_free (structure);
+}
+
+GST_END_TEST;
+
+static Suite *
+vaapistats_suite (void)
+{
+  Suite *s = suite_create ("vaapistats");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_encoder_stats_meta);
+  tcase_add_test (tc_chain, test_encoder_stats_summary);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vaapistats);
@@ -0,0 +1,206 @@
+/*
+ *  vaapisubpicturecache.c - GStreamer unit test for the subpicture cache
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+#include <gst/vaapi/gstvaapisubpicturecache.h>
+#if USE_DRM
+# include <gst/vaapi/gstvaapidisplay_drm.h>
+#endif
+
+#if USE_DRM
+/* 1024x1024 ARGB: four of them fill the default cache size */
+#define LARGE_SIZE 1024
+
+static GstVideoOverlayRectangle *
+create_rectangle (guint size, guint8 value)
+{
+  GstVideoOverlayRectangle *rect;
+  GstBuffer *buffer;
+
+  buffer = gst_buffer_new_allocate (NULL, size * size * 4, NULL);
+  gst_buffer_memset (buffer, 0, value, size * size * 4);
+  gst_buffer_add_video_meta (buffer, GST_VIDEO_FRAME_FLAG_NONE,
+      GST_VIDEO_OVERLAY_COMPOSITION_FORMAT_RGB, size, size);
+  rect = gst_video_overlay_rectangle_new_raw (buffer, 0, 0, size, size,
+      GST_VIDEO_OVERLAY_FORMAT_FLAG_NONE);
+  gst_buffer_unref (buffer);
+  return rect;
+}
+
+static void
+check_stats (GstVaapiSubpictureCache * cache, guint64 hits, guint64 misses,
+    guint num_entries)
+{
+  GstVaapiSubpictureCacheStats stats;
+
+  gst_vaapi_subpicture_cache_get_stats (cache, &stats);
+  fail_unless_equals_uint64 (stats.hits, hits);
+  fail_unless_equals_uint64 (stats.misses, misses);
+  fail_unless_equals_int (stats.num_entries, num_entries);
+}
+
+GST_START_TEST (test_subpicture_cache_lookup)
+{
+  GstVaapiDisplay *display;
+  GstVaapiSubpictureCache *cache;
+  GstVaapiSubpicture *subpicture, *other;
+  GstVideoOverlayRectangle *rect, *copy;
+
+  display = gst_vaapi_display_drm_new (NULL);
+  fail_unless (display != NULL);
+  cache = gst_vaapi_subpicture_cache_new (0);
+
+  /* the same rectangle hits the cache */
+  rect = create_rectangle (64, 0x80);
+  subpicture = gst_vaapi_subpicture_cache_acquire (cache, display, rect);
+  fail_unless (subpicture != NULL);
+  check_stats (cache, 0, 1, 1);
+
+  other = gst_vaapi_subpicture_cache_acquire (cache, display, rect);
+  fail_unless (other == subpicture);
+  check_stats (cache, 1, 1, 1);
+  gst_vaapi_subpicture_unref (other);
+
+  /* other pixels miss it */
+  copy = create_rectangle (64, 0x40);
+  other = gst_vaapi_subpicture_cache_acquire (cache, display, copy);
+  fail_unless (other != NULL && other != subpicture);
+  check_stats (cache, 1, 2, 2);
+  gst_vaapi_subpicture_unref (other);
+  gst_video_overlay_rectangle_unref (copy);
+
+  /* so does a global alpha change of the same pixels */
+  copy = gst_video_overlay_rectangle_copy (rect);
+  gst_video_overlay_rectangle_set_global_alpha (copy, 0.5);
+  other = gst_vaapi_subpicture_cache_acquire (cache, display, copy);
+  fail_unless (other != NULL && other != subpicture);
+  check_stats (cache, 1, 3, 3);
+  gst_vaapi_subpicture_unref (other);
+  gst_video_overlay_rectangle_unref (copy);
+
+  gst_vaapi_subpicture_unref (subpicture);
+  gst_video_overlay_rectangle_unref (rect);
+
+  gst_vaapi_subpicture_cache_reset (cache);
+  check_stats (cache, 1, 3, 0);
+
+  gst_object_unref (cache);
+  gst_object_unref (display);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_subpicture_cache_eviction)
+{
+  GstVaapiDisplay *display;
+  GstVaapiSubpictureCache *cache;
+  GstVaapiSubpictureCacheStats stats;
+  GstVaapiSubpicture *subpicture;
+  GstVideoOverlayRectangle *rects[5];
+  guint i;
+
+  display = gst_vaapi_display_drm_new (NULL);
+  fail_unless (display != NULL);
+  cache = gst_vaapi_subpicture_cache_new (0);
+
+  for (i = 0; i < G_N_ELEMENTS (rects); i++)
+    rects[i] = create_rectangle (LARGE_SIZE, i);
+
+  /* fill the cache, then make the first rectangle the most recently
+   * used one */
+  for (i = 0; i < 4; i++) {
+    subpicture = gst_vaapi_subpicture_cache_acquire (cache, display,
+        rects[i]);
+    fail_unless (subpicture != NULL);
+    gst_vaapi_subpicture_unref (subpicture);
+  }
+  gst_vaapi_subpicture_cache_get_stats (cache, &stats);
+  fail_unless (stats.size <= GST_VAAPI_SUBPICTURE_CACHE_DEFAULT_MAX_SIZE);
+
+  subpicture = gst_vaapi_subpicture_cache_acquire (cache, display, rects[0]);
+  gst_vaapi_subpicture_unref (subpicture);
+  gst_vaapi_subpicture_cache_get_stats (cache, &stats);
+  fail_unless_equals_uint64 (stats.hits, 1);
+  fail_unless_equals_uint64 (stats.evictions, 0);
+
+  /* one more evicts the least recently used rectangle */
+  subpicture = gst_vaapi_subpicture_cache_acquire (cache, display, rects[4]);
+  fail_unless (subpicture != NULL);
+  gst_vaapi_subpicture_unref (subpicture);
+  gst_vaapi_subpicture_cache_get_stats (cache, &stats);
+  fail_unless (stats.evictions >= 1);
+  fail_unless (stats.size <= GST_VAAPI_SUBPICTURE_CACHE_DEFAULT_MAX_SIZE);
+  fail_unless_equals_int (stats.num_entries, 5 - stats.evictions);
+
+  subpicture = gst_vaapi_subpicture_cache_acquire (cache, display, rects[0]);
+  gst_vaapi_subpicture_unref (subpicture);
+  gst_vaapi_subpicture_cache_get_stats (cache, &stats);
+  fail_unless_equals_uint64 (stats.hits, 2);
+
+  subpicture = gst_vaapi_subpicture_cache_acquire (cache, display, rects[1]);
+  gst_vaapi_subpicture_unref (subpicture);
+  gst_vaapi_subpicture_cache_get_stats (cache, &stats);
+  fail_unless_equals_uint64 (stats.hits, 2);
+  fail_unless_equals_uint64 (stats.misses, 6);
+
+  for (i = 0; i < G_N_ELEMENTS (rects); i++)
+    gst_video_overlay_rectangle_unref (rects[i]);
+  gst_object_unref (cache);
+  gst_object_unref (display);
+}
+
+GST_END_TEST;
+
+static gboolean
+has_va_display (void)
+{
+  GstVaapiDisplay *const display = gst_vaapi_display_drm_new (NULL);
+
+  if (!display)
+    return FALSE;
+  gst_object_unref (display);
+  return TRUE;
+}
+#endif
+
+static Suite *
+vaapisubpicturecache_suite (void)
+{
+  Suite *s = suite_create ("vaapisubpicturecache");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+#if USE_DRM
+  if (has_va_display ()) {
+    tcase_add_test (tc_chain, test_subpicture_cache_lookup);
+    tcase_add_test (tc_chain, test_subpicture_cache_eviction);
+  } else {
+    g_print ("Skipping the subpicture cache tests: no VA display\n");
+  }
+#endif
+
+  return s;
+}
+
+GST_CHECK_MAIN (vaapisubpicturecache);
@@ -0,0 +1,196 @@
+/*
+ *  vaapiswrc.c - GStreamer unit test for the software rate control
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/vaapi/gstvaapiencoder_swrc.h>
+
+#define BITRATE 2000            /* kbps */
+#define FPS 30
+#define GOP_SIZE 30
+#define NUM_FRAMES 300
+
+/* A synthetic encoder: the size of a frame halves every 6 QP, and the
+   intra frames are 5 times larger than the predicted ones */
+static guint
+synthetic_frame_size (GstVaapiSwRateControlFrameType type, gint qp,
+    guint scale)
+{
+  static const guint fraction[6] = { 64, 57, 51, 45, 40, 36 };
+  guint64 size = (type == GST_VAAPI_SW_RC_FRAME_I ? 600000 : 120000);
+
+  size = size * scale * fraction[qp % 6] / 64;
+  return (guint) (size >> (qp / 6));
+}
+
+/* Runs the rate control over a stream coded with a delay of a few
+   frames, as the hardware does, and returns the bitrate of the second
+   half of the stream, in kbps */
+static guint
+run_synthetic_stream (guint scale, gint * qps)
+{
+  GstVaapiSwRateControl rc;
+  GstVaapiSwRateControlFrameType types[NUM_FRAMES];
+  guint targets[NUM_FRAMES];
+  guint64 total = 0;
+  guint i, j, size;
+
+  gst_vaapi_sw_rate_control_init (&rc, BITRATE, FPS, 1, 1000, 26, 1, 51);
+
+  for (i = 0; i < NUM_FRAMES + 4; i++) {
+    if (i < NUM_FRAMES) {
+      types[i] = (i % GOP_SIZE) ? GST_VAAPI_SW_RC_FRAME_P :
+          GST_VAAPI_SW_RC_FRAME_I;
+      qps[i] = gst_vaapi_sw_rate_control_get_qp (&rc, types[i], &targets[i]);
+      fail_unless (qps[i] >= 1 && qps[i] <= 51);
+    }
+
+    /* the feedback of a frame comes 4 frames later */
+    if (i < 4)
+      continue;
+    j = i - 4;
+    size = synthetic_frame_size (types[j], qps[j], scale);
+    gst_vaapi_sw_rate_control_update (&rc, types[j], qps[j], targets[j],
+        size);
+    if (j >= NUM_FRAMES / 2)
+      total += size;
+  }
+  return total * FPS / (NUM_FRAMES / 2) / 1000;
+}
+
+GST_START_TEST (test_sw_rate_control_converges)
+{
+  gint qps[NUM_FRAMES];
+  guint bitrate;
+
+  bitrate = run_synthetic_stream (1, qps);
+  fail_unless (bitrate > BITRATE * 9 / 10 && bitrate < BITRATE * 11 / 10,
+      "bitrate %u kbps", bitrate);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sw_rate_control_complexity)
+{
+  gint qps[NUM_FRAMES], complex_qps[NUM_FRAMES];
+  guint bitrate;
+
+  run_synthetic_stream (1, qps);
+
+  /* frames 4 times larger are quantized harder, to the same bitrate */
+  bitrate = run_synthetic_stream (4, complex_qps);
+  fail_unless (bitrate > BITRATE * 9 / 10 && bitrate < BITRATE * 11 / 10,
+      "bitrate %u kbps", bitrate);
+  fail_unless (complex_qps[NUM_FRAMES - 1] >= qps[NUM_FRAMES - 1] + 10);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sw_rate_control_overshoot)
+{
+  GstVaapiSwRateControl rc;
+  guint target;
+  gint qp, last_qp;
+  guint i;
+
+  gst_vaapi_sw_rate_control_init (&rc, BITRATE, FPS, 1, 1000, 26, 1, 51);
+
+  /* every frame comes out twice as large as targeted */
+  last_qp = 0;
+  for (i = 0; i < 10; i++) {
+    qp = gst_vaapi_sw_rate_control_get_qp (&rc, GST_VAAPI_SW_RC_FRAME_P,
+        &target);
+    fail_unless (qp >= last_qp);
+    gst_vaapi_sw_rate_control_update (&rc, GST_VAAPI_SW_RC_FRAME_P, qp,
+        target, target * 2);
+    last_qp = qp;
+  }
+  fail_unless (last_qp > 26);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sw_rate_control_set_target)
+{
+  GstVaapiSwRateControl rc;
+  guint i, target, size;
+  guint64 total = 0;
+  gint qp, last_qp = 0;
+
+  gst_vaapi_sw_rate_control_init (&rc, BITRATE, FPS, 1, 1000, 26, 1, 51);
+
+  for (i = 0; i < 2 * NUM_FRAMES; i++) {
+    /* halve the bitrate in the middle of the stream */
+    if (i == NUM_FRAMES) {
+      gst_vaapi_sw_rate_control_set_target (&rc, BITRATE / 2, FPS, 1, 1000,
+          1, 51);
+      /* the model is kept: the QP does not restart from scratch */
+      qp = gst_vaapi_sw_rate_control_get_qp (&rc, GST_VAAPI_SW_RC_FRAME_P,
+          &target);
+      fail_unless (qp >= last_qp && qp <= last_qp + 4);
+    } else {
+      qp = gst_vaapi_sw_rate_control_get_qp (&rc, GST_VAAPI_SW_RC_FRAME_P,
+          &target);
+    }
+    size = synthetic_frame_size (GST_VAAPI_SW_RC_FRAME_P, qp, 1);
+    gst_vaapi_sw_rate_control_update (&rc, GST_VAAPI_SW_RC_FRAME_P, qp,
+        target, size);
+    if (i >= NUM_FRAMES + NUM_FRAMES / 2)
+      total += size;
+    last_qp = qp;
+  }
+
+  total = total * FPS / (NUM_FRAMES / 2) / 1000;
+  fail_unless (total > BITRATE / 2 * 9 / 10 && total < BITRATE / 2 * 11 / 10,
+      "bitrate %" G_GUINT64_FORMAT " kbps", total);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sw_rate_control_deterministic)
+{
+  gint qps[NUM_FRAMES], other_qps[NUM_FRAMES];
+
+  run_synthetic_stream (2, qps);
+  run_synthetic_stream (2, other_qps);
+  fail_unless (memcmp (qps, other_qps, sizeof (qps)) == 0);
+}
+
+GST_END_TEST;
+
+static Suite *
+vaapiswrc_suite (void)
+{
+  Suite *s = suite_create ("vaapiswrc");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_sw_rate_control_converges);
+  tcase_add_test (tc_chain, test_sw_rate_control_complexity);
+  tcase_add_test (tc_chain, test_sw_rate_control_overshoot);
+  tcase_add_test (tc_chain, test_sw_rate_control_set_target);
+  tcase_add_test (tc_chain, test_sw_rate_control_deterministic);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vaapiswrc);
@@ -0,0 +1,161 @@
+/*
+ *  vaapitlayers.c - GStreamer unit test for the encoder temporal layers
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/vaapi/gstvaapiencoder_tlayers.h>
+
+GST_START_TEST (test_temporal_layer_meta)
+{
+  GstBuffer *buffer, *copy;
+  guint temporal_id, num_layers;
+  gboolean layer_sync;
+
+  buffer = gst_buffer_new ();
+  fail_if (gst_vaapi_buffer_get_temporal_layer (buffer, NULL, NULL, NULL));
+
+  fail_unless (gst_vaapi_buffer_add_temporal_layer (buffer, 2, 3, TRUE));
+
+  /* the meta follows the buffer through copies */
+  copy = gst_buffer_copy (buffer);
+  gst_buffer_unref (buffer);
+  fail_unless (gst_vaapi_buffer_get_temporal_layer (copy, &temporal_id,
+          &num_layers, &layer_sync));
+  fail_unless_equals_int (temporal_id, 2);
+  fail_unless_equals_int (num_layers, 3);
+  fail_unless (layer_sync);
+  gst_buffer_unref (copy);
+}
+
+GST_END_TEST;
+
+/* Dropping the frames above any layer never breaks the frames below:
+   a frame only predicts from reference frames last updated by its own
+   layer, or the layers below */
+GST_START_TEST (test_temporal_layers_pattern)
+{
+  static const guint expected_ids[2][8] = {
+    {0, 1, 0, 1, 0, 1, 0, 1},
+    {0, 2, 1, 2, 0, 2, 1, 2},
+  };
+  static const gboolean expected_sync[2][8] = {
+    {TRUE, TRUE, TRUE, FALSE, TRUE, FALSE, TRUE, FALSE},
+    {TRUE, TRUE, TRUE, FALSE, TRUE, FALSE, FALSE, FALSE},
+  };
+  const GstVaapiTemporalLayerFrame *frame;
+  GstVaapiTemporalLayers layers;
+  guint ref_ids[3] = { 0, };
+  guint n, i, j;
+  gboolean layer_sync;
+
+  fail_if (gst_vaapi_temporal_layers_init (&layers, 1));
+  fail_if (gst_vaapi_temporal_layers_init (&layers, 4));
+
+  for (n = 2; n <= GST_VAAPI_MAX_TEMPORAL_LAYERS; n++) {
+    fail_unless (gst_vaapi_temporal_layers_init (&layers, n));
+
+    for (i = 0; i < 8; i++) {
+      frame = gst_vaapi_temporal_layers_next (&layers, i == 0, &layer_sync);
+      fail_unless_equals_int (frame->temporal_id, expected_ids[n - 2][i]);
+      fail_unless_equals_int (layer_sync, expected_sync[n - 2][i]);
+
+      for (j = 0; j < 3; j++) {
+        if (i > 0 && (frame->ref_flags & (1 << j)))
+          fail_unless (ref_ids[j] <= frame->temporal_id);
+        if (frame->refresh_flags & (1 << j))
+          ref_ids[j] = frame->temporal_id;
+      }
+
+      /* the base layer always keeps a reference to predict from */
+      if (frame->temporal_id == 0)
+        fail_unless (frame->refresh_flags & GST_VAAPI_REF_FRAME_LAST);
+    }
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_temporal_layers_bitrates)
+{
+  GstVaapiTemporalLayers layers;
+  GArray *shares;
+  guint bitrates[GST_VAAPI_MAX_TEMPORAL_LAYERS];
+  guint share;
+  gint fps_n, fps_d;
+
+  fail_unless (gst_vaapi_temporal_layers_init (&layers, 3));
+
+  /* the default allocation, as cumulative bitrates */
+  gst_vaapi_temporal_layers_get_bitrates (&layers, 1000, NULL, bitrates);
+  fail_unless_equals_int (bitrates[0], 400);
+  fail_unless_equals_int (bitrates[1], 600);
+  fail_unless_equals_int (bitrates[2], 1000);
+
+  /* relative weights */
+  shares = g_array_new (FALSE, FALSE, sizeof (guint));
+  share = 2;
+  g_array_append_val (shares, share);
+  share = 1;
+  g_array_append_val (shares, share);
+  g_array_append_val (shares, share);
+  gst_vaapi_temporal_layers_get_bitrates (&layers, 1000, shares, bitrates);
+  fail_unless_equals_int (bitrates[0], 500);
+  fail_unless_equals_int (bitrates[1], 750);
+  fail_unless_equals_int (bitrates[2], 1000);
+
+  /* a share per layer is needed */
+  g_array_set_size (shares, 2);
+  gst_vaapi_temporal_layers_get_bitrates (&layers, 1000, shares, bitrates);
+  fail_unless_equals_int (bitrates[0], 400);
+  g_array_unref (shares);
+
+  gst_vaapi_temporal_layers_get_framerate (&layers, 0, 30, 1, &fps_n,
+      &fps_d);
+  fail_unless_equals_int (fps_n, 15);
+  fail_unless_equals_int (fps_d, 2);
+  gst_vaapi_temporal_layers_get_framerate (&layers, 1, 30, 1, &fps_n,
+      &fps_d);
+  fail_unless_equals_int (fps_n, 15);
+  fail_unless_equals_int (fps_d, 1);
+  gst_vaapi_temporal_layers_get_framerate (&layers, 2, 30000, 1001, &fps_n,
+      &fps_d);
+  fail_unless_equals_int (fps_n, 30000);
+  fail_unless_equals_int (fps_d, 1001);
+}
+
+GST_END_TEST;
+
+static Suite *
+vaapitlayers_suite (void)
+{
+  Suite *s = suite_create ("vaapitlayers");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_temporal_layer_meta);
+  tcase_add_test (tc_chain, test_temporal_layers_pattern);
+  tcase_add_test (tc_chain, test_temporal_layers_bitrates);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vaapitlayers);
@@ -0,0 +1,247 @@
+/*
+ *  vaapivacalls.c - GStreamer unit test for the VA call accounting
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/vaapi/gstvaapivacalls.h>
+#include <va/va.h>
+
+#define NUM_FRAMES 10
+#define NUM_SLICES 3
+
+/* A fake VA driver, standing for the real entry points */
+typedef struct
+{
+  VAStatus (*begin_picture) (VAContextID context, VASurfaceID target);
+  VAStatus (*render_picture) (VAContextID context, VABufferID * buffers,
+      int num_buffers);
+  VAStatus (*end_picture) (VAContextID context);
+  VAStatus (*sync_surface) (VASurfaceID target);
+} FakeVaTable;
+
+static guint num_driver_calls;
+
+static VAStatus
+fake_begin_picture (VAContextID context, VASurfaceID target)
+{
+  num_driver_calls++;
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+fake_render_picture (VAContextID context, VABufferID * buffers,
+    int num_buffers)
+{
+  num_driver_calls++;
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+fake_end_picture (VAContextID context)
+{
+  num_driver_calls++;
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+fake_sync_surface (VASurfaceID target)
+{
+  g_usleep (100);
+  num_driver_calls++;
+  return VA_STATUS_SUCCESS;
+}
+
+static const FakeVaTable fake_va = {
+  fake_begin_picture,
+  fake_render_picture,
+  fake_end_picture,
+  fake_sync_surface,
+};
+
+/* Submits a frame the way the decoders do, one slice at a time */
+static void
+decode_frame (GstVaapiVaCallStats * owner)
+{
+  VABufferID buffers[2] = { 1, 2 };
+  VAStatus status;
+  guint i;
+
+  gst_vaapi_va_calls_add_frame (owner);
+  gst_vaapi_va_calls_push (owner);
+
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_BEGIN_PICTURE, status,
+      fake_va.begin_picture (1, 1));
+  fail_unless_equals_int (status, VA_STATUS_SUCCESS);
+  for (i = 0; i < NUM_SLICES; i++) {
+    GST_VAAPI_VA_CALL (GST_VAAPI_VA_RENDER_PICTURE, status,
+        fake_va.render_picture (1, buffers, G_N_ELEMENTS (buffers)));
+    fail_unless_equals_int (status, VA_STATUS_SUCCESS);
+  }
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_END_PICTURE, status,
+      fake_va.end_picture (1));
+  fail_unless_equals_int (status, VA_STATUS_SUCCESS);
+
+  gst_vaapi_va_calls_pop ();
+}
+
+static void
+sync_surface (void)
+{
+  VAStatus status;
+
+  GST_VAAPI_VA_CALL (GST_VAAPI_VA_SYNC_SURFACE, status,
+      fake_va.sync_surface (1));
+  fail_unless_equals_int (status, VA_STATUS_SUCCESS);
+}
+
+GST_START_TEST (test_va_calls_disabled)
+{
+  GstVaapiVaCallStats owner = { 0, }, stats, unattributed;
+  guint i;
+
+  gst_vaapi_va_calls_set_enabled (FALSE);
+  gst_vaapi_va_calls_reset (NULL);
+  num_driver_calls = 0;
+
+  for (i = 0; i < NUM_FRAMES; i++) {
+    decode_frame (&owner);
+    sync_surface ();
+  }
+
+  /* the driver is still called, but nothing is accounted */
+  fail_unless_equals_int (num_driver_calls, NUM_FRAMES * (NUM_SLICES + 3));
+  gst_vaapi_va_calls_get_stats (&owner, &stats);
+  fail_unless_equals_uint64 (stats.num_frames, 0);
+  for (i = 0; i < GST_VAAPI_VA_N_CALLS; i++)
+    fail_unless_equals_uint64 (stats.calls[i].count, 0);
+  gst_vaapi_va_calls_get_stats (NULL, &unattributed);
+  fail_unless_equals_uint64
+      (unattributed.calls[GST_VAAPI_VA_SYNC_SURFACE].count, 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_va_calls_attribution)
+{
+  GstVaapiVaCallStats decoder = { 0, }, filter = { 0, };
+  GstVaapiVaCallStats stats, unattributed;
+  guint i;
+
+  gst_vaapi_va_calls_set_enabled (TRUE);
+  gst_vaapi_va_calls_reset (NULL);
+
+  for (i = 0; i < NUM_FRAMES; i++) {
+    decode_frame (&decoder);
+
+    /* a filter processing the frame from within the decoder scope */
+    gst_vaapi_va_calls_push (&decoder);
+    decode_frame (&filter);
+    sync_surface ();
+    gst_vaapi_va_calls_pop ();
+
+    /* out of any scope */
+    sync_surface ();
+  }
+
+  gst_vaapi_va_calls_get_stats (&decoder, &stats);
+  fail_unless_equals_uint64 (stats.num_frames, NUM_FRAMES);
+  fail_unless_equals_uint64 (stats.calls[GST_VAAPI_VA_BEGIN_PICTURE].count,
+      NUM_FRAMES);
+  fail_unless_equals_uint64 (stats.calls[GST_VAAPI_VA_RENDER_PICTURE].count,
+      NUM_FRAMES * NUM_SLICES);
+  fail_unless_equals_uint64 (stats.calls[GST_VAAPI_VA_END_PICTURE].count,
+      NUM_FRAMES);
+  fail_unless_equals_uint64 (stats.calls[GST_VAAPI_VA_SYNC_SURFACE].count,
+      NUM_FRAMES);
+  fail_unless (stats.calls[GST_VAAPI_VA_SYNC_SURFACE].time >=
+      NUM_FRAMES * 100 * GST_USECOND);
+
+  gst_vaapi_va_calls_get_stats (&filter, &stats);
+  fail_unless_equals_uint64 (stats.num_frames, NUM_FRAMES);
+  fail_unless_equals_uint64 (stats.calls[GST_VAAPI_VA_RENDER_PICTURE].count,
+      NUM_FRAMES * NUM_SLICES);
+  fail_unless_equals_uint64 (stats.calls[GST_VAAPI_VA_SYNC_SURFACE].count, 0);
+
+  gst_vaapi_va_calls_get_stats (NULL, &unattributed);
+  fail_unless_equals_uint64
+      (unattributed.calls[GST_VAAPI_VA_SYNC_SURFACE].count, NUM_FRAMES);
+  fail_unless_equals_uint64
+      (unattributed.calls[GST_VAAPI_VA_BEGIN_PICTURE].count, 0);
+
+  gst_vaapi_va_calls_reset (&decoder);
+  gst_vaapi_va_calls_get_stats (&decoder, &stats);
+  fail_unless_equals_uint64 (stats.num_frames, 0);
+  fail_unless_equals_uint64 (stats.calls[GST_VAAPI_VA_BEGIN_PICTURE].count,
+      0);
+
+  gst_vaapi_va_calls_set_enabled (FALSE);
+}
+
+GST_END_TEST;
+
+static gpointer
+sync_thread (gpointer data)
+{
+  sync_surface ();
+  return NULL;
+}
+
+GST_START_TEST (test_va_calls_threads)
+{
+  GstVaapiVaCallStats owner = { 0, }, stats, unattributed;
+  GThread *thread;
+
+  gst_vaapi_va_calls_set_enabled (TRUE);
+  gst_vaapi_va_calls_reset (NULL);
+
+  /* scopes only apply to the thread that pushed them */
+  gst_vaapi_va_calls_push (&owner);
+  thread = g_thread_new ("sync", sync_thread, NULL);
+  g_thread_join (thread);
+  gst_vaapi_va_calls_pop ();
+
+  gst_vaapi_va_calls_get_stats (&owner, &stats);
+  fail_unless_equals_uint64 (stats.calls[GST_VAAPI_VA_SYNC_SURFACE].count, 0);
+  gst_vaapi_va_calls_get_stats (NULL, &unattributed);
+  fail_unless_equals_uint64
+      (unattributed.calls[GST_VAAPI_VA_SYNC_SURFACE].count, 1);
+
+  gst_vaapi_va_calls_set_enabled (FALSE);
+}
+
+GST_END_TEST;
+
+static Suite *
+vaapivacalls_suite (void)
+{
+  Suite *s = suite_create ("vaapivacalls");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_va_calls_disabled);
+  tcase_add_test (tc_chain, test_va_calls_attribution);
+  tcase_add_test (tc_chain, test_va_calls_threads);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vaapivacalls);
@@ -0,0 +1,130 @@
+/*
+ *  benchstats.c - Throughput and latency statistics for the tests
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "gst/vaapi/sysdeps.h"
+#include <sys/resource.h>
+#include <gst/vaapi/gstvaapisurface.h>
+#include "benchstats.h"
+
+void
+bench_run_init (BenchRun * run, guint warmup_secs, guint duration_secs)
+{
+  run->start_time = g_get_monotonic_time () + warmup_secs * G_USEC_PER_SEC;
+  run->end_time = duration_secs ?
+      run->start_time + duration_secs * G_USEC_PER_SEC : G_MAXINT64;
+}
+
+gboolean
+bench_run_is_done (const BenchRun * run)
+{
+  return g_get_monotonic_time () >= run->end_time;
+}
+
+void
+bench_stats_init (BenchStats * stats)
+{
+  stats->num_frames = 0;
+  stats->last_time = 0;
+  stats->latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+}
+
+void
+bench_stats_clear (BenchStats * stats)
+{
+  if (stats->latencies) {
+    g_array_unref (stats->latencies);
+    stats->latencies = NULL;
+  }
+}
+
+void
+bench_stats_add_frame (BenchStats * stats, const BenchRun * run,
+    gint64 submit_time, gint64 done_time)
+{
+  gint64 latency;
+
+  if (done_time < run->start_time || done_time >= run->end_time)
+    return;
+
+  latency = done_time - submit_time;
+  g_array_append_val (stats->latencies, latency);
+  stats->num_frames++;
+  stats->last_time = done_time;
+}
+
+gdouble
+bench_stats_get_fps (const BenchStats * stats, const BenchRun * run)
+{
+  const gint64 elapsed = stats->last_time - run->start_time;
+
+  if (stats->num_frames == 0 || elapsed <= 0)
+    return 0;
+  return (gdouble) stats->num_frames * G_USEC_PER_SEC / elapsed;
+}
+
+static gint
+compare_latencies (gconstpointer a, gconstpointer b)
+{
+  const gint64 va = *(const gint64 *) a;
+  const gint64 vb = *(const gint64 *) b;
+
+  return va < vb ? -1 : va > vb ? 1 : 0;
+}
+
+/* Nearest-rank percentile of the sorted latencies, in ms */
+static gdouble
+get_percentile (GArray * latencies, guint percent)
+{
+  guint rank;
+
+  rank = (latencies->len * percent + 99) / 100;
+  return g_array_index (latencies, gint64, MAX (rank, 1) - 1) / 1000.0;
+}
+
+void
+bench_stats_print (BenchStats * stats, const BenchRun * run,
+    const gchar * name)
+{
+  GArray *const latencies = stats->latencies;
+
+  g_print ("%s: %" G_GUINT64_FORMAT " frames, %.1f fps", name,
+      stats->num_frames, bench_stats_get_fps (stats, run));
+
+  if (latencies->len > 0) {
+    g_array_sort (latencies, compare_latencies);
+    g_print (", latency (ms) p50 %.2f p90 %.2f p99 %.2f max %.2f",
+        get_percentile (latencies, 50), get_percentile (latencies, 90),
+        get_percentile (latencies, 99), get_percentile (latencies, 100));
+  }
+  g_print ("\n");
+}
+
+void
+bench_print_resources (void)
+{
+  struct rusage usage;
+  guint num_surfaces, max_surfaces;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    g_print ("peak RSS: %ld KiB\n", usage.ru_maxrss);
+
+  num_surfaces = gst_vaapi_surface_get_num_allocated (&max_surfaces);
+  g_print ("VA surfaces: %u allocated, %u at peak\n", num_surfaces,
+      max_surfaces);
+}
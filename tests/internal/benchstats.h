@@ -0,0 +1,70 @@
+/*
+ *  benchstats.h - Throughput and latency statistics for the tests
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef BENCHSTATS_H
+#define BENCHSTATS_H
+
+#include <glib.h>
+
+typedef struct _BenchRun BenchRun;
+typedef struct _BenchStats BenchStats;
+
+/* The measured part of a run, in monotonic time (us). Frames completed
+   during the warm-up, before start_time, are not accounted */
+struct _BenchRun
+{
+  gint64 start_time;
+  gint64 end_time;
+};
+
+/* The frames completed by one instance during the measured run */
+struct _BenchStats
+{
+  guint64 num_frames;
+  gint64 last_time;
+  GArray *latencies;
+};
+
+void
+bench_run_init (BenchRun * run, guint warmup_secs, guint duration_secs);
+
+gboolean
+bench_run_is_done (const BenchRun * run);
+
+void
+bench_stats_init (BenchStats * stats);
+
+void
+bench_stats_clear (BenchStats * stats);
+
+void
+bench_stats_add_frame (BenchStats * stats, const BenchRun * run,
+    gint64 submit_time, gint64 done_time);
+
+gdouble
+bench_stats_get_fps (const BenchStats * stats, const BenchRun * run);
+
+void
+bench_stats_print (BenchStats * stats, const BenchRun * run,
+    const gchar * name);
+
+void
+bench_print_resources (void);
+
+#endif /* BENCHSTATS_H */
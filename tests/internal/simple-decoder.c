@@ -35,11 +35,17 @@
 #include <gst/vaapi/gstvaapidecoder_mpeg4.h>
 #include <gst/vaapi/gstvaapidecoder_vc1.h>
 #include <gst/vaapi/gstvaapiwindow.h>
+#include "benchstats.h"
 #include "codec.h"
 #include "output.h"
 
 static gchar *g_codec_str;
 static gboolean g_benchmark;
+static guint g_num_instances = 1;
+static guint g_duration;
+static guint g_warmup;
+
+static BenchRun g_bench_run;
 
 static GOptionEntry g_options[] = {
   {"codec", 'c',
@@ -50,6 +56,19 @@ static GOptionEntry g_options[] = {
         0,
         G_OPTION_ARG_NONE, &g_benchmark,
       "benchmark mode", NULL},
+  {"instances", 0,
+        0,
+        G_OPTION_ARG_INT, &g_num_instances,
+      "number of decoders running in parallel, in benchmark mode", NULL},
+  {"duration", 0,
+        0,
+        G_OPTION_ARG_INT, &g_duration,
+      "benchmark duration in seconds, looping the bitstream "
+        "(0: decode it once)", NULL},
+  {"warmup", 0,
+        0,
+        G_OPTION_ARG_INT, &g_warmup,
+      "seconds excluded from the benchmark results", NULL},
   {NULL,}
 };
 
@@ -72,6 +91,7 @@ typedef struct
   GstVaapiSurfaceProxy *proxy;
   GstClockTime pts;
   GstClockTime duration;
+  gint64 input_time;
 } RenderFrame;
 
 typedef struct
@@ -103,8 +123,9 @@ typedef struct
   GError *error;
   AppEvent event;
   GCond event_cond;
-  GTimer *timer;
   guint32 num_frames;
+  gint64 input_time;
+  BenchStats stats;
 } App;
 
 static inline RenderFrame *
@@ -242,6 +263,9 @@ decoder_thread (gpointer data)
   pts = g_get_monotonic_time ();
   ofs = 0;
   while (!g_atomic_int_get (&app->decoder_thread_cancel)) {
+    if (g_benchmark && bench_run_is_done (&g_bench_run))
+      goto send_eos;
+
     if (G_UNLIKELY (ofs == app->file_size))
       buffer = NULL;
     else {
@@ -252,6 +276,7 @@ decoder_thread (gpointer data)
         SEND_ERROR ("failed to allocate new buffer");
       ofs += size;
     }
+    app->input_time = g_get_monotonic_time ();
     if (!gst_vaapi_decoder_put_buffer (app->decoder, buffer))
       SEND_ERROR ("failed to push buffer to decoder");
     gst_buffer_replace (&buffer, NULL);
@@ -265,6 +290,7 @@ decoder_thread (gpointer data)
         rfp->proxy = proxy;
         rfp->pts = pts;
         rfp->duration = app->frame_duration;
+        rfp->input_time = app->input_time;
         pts += app->frame_duration;
         g_async_queue_push (app->decoder_queue, rfp);
         break;
@@ -273,8 +299,15 @@ decoder_thread (gpointer data)
         break;
       case GST_VAAPI_DECODER_STATUS_END_OF_STREAM:
         gst_vaapi_decoder_flush (app->decoder);
-        if (got_eos)
-          goto send_eos;
+        if (got_eos) {
+          if (!g_duration)
+            goto send_eos;
+          /* loop the bitstream until the end of the benchmark */
+          gst_vaapi_decoder_reset (app->decoder);
+          got_eos = FALSE;
+          ofs = 0;
+          break;
+        }
         got_eos = TRUE;
         break;
       default:
@@ -362,8 +395,6 @@ start_decoder (App * app)
   gst_vaapi_decoder_set_codec_state_changed_func (app->decoder,
       handle_decoder_state_changes, app);
 
-  g_timer_start (app->timer);
-
   app->decoder_thread = g_thread_try_new ("Decoder Thread", decoder_thread,
       app, NULL);
   if (!app->decoder_thread)
@@ -374,8 +405,6 @@ start_decoder (App * app)
 static gboolean
 stop_decoder (App * app)
 {
-  g_timer_stop (app->timer);
-
   g_atomic_int_set (&app->decoder_thread_cancel, TRUE);
   g_thread_join (app->decoder_thread);
   g_print ("Decoder thread stopped\n");
@@ -427,17 +456,22 @@ renderer_process (App * app, RenderFrame * rfp)
   if (!surface)
     SEND_ERROR ("failed to get decoded surface from render frame");
 
-  ensure_window_size (app, surface);
+  if (app->window)
+    ensure_window_size (app, surface);
 
   crop_rect = gst_vaapi_surface_proxy_get_crop_rect (rfp->proxy);
 
   if (!gst_vaapi_surface_sync (surface))
     SEND_ERROR ("failed to sync decoded surface");
 
-  if (G_LIKELY (!g_benchmark))
+  /* the benchmark measures the decoding, nothing is displayed */
+  if (g_benchmark)
+    bench_stats_add_frame (&app->stats, &g_bench_run, rfp->input_time,
+        g_get_monotonic_time ());
+  else
     renderer_wait_until (app, rfp->pts);
 
-  if (!gst_vaapi_window_put_surface (app->window, surface,
+  if (app->window && !gst_vaapi_window_put_surface (app->window, surface,
           crop_rect, NULL, GST_VAAPI_PICTURE_STRUCTURE_FRAME))
     SEND_ERROR ("failed to render surface %" GST_VAAPI_ID_FORMAT,
         GST_VAAPI_ID_ARGS (gst_vaapi_surface_get_id (surface)));
@@ -528,10 +562,7 @@ app_free (App * app)
     app->decoder_queue = NULL;
   }
 
-  if (app->timer) {
-    g_timer_destroy (app->timer);
-    app->timer = NULL;
-  }
+  bench_stats_clear (&app->stats);
 
   g_cond_clear (&app->render_ready);
   g_cond_clear (&app->event_cond);
@@ -561,9 +592,7 @@ app_new (void)
   if (!app->decoder_queue)
     goto error;
 
-  app->timer = g_timer_new ();
-  if (!app->timer)
-    goto error;
+  bench_stats_init (&app->stats);
   return app;
 
 error:
@@ -605,18 +634,9 @@ app_check_events (App * app)
 }
 
 static gboolean
-app_run (App * app, int argc, char *argv[])
+app_start (App * app, GstVaapiDisplay * display, const gchar * file_name)
 {
-  if (argc < 2) {
-    g_message ("no bitstream file specified");
-    return FALSE;
-  }
-  app->file_name = g_strdup (argv[1]);
-
-  if (!g_file_test (app->file_name, G_FILE_TEST_IS_REGULAR)) {
-    g_message ("failed to find file '%s'", app->file_name);
-    return FALSE;
-  }
+  app->file_name = g_strdup (file_name);
 
   app->codec = identify_codec (app->file_name);
   if (!app->codec) {
@@ -629,20 +649,18 @@ app_run (App * app, int argc, char *argv[])
 
   g_print ("Simple decoder (%s bitstream)\n", string_from_codec (app->codec));
 
-  app->display = video_output_create_display (NULL);
-  if (!app->display) {
-    g_message ("failed to create VA display");
-    return FALSE;
-  }
+  app->display = gst_object_ref (display);
 
-  app->window = video_output_create_window (app->display,
-      app->window_width, app->window_height);
-  if (!app->window) {
-    g_message ("failed to create window");
-    return FALSE;
-  }
+  if (!g_benchmark) {
+    app->window = video_output_create_window (app->display,
+        app->window_width, app->window_height);
+    if (!app->window) {
+      g_message ("failed to create window");
+      return FALSE;
+    }
 
-  gst_vaapi_window_show (app->window);
+    gst_vaapi_window_show (app->window);
+  }
 
   if (!start_decoder (app)) {
     g_message ("failed to start decoder thread");
@@ -653,39 +671,109 @@ app_run (App * app, int argc, char *argv[])
     g_message ("failed to start renderer thread");
     return FALSE;
   }
+  return TRUE;
+}
 
-  app_check_events (app);
+static gboolean
+app_stop (App * app, gboolean wait_events)
+{
+  gboolean success = TRUE;
 
-  stop_renderer (app);
-  stop_decoder (app);
+  if (wait_events)
+    success = app_check_events (app);
 
-  g_print ("Decoded %u frames", app->num_frames);
-  if (g_benchmark) {
-    const gdouble elapsed = g_timer_elapsed (app->timer, NULL);
-    g_print (" in %.2f sec (%.1f fps)\n",
-        elapsed, (gdouble) app->num_frames / elapsed);
+  if (app->render_thread)
+    stop_renderer (app);
+  if (app->decoder_thread)
+    stop_decoder (app);
+  return success;
+}
+
+static void
+print_benchmark_results (GPtrArray * apps)
+{
+  gdouble total_fps = 0;
+  gchar *name;
+  guint i;
+
+  for (i = 0; i < apps->len; i++) {
+    App *const app = g_ptr_array_index (apps, i);
+
+    name = g_strdup_printf ("decoder %u", i);
+    bench_stats_print (&app->stats, &g_bench_run, name);
+    total_fps += bench_stats_get_fps (&app->stats, &g_bench_run);
+    g_free (name);
   }
-  g_print ("\n");
-  return TRUE;
+  g_print ("total: %.1f fps over %u decoders\n", total_fps, apps->len);
+  bench_print_resources ();
 }
 
 int
 main (int argc, char *argv[])
 {
+  GstVaapiDisplay *display = NULL;
+  GPtrArray *apps;
   App *app;
-  gint ret;
+  gboolean success = FALSE;
+  guint i;
 
   if (!video_output_init (&argc, argv, g_options))
     g_error ("failed to initialize video output subsystem");
 
-  app = app_new ();
-  if (!app)
-    g_error ("failed to create application context");
+  apps = g_ptr_array_new_with_free_func ((GDestroyNotify) app_free);
 
-  ret = !app_run (app, argc, argv);
+  if (argc < 2) {
+    g_message ("no bitstream file specified");
+    goto done;
+  }
 
-  app_free (app);
+  if (!g_file_test (argv[1], G_FILE_TEST_IS_REGULAR)) {
+    g_message ("failed to find file '%s'", argv[1]);
+    goto done;
+  }
+
+  if (!g_benchmark) {
+    g_num_instances = 1;
+    g_duration = 0;
+  }
+
+  /* all the decoders share the same display */
+  display = video_output_create_display (NULL);
+  if (!display) {
+    g_message ("failed to create VA display");
+    goto done;
+  }
+
+  bench_run_init (&g_bench_run, g_warmup, g_duration);
+
+  success = TRUE;
+  for (i = 0; i < MAX (g_num_instances, 1); i++) {
+    app = app_new ();
+    if (!app)
+      g_error ("failed to create application context");
+    g_ptr_array_add (apps, app);
+
+    success = app_start (app, display, argv[1]);
+    if (!success)
+      break;
+  }
+
+  /* on failure, stop the decoders that were started */
+  for (i = 0; i < apps->len; i++) {
+    app = g_ptr_array_index (apps, i);
+    if (!app_stop (app, success))
+      success = FALSE;
+  }
+
+  if (success && g_benchmark)
+    print_benchmark_results (apps);
+  else if (success)
+    g_print ("Decoded %u frames\n", ((App *) apps->pdata[0])->num_frames);
+
+done:
+  g_ptr_array_unref (apps);
+  gst_vaapi_display_replace (&display, NULL);
   g_free (g_codec_str);
   video_output_exit ();
-  return ret;
+  return !success;
 }
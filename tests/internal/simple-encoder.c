@@ -25,16 +25,29 @@
 #include <gst/vaapi/gstvaapisurfacepool.h>
 #include <gst/vaapi/gstvaapisurfaceproxy.h>
 
+#include "benchstats.h"
 #include "output.h"
 #include "y4mreader.h"
 
 static guint g_bitrate = 0;
+static guint g_num_frames = 0;
+static gboolean g_loop = FALSE;
+static gboolean g_preload = FALSE;
+static gboolean g_benchmark = FALSE;
+static guint g_num_instances = 1;
+static guint g_duration = 0;
+static guint g_warmup = 0;
 static gchar *g_codec_str;
 static gchar *g_output_file_name;
 static char **g_input_files = NULL;
 
 #define SURFACE_NUM 16
 
+/* submission times kept for the frames in flight, in benchmark mode */
+#define SUBMIT_TIMES_NUM 256
+
+static BenchRun g_bench_run;
+
 static GOptionEntry g_options[] = {
   {"codec", 'c', 0, G_OPTION_ARG_STRING, &g_codec_str,
       "codec to use for video encoding (h264/mpeg2)", NULL},
@@ -42,6 +55,22 @@ static GOptionEntry g_options[] = {
       "desired bitrate expressed in kbps", NULL},
   {"output", 'o', 0, G_OPTION_ARG_FILENAME, &g_output_file_name,
       "output file name", NULL},
+  {"num-frames", 'n', 0, G_OPTION_ARG_INT, &g_num_frames,
+      "number of frames to encode, 0 for the whole input", NULL},
+  {"loop", 'l', 0, G_OPTION_ARG_NONE, &g_loop,
+      "loop the input file, up to --num-frames frames", NULL},
+  {"preload", 'p', 0, G_OPTION_ARG_NONE, &g_preload,
+      "upload the first frames once and feed them again, to measure the "
+      "encoder alone", NULL},
+  {"benchmark", 0, 0, G_OPTION_ARG_NONE, &g_benchmark,
+      "benchmark mode, nothing is written", NULL},
+  {"instances", 0, 0, G_OPTION_ARG_INT, &g_num_instances,
+      "number of encoders running in parallel, in benchmark mode", NULL},
+  {"duration", 0, 0, G_OPTION_ARG_INT, &g_duration,
+      "benchmark duration in seconds, looping the input "
+      "(0: encode it once)", NULL},
+  {"warmup", 0, 0, G_OPTION_ARG_INT, &g_warmup,
+      "seconds excluded from the benchmark results", NULL},
   {G_OPTION_REMAINING, ' ', 0, G_OPTION_ARG_FILENAME_ARRAY, &g_input_files,
       "input file name", NULL},
   {NULL}
@@ -56,6 +85,10 @@ typedef struct
   guint saved_frames;
   Y4MReader *parser;
   FILE *output_file;
+  gint64 elapsed;
+  BenchStats stats;
+  gint64 submit_times[SUBMIT_TIMES_NUM];
+  gboolean success;
   guint input_stopped:1;
   guint encode_failed:1;
 } App;
@@ -100,9 +133,22 @@ parse_options (int *argc, char *argv[])
     goto bail;
   }
 
+  if (!g_benchmark) {
+    g_num_instances = 1;
+    g_duration = 0;
+  } else if (g_duration) {
+    g_loop = TRUE;
+  }
+
+  if (g_loop && !g_num_frames && !g_duration) {
+    g_printerr ("Looping the input needs a number of frames to encode\n");
+    success = FALSE;
+    goto bail;
+  }
+
   if (!g_codec_str)
     g_codec_str = g_strdup ("h264");
-  if (!g_output_file_name)
+  if (!g_output_file_name && !g_benchmark)
     g_output_file_name = generate_output_filename (g_codec_str);
 
 bail:
@@ -119,7 +165,8 @@ print_yuv_info (App * app)
   g_print ("Source YUV  : %s\n", g_input_files ? g_input_files[0] : "stdin");
   g_print ("Frame Rate  : %0.1f fps\n",
       1.0 * app->parser->fps_n / app->parser->fps_d);
-  g_print ("Coded file  : %s\n", g_output_file_name);
+  if (g_output_file_name)
+    g_print ("Coded file  : %s\n", g_output_file_name);
   g_print ("\n");
 }
 
@@ -130,6 +177,9 @@ print_num_frame (App * app)
   g_print ("read frames    : %d\n", app->read_frames);
   g_print ("encoded frames : %d\n", app->encoded_frames);
   g_print ("saved frames   : %d\n", app->saved_frames);
+  if (app->elapsed > 0)
+    g_print ("encode rate    : %0.1f fps\n",
+        1.0 * app->encoded_frames * G_USEC_PER_SEC / app->elapsed);
   g_print ("\n");
 }
 
@@ -208,9 +258,11 @@ allocate_buffer (GstVaapiCodedBuffer * vbuf)
 }
 
 static GstVaapiEncoderStatus
-get_encoder_buffer (GstVaapiEncoder * encoder, GstBuffer ** buffer)
+get_encoder_buffer (GstVaapiEncoder * encoder, GstBuffer ** buffer,
+    guint32 * frame_number_ptr)
 {
   GstVaapiCodedBufferProxy *proxy = NULL;
+  GstVideoCodecFrame *frame;
   GstVaapiEncoderStatus status;
 
   status = gst_vaapi_encoder_get_buffer_with_timeout (encoder, &proxy, 50000);
@@ -222,6 +274,9 @@ get_encoder_buffer (GstVaapiEncoder * encoder, GstBuffer ** buffer)
   }
 
   *buffer = allocate_buffer (GST_VAAPI_CODED_BUFFER_PROXY_BUFFER (proxy));
+  frame = gst_vaapi_coded_buffer_proxy_get_user_data (proxy);
+  if (frame)
+    *frame_number_ptr = frame->system_frame_number;
   gst_vaapi_coded_buffer_proxy_unref (proxy);
 
   return status;
@@ -260,10 +315,11 @@ get_buffer_thread (gpointer data)
 
   GstVaapiEncoderStatus ret;
   GstBuffer *obuf;
+  guint32 frame_number = 0;
 
   while (1) {
     obuf = NULL;
-    ret = get_encoder_buffer (app->encoder, &obuf);
+    ret = get_encoder_buffer (app->encoder, &obuf, &frame_number);
     if (app->input_stopped && ret > GST_VAAPI_ENCODER_STATUS_SUCCESS) {
       break;                    /* finished */
     } else if (ret > GST_VAAPI_ENCODER_STATUS_SUCCESS) {        /* another chance */
@@ -277,6 +333,11 @@ get_buffer_thread (gpointer data)
     app->encoded_frames++;
     g_debug ("encoded frame %d, buffer = %p", app->encoded_frames, obuf);
 
+    if (g_benchmark)
+      bench_stats_add_frame (&app->stats, &g_bench_run,
+          app->submit_times[frame_number % SUBMIT_TIMES_NUM],
+          g_get_monotonic_time ());
+
     if (app->output_file && outputs_to_file (obuf, app->output_file))
       app->saved_frames++;
 
@@ -308,35 +369,43 @@ app_free (App * app)
   if (app->output_file)
     fclose (app->output_file);
 
+  bench_stats_clear (&app->stats);
   g_slice_free (App, app);
 }
 
 static App *
-app_new (const gchar * input_fn, const gchar * output_fn)
+app_new (GstVaapiDisplay * display, const gchar * input_fn,
+    const gchar * output_fn)
 {
   App *app = g_slice_new0 (App);
   if (!app)
     return NULL;
 
+  bench_stats_init (&app->stats);
+
   app->parser = y4m_reader_open (input_fn);
   if (!app->parser) {
     g_warning ("Could not parse input stream.");
     goto error;
   }
 
-  app->output_file = fopen (output_fn, "w");
-  if (app->output_file == NULL) {
-    g_warning ("Could not open file \"%s\" for writing: %s.", output_fn,
-        g_strerror (errno));
+  y4m_reader_set_loop (app->parser, g_loop);
+  if (g_loop && !app->parser->loop) {
+    g_warning ("Only regular files can be looped.");
     goto error;
   }
 
-  app->display = video_output_create_display (NULL);
-  if (!app->display) {
-    g_warning ("Could not create VA display.");
-    goto error;
+  if (output_fn) {
+    app->output_file = fopen (output_fn, "w");
+    if (app->output_file == NULL) {
+      g_warning ("Could not open file \"%s\" for writing: %s.", output_fn,
+          g_strerror (errno));
+      goto error;
+    }
   }
 
+  app->display = gst_object_ref (display);
+
   app->encoder = encoder_new (app->display);
   if (!app->encoder) {
     g_warning ("Could not create encoder.");
@@ -357,7 +426,7 @@ error:
 }
 
 static gboolean
-upload_frame (GstVaapiEncoder * encoder, GstVaapiSurfaceProxy * proxy)
+upload_frame (App * app, GstVaapiSurfaceProxy * proxy)
 {
   GstVideoCodecFrame *frame;
   GstVaapiEncoderStatus ret;
@@ -367,7 +436,11 @@ upload_frame (GstVaapiEncoder * encoder, GstVaapiSurfaceProxy * proxy)
       gst_vaapi_surface_proxy_ref (proxy),
       (GDestroyNotify) gst_vaapi_surface_proxy_unref);
 
-  ret = gst_vaapi_encoder_put_frame (encoder, frame);
+  frame->system_frame_number = app->read_frames;
+  app->submit_times[app->read_frames % SUBMIT_TIMES_NUM] =
+      g_get_monotonic_time ();
+
+  ret = gst_vaapi_encoder_put_frame (app->encoder, frame);
   return (ret == GST_VAAPI_ENCODER_STATUS_SUCCESS);
 }
 
@@ -387,12 +460,45 @@ load_frame (App * app, GstVaapiImage * image)
   return ret;
 }
 
+/* Uploads the image into a new surface from the pool */
+static GstVaapiSurfaceProxy *
+upload_image (GstVaapiVideoPool * pool, GstVaapiImage * image)
+{
+  GstVaapiSurfaceProxy *proxy;
+  GstVaapiSurface *surface;
+
+  proxy = gst_vaapi_surface_proxy_new_from_pool (GST_VAAPI_SURFACE_POOL (pool));
+  if (!proxy) {
+    g_warning ("Could not get surface proxy from pool.");
+    return NULL;
+  }
+  surface = gst_vaapi_surface_proxy_get_surface (proxy);
+  if (!surface) {
+    g_warning ("Could not get surface from proxy.");
+    goto error;
+  }
+
+  if (!gst_vaapi_surface_put_image (surface, image)) {
+    g_warning ("Could not update surface");
+    goto error;
+  }
+  return proxy;
+
+error:
+  gst_vaapi_surface_proxy_unref (proxy);
+  return NULL;
+}
+
 static int
 app_run (App * app)
 {
   GstVaapiImage *image;
   GstVaapiVideoPool *pool;
+  GstVaapiSurfaceProxy *preloaded[SURFACE_NUM];
   GThread *buffer_thread;
+  guint i, num_preloaded = 0;
+  gboolean input_done = FALSE;
+  gint64 start_time;
   gsize id;
   int ret = EXIT_FAILURE;
 
@@ -406,42 +512,58 @@ app_run (App * app)
     pool = gst_vaapi_surface_pool_new_full (app->display, &vi, 0);
   }
 
+  /* with --preload, the input is only read and uploaded here, and
+     the encoder is then fed with these surfaces over and over */
+  if (g_preload) {
+    while (num_preloaded < SURFACE_NUM && load_frame (app, image)) {
+      preloaded[num_preloaded] = upload_image (pool, image);
+      if (!preloaded[num_preloaded])
+        break;
+      num_preloaded++;
+    }
+  }
+
+  start_time = g_get_monotonic_time ();
   buffer_thread = g_thread_new ("get buffer thread", get_buffer_thread, app);
 
   while (1) {
     GstVaapiSurfaceProxy *proxy;
-    GstVaapiSurface *surface;
 
-    if (!load_frame (app, image))
-      break;
-
-    if (!gst_vaapi_image_unmap (image))
-      break;
-
-    proxy =
-        gst_vaapi_surface_proxy_new_from_pool (GST_VAAPI_SURFACE_POOL (pool));
-    if (!proxy) {
-      g_warning ("Could not get surface proxy from pool.");
+    if (g_num_frames && app->read_frames >= g_num_frames) {
+      input_done = TRUE;
       break;
     }
-    surface = gst_vaapi_surface_proxy_get_surface (proxy);
-    if (!surface) {
-      g_warning ("Could not get surface from proxy.");
+    if (g_benchmark && bench_run_is_done (&g_bench_run)) {
+      input_done = TRUE;
       break;
     }
 
-    if (!gst_vaapi_surface_put_image (surface, image)) {
-      g_warning ("Could not update surface");
-      break;
+    if (g_preload) {
+      if (!g_num_frames && !g_duration
+          && app->read_frames >= num_preloaded) {
+        input_done = num_preloaded > 0;
+        break;
+      }
+      proxy = gst_vaapi_surface_proxy_ref
+          (preloaded[app->read_frames % num_preloaded]);
+    } else {
+      if (!load_frame (app, image)) {
+        input_done = y4m_reader_is_eos (app->parser);
+        break;
+      }
+      proxy = upload_image (pool, image);
+      if (!proxy)
+        break;
     }
 
-    if (!upload_frame (app->encoder, proxy)) {
+    if (!upload_frame (app, proxy)) {
       g_warning ("put frame failed");
+      gst_vaapi_surface_proxy_unref (proxy);
       break;
     }
 
     app->read_frames++;
-    id = gst_vaapi_surface_get_id (surface);
+    id = gst_vaapi_surface_proxy_get_surface_id (proxy);
     g_debug ("input frame %d, surface id = %" G_GSIZE_FORMAT, app->read_frames,
         id);
 
@@ -451,18 +573,79 @@ app_run (App * app)
   app->input_stopped = TRUE;
 
   g_thread_join (buffer_thread);
+  app->elapsed = g_get_monotonic_time () - start_time;
 
-  if (!app->encode_failed && feof (app->parser->fp))
+  if (!app->encode_failed && input_done)
     ret = EXIT_SUCCESS;
 
+  for (i = 0; i < num_preloaded; i++)
+    gst_vaapi_surface_proxy_unref (preloaded[i]);
   gst_vaapi_video_pool_replace (&pool, NULL);
   gst_vaapi_image_unref (image);
   return ret;
 }
 
+static gpointer
+app_thread (gpointer data)
+{
+  App *const app = data;
+
+  app->success = (app_run (app) == EXIT_SUCCESS);
+  return NULL;
+}
+
+/* Runs the encoders in parallel, on the same display */
+static int
+run_benchmark (GstVaapiDisplay * display, const gchar * input_fn)
+{
+  GPtrArray *apps;
+  GThread **threads;
+  gdouble total_fps = 0;
+  int ret = EXIT_SUCCESS;
+  gchar *name;
+  guint i;
+
+  apps = g_ptr_array_new_with_free_func ((GDestroyNotify) app_free);
+  for (i = 0; i < g_num_instances; i++) {
+    App *const app = app_new (display, input_fn, NULL);
+    if (!app) {
+      g_ptr_array_unref (apps);
+      return EXIT_FAILURE;
+    }
+    g_ptr_array_add (apps, app);
+  }
+  print_yuv_info (g_ptr_array_index (apps, 0));
+
+  bench_run_init (&g_bench_run, g_warmup, g_duration);
+
+  threads = g_new0 (GThread *, apps->len);
+  for (i = 0; i < apps->len; i++)
+    threads[i] = g_thread_new ("encoder", app_thread, apps->pdata[i]);
+
+  for (i = 0; i < apps->len; i++) {
+    App *const app = g_ptr_array_index (apps, i);
+
+    g_thread_join (threads[i]);
+    if (!app->success)
+      ret = EXIT_FAILURE;
+
+    name = g_strdup_printf ("encoder %u", i);
+    bench_stats_print (&app->stats, &g_bench_run, name);
+    total_fps += bench_stats_get_fps (&app->stats, &g_bench_run);
+    g_free (name);
+  }
+  g_print ("total: %.1f fps over %u encoders\n", total_fps, apps->len);
+  bench_print_resources ();
+
+  g_free (threads);
+  g_ptr_array_unref (apps);
+  return ret;
+}
+
 int
 main (int argc, char *argv[])
 {
+  GstVaapiDisplay *display = NULL;
   App *app;
   int ret = EXIT_FAILURE;
   gchar *input_fn;
@@ -478,7 +661,18 @@ main (int argc, char *argv[])
     goto bail;
   }
 
-  app = app_new (input_fn, g_output_file_name);
+  display = video_output_create_display (NULL);
+  if (!display) {
+    g_warning ("Could not create VA display.");
+    goto bail;
+  }
+
+  if (g_benchmark) {
+    ret = run_benchmark (display, input_fn);
+    goto bail;
+  }
+
+  app = app_new (display, input_fn, g_output_file_name);
   if (!app)
     goto bail;
 
@@ -489,6 +683,7 @@ main (int argc, char *argv[])
   app_free (app);
 
 bail:
+  gst_vaapi_display_replace (&display, NULL);
   g_free (g_codec_str);
   g_free (g_output_file_name);
   g_strfreev (g_input_files);
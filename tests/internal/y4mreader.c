@@ -20,11 +20,18 @@
  */
 
 #include "gst/vaapi/sysdeps.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "y4mreader.h"
 
 /* format documentation:
  * http://wiki.multimedia.cx/index.php?title=YUV4MPEG2 */
 
+/* number of frames to prefetch ahead of the one being read, when the
+   input is memory-mapped */
+#define PREFETCH_FRAMES 4
+
 static inline gboolean
 parse_int (const gchar * str, guint * out_value_ptr)
 {
@@ -51,32 +58,49 @@ parse_int (const gchar * str, guint * out_value_ptr)
   return ret;
 }
 
+/* Reads a header line, without the terminating newline */
 static gboolean
-parse_header (Y4MReader * file)
+read_line (Y4MReader * file, guint8 line[BUFSIZ], guint * len_ptr)
 {
-  gint i, j, b;
-  guint8 header[BUFSIZ];
-  size_t s;
-  gchar *str;
-
-  memset (header, 0, BUFSIZ);
-  s = fread (header, 1, 9, file->fp);
-  if (s < 9)
-    return FALSE;
+  const guint8 *start, *end;
+  gint i, b;
 
-  if (memcmp (header, "YUV4MPEG2", 9) != 0)
-    return FALSE;
+  if (file->data) {
+    start = file->data + file->offset;
+    end = memchr (start, 0xa, MIN (file->data_size - file->offset,
+            BUFSIZ - 1));
+    if (!end)
+      return FALSE;
+    memcpy (line, start, end - start);
+    *len_ptr = end - start;
+    file->offset += end - start + 1;
+    return TRUE;
+  }
 
-  for (i = 9; i < BUFSIZ - 1; i++) {
+  for (i = 0; i < BUFSIZ - 1; i++) {
     b = fgetc (file->fp);
     if (b == EOF)
       return FALSE;
     if (b == 0xa)
       break;
-    header[i] = b;
+    line[i] = b;
   }
+  *len_ptr = i;
+  return (i < BUFSIZ - 1);
+}
 
-  if (i == BUFSIZ - 1)
+static gboolean
+parse_header (Y4MReader * file)
+{
+  guint i, j;
+  guint8 header[BUFSIZ];
+  gchar *str;
+
+  memset (header, 0, BUFSIZ);
+  if (!read_line (file, header, &i))
+    return FALSE;
+
+  if (i < 9 || memcmp (header, "YUV4MPEG2", 9) != 0)
     return FALSE;
 
   j = 9;
@@ -139,6 +163,54 @@ parse_header (Y4MReader * file)
   return TRUE;
 }
 
+/* Maps the whole file, so that frames are read without any copy.
+   Streams, e.g. pipes, are read through the FILE instead */
+static gboolean
+map_file (Y4MReader * file)
+{
+  struct stat st;
+  void *data;
+
+  if (fstat (fileno (file->fp), &st) < 0 || !S_ISREG (st.st_mode) ||
+      st.st_size <= 0)
+    return FALSE;
+
+  data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno (file->fp),
+      0);
+  if (data == MAP_FAILED)
+    return FALSE;
+
+  file->data = data;
+  file->data_size = st.st_size;
+  madvise (file->data, file->data_size, MADV_SEQUENTIAL);
+  return TRUE;
+}
+
+static inline gsize
+get_frame_size (Y4MReader * file)
+{
+  /* only valid for I420 */
+  return (gsize) file->width * file->height * 3 / 2;
+}
+
+/* Asks the kernel to read ahead the next frames, so that they are in
+   the page cache when the encoder gets to them */
+static void
+prefetch_frames (Y4MReader * file)
+{
+  const gsize page_size = sysconf (_SC_PAGESIZE);
+  gsize start, end;
+
+  end = MIN (file->offset + PREFETCH_FRAMES * get_frame_size (file),
+      file->data_size);
+  if (end <= file->prefetch_offset)
+    return;
+
+  start = MAX (file->offset, file->prefetch_offset) & ~(page_size - 1);
+  madvise (file->data + start, end - start, MADV_WILLNEED);
+  file->prefetch_offset = end;
+}
+
 Y4MReader *
 y4m_reader_open (const gchar * filename)
 {
@@ -152,6 +224,7 @@ y4m_reader_open (const gchar * filename)
       g_warning ("open file %s error", filename);
       goto bail;
     }
+    map_file (imagefile);
   } else {
     imagefile->fp = stdin;
   }
@@ -159,9 +232,15 @@ y4m_reader_open (const gchar * filename)
   if (!parse_header (imagefile))
     goto bail;
 
+  if (imagefile->width == 0 || imagefile->height == 0)
+    goto bail;
+
+  imagefile->frames_offset = imagefile->offset;
   return imagefile;
 
 bail:
+  if (imagefile->data)
+    munmap (imagefile->data, imagefile->data_size);
   if (imagefile->fp && imagefile->fp != stdin)
     fclose (imagefile->fp);
 
@@ -174,45 +253,144 @@ y4m_reader_close (Y4MReader * file)
 {
   g_return_if_fail (file);
 
+  if (file->data)
+    munmap (file->data, file->data_size);
   if (file->fp && file->fp != stdin)
     fclose (file->fp);
 
+  g_free (file->frame_buffer);
   g_slice_free (Y4MReader, file);
 }
 
+/* Restarts from the first frame once the last one was read, for
+   endless inputs. Only memory-mapped files can loop */
+void
+y4m_reader_set_loop (Y4MReader * file, gboolean loop)
+{
+  g_return_if_fail (file);
+
+  file->loop = loop && file->data;
+
+  /* the clip is read again, keep it in the page cache */
+  if (file->data)
+    madvise (file->data, file->data_size,
+        file->loop ? MADV_NORMAL : MADV_SEQUENTIAL);
+}
+
+gboolean
+y4m_reader_is_eos (Y4MReader * file)
+{
+  g_return_val_if_fail (file, TRUE);
+
+  return file->eos;
+}
+
 static gboolean
 skip_frame_header (Y4MReader * file)
 {
-  gint i, b;
   guint8 header[BUFSIZ];
-  size_t s;
+  guint len;
 
-  memset (header, 0, BUFSIZ);
-  s = fread (header, 1, 5, file->fp);
-  if (s < 5)
+  if (!read_line (file, header, &len))
     return FALSE;
 
-  if (memcmp (header, "FRAME", 5) != 0)
+  return (len >= 5 && memcmp (header, "FRAME", 5) == 0);
+}
+
+/* Gets a view of the next frame. For memory-mapped files it points
+   into the mapping, and remains valid until the reader is closed.
+   Otherwise the frame is read into a buffer owned by the reader */
+gboolean
+y4m_reader_get_frame (Y4MReader * file, Y4MFrame * frame)
+{
+  const gsize frame_size = get_frame_size (file);
+  const guint8 *base;
+
+  g_return_val_if_fail (file && file->fp, FALSE);
+  g_return_val_if_fail (frame, FALSE);
+
+  if (file->eos)
     return FALSE;
 
-  for (i = 5; i < BUFSIZ - 1; i++) {
-    b = fgetc (file->fp);
-    if (b == EOF)
-      return FALSE;
-    if (b == 0xa)
-      break;
-    header[i] = b;
+  if (file->data) {
+    if (file->loop && file->offset >= file->data_size &&
+        file->frames_offset < file->offset) {
+      file->offset = file->frames_offset;
+      file->prefetch_offset = 0;
+    }
+    if (file->offset >= file->data_size)
+      goto eos;
+    if (!skip_frame_header (file))
+      goto error;
+    if (file->data_size - file->offset < frame_size)
+      goto error;
+    base = file->data + file->offset;
+    file->offset += frame_size;
+    prefetch_frames (file);
+  } else {
+    if (!file->frame_buffer)
+      file->frame_buffer = g_malloc (frame_size);
+    if (!skip_frame_header (file))
+      goto eos;
+    if (fread (file->frame_buffer, 1, frame_size, file->fp) != frame_size)
+      goto error;
+    base = file->frame_buffer;
   }
 
-  return (i < BUFSIZ - 1);
+  frame->pitches[0] = file->width;
+  frame->pitches[1] = frame->pitches[2] = file->width / 2;
+  frame->planes[0] = base;
+  frame->planes[1] = frame->planes[0] + file->width * file->height;
+  frame->planes[2] = frame->planes[1] + frame->pitches[1] * file->height / 2;
+  return TRUE;
+
+  /* ERRORS */
+error:
+  {
+    g_warning ("truncated frame");
+    file->eos = TRUE;
+    return FALSE;
+  }
+eos:
+  {
+    file->eos = TRUE;
+    return FALSE;
+  }
+}
+
+/* Loads the next I420 frame into the supplied planes */
+gboolean
+y4m_reader_load_frame (Y4MReader * file, guint8 * planes[3],
+    const guint pitches[3])
+{
+  Y4MFrame frame;
+  const guint8 *src;
+  guint8 *dst;
+  guint width, height, i, j;
+
+  if (!y4m_reader_get_frame (file, &frame))
+    return FALSE;
+
+  for (i = 0; i < 3; i++) {
+    width = i == 0 ? file->width : file->width / 2;
+    height = i == 0 ? file->height : file->height / 2;
+    src = frame.planes[i];
+    dst = planes[i];
+    for (j = 0; j < height; j++) {
+      memcpy (dst, src, width);
+      src += frame.pitches[i];
+      dst += pitches[i];
+    }
+  }
+
+  return TRUE;
 }
 
 gboolean
 y4m_reader_load_image (Y4MReader * file, GstVaapiImage * image)
 {
-  guint8 *plane;
-  size_t s;
-  guint frame_size, stride, i;
+  guint8 *planes[3];
+  guint frame_size, pitches[3], i;
 
   g_return_val_if_fail (gst_vaapi_image_is_mapped (image), FALSE);
   g_return_val_if_fail (file && file->fp, FALSE);
@@ -224,38 +402,9 @@ y4m_reader_load_image (Y4MReader * file, GstVaapiImage * image)
   if (gst_vaapi_image_get_plane_count (image) != 3)
     return FALSE;
 
-  if (!skip_frame_header (file))
-    return FALSE;
-
-  /* Y plane */
-  plane = gst_vaapi_image_get_plane (image, 0);
-  stride = gst_vaapi_image_get_pitch (image, 0);
-  for (i = 0; i < file->height; i++) {
-    s = fread (plane, 1, file->width, file->fp);
-    if (s != file->width)
-      return FALSE;
-    plane += stride;
-  }
-
-  /* U plane */
-  plane = gst_vaapi_image_get_plane (image, 1);
-  stride = gst_vaapi_image_get_pitch (image, 1);
-  for (i = 0; i < file->height / 2; i++) {
-    s = fread (plane, 1, file->width / 2, file->fp);
-    if (s != file->width / 2)
-      return FALSE;
-    plane += stride;
-  }
-
-  /* V plane */
-  plane = gst_vaapi_image_get_plane (image, 2);
-  stride = gst_vaapi_image_get_pitch (image, 2);
-  for (i = 0; i < file->height / 2; i++) {
-    s = fread (plane, 1, file->width / 2, file->fp);
-    if (s != file->width / 2)
-      return FALSE;
-    plane += stride;
+  for (i = 0; i < 3; i++) {
+    planes[i] = gst_vaapi_image_get_plane (image, i);
+    pitches[i] = gst_vaapi_image_get_pitch (image, i);
   }
-
-  return TRUE;
+  return y4m_reader_load_frame (file, planes, pitches);
 }
@@ -24,6 +24,7 @@
 #include <gst/vaapi/gstvaapiimage.h>
 
 typedef struct _Y4MReader Y4MReader;
+typedef struct _Y4MFrame Y4MFrame;
 
 struct _Y4MReader
 {
@@ -32,10 +33,37 @@ struct _Y4MReader
   guint height;
   gint fps_n;
   gint fps_d;
+
+  /* regular files are memory-mapped, frames are views into the map */
+  guint8 *data;
+  gsize data_size;
+  gsize offset;                 /* offset of the next frame header */
+  gsize frames_offset;          /* offset of the first frame header */
+  gsize prefetch_offset;        /* end of the range already prefetched */
+
+  guint8 *frame_buffer;         /* frame storage for streamed input */
+  gboolean loop;
+  gboolean eos;
+};
+
+/* An I420 frame, valid at least until the next y4m_reader_get_frame() */
+struct _Y4MFrame
+{
+  const guint8 *planes[3];
+  guint pitches[3];
 };
 
 Y4MReader *y4m_reader_open (const gchar * filename);
 
 void y4m_reader_close (Y4MReader * file);
 
+void y4m_reader_set_loop (Y4MReader * file, gboolean loop);
+
+gboolean y4m_reader_is_eos (Y4MReader * file);
+
+gboolean y4m_reader_get_frame (Y4MReader * file, Y4MFrame * frame);
+
 gboolean y4m_reader_load_image (Y4MReader * file, GstVaapiImage * image);
+
+gboolean y4m_reader_load_frame (Y4MReader * file, guint8 * planes[3],
+    const guint pitches[3]);